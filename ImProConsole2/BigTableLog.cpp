@@ -0,0 +1,316 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "impro_util.h"
+#include "BigTableLog.h"
+
+using namespace std;
+
+// header of the binary log (followed by the yaml text, and records from headerBytes)
+struct BigTableLogHeader {
+	char    magic[8];     // "IMPROTBL"
+	int32_t version;      // 1
+	int32_t headerBytes;  // offset of the first record (64 + yaml, rounded up to 8)
+	int32_t nColumn;
+	int32_t recordBytes;  // sum of sizes of columns
+	int64_t yamlBytes;    // bytes of the yaml text after this header
+	char    reserved[32];
+};
+static_assert(sizeof(BigTableLogHeader) == 64, "BigTableLogHeader must be 64 bytes");
+static const char bigTableLogMagic[8] = { 'I', 'M', 'P', 'R', 'O', 'T', 'B', 'L' };
+static const int32_t bigTableLogVersion = 1;
+static const char * bigTableLogTypeNames[4] = { "i32", "i64", "f32", "f64" };
+static const int bigTableLogTypeBytes[4] = { 4, 8, 4, 8 };
+static const char * bigTableLogDefaultFormats[4] = { "%d, ", "%lld, ", "%16.9e, ", "%25.17e, " };
+
+// checks that a printf format has exactly one conversion (besides "%%"), which takes
+// the argument that formatRecord() passes for the column type: int (Int32), long long 
+// (Int64) or double (Float32, Float64). Widths and precisions must be digits (not '*').
+static bool bigTableLogFormatFits(const string & format, int type)
+{
+	int nConversion = 0;
+	for (size_t i = 0; i < format.length(); i++) {
+		if (format[i] != '%') continue;
+		i++;
+		if (i < format.length() && format[i] == '%') continue;
+		while (i < format.length() && strchr("-+ #0", format[i]) != NULL) i++;
+		while (i < format.length() && isdigit((unsigned char) format[i])) i++;
+		if (i < format.length() && format[i] == '.') {
+			i++;
+			while (i < format.length() && isdigit((unsigned char) format[i])) i++;
+		}
+		string length;
+		while (i < format.length() && strchr("hlLqjzt", format[i]) != NULL) length += format[i++];
+		if (i >= format.length()) return false;
+		char conversion = format[i];
+		bool fits;
+		if (type == BigTableLog::Int32)
+			fits = length.empty() && strchr("diouxX", conversion) != NULL;
+		else if (type == BigTableLog::Int64)
+			fits = length == "ll" && strchr("diouxX", conversion) != NULL;
+		else
+			fits = (length.empty() || length == "l") && strchr("eEfFgGaA", conversion) != NULL;
+		if (!fits) return false;
+		nConversion++;
+	}
+	return nConversion == 1;
+}
+
+BigTableLog::BigTableLog()
+{
+	fsMeta.open(".yml", cv::FileStorage::WRITE | cv::FileStorage::MEMORY);
+}
+
+BigTableLog::~BigTableLog()
+{
+	this->close();
+}
+
+void BigTableLog::addPreambleLine(const string & line)
+{
+	this->preamble.push_back(line);
+}
+
+void BigTableLog::addColumn(const string & name, int type, const string & format, const string & title)
+{
+	if (type < Int32 || type > Float64) type = Float64;
+	this->colNames.push_back(name);
+	this->colTypes.push_back(type);
+	if (bigTableLogFormatFits(format, type))
+		this->colFormats.push_back(format);
+	else {
+		cerr << "BigTableLog::addColumn(): Format \"" << format << "\" of column " << name 
+			<< " does not fit type " << bigTableLogTypeNames[type] << ". \"" 
+			<< bigTableLogDefaultFormats[type] << "\" is used.\n";
+		this->colFormats.push_back(bigTableLogDefaultFormats[type]);
+	}
+	this->colTitles.push_back(title);
+	this->colOffsets.push_back(this->recordBytes);
+	this->recordBytes += bigTableLogTypeBytes[type];
+}
+
+int BigTableLog::open(const string & fileName)
+{
+	this->close();
+	if (this->nColumn() <= 0) {
+		cerr << "BigTableLog::open(): No column is defined.\n";
+		return -1;
+	}
+	this->binary = fileName.length() >= 4 && fileName.compare(fileName.length() - 4, 4, ".bin") == 0;
+	// meta, preamble, and columns in yaml (the meta storage is closed here)
+	string yaml;
+	if (this->fsMeta.isOpened()) {
+		this->fsMeta << "preamble" << "[";
+		for (size_t i = 0; i < this->preamble.size(); i++)
+			this->fsMeta << this->preamble[i];
+		this->fsMeta << "]";
+		this->fsMeta << "columns" << "[";
+		for (int i = 0; i < this->nColumn(); i++)
+			this->fsMeta << "{" << "name" << this->colNames[i] << "type" << bigTableLogTypeNames[this->colTypes[i]]
+				<< "format" << this->colFormats[i] << "title" << this->colTitles[i] << "}";
+		this->fsMeta << "]";
+		yaml = this->fsMeta.releaseAndGetString();
+	}
+	errno_t err = fopen_s(&this->file, fileName.c_str(), this->binary ? "wb" : "w");
+	if (err != 0) {
+		cerr << "BigTableLog::open(): Cannot open " << fileName << " to write.\n";
+		this->file = NULL;
+		return -1;
+	}
+	this->fileName = fileName;
+	bool ok = true;
+	if (this->binary) {
+		BigTableLogHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, bigTableLogMagic, sizeof(header.magic));
+		header.version = bigTableLogVersion;
+		header.headerBytes = (int32_t) ((sizeof(header) + yaml.size() + 7) / 8 * 8);
+		header.nColumn = this->nColumn();
+		header.recordBytes = this->recordBytes;
+		header.yamlBytes = (int64_t) yaml.size();
+		vector<char> padding(header.headerBytes - sizeof(header) - yaml.size(), '\0');
+		ok = fwrite(&header, sizeof(header), 1, this->file) == 1;
+		ok = ok && fwrite(yaml.data(), 1, yaml.size(), this->file) == yaml.size();
+		ok = ok && fwrite(padding.data(), 1, padding.size(), this->file) == padding.size();
+	}
+	else {
+		string head;
+		for (size_t i = 0; i < this->preamble.size(); i++)
+			head += this->preamble[i] + "\n";
+		for (int i = 0; i < this->nColumn(); i++)
+			head += this->colTitles[i];
+		head += "\n";
+		ok = fwrite(head.data(), 1, head.size(), this->file) == head.size();
+	}
+	ok = (fflush(this->file) == 0) && ok;
+	if (!ok) {
+		cerr << "BigTableLog::open(): Failed to write " << fileName << ".\n";
+		fclose(this->file);
+		this->file = NULL;
+		return -1;
+	}
+	this->record.assign(this->recordBytes, 0);
+	this->iPut = 0;
+	return 0;
+}
+
+void BigTableLog::put(double v)
+{
+	if (this->iPut < this->nColumn() && this->record.size() == (size_t) this->recordBytes) {
+		unsigned char * p = this->record.data() + this->colOffsets[this->iPut];
+		switch (this->colTypes[this->iPut]) {
+		case Int32:   { int32_t x = (int32_t) v; memcpy(p, &x, sizeof(x)); break; }
+		case Int64:   { int64_t x = (int64_t) v; memcpy(p, &x, sizeof(x)); break; }
+		case Float32: { float x = (float) v; memcpy(p, &x, sizeof(x)); break; }
+		default:      { memcpy(p, &v, sizeof(v)); break; }
+		}
+	}
+	this->iPut++;
+}
+
+void BigTableLog::put(int64_t v)
+{
+	if (this->iPut < this->nColumn() && this->record.size() == (size_t) this->recordBytes) {
+		unsigned char * p = this->record.data() + this->colOffsets[this->iPut];
+		switch (this->colTypes[this->iPut]) {
+		case Int32:   { int32_t x = (int32_t) v; memcpy(p, &x, sizeof(x)); break; }
+		case Int64:   { memcpy(p, &v, sizeof(v)); break; }
+		case Float32: { float x = (float) v; memcpy(p, &x, sizeof(x)); break; }
+		default:      { double x = (double) v; memcpy(p, &x, sizeof(x)); break; }
+		}
+	}
+	this->iPut++;
+}
+
+void BigTableLog::formatRecord(string & text) const
+{
+	char buf[256];
+	text.clear();
+	for (int i = 0; i < this->nColumn(); i++) {
+		const unsigned char * p = this->record.data() + this->colOffsets[i];
+		const char * fmt = this->colFormats[i].c_str();
+		switch (this->colTypes[i]) {
+		case Int32:   { int32_t x; memcpy(&x, p, sizeof(x)); snprintf(buf, sizeof(buf), fmt, (int) x); break; }
+		case Int64:   { int64_t x; memcpy(&x, p, sizeof(x)); snprintf(buf, sizeof(buf), fmt, (long long) x); break; }
+		case Float32: { float x; memcpy(&x, p, sizeof(x)); snprintf(buf, sizeof(buf), fmt, (double) x); break; }
+		default:      { double x; memcpy(&x, p, sizeof(x)); snprintf(buf, sizeof(buf), fmt, x); break; }
+		}
+		text += buf;
+	}
+}
+
+int BigTableLog::writeRecord()
+{
+	if (this->file == NULL) return -1;
+	if (this->iPut != this->nColumn()) {
+		cerr << "BigTableLog::writeRecord(): " << this->iPut << " values are put to a record of "
+			<< this->nColumn() << " columns (" << this->fileName << ").\n";
+		this->iPut = 0;
+		return -1;
+	}
+	this->iPut = 0;
+	bool ok;
+	if (this->binary)
+		ok = fwrite(this->record.data(), this->record.size(), 1, this->file) == 1;
+	else {
+		this->formatRecord(this->text);
+		this->text += "\n";
+		ok = fwrite(this->text.data(), 1, this->text.size(), this->file) == this->text.size();
+	}
+	ok = (fflush(this->file) == 0) && ok;
+	if (!ok) {
+		cerr << "BigTableLog::writeRecord(): Failed to write " << this->fileName << ".\n";
+		return -1;
+	}
+	return 0;
+}
+
+int BigTableLog::close()
+{
+	if (this->file == NULL) return 0;
+	int ret = fclose(this->file) == 0 ? 0 : -1;
+	this->file = NULL;
+	return ret;
+}
+
+int BigTableLog::toCsv(const string & fileLog, const string & fileCsv)
+{
+	FILE * fLog;
+	if (fopen_s(&fLog, fileLog.c_str(), "rb") != 0) {
+		cerr << "BigTableLog::toCsv(): Cannot open " << fileLog << ".\n";
+		return -1;
+	}
+	BigTableLogHeader header;
+	bool ok = fread(&header, sizeof(header), 1, fLog) == 1 &&
+		memcmp(header.magic, bigTableLogMagic, sizeof(header.magic)) == 0 &&
+		header.version == bigTableLogVersion && header.nColumn > 0 && header.yamlBytes > 0 &&
+		header.headerBytes >= (int64_t) sizeof(header) + header.yamlBytes;
+	string yaml;
+	if (ok) {
+		yaml.resize((size_t) header.yamlBytes);
+		ok = fread(&yaml[0], 1, yaml.size(), fLog) == yaml.size();
+	}
+	if (!ok) {
+		cerr << "BigTableLog::toCsv(): " << fileLog << " is not a big table log (or is of another version).\n";
+		fclose(fLog);
+		return -1;
+	}
+	// columns and preamble of the log (as a text-mode BigTableLog)
+	BigTableLog table;
+	cv::FileStorage fs(yaml, cv::FileStorage::READ | cv::FileStorage::MEMORY);
+	cv::FileNode pre = fs["preamble"];
+	for (cv::FileNodeIterator it = pre.begin(); it != pre.end(); ++it)
+		table.addPreambleLine((string) *it);
+	cv::FileNode cols = fs["columns"];
+	for (cv::FileNodeIterator it = cols.begin(); it != cols.end(); ++it) {
+		string typeName = (string) (*it)["type"];
+		int type = -1;
+		for (int t = Int32; t <= Float64; t++)
+			if (typeName == bigTableLogTypeNames[t]) type = t;
+		if (type < 0) break;
+		table.addColumn((string) (*it)["name"], type, (string) (*it)["format"], (string) (*it)["title"]);
+	}
+	if (table.nColumn() != header.nColumn || table.recordBytes != header.recordBytes) {
+		cerr << "BigTableLog::toCsv(): Columns of " << fileLog << " are broken.\n";
+		fclose(fLog);
+		return -1;
+	}
+	if (table.open(fileCsv) != 0 || table.isBinary()) {
+		if (table.isBinary())
+			cerr << "BigTableLog::toCsv(): " << fileCsv << " is not a csv file name.\n";
+		table.close();
+		fclose(fLog);
+		return -1;
+	}
+	// records, in blocks (a partial record at the end, being written, is not converted)
+	fseek(fLog, header.headerBytes, SEEK_SET);
+	const int nBlock = 4096;
+	vector<unsigned char> block((size_t) nBlock * header.recordBytes);
+	string text, line;
+	int nRecord = 0;
+	while (ok) {
+		size_t n = fread(block.data(), header.recordBytes, nBlock, fLog);
+		text.clear();
+		for (size_t i = 0; i < n; i++) {
+			memcpy(table.record.data(), block.data() + i * header.recordBytes, header.recordBytes);
+			table.formatRecord(line);
+			text += line;
+			text += "\n";
+		}
+		ok = fwrite(text.data(), 1, text.size(), table.file) == text.size();
+		nRecord += (int) n;
+		if (n < (size_t) nBlock) break;
+	}
+	fclose(fLog);
+	if (table.close() != 0 || !ok) {
+		cerr << "BigTableLog::toCsv(): Failed to write " << fileCsv << ".\n";
+		return -1;
+	}
+	return nRecord;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+//! BigTableLog writes a big table (one record per step, fixed columns) as a csv text file
+//! or as a columnar binary log that can be converted to the same csv text later.
+/*!
+\details Columns are defined before open() by addColumn(), each with a type, a printf
+format of a value (including the separator, e.g., "%16.9e, ") and a title in the header
+line of the csv text (e.g., "   RefPnt2f[0].x, "). Settings of the analysis (intrinsics,
+extrinsics, points, tracking options) can be written to meta() (a cv::FileStorage in
+memory), and preamble lines are the lines before the header line of the csv text.
+    BigTableLog log;
+    log.meta() << "cameraMatrix" << cmat;
+    log.addPreambleLine("winSize: , 32");
+    log.addColumn("Step", BigTableLog::Int32, "%7d, ", " Step , ");
+    log.addColumn("ux", BigTableLog::Float64, "%25.17e, ", "  ux, ");
+    log.open("bigTable.bin");                 // or "bigTable.csv" for text
+    for each step:
+        log.put(iStep); log.put(ux);          // all columns, in order
+        log.writeRecord();                    // one buffered write per record
+    log.close();
+    BigTableLog::toCsv("bigTable.bin", "bigTable.csv");
+Binary log: a 64-byte header (magic "IMPROTBL", version, offset of records, number of
+columns, bytes of a record, bytes of the yaml text), a yaml text (meta, preamble and
+columns, by cv::FileStorage), and fixed-size records of packed values (in the byte order
+of the writer). Every record is flushed, so a crash loses at most the record being
+written, and the log can be read (converted) while it grows.
+*/
+class BigTableLog
+{
+public:
+	enum ColumnType { Int32 = 0, Int64 = 1, Float32 = 2, Float64 = 3 };
+
+	BigTableLog();
+	~BigTableLog();
+	BigTableLog(const BigTableLog &) = delete;
+	BigTableLog & operator=(const BigTableLog &) = delete;
+
+	//! settings of the analysis (stored in the header of the binary log). Write before open().
+	cv::FileStorage & meta() { return fsMeta; }
+	//! adds a line (without newline) before the header line of the csv text. Before open().
+	void addPreambleLine(const std::string & line);
+	//! adds a column. Before open(). A format must have exactly one conversion, which fits
+	//! the type (e.g., "%7d, " for Int32, "%lld" for Int64, "%16.9e, " for Float32 or Float64),
+	//! otherwise a default format of the type is used.
+	void addColumn(const std::string & name, int type, const std::string & format, const std::string & title);
+	int nColumn() const { return (int) colNames.size(); }
+
+	//! creates fileName and writes the header. Files ending with .bin are binary logs,
+	//! and others are csv text files.
+	//! \return 0:success. -1:cannot open the file or no column.
+	int open(const std::string & fileName);
+	bool isOpen() const { return file != NULL; }
+	bool isBinary() const { return binary; }
+
+	//! puts the value of the next column of the record
+	void put(double v);
+	void put(float v) { put((double) v); }
+	void put(int64_t v);
+	void put(int v) { put((int64_t) v); }
+	//! writes the record (all columns must have been put) and starts the next one
+	//! \return 0:success. -1:not open, wrong number of values, or failed to write.
+	int writeRecord();
+	int close();
+
+	//! converts a binary log to the csv text that BigTableLog writes in text mode
+	//! \return number of records converted, or -1 if fileLog is not a valid log
+	static int toCsv(const std::string & fileLog, const std::string & fileCsv);
+
+protected:
+	void formatRecord(std::string & text) const;
+
+	cv::FileStorage fsMeta;
+	std::vector<std::string> preamble;
+	std::vector<std::string> colNames, colFormats, colTitles;
+	std::vector<int> colTypes, colOffsets;
+	int recordBytes = 0;
+	std::vector<unsigned char> record; // values of the record being put
+	int iPut = 0;                      // column of the next put()
+	std::string text;                  // (buffer of formatted record of text mode)
+	FILE * file = NULL;
+	bool binary = false;
+	std::string fileName;
+};
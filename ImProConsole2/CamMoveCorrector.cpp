@@ -43,26 +43,29 @@ int CamMoveCorrector::correctImgMoved()
 	// Check if there are fixed point
 	if (this->fixedPoints.size() > 0)
 	{
-		cv::Mat imgFixedSobel; 
 		cv::Mat imgMovedSobel;
+		LkPyramid pyrMoved;
+		cv::Size winSize(61, 61);
+		int maxLevel = 3;
 		// correct image: 
 		// compare imgFixed and imgOri
 		vector<cv::Point2f> fixedPointsMoved = this->fixedPoints; 
 		vector<uchar> optStatus(this->fixedPoints.size());
 		vector<float> optError(this->fixedPoints.size());
-		imgFixedSobel = sobel_xy(imgFixed); 
+		// fixed image pyramid is built only when imgFixed changes
+		if (pyrFixed.empty() || imgFixedOfPyr.data != imgFixed.data || imgFixedOfPyr.size() != imgFixed.size()) {
+			pyrFixed.build(sobel_xy(imgFixed), winSize, maxLevel);
+			imgFixedOfPyr = imgFixed;
+		}
 		imgMovedSobel = sobel_xy(imgMoved);
-		cout << imgFixedSobel.type() << endl;
-		cout << imgMovedSobel.type() << endl;
-		cout << imgFixedSobel.channels() << endl;
-		cout << imgMovedSobel.channels() << endl;
-		cv::calcOpticalFlowPyrLK(imgFixedSobel, imgMovedSobel,
+		pyrMoved.build(imgMovedSobel, winSize, maxLevel, false);
+		cv::calcOpticalFlowPyrLK(pyrFixed.levels(), pyrMoved.levels(),
 			this->fixedPoints, // points which are supposed to be fixed
 			fixedPointsMoved,
 			optStatus,
 			optError,
-			cv::Size(61, 61),
-			3 /* max level */,
+			winSize,
+			maxLevel,
 			cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 50 /* ecc max count */, 0.001 /* eps */)) ; 
 			
 			
@@ -84,6 +87,12 @@ int CamMoveCorrector::correctImgMoved()
 	return 0; 
 }
 
+void CamMoveCorrector::reset()
+{
+	pyrFixed.clear();
+	imgFixedOfPyr.release();
+}
+
 
 
 
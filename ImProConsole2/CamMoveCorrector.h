@@ -1,5 +1,6 @@
 #pragma once
 #include <opencv2/opencv.hpp>
+#include "LkPyramid.h"
 
 // CamMoveCorrector a;
 // a.imgFixed = imgInit;  // assign initial (unmoved) image
@@ -16,11 +17,19 @@ public:
 
 	int correctImgMoved(); // This function updates imgMoved, making it unmoved (which movedPoints moves to fixedPoints)
 
+	void reset(); // This function discards the pyramid of imgFixed. Call it if imgFixed is modified in place.
+
 	std::vector<cv::Point2f> fixedPoints;
 	std::vector<cv::Point2f> movedPoints;
 
 	cv::Mat imgFixed;
 	cv::Mat imgMoved; 
+
+protected:
+	// optical-flow pyramid of Sobel image of imgFixed, kept across calls until imgFixed
+	// is assigned another image. (If imgFixed is modified in place, call reset().)
+	cv::Mat imgFixedOfPyr; // header of imgFixed which pyrFixed is built from
+	LkPyramid pyrFixed;
 };
 
 
@@ -0,0 +1,150 @@
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+#include "impro_util.h"
+#include "ChunkedTable.h"
+
+using namespace std;
+
+// moves the position of an open file (64-bit, also on Windows)
+static int seek64(FILE * file, int64_t offset)
+{
+#if defined(_WIN32)
+	return _fseeki64(file, offset, SEEK_SET);
+#else
+	return fseeko(file, (off_t) offset, SEEK_SET);
+#endif
+}
+
+ChunkedTable::ChunkedTable()
+{
+}
+
+ChunkedTable::~ChunkedTable()
+{
+	this->close();
+}
+
+int ChunkedTable::rowsOfChunkBytes(int nCols, double chunkBytes)
+{
+	double rowBytes = std::max(nCols, 1) * (double) sizeof(float);
+	return std::max(16, (int) std::min(chunkBytes / rowBytes, 1e9));
+}
+
+int ChunkedTable::create(int _nRows, int _nCols, int _chunkRows, const string & _spillFile)
+{
+	this->close();
+	if (_nRows <= 0 || _nCols <= 0 || _chunkRows < 0) {
+		cerr << "ChunkedTable::create(): Invalid size " << _nRows << " x " << _nCols << ".\n";
+		return -1;
+	}
+	if (_spillFile.length() > 0) {
+		errno_t err = fopen_s(&this->spill, _spillFile.c_str(), "w+b");
+		if (err != 0) {
+			cerr << "ChunkedTable::create(): Cannot create spill file " << _spillFile << ".\n";
+			this->spill = NULL;
+			return -1;
+		}
+		this->spillFile = _spillFile;
+	}
+	this->nRows = _nRows;
+	this->nCols = _nCols;
+	this->nChunkRows = _chunkRows > 0 ? _chunkRows : rowsOfChunkBytes(_nCols);
+	this->nChunkRows = std::min(this->nChunkRows, _nRows);
+	this->spilled.assign(this->nChunks(), false);
+	this->resIdx.push_back(0);
+	this->resMat.push_back(cv::Mat::zeros(this->nChunkRows, this->nCols, CV_32F));
+	return 0;
+}
+
+int ChunkedTable::rowsOfChunk(int iChunk) const
+{
+	return std::min(this->nChunkRows, this->nRows - iChunk * this->nChunkRows);
+}
+
+float * ChunkedTable::rowPtr(int iRow)
+{
+	if (iRow < 0 || iRow >= this->nRows)
+		CV_Error(cv::Error::StsOutOfRange, "ChunkedTable: row is out of range.");
+	int iChunk = iRow / this->nChunkRows;
+	int iInChunk = iRow - iChunk * this->nChunkRows;
+	for (size_t i = 0; i < this->resIdx.size(); i++)
+		if (this->resIdx[i] == iChunk)
+			return this->resMat[i].ptr<float>(iInChunk);
+	if (iChunk < this->resIdx.back())
+		CV_Error(cv::Error::StsOutOfRange, "ChunkedTable: row has been released.");
+	// a new chunk: keeps the first and the two latest chunks, spills and releases others
+	this->resIdx.push_back(iChunk);
+	this->resMat.push_back(cv::Mat::zeros(this->nChunkRows, this->nCols, CV_32F));
+	while (this->resIdx.size() > 3) {
+		this->spillChunk(this->resIdx[1], this->resMat[1]);
+		this->resIdx.erase(this->resIdx.begin() + 1);
+		this->resMat.erase(this->resMat.begin() + 1);
+	}
+	return this->resMat.back().ptr<float>(iInChunk);
+}
+
+cv::Mat ChunkedTable::row(int iRow)
+{
+	return cv::Mat(1, this->nCols, CV_32F, this->rowPtr(iRow));
+}
+
+int ChunkedTable::spillChunk(int iChunk, const cv::Mat & chunk)
+{
+	if (this->spill == NULL)
+		return -1;
+	size_t bytes = (size_t) this->rowsOfChunk(iChunk) * this->nCols * sizeof(float);
+	int64_t offset = (int64_t) iChunk * this->nChunkRows * this->nCols * (int64_t) sizeof(float);
+	bool ok = seek64(this->spill, offset) == 0 && fwrite(chunk.data, 1, bytes, this->spill) == bytes;
+	if (!ok) {
+		cerr << "ChunkedTable: Failed to write chunk " << iChunk << " to " << this->spillFile << ".\n";
+		return -1;
+	}
+	this->spilled[iChunk] = true;
+	return 0;
+}
+
+int ChunkedTable::readChunk(int iChunk, cv::Mat & rowsOut)
+{
+	if (iChunk < 0 || iChunk >= this->nChunks())
+		return -1;
+	int n = this->rowsOfChunk(iChunk);
+	for (size_t i = 0; i < this->resIdx.size(); i++)
+		if (this->resIdx[i] == iChunk) {
+			rowsOut = this->resMat[i].rowRange(0, n);
+			return 0;
+		}
+	if (this->spill == NULL || this->spilled[iChunk] == false) {
+		cerr << "ChunkedTable::readChunk(): Chunk " << iChunk << " was released and is not in a spill file.\n";
+		return -1;
+	}
+	rowsOut.create(n, this->nCols, CV_32F);
+	size_t bytes = (size_t) n * this->nCols * sizeof(float);
+	int64_t offset = (int64_t) iChunk * this->nChunkRows * this->nCols * (int64_t) sizeof(float);
+	fflush(this->spill);
+	bool ok = seek64(this->spill, offset) == 0 && fread(rowsOut.data, 1, bytes, this->spill) == bytes;
+	if (!ok) {
+		cerr << "ChunkedTable::readChunk(): Failed to read chunk " << iChunk << " from " << this->spillFile << ".\n";
+		return -1;
+	}
+	return 0;
+}
+
+void ChunkedTable::close()
+{
+	if (this->spill != NULL) {
+		fclose(this->spill);
+		this->spill = NULL;
+		std::remove(this->spillFile.c_str());
+	}
+	this->spillFile = "";
+	this->resIdx.clear();
+	this->resMat.clear();
+	this->spilled.clear();
+	this->nRows = this->nCols = this->nChunkRows = 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+//! ChunkedTable is a big table of floats (nRows x nCols, a row per step) kept in memory
+//! as fixed-size chunks of rows, of which only a few are resident at a time.
+/*!
+\details Rows are filled in increasing order (e.g., a row per frame of tracking). The first
+chunk and the two latest chunks are resident, so that the first row and the previous
+row(s) of the current one are always accessible. When a row of a new chunk is accessed,
+older chunks are written to a binary spill file (at their offsets, chunk by chunk) and
+released, so the memory does not depend on the number of rows.
+After all rows are filled, the whole table can be read back chunk by chunk (readChunk()),
+e.g., to write a summary of all steps by streaming. If no spill file is given, released
+chunks are discarded, and only resident chunks can be read back.
+    ChunkedTable table;
+    table.create(nFrame, nCol, 1024, "summary.txt.chunks.bin");
+    for each frame:
+        table.at(iFrame, 0) = ...;              // rows of the current (and previous) chunks
+        table.row(iFrame).copyTo(...);
+    cv::Mat rows;
+    for (int iChunk = 0; iChunk < table.nChunks(); iChunk++) {
+        table.readChunk(iChunk, rows);          // rows.rows <= chunkRows
+        ...
+    }
+    table.close();                              // removes the spill file
+Rows of a new chunk must first be accessed by a single thread (e.g., before a parallel
+loop over points), as that moves the resident chunks. Accessing resident rows from
+multiple threads is safe.
+*/
+class ChunkedTable
+{
+public:
+	ChunkedTable();
+	~ChunkedTable();
+	ChunkedTable(const ChunkedTable &) = delete;
+	ChunkedTable & operator=(const ChunkedTable &) = delete;
+
+	//! creates a table of zeros.
+	//! \param chunkRows number of rows of a chunk (0: chosen by rowsOfChunkBytes())
+	//! \param spillFile binary file to which released chunks are written (empty: discarded).
+	//!        It is created (overwritten), and removed by close().
+	//! \return 0: success. -1: invalid size or cannot create the spill file.
+	int create(int nRows, int nCols, int chunkRows = 0, const std::string & spillFile = "");
+	//! number of rows of a chunk of about chunkBytes (at least 16 rows)
+	static int rowsOfChunkBytes(int nCols, double chunkBytes = 64. * 1024 * 1024);
+
+	int rows() const { return nRows; }
+	int cols() const { return nCols; }
+	int chunkRows() const { return nChunkRows; }
+	int nChunks() const { return nChunkRows > 0 ? (nRows + nChunkRows - 1) / nChunkRows : 0; }
+
+	//! element of a resident row, or of a row of a new chunk (which becomes resident).
+	//! Throws cv::Exception if the row has been released.
+	float & at(int iRow, int iCol) { return rowPtr(iRow)[iCol]; }
+	//! a row (1 x nCols, CV_32F) sharing the data of the chunk
+	cv::Mat row(int iRow);
+
+	//! reads rows of a chunk (from memory if resident, otherwise from the spill file)
+	//! \return 0: success. -1: out of range, or the chunk was released and not spilled.
+	int readChunk(int iChunk, cv::Mat & rowsOut);
+
+	//! releases all chunks and removes the spill file
+	void close();
+
+protected:
+	float * rowPtr(int iRow);
+	int spillChunk(int iChunk, const cv::Mat & chunk);
+	int rowsOfChunk(int iChunk) const;
+
+	int nRows = 0, nCols = 0, nChunkRows = 0;
+	std::vector<int> resIdx;      // indices of resident chunks (the first, and the latest ones)
+	std::vector<cv::Mat> resMat;  // resident chunks (chunkRows x nCols, CV_32F)
+	std::vector<bool> spilled;    // chunks written to the spill file
+	std::string spillFile;
+	FILE * spill = NULL;
+};
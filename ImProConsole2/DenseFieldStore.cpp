@@ -0,0 +1,544 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+#include "impro_util.h"
+#include "DenseFieldStore.h"
+
+using namespace std;
+
+// header of a store (followed by the yaml text, and chunks from headerBytes)
+struct DenseFieldStoreHeader {
+	char    magic[8];     // "IMPRODFS"
+	int32_t version;      // 1
+	int32_t headerBytes;  // offset of the first chunk (64 + yaml, rounded up to 8)
+	int32_t nPoints;
+	int32_t chunkFrames;
+	int32_t nFrames;      // frames stored (0 if not closed)
+	int32_t nChunks;      // chunks in the index (0 if not closed)
+	int64_t indexOffset;  // offset of the index of chunks (0 if not closed)
+	int64_t yamlBytes;    // bytes of the yaml text after this header
+	char    reserved[16];
+};
+static_assert(sizeof(DenseFieldStoreHeader) == 64, "DenseFieldStoreHeader must be 64 bytes");
+
+// header of a chunk (followed by bytes of data)
+struct DenseFieldChunkHeader {
+	char    magic[4];     // "DFSC"
+	int32_t codec;
+	int32_t firstFrame;
+	int32_t nFrames;
+	int64_t bytes;
+};
+static_assert(sizeof(DenseFieldChunkHeader) == 24, "DenseFieldChunkHeader must be 24 bytes");
+
+static const char denseFieldStoreMagic[8] = { 'I', 'M', 'P', 'R', 'O', 'D', 'F', 'S' };
+static const char denseFieldChunkMagic[4] = { 'D', 'F', 'S', 'C' };
+static const int32_t denseFieldStoreVersion = 1;
+
+// moves the position of an open file (64-bit, also on Windows)
+static int seek64(FILE * file, int64_t offset, int origin = SEEK_SET)
+{
+#if defined(_WIN32)
+	return _fseeki64(file, offset, origin);
+#else
+	return fseeko(file, (off_t) offset, origin);
+#endif
+}
+
+// size of an open file (64-bit, also on Windows). The position is moved to the end.
+static int64_t fileSize64(FILE * file)
+{
+	seek64(file, 0, SEEK_END);
+#if defined(_WIN32)
+	return (int64_t) _ftelli64(file);
+#else
+	return (int64_t) ftello(file);
+#endif
+}
+
+// XorShuffleRle encoding of nFrames frames (raw) of frameBytes bytes each: each 32-bit word
+// is XORed with the word of the previous frame, bytes of words are shuffled into 4 planes,
+// and the planes are coded by runs: a control byte c < 128 is followed by c + 1 literal
+// bytes, and c >= 128 stands for c - 127 zero bytes.
+static void encodeXorShuffleRle(const unsigned char * raw, int nFrames, size_t frameBytes, vector<unsigned char> & out)
+{
+	size_t wordsPerFrame = frameBytes / 4, nWords = wordsPerFrame * nFrames;
+	vector<uint32_t> words(nWords);
+	memcpy(words.data(), raw, nWords * 4);
+	for (size_t i = nWords; i-- > wordsPerFrame; )
+		words[i] ^= words[i - wordsPerFrame];
+	vector<unsigned char> planes(nWords * 4);
+	for (int b = 0; b < 4; b++)
+		for (size_t i = 0; i < nWords; i++)
+			planes[b * nWords + i] = (unsigned char) (words[i] >> (8 * b));
+	out.clear();
+	out.reserve(planes.size() / 2);
+	size_t n = planes.size();
+	for (size_t i = 0; i < n; ) {
+		size_t j = i;
+		if (planes[i] == 0) {
+			while (j < n && j - i < 128 && planes[j] == 0) j++;
+			out.push_back((unsigned char) (127 + (j - i)));
+		}
+		else {
+			// literals until a run of (at least 2) zeros
+			while (j < n && j - i < 128 && !(planes[j] == 0 && (j + 1 >= n || planes[j + 1] == 0))) j++;
+			out.push_back((unsigned char) (j - i - 1));
+			out.insert(out.end(), planes.begin() + i, planes.begin() + j);
+		}
+		i = j;
+	}
+}
+
+// decodes XorShuffleRle data of nFrames frames to raw. Returns false if the data are broken.
+static bool decodeXorShuffleRle(const unsigned char * data, size_t bytes, int nFrames, size_t frameBytes, unsigned char * raw)
+{
+	size_t wordsPerFrame = frameBytes / 4, nWords = wordsPerFrame * nFrames;
+	vector<unsigned char> planes(nWords * 4);
+	size_t n = planes.size(), k = 0;
+	for (size_t i = 0; i < bytes; ) {
+		unsigned char c = data[i++];
+		if (c >= 128) {
+			size_t run = c - 127;
+			if (k + run > n) return false;
+			memset(planes.data() + k, 0, run);
+			k += run;
+		}
+		else {
+			size_t run = (size_t) c + 1;
+			if (k + run > n || i + run > bytes) return false;
+			memcpy(planes.data() + k, data + i, run);
+			k += run;
+			i += run;
+		}
+	}
+	if (k != n) return false;
+	vector<uint32_t> words(nWords, 0);
+	for (int b = 0; b < 4; b++)
+		for (size_t i = 0; i < nWords; i++)
+			words[i] |= (uint32_t) planes[b * nWords + i] << (8 * b);
+	for (size_t i = wordsPerFrame; i < nWords; i++)
+		words[i] ^= words[i - wordsPerFrame];
+	memcpy(raw, words.data(), nWords * 4);
+	return true;
+}
+
+DenseFieldStore::DenseFieldStore()
+{
+}
+
+DenseFieldStore::~DenseFieldStore()
+{
+	this->close();
+}
+
+int DenseFieldStore::create(const string & _fileName, const DenseFieldInfo & info, int _chunkFrames, bool _compress)
+{
+	this->close();
+	if (info.nxPoint <= 0 || info.nyPoint <= 0 || _chunkFrames <= 0) {
+		cerr << "DenseFieldStore::create(): Invalid number of points (" << info.nxPoint << " x "
+			<< info.nyPoint << ") or of frames per chunk (" << _chunkFrames << ").\n";
+		return -1;
+	}
+	// info in yaml
+	cv::FileStorage fs(".yml", cv::FileStorage::WRITE | cv::FileStorage::MEMORY);
+	fs << "fieldName" << info.fieldName;
+	fs << "videoWidth" << info.videoWidth;
+	fs << "videoHeight" << info.videoHeight;
+	fs << "nFrames" << info.nFrames;
+	fs << "fps" << info.fps;
+	fs << "nxPoint" << info.nxPoint;
+	fs << "nyPoint" << info.nyPoint;
+	fs << "winSize" << info.winSize;
+	string yaml = fs.releaseAndGetString();
+	errno_t err = fopen_s(&this->file, _fileName.c_str(), "wb");
+	if (err != 0) {
+		cerr << "DenseFieldStore::create(): Cannot open " << _fileName << " to write.\n";
+		this->file = NULL;
+		return -1;
+	}
+	this->fieldInfo = info;
+	this->fileName = _fileName;
+	this->chunkFrames = _chunkFrames;
+	this->compress = _compress;
+	this->writing = true;
+	DenseFieldStoreHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, denseFieldStoreMagic, sizeof(header.magic));
+	header.version = denseFieldStoreVersion;
+	header.headerBytes = (int32_t) ((sizeof(header) + yaml.size() + 7) / 8 * 8);
+	header.nPoints = info.nPoints();
+	header.chunkFrames = _chunkFrames;
+	header.yamlBytes = (int64_t) yaml.size();
+	vector<char> padding(header.headerBytes - sizeof(header) - yaml.size(), '\0');
+	bool ok = fwrite(&header, sizeof(header), 1, this->file) == 1;
+	ok = ok && fwrite(yaml.data(), 1, yaml.size(), this->file) == yaml.size();
+	ok = ok && fwrite(padding.data(), 1, padding.size(), this->file) == padding.size();
+	if (!ok) {
+		cerr << "DenseFieldStore::create(): Failed to write " << _fileName << ".\n";
+		this->close();
+		return -1;
+	}
+	this->headerBytes = header.headerBytes;
+	this->yamlBytes = header.yamlBytes;
+	this->chunk.reserve(this->frameBytes() * _chunkFrames);
+	return 0;
+}
+
+int DenseFieldStore::appendFrame(const cv::Mat & field)
+{
+	if (this->file == NULL || this->writing == false)
+		return -1;
+	if (field.type() != CV_32FC2 || (int) field.total() != this->fieldInfo.nPoints()) {
+		cerr << "DenseFieldStore::appendFrame(): A frame must be " << this->fieldInfo.nPoints()
+			<< " points of CV_32FC2 (" << this->fileName << ").\n";
+		return -1;
+	}
+	cv::Mat cont = field.isContinuous() ? field : field.clone();
+	this->chunk.insert(this->chunk.end(), cont.data, cont.data + this->frameBytes());
+	this->nStored++;
+	if (this->chunk.size() >= this->frameBytes() * this->chunkFrames)
+		return this->writeChunk();
+	return 0;
+}
+
+int DenseFieldStore::writeChunk()
+{
+	int n = (int) (this->chunk.size() / this->frameBytes());
+	if (n <= 0)
+		return 0;
+	DenseFieldChunkHeader ch;
+	memcpy(ch.magic, denseFieldChunkMagic, sizeof(ch.magic));
+	ch.codec = Raw;
+	ch.firstFrame = this->nStored - n;
+	ch.nFrames = n;
+	const vector<unsigned char> * data = &this->chunk;
+	if (this->compress) {
+		encodeXorShuffleRle(this->chunk.data(), n, this->frameBytes(), this->encoded);
+		if (this->encoded.size() < this->chunk.size()) {
+			ch.codec = XorShuffleRle;
+			data = &this->encoded;
+		}
+	}
+	ch.bytes = (int64_t) data->size();
+	ChunkIndex ci;
+	ci.offset = this->index.size() > 0 ?
+		this->index.back().offset + (int64_t) sizeof(ch) + this->index.back().bytes : this->headerBytes;
+	ci.bytes = ch.bytes;
+	ci.firstFrame = ch.firstFrame;
+	ci.nFrames = n;
+	ci.codec = ch.codec;
+	ci.reserved = 0;
+	bool ok = fwrite(&ch, sizeof(ch), 1, this->file) == 1;
+	ok = ok && fwrite(data->data(), 1, data->size(), this->file) == data->size();
+	ok = (fflush(this->file) == 0) && ok;
+	this->chunk.clear();
+	if (!ok) {
+		cerr << "DenseFieldStore: Failed to write a chunk to " << this->fileName << ".\n";
+		return -1;
+	}
+	this->index.push_back(ci);
+	return 0;
+}
+
+int DenseFieldStore::close()
+{
+	int ret = 0;
+	if (this->file != NULL && this->writing) {
+		// the rest of the chunk, the index, and the header (with the number of frames and the index)
+		ret = this->writeChunk();
+		DenseFieldStoreHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, denseFieldStoreMagic, sizeof(header.magic));
+		header.version = denseFieldStoreVersion;
+		header.headerBytes = (int32_t) this->headerBytes;
+		header.nPoints = this->fieldInfo.nPoints();
+		header.chunkFrames = this->chunkFrames;
+		header.nFrames = this->nStored;
+		header.nChunks = (int32_t) this->index.size();
+		header.indexOffset = this->index.size() > 0 ?
+			this->index.back().offset + (int64_t) sizeof(DenseFieldChunkHeader) + this->index.back().bytes : this->headerBytes;
+		header.yamlBytes = this->yamlBytes;
+		bool ok = seek64(this->file, header.indexOffset) == 0;
+		ok = ok && fwrite(this->index.data(), sizeof(ChunkIndex), this->index.size(), this->file) == this->index.size();
+		ok = ok && seek64(this->file, 0) == 0;
+		ok = ok && fwrite(&header, sizeof(header), 1, this->file) == 1;
+		if (!ok) {
+			cerr << "DenseFieldStore::close(): Failed to write the index of " << this->fileName << ".\n";
+			ret = -1;
+		}
+	}
+	if (this->file != NULL && fclose(this->file) != 0)
+		ret = -1;
+	this->file = NULL;
+	if (this->fsXml.isOpened())
+		this->fsXml.release();
+	this->writing = false;
+	this->nStored = 0;
+	this->headerBytes = this->yamlBytes = 0;
+	this->index.clear();
+	this->chunk.clear();
+	this->encoded.clear();
+	this->iChunkCached = -1;
+	return ret;
+}
+
+int DenseFieldStore::open(const string & _fileName)
+{
+	this->close();
+	errno_t err = fopen_s(&this->file, _fileName.c_str(), "rb");
+	if (err != 0) {
+		cerr << "DenseFieldStore::open(): Cannot open " << _fileName << ".\n";
+		this->file = NULL;
+		return -1;
+	}
+	this->fileName = _fileName;
+	DenseFieldStoreHeader header;
+	bool isStore = fread(&header, sizeof(header), 1, this->file) == 1 &&
+		memcmp(header.magic, denseFieldStoreMagic, sizeof(header.magic)) == 0;
+	if (isStore == false) {
+		// an xml(.gz) output of vidTrack
+		fclose(this->file);
+		this->file = NULL;
+		try {
+			this->fsXml.open(_fileName, cv::FileStorage::READ);
+		}
+		catch (...) {
+		}
+		if (this->fsXml.isOpened() == false) {
+			cerr << "DenseFieldStore::open(): " << _fileName << " is neither a dense field store nor an xml file.\n";
+			return -1;
+		}
+		DenseFieldInfo & info = this->fieldInfo;
+		info = DenseFieldInfo();
+		this->fsXml["videoWidth"] >> info.videoWidth;
+		this->fsXml["videoHeight"] >> info.videoHeight;
+		this->fsXml["nFrames"] >> info.nFrames;
+		this->fsXml["fps"] >> info.fps;
+		this->fsXml["nxPoint"] >> info.nxPoint;
+		this->fsXml["nyPoint"] >> info.nyPoint;
+		this->fsXml["winSize"] >> info.winSize;
+		if (this->fsXml["imgPoints0"].empty() == false)
+			info.fieldName = "imgPoints";
+		else if (this->fsXml["imgVelocities0"].empty() == false)
+			info.fieldName = "imgVelocities";
+		else {
+			cerr << "DenseFieldStore::open(): " << _fileName << " has no imgPoints0 or imgVelocities0.\n";
+			this->close();
+			return -1;
+		}
+		char name[100];
+		for (this->nStored = 0; ; this->nStored++) {
+			snprintf(name, 100, "%s%d", info.fieldName.c_str(), this->nStored);
+			if (this->fsXml[name].empty()) break;
+		}
+		return 0;
+	}
+	// a store: info, and the index (rebuilt by scanning chunks if the store was not closed)
+	string yaml;
+	bool ok = header.version == denseFieldStoreVersion && header.nPoints > 0 && header.yamlBytes > 0 &&
+		header.headerBytes >= (int64_t) sizeof(header) + header.yamlBytes;
+	if (ok) {
+		yaml.resize((size_t) header.yamlBytes);
+		ok = fread(&yaml[0], 1, yaml.size(), this->file) == yaml.size();
+	}
+	if (ok) {
+		cv::FileStorage fs(yaml, cv::FileStorage::READ | cv::FileStorage::MEMORY);
+		DenseFieldInfo & info = this->fieldInfo;
+		info = DenseFieldInfo();
+		fs["fieldName"] >> info.fieldName;
+		fs["videoWidth"] >> info.videoWidth;
+		fs["videoHeight"] >> info.videoHeight;
+		fs["nFrames"] >> info.nFrames;
+		fs["fps"] >> info.fps;
+		fs["nxPoint"] >> info.nxPoint;
+		fs["nyPoint"] >> info.nyPoint;
+		fs["winSize"] >> info.winSize;
+		ok = info.nPoints() == header.nPoints;
+	}
+	if (!ok) {
+		cerr << "DenseFieldStore::open(): " << _fileName << " is broken (or of another version).\n";
+		this->close();
+		return -1;
+	}
+	this->headerBytes = header.headerBytes;
+	this->yamlBytes = header.yamlBytes;
+	this->chunkFrames = header.chunkFrames;
+	if (header.indexOffset > 0) {
+		this->index.resize(header.nChunks);
+		ok = seek64(this->file, header.indexOffset) == 0 &&
+			fread(this->index.data(), sizeof(ChunkIndex), this->index.size(), this->file) == this->index.size();
+		this->nStored = header.nFrames;
+		if (!ok) {
+			cerr << "DenseFieldStore::open(): Failed to read the index of " << _fileName << ".\n";
+			this->close();
+			return -1;
+		}
+	}
+	else if (this->scanChunks() != 0) {
+		this->close();
+		return -1;
+	}
+	return 0;
+}
+
+int DenseFieldStore::scanChunks()
+{
+	int64_t size = fileSize64(this->file);
+	int64_t offset = this->headerBytes;
+	DenseFieldChunkHeader ch;
+	this->index.clear();
+	this->nStored = 0;
+	while (offset + (int64_t) sizeof(ch) <= size) {
+		if (seek64(this->file, offset) != 0 || fread(&ch, sizeof(ch), 1, this->file) != 1)
+			break;
+		if (memcmp(ch.magic, denseFieldChunkMagic, sizeof(ch.magic)) != 0 || ch.firstFrame != this->nStored ||
+			ch.nFrames <= 0 || ch.bytes < 0 || offset + (int64_t) sizeof(ch) + ch.bytes > size)
+			break; // (a chunk being written, or the end)
+		ChunkIndex ci;
+		ci.offset = offset;
+		ci.bytes = ch.bytes;
+		ci.firstFrame = ch.firstFrame;
+		ci.nFrames = ch.nFrames;
+		ci.codec = ch.codec;
+		ci.reserved = 0;
+		this->index.push_back(ci);
+		this->nStored += ch.nFrames;
+		offset += (int64_t) sizeof(ch) + ch.bytes;
+	}
+	printf("# DenseFieldStore: %s was not closed. %d frames in %d chunks are found.\n",
+		this->fileName.c_str(), this->nStored, (int) this->index.size());
+	return 0;
+}
+
+// index of the chunk that has frame iFrame (chunks have chunkFrames frames, except the last)
+int DenseFieldStore::findChunk(int iFrame) const
+{
+	int iChunk = this->chunkFrames > 0 ? iFrame / this->chunkFrames : 0;
+	if (iChunk >= 0 && iChunk < (int) this->index.size() && this->index[iChunk].firstFrame <= iFrame &&
+		iFrame < this->index[iChunk].firstFrame + this->index[iChunk].nFrames)
+		return iChunk;
+	// (chunks of other sizes) binary search
+	int lo = 0, hi = (int) this->index.size() - 1;
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+		if (iFrame < this->index[mid].firstFrame) hi = mid - 1;
+		else if (iFrame >= this->index[mid].firstFrame + this->index[mid].nFrames) lo = mid + 1;
+		else return mid;
+	}
+	return -1;
+}
+
+int DenseFieldStore::readChunk(int iChunk)
+{
+	if (iChunk == this->iChunkCached)
+		return 0;
+	const ChunkIndex & ci = this->index[iChunk];
+	size_t rawBytes = this->frameBytes() * ci.nFrames;
+	this->chunk.resize(rawBytes);
+	this->iChunkCached = -1;
+	bool ok = seek64(this->file, ci.offset + (int64_t) sizeof(DenseFieldChunkHeader)) == 0;
+	if (ci.codec == Raw)
+		ok = ok && ci.bytes == (int64_t) rawBytes && fread(this->chunk.data(), 1, rawBytes, this->file) == rawBytes;
+	else if (ci.codec == XorShuffleRle) {
+		this->encoded.resize((size_t) ci.bytes);
+		ok = ok && fread(this->encoded.data(), 1, this->encoded.size(), this->file) == this->encoded.size();
+		ok = ok && decodeXorShuffleRle(this->encoded.data(), this->encoded.size(), ci.nFrames, this->frameBytes(), this->chunk.data());
+	}
+	else
+		ok = false;
+	if (!ok) {
+		cerr << "DenseFieldStore: Failed to read chunk " << iChunk << " of " << this->fileName << ".\n";
+		return -1;
+	}
+	this->iChunkCached = iChunk;
+	return 0;
+}
+
+int DenseFieldStore::readFrame(int iFrame, cv::Mat & field)
+{
+	return this->readFrames(iFrame, 1, field);
+}
+
+int DenseFieldStore::readFrames(int iFrame, int n, cv::Mat & fields)
+{
+	if (this->writing || iFrame < 0 || n <= 0 || iFrame + n > this->nStored)
+		return -1;
+	fields.create(n, this->fieldInfo.nPoints(), CV_32FC2);
+	if (this->fsXml.isOpened()) {
+		char name[100];
+		cv::Mat field;
+		for (int i = 0; i < n; i++) {
+			snprintf(name, 100, "%s%d", this->fieldInfo.fieldName.c_str(), iFrame + i);
+			this->fsXml[name] >> field;
+			if (field.type() != CV_32FC2 || (int) field.total() != this->fieldInfo.nPoints()) {
+				cerr << "DenseFieldStore: " << name << " of " << this->fileName << " is not a field of "
+					<< this->fieldInfo.nPoints() << " points.\n";
+				return -1;
+			}
+			field.reshape(2, 1).copyTo(fields.row(i));
+		}
+		return 0;
+	}
+	if (this->file == NULL)
+		return -1;
+	// frames of each chunk (frames of raw chunks are read directly)
+	for (int i = 0; i < n; ) {
+		int iChunk = this->findChunk(iFrame + i);
+		if (iChunk < 0) return -1;
+		const ChunkIndex & ci = this->index[iChunk];
+		int iInChunk = iFrame + i - ci.firstFrame;
+		int nInChunk = std::min(n - i, ci.nFrames - iInChunk);
+		size_t bytes = this->frameBytes() * nInChunk;
+		if (ci.codec == Raw && iChunk != this->iChunkCached) {
+			bool ok = seek64(this->file, ci.offset + (int64_t) sizeof(DenseFieldChunkHeader) +
+				(int64_t) this->frameBytes() * iInChunk) == 0 && fread(fields.ptr(i), 1, bytes, this->file) == bytes;
+			if (!ok) {
+				cerr << "DenseFieldStore: Failed to read frame " << iFrame + i << " of " << this->fileName << ".\n";
+				return -1;
+			}
+		}
+		else {
+			if (this->readChunk(iChunk) != 0) return -1;
+			memcpy(fields.ptr(i), this->chunk.data() + this->frameBytes() * iInChunk, bytes);
+		}
+		i += nInChunk;
+	}
+	return 0;
+}
+
+int DenseFieldStore::exportXml(const string & fileStore, const string & fileXml)
+{
+	DenseFieldStore store;
+	if (store.open(fileStore) != 0)
+		return -1;
+	cv::FileStorage fs(fileXml, cv::FileStorage::WRITE);
+	if (fs.isOpened() == false) {
+		cerr << "DenseFieldStore::exportXml(): Cannot open " << fileXml << " to write.\n";
+		return -1;
+	}
+	const DenseFieldInfo & info = store.info();
+	fs << "videoWidth" << info.videoWidth;
+	fs << "videoHeight" << info.videoHeight;
+	fs << "nFrames" << info.nFrames;
+	fs << "fps" << info.fps;
+	fs << "nxPoint" << info.nxPoint;
+	fs << "nyPoint" << info.nyPoint;
+	fs << "winSize" << info.winSize;
+	char name[100];
+	cv::Mat field;
+	for (int i = 0; i < store.nFrames(); i++) {
+		if (store.readFrame(i, field) != 0)
+			return -1;
+		snprintf(name, 100, "%s%d", info.fieldName.c_str(), i);
+		fs << name << field;
+	}
+	fs.release();
+	return store.nFrames();
+}
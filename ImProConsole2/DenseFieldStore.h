@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+//! Settings of a dense point field of a video (as in the vidTrack output)
+struct DenseFieldInfo
+{
+	std::string fieldName = "imgPoints"; // name of frames in xml (fieldName%d), e.g., "imgPoints" or "imgVelocities"
+	int videoWidth = -1, videoHeight = -1;
+	int nFrames = -1;                     // number of frames of the video (frames stored may be fewer)
+	double fps = -1.;
+	int nxPoint = -1, nyPoint = -1;
+	cv::Size winSize = cv::Size(0, 0);
+	int nPoints() const { return nxPoint * nyPoint; }
+};
+
+//! DenseFieldStore writes and reads a dense point field (a CV_32FC2 field of nyPoint x nxPoint
+//! points per frame, e.g., image points or image velocities of vidTrack) as a chunked binary store
+//! with random access to any frame or range of frames.
+/*!
+\details A store is a 64-byte header (magic "IMPRODFS", version, offset of the first chunk,
+number of points, frames per chunk, number of frames and chunks, offset of the index, bytes of
+the yaml text), a yaml text of DenseFieldInfo (by cv::FileStorage), chunks of frames, and an
+index of chunks (offset, bytes, first frame, number of frames, codec of each chunk). Each chunk
+starts with a small header, so that the index of a store which was not closed (e.g., by a crash)
+is rebuilt by scanning the chunks.
+Chunks are raw (frames of 1 x nPoints CV_32FC2), or compressed: each frame of the chunk is
+XORed with the previous frame (bit patterns of floats of neighboring frames share high bytes),
+bytes are shuffled into planes, and runs of zero bytes are run-length encoded. A chunk is kept
+raw if compression does not make it smaller. A frame of a raw chunk is read by a single seek and
+read. A compressed chunk is decoded as a whole, and the last decoded chunk is cached.
+For compatibility, open() also reads the xml(.gz) output of vidTrack (fieldName%d nodes), and
+exportXml() writes a store to that xml format.
+    DenseFieldStore store;
+    store.create("vidTrack_imgxy.dfs", info);   // info: DenseFieldInfo
+    for each frame:
+        store.appendFrame(posCurr);              // 1 x nPoints (or nyPoint x nxPoint) CV_32FC2
+    store.close();
+    store.open("vidTrack_imgxy.dfs");
+    store.readFrame(100, pos);                   // 1 x nPoints CV_32FC2
+    store.readFrames(100, 50, pos50);            // 50 x nPoints CV_32FC2
+    DenseFieldStore::exportXml("vidTrack_imgxy.dfs", "vidTrack_imgxy.xml.gz");
+*/
+class DenseFieldStore
+{
+public:
+	enum Codec { Raw = 0, XorShuffleRle = 1 };
+
+	DenseFieldStore();
+	~DenseFieldStore();
+	DenseFieldStore(const DenseFieldStore &) = delete;
+	DenseFieldStore & operator=(const DenseFieldStore &) = delete;
+
+	//! creates a store to write.
+	//! \param chunkFrames number of frames of a chunk
+	//! \param compress compresses chunks (XorShuffleRle) if true
+	//! \return 0: success. -1: invalid info, or cannot create the file.
+	int create(const std::string & fileName, const DenseFieldInfo & info, int chunkFrames = 32, bool compress = true);
+	//! appends a frame (info().nPoints() points, CV_32FC2, any shape)
+	//! \return 0: success. -1: not created, wrong size or type, or failed to write.
+	int appendFrame(const cv::Mat & field);
+
+	//! opens a store (or an xml(.gz) output of vidTrack) to read
+	//! \return 0: success. -1: cannot open, or not a store nor a vidTrack xml.
+	int open(const std::string & fileName);
+	//! reads frame iFrame (1 x nPoints CV_32FC2)
+	//! \return 0: success. -1: out of range, or failed to read.
+	int readFrame(int iFrame, cv::Mat & field);
+	//! reads nFrames frames from iFrame (a row per frame, nFrames x nPoints CV_32FC2)
+	//! \return 0: success. -1: out of range, or failed to read.
+	int readFrames(int iFrame, int nFrames, cv::Mat & fields);
+
+	//! writes the rest of the chunk and the index (writing), or closes the file (reading)
+	//! \return 0: success. -1: failed to write.
+	int close();
+
+	const DenseFieldInfo & info() const { return fieldInfo; }
+	//! number of frames stored
+	int nFrames() const { return nStored; }
+	bool isOpen() const { return file != NULL || fsXml.isOpened(); }
+
+	//! writes a store (or an xml) to the xml format of vidTrack (fileXml can be .xml.gz)
+	//! \return number of frames written, or -1 if fileStore cannot be read or fileXml written.
+	static int exportXml(const std::string & fileStore, const std::string & fileXml);
+
+protected:
+	struct ChunkIndex {
+		int64_t offset;     // offset of the chunk header
+		int64_t bytes;      // bytes of the chunk data (after its header)
+		int32_t firstFrame;
+		int32_t nFrames;
+		int32_t codec;
+		int32_t reserved;
+	};
+	int writeChunk();
+	int readChunk(int iChunk);
+	int scanChunks();
+	int findChunk(int iFrame) const;
+	size_t frameBytes() const { return (size_t) fieldInfo.nPoints() * 2 * sizeof(float); }
+
+	DenseFieldInfo fieldInfo;
+	FILE * file = NULL;
+	bool writing = false;
+	bool compress = true;
+	int chunkFrames = 32;
+	int nStored = 0;
+	int64_t headerBytes = 0, yamlBytes = 0;
+	std::string fileName;
+	std::vector<ChunkIndex> index;
+	std::vector<unsigned char> chunk;   // frames of the chunk being written, or the decoded chunk
+	int iChunkCached = -1;              // index of the decoded chunk in chunk (reading)
+	std::vector<unsigned char> encoded; // (buffer of compressed chunk)
+	cv::FileStorage fsXml;              // (reading an xml output of vidTrack)
+};
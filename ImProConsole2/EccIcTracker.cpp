@@ -0,0 +1,189 @@
+#include <vector>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+
+#include "EccIcTracker.h"
+
+using namespace std;
+
+static int numParamsOfMotion(int motionType)
+{
+	switch (motionType) {
+	case cv::MOTION_TRANSLATION: return 2;
+	case cv::MOTION_EUCLIDEAN:   return 3;
+	case cv::MOTION_AFFINE:      return 6;
+	case cv::MOTION_HOMOGRAPHY:  return 8;
+	}
+	return -1;
+}
+
+// warp (3x3, CV_64F) of parameter increment dp (at identity)
+static cv::Mat warpOfParams(int motionType, const double * dp)
+{
+	cv::Mat w = cv::Mat::eye(3, 3, CV_64F);
+	double * m = w.ptr<double>(0);
+	switch (motionType) {
+	case cv::MOTION_TRANSLATION:
+		m[2] = dp[0]; m[5] = dp[1];
+		break;
+	case cv::MOTION_EUCLIDEAN:
+		m[0] = cos(dp[0]); m[1] = -sin(dp[0]); m[2] = dp[1];
+		m[3] = sin(dp[0]); m[4] = cos(dp[0]);  m[5] = dp[2];
+		break;
+	case cv::MOTION_AFFINE:
+		m[0] += dp[0]; m[1] = dp[1]; m[2] = dp[2];
+		m[3] = dp[3]; m[4] += dp[4]; m[5] = dp[5];
+		break;
+	case cv::MOTION_HOMOGRAPHY:
+		m[0] += dp[0]; m[1] = dp[1]; m[2] = dp[2];
+		m[3] = dp[3]; m[4] += dp[4]; m[5] = dp[5];
+		m[6] = dp[6]; m[7] = dp[7];
+		break;
+	}
+	return w;
+}
+
+int EccIcTracker::setTemplate(const cv::Mat & tmplt, int motionType, int gaussFiltSize)
+{
+	int K = numParamsOfMotion(motionType);
+	if (K <= 0 || tmplt.rows < 2 || tmplt.cols < 2 || tmplt.channels() != 1)
+		return -1;
+	this->motion = motionType;
+	this->gaussSize = gaussFiltSize;
+	this->tSize = tmplt.size();
+
+	// template (blurred) and its gradients
+	cv::Mat t, gx, gy;
+	tmplt.convertTo(t, CV_32F);
+	if (gaussFiltSize > 1)
+		cv::GaussianBlur(t, t, cv::Size(gaussFiltSize, gaussFiltSize), 0, 0);
+	cv::Sobel(t, gx, CV_32F, 1, 0, 3, 1. / 8.);
+	cv::Sobel(t, gy, CV_32F, 0, 1, 3, 1. / 8.);
+
+	// steepest-descent images: gradient times jacobian of warp (at identity)
+	int N = tSize.area();
+	sd.create(K, N, CV_32F);
+	for (int y = 0; y < tSize.height; y++) {
+		const float * pgx = gx.ptr<float>(y);
+		const float * pgy = gy.ptr<float>(y);
+		for (int x = 0; x < tSize.width; x++) {
+			int i = y * tSize.width + x;
+			float dx = pgx[x], dy = pgy[x];
+			switch (motionType) {
+			case cv::MOTION_TRANSLATION:
+				sd.at<float>(0, i) = dx;
+				sd.at<float>(1, i) = dy;
+				break;
+			case cv::MOTION_EUCLIDEAN:
+				sd.at<float>(0, i) = -y * dx + x * dy;
+				sd.at<float>(1, i) = dx;
+				sd.at<float>(2, i) = dy;
+				break;
+			case cv::MOTION_AFFINE:
+			case cv::MOTION_HOMOGRAPHY:
+				sd.at<float>(0, i) = x * dx;
+				sd.at<float>(1, i) = y * dx;
+				sd.at<float>(2, i) = dx;
+				sd.at<float>(3, i) = x * dy;
+				sd.at<float>(4, i) = y * dy;
+				sd.at<float>(5, i) = dy;
+				if (motionType == cv::MOTION_HOMOGRAPHY) {
+					sd.at<float>(6, i) = -x * (x * dx + y * dy);
+					sd.at<float>(7, i) = -y * (x * dx + y * dy);
+				}
+				break;
+			}
+		}
+	}
+	// zero-mean template and zero-mean steepest-descent images
+	// (derivatives of the zero-mean template)
+	tz = t.reshape(1, 1).clone();
+	tz -= cv::mean(tz)[0];
+	for (int k = 0; k < K; k++)
+		sd.row(k) -= cv::mean(sd.row(k))[0];
+
+	// Hessian, its inverse and template projections
+	cv::Mat sd64, tz64, hessian;
+	sd.convertTo(sd64, CV_64F);
+	tz.convertTo(tz64, CV_64F);
+	cv::mulTransposed(sd64, hessian, false);
+	if (cv::invert(hessian, hInv, cv::DECOMP_CHOLESKY) == 0) {
+		sd.release();
+		return -1; // textureless template
+	}
+	cv::Mat tProj = sd64 * tz64.t();
+	tProjH = hInv * tProj;
+	tNorm2 = tz64.dot(tz64);
+	lambdaN = tNorm2 - tProj.dot(tProjH);
+	return 0;
+}
+
+double EccIcTracker::track(const cv::Mat & image, cv::Mat & warp, cv::TermCriteria criteria)
+{
+	CV_Assert(!this->empty());
+	CV_Assert(image.channels() == 1 && image.rows > 0 && image.cols > 0);
+	int warpRows = (motion == cv::MOTION_HOMOGRAPHY) ? 3 : 2;
+	CV_Assert(warp.type() == CV_32F && warp.rows == warpRows && warp.cols == 3);
+	int K = sd.rows;
+	int maxIter = (criteria.type & cv::TermCriteria::COUNT) ? criteria.maxCount : 200;
+	double eps = (criteria.type & cv::TermCriteria::EPS) ? criteria.epsilon : -1.;
+
+	image.convertTo(imgFloat, CV_32F);
+	if (gaussSize > 1)
+		cv::GaussianBlur(imgFloat, imgFloat, cv::Size(gaussSize, gaussSize), 0, 0);
+
+	cv::Mat w = cv::Mat::eye(3, 3, CV_64F);
+	cv::Mat wTop = w(cv::Rect(0, 0, 3, warpRows));
+	warp.convertTo(wTop, CV_64F);
+
+	double tNorm = sqrt(tNorm2);
+	double rho = -1., lastRho = -1.;
+	vector<double> dp(K);
+	for (int iter = 0; iter < maxIter; iter++) {
+		// image warped to template coordinates
+		if (motion == cv::MOTION_HOMOGRAPHY)
+			cv::warpPerspective(imgFloat, imgWarped, w, tSize,
+				cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_REPLICATE);
+		else
+			cv::warpAffine(imgFloat, imgWarped, w(cv::Rect(0, 0, 3, 2)), tSize,
+				cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_REPLICATE);
+		iz = imgWarped.reshape(1, 1);
+		iz -= cv::mean(iz)[0];
+
+		double correlation = iz.dot(tz);
+		double iNorm = cv::norm(iz);
+		rho = correlation / (iNorm * tNorm);
+		if (cvIsNaN(rho))
+			CV_Error(cv::Error::StsNoConv, "NaN encountered.");
+		if (eps >= 0. && iter > 0 && fabs(rho - lastRho) < eps)
+			break;
+		lastRho = rho;
+
+		// projection of warped image onto steepest-descent images (the only
+		// image-dependent product of an iteration)
+		cv::gemm(sd, iz, 1.0, cv::noArray(), 0.0, proj, cv::GEMM_2_T);
+		cv::Mat proj64;
+		proj.convertTo(proj64, CV_64F);
+		cv::Mat projH = hInv * proj64;
+		double lambdaD = correlation - proj64.dot(tProjH);
+		if (lambdaD <= 0.0)
+			CV_Error(cv::Error::StsNoConv, "The algorithm stopped before its convergence. "
+				"The correlation is going to be minimized. Images may be uncorrelated or non-overlapped");
+		double lambda = lambdaN / lambdaD;
+
+		// dp = hInv * sd * (lambda * iz - tz)^T
+		for (int k = 0; k < K; k++)
+			dp[k] = lambda * projH.at<double>(k, 0) - tProjH.at<double>(k, 0);
+
+		// inverse composition: W(p) <- W(p) o W(dp)^-1
+		w = w * warpOfParams(motion, dp.data()).inv();
+		if (motion != cv::MOTION_HOMOGRAPHY) {
+			w.at<double>(2, 0) = w.at<double>(2, 1) = 0.;
+			w.at<double>(2, 2) = 1.;
+		}
+		else
+			w /= w.at<double>(2, 2);
+	}
+	w(cv::Rect(0, 0, 3, warpRows)).convertTo(warp, CV_32F);
+	return rho;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+//! EccIcTracker is an inverse-compositional ECC (enhanced correlation coefficient) tracker
+/*!
+\details cv::findTransformECC() computes the gradients of the warped image, the
+steepest-descent images and the Hessian in every iteration of every call. In the
+inverse-compositional formulation they are computed from the template, so they are
+computed once by setTemplate() and reused by every track() call (e.g., every frame)
+until the template changes. Each iteration only warps the image, projects it onto
+the precomputed steepest-descent images and composes the inverse increment.
+Motion types are the same as cv::findTransformECC() (cv::MOTION_TRANSLATION,
+cv::MOTION_EUCLIDEAN, cv::MOTION_AFFINE, cv::MOTION_HOMOGRAPHY), and so is the warp
+matrix (2x3, or 3x3 for homography, CV_32F, mapping template to image coordinates).
+Pixels warped outside the image are replicated from the border (no mask).
+A tracker must not be shared among threads.
+Usage:
+    EccIcTracker tracker;
+    tracker.setTemplate(imgTmplt, cv::MOTION_EUCLIDEAN);     // once per template
+    double ecc = tracker.track(imgSearch, warp, criteria);  // every frame
+*/
+class EccIcTracker
+{
+public:
+	//! sets the template and precomputes steepest-descent images and Hessian.
+	//! \param gaussFiltSize size of Gaussian blur applied to template and image (0 or 1 for none)
+	//! \return 0:success. -1:invalid arguments.
+	int setTemplate(const cv::Mat & tmplt, int motionType = cv::MOTION_AFFINE, int gaussFiltSize = 5);
+
+	//! finds the warp that maximizes the ECC between template and image.
+	//! \param image image where the template is searched (8-bit or 32-bit float, single channel)
+	//! \param warp input: initial guess. output: updated warp (2x3, or 3x3 for homography, CV_32F)
+	//! \param criteria termination criteria (COUNT: max. iterations, EPS: change of ECC)
+	//! \return the final ECC coefficient. Throws cv::Exception if the iteration diverges,
+	//! the same as cv::findTransformECC().
+	double track(const cv::Mat & image, cv::Mat & warp,
+		cv::TermCriteria criteria = cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 50, 0.001));
+
+	bool empty() const { return sd.empty(); }
+	int motionType() const { return motion; }
+	int numParams() const { return sd.rows; }
+
+protected:
+	cv::Mat tz;         // zero-mean (blurred) template, 1 x N, CV_32F
+	cv::Mat sd;         // zero-mean steepest-descent images, K x N, CV_32F (K: number of parameters)
+	cv::Mat hInv;       // inverse of Hessian (sd * sd^T), K x K, CV_64F
+	cv::Mat tProjH;     // hInv * sd * tz^T, K x 1, CV_64F
+	double tNorm2 = 0.; // squared norm of tz
+	double lambdaN = 0.;// tNorm2 - (sd * tz^T) . tProjH
+	cv::Size tSize;     // template size
+	int motion = cv::MOTION_AFFINE;
+	int gaussSize = 5;
+
+	// work buffers (kept to avoid reallocation across calls)
+	cv::Mat imgFloat, imgWarped, iz, proj;
+};
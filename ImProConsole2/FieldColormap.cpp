@@ -0,0 +1,58 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "FieldColormap.h"
+#include "impro_util.h"
+
+using namespace std;
+
+cv::Mat colormapLut(int colormap)
+{
+	if (colormap < 0) {
+		// jet_bgr table (built once)
+		static const cv::Mat jetLut = []() {
+			cv::Mat lut(256, 1, CV_8UC3);
+			for (int i = 0; i < 256; i++)
+				lut.at<cv::Vec3b>(i, 0) = cv::Vec3b(jet_bgr[i][0], jet_bgr[i][1], jet_bgr[i][2]);
+			return lut;
+		}();
+		return jetLut;
+	}
+	cv::Mat ramp(256, 1, CV_8U), lut;
+	for (int i = 0; i < 256; i++)
+		ramp.at<uchar>(i, 0) = (uchar) i;
+	cv::applyColorMap(ramp, lut, colormap);
+	return lut;
+}
+
+int fieldToGray(const cv::Mat & field, cv::Mat & gray, float vmin, float vmax)
+{
+	if (field.empty() || field.channels() != 1 || !(vmax > vmin)) {
+		cerr << "fieldToGray error: field needs to be single-channel and vmax > vmin.\n";
+		return -1;
+	}
+	double alpha = 255. / ((double) vmax - vmin);
+	field.convertTo(gray, CV_8U, alpha, -vmin * alpha); // saturated (clamped) and rounded
+	return 0;
+}
+
+int fieldToColormap(const cv::Mat & field, cv::Mat & img, float vmin, float vmax, const cv::Mat & lut)
+{
+	cv::Mat gray;
+	if (fieldToGray(field, gray, vmin, vmax) != 0)
+		return -1;
+	cv::applyColorMap(gray, img, lut.empty() ? colormapLut() : lut);
+	return 0;
+}
+
+int cellFieldToColormap(const cv::Mat & cells, cv::Size imgSize, cv::Mat & img, float vmin, float vmax,
+	const cv::Mat & lut)
+{
+	cv::Mat cellImg;
+	if (imgSize.width <= 0 || imgSize.height <= 0)
+		return -1;
+	if (fieldToColormap(cells, cellImg, vmin, vmax, lut) != 0)
+		return -1;
+	cv::resize(cellImg, img, imgSize, 0, 0, cv::INTER_NEAREST);
+	return 0;
+}
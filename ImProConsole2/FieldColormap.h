@@ -0,0 +1,31 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+// Field visualization: float fields (displacement, strain, crack, velocity, etc.)
+// to color images. A field is mapped to 8-bit by a clamped linear scale in one
+// (vectorized) pass, and then colored by a 256-entry colormap table. Fields of 
+// grid cells (e.g., one value per tracking point) are colored at cell resolution
+// and enlarged by nearest-neighbor resize.
+
+//! returns a colormap table (256x1, CV_8UC3, BGR).
+//! \param colormap -1: jet_bgr of impro_util.h. Otherwise: OpenCV colormap (cv::COLORMAP_JET, etc.)
+cv::Mat colormapLut(int colormap = -1);
+
+//! maps a field to 8-bit: 0 at vmin (or below) and 255 at vmax (or above).
+//! \param field single-channel field (any depth, normally CV_32F)
+//! \param gray output (CV_8U, the same size as field)
+//! \return 0: success. -1: invalid input.
+int fieldToGray(const cv::Mat & field, cv::Mat & gray, float vmin, float vmax);
+
+//! maps a field to a color image (CV_8UC3, the same size as field) through fieldToGray() and a colormap table.
+//! \param lut colormap table (see colormapLut()). Empty for jet_bgr of impro_util.h.
+//! \return 0: success. -1: invalid input.
+int fieldToColormap(const cv::Mat & field, cv::Mat & img, float vmin, float vmax,
+	const cv::Mat & lut = cv::Mat());
+
+//! maps a field of grid cells (one value per cell, ny x nx) to a color image of imgSize,
+//! each cell filling its (imgSize / (nx, ny)) part of the image.
+//! \return 0: success. -1: invalid input.
+int cellFieldToColormap(const cv::Mat & cells, cv::Size imgSize, cv::Mat & img, float vmin, float vmax,
+	const cv::Mat & lut = cv::Mat());
@@ -8,6 +8,16 @@
 #include <ctime>
 #include <thread>
 #include <experimental/filesystem>
+#include <memory>
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 #include "impro_util.h"
 
@@ -114,6 +124,7 @@ int FileSeq::setFilesByFormat(const std::string format, int begin, int num_files
 {
 	char cstr[10000]; // maximum length of each file name string
 	this->filenames.clear();
+	this->fileIndex.reset();
 	for (int i = 0; i < num_files; i++) {
 		snprintf(cstr, 10000, format.c_str(), i + begin);
 		filenames.push_back(std::string(cstr));
@@ -136,6 +147,7 @@ int FileSeq::setFilesByExt(std::string fileExt)
 
 	// clear files
 	this->filenames.clear(); 
+	this->fileIndex.reset();
 
 	// add files into filenames
 	for (auto & p : fs::directory_iterator(this->theDir)) {
@@ -180,6 +192,7 @@ int FileSeq::setFilesByListFile(std::string fileListFile)
 //	}
 	// read file names
 	this->filenames.clear(); 
+	this->fileIndex.reset();
 	while (flist.eof() == false)
 	{
 		string fname;
@@ -208,6 +221,7 @@ int FileSeq::setFilesByStringVec(const std::vector<std::string> & fVec)
 		return -1;
 	// set directory
 	this->filenames.clear();
+	this->fileIndex.reset();
 	this->setDir(fVec[0]);
 	for (int i = 1; i < (int) fVec.size(); i++) 
 	{
@@ -271,6 +285,7 @@ int FileSeq::setDirFilesByConsoleOneByOne(std::istream & ifile)
     cout << "#  Enter number of files: ";
 	int nFiles = readIntFromIstream(ifile);
 	this->filenames.clear();	// clear files
+	this->fileIndex.reset();
 	for (int i = 0; i < nFiles; i++)
 	{
 		this->filenames.push_back(readStringFromIstream(ifile));
@@ -290,6 +305,7 @@ int FileSeq::setDirFilesByConsoleCStyle(std::istream & ifile)
     cout << "#  Enter number of files: ";
 	int nFiles = readIntFromIstream(ifile);
 	this->filenames.clear();	// clear files
+	this->fileIndex.reset();
 	this->setFilesByFormat(cformat, startIdx, nFiles); 
     printf("#  %d files are set, from %s to %s under %s\n", (int)this->filenames.size(),
 		this->filename(0).c_str(), this->filename((int)this->filenames.size() - 1).c_str(), this->directory().c_str());
@@ -411,192 +427,422 @@ std::string FileSeq::fullPathOfFile(int idx) const
 	return this->directory() + this->filename(idx);
 }
 
-int FileSeq::countCanRead() const
+// FileSeqDirWatcher watches a directory for files which are closed after writing 
+// (or moved in), deleted or moved out. On Linux it uses one inotify instance, which
+// is shared by waiting (waitForFile(), waitForImageFile()) and by the index of 
+// existing files (FileSeqIndex) of the FileSeq and its copies. Events read by either 
+// of them are passed to all indices subscribed to the watcher. Otherwise (or if 
+// inotify is not available) it only sleeps. 
+class FileSeqDirWatcher
 {
-	int count = 0, nfiles = this->num_files();
-	for (int i = 0; i < nfiles; i++)
+public:
+	explicit FileSeqDirWatcher(const std::string & _dir) : dir(_dir)
 	{
-		if (this->canRead(i))
-			count++;
+#ifdef __linux__
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd >= 0)
+			wd = inotify_add_watch(fd, _dir.length() > 0 ? _dir.c_str() : ".", 
+				IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM);
+#endif
 	}
-	return count;
-}
+	~FileSeqDirWatcher()
+	{
+#ifdef __linux__
+		if (fd >= 0) close(fd);
+#endif
+	}
+	bool ok() const { return fd >= 0 && wd >= 0; }
 
-int FileSeq::waitForFile(int idx, int waitTimeEach, int maxTotalWait) 
-{
-	// Check arguments
-	if (idx >= this->num_files())
+	// passes later events to index (until the index is released)
+	void subscribe(const std::shared_ptr<FileSeqIndex> & index) { indices.push_back(index); }
+
+	// waits up to timeoutMs (or until the directory changes), and appends names of 
+	// arrived files to names. Returns the number of arrived files (0: time-out or no 
+	// arrival), or -1 if arrivals are unknown (inotify is not available and it only slept).
+	int wait(int timeoutMs, std::vector<std::string> & names)
 	{
-        this->log("# Error: from FileSeq::waitForFile: Wrong idx: " + to_string(idx));
-		std::cerr << "Error from FileSeq::waitForFile: " 
-            << "# Wrong idx: " << idx << ". \n";
+#ifdef __linux__
+		if (ok()) {
+			struct pollfd pfd;
+			pfd.fd = fd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			if (poll(&pfd, 1, timeoutMs) <= 0)
+				return 0;
+			return readEvents(&names);
+		}
+#endif
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
 		return -1;
 	}
-	if (waitTimeEach < 1)
+
+	// reads pending events without waiting and passes them to the subscribed indices.
+	// Returns the number of arrived files (their names appended to names if not NULL).
+	int readEvents(std::vector<std::string> * names = NULL);
+
+	std::string dir;
+
+private:
+	int fd = -1, wd = -1;
+	std::vector<std::weak_ptr<FileSeqIndex> > indices;
+};
+
+// FileSeqIndex keeps which files of a FileSeq exist, so that countCanRead() and 
+// findLastCanReadFile() do not open every file of the sequence. It is built from 
+// one listing of the directory. On Linux it is then kept up to date by the events
+// of the FileSeqDirWatcher of the FileSeq (files closed after writing, moved in, 
+// deleted, or moved out). Otherwise (or if inotify is not available) the directory 
+// is listed again at each sync(). File names with a directory part (e.g., full 
+// paths) are not in the listing. They are kept in unindexed and checked by 
+// FileSeq::canRead(). 
+class FileSeqIndex
+{
+public:
+	FileSeqIndex(const std::string & _dir, const std::vector<std::string> & names) 
+		: dir(_dir), nNames(names.size()), exists(names.size(), 0)
 	{
-        this->log("# Warning from FileSeq::waitForFile: waitTimeEach of a non-positive "
-			+ std::string("value means waiting forever.")); 
-        std::cerr << "# Warning from FileSeq::waitForFile: "
-			<< "waitTimeEach of a non-positive value means waiting forever.\n";
+		for (int i = 0; i < (int) names.size(); i++) {
+			if (names[i].find_first_of("/\\:") != std::string::npos)
+				unindexed.push_back(i);
+			else
+				idxOfName.emplace(key(names[i]), i);
+		}
 	}
 
-	// 
-	int waitCount = 0; 
-	int checkLaterFileExisting = 1;
-	int checkEndOfFileSeq = 1;
-	while (true)
+	// subscribes to watcher (which watches the directory before listing, so that 
+	// no file is missed in between) and lists the directory
+	static std::shared_ptr<FileSeqIndex> create(const std::string & _dir, 
+		const std::vector<std::string> & names, const std::shared_ptr<FileSeqDirWatcher> & watcher)
 	{
-		// try to open the file
-		if (this->canRead(idx)) {
-			break;
-		} else 
-		{
-			// check if waited too long
-			if (maxTotalWait >= 0 && waitCount * waitTimeEach >= maxTotalWait)
-			{ // give up waiting
-                this->log("# Warning from FileSeq::waitForFile: Gave up waiting file index " +
-					to_string(idx) + ": " + this->filename(idx)); 
-                std::cerr << "# Warning from FileSeq::waitForFile: "
-                    << "# Gave up waiting file index " << idx << ".\n";
-				// 1. refresh number of files
-				this->filenames.resize((size_t) idx); 
-				// 2. generate file list file
-				this->generateFileList("fileList.txt");
-				return -1;
-			}
-			// check if eofs file exists (signal of end of files)
-			if (checkEndOfFileSeq == 1 && this->checkEndOfFiles()) {
-                this->log("# Signal of end-of-files (eofs) exists " +
-					std::string("while waiting for file idx ") + to_string(idx) + 
-					+ ": " + this->filename(idx) 
-					+ ". File list refreshes and written to fileList.txt");
-				// 1. refresh number of files
-				this->filenames.resize((size_t) idx); 
-				// 2. generate file list file
-				this->generateFileList("fileList.txt");
-				// 3. return the value indicating eofs
-				return -2;
-			}
+		std::shared_ptr<FileSeqIndex> index = std::make_shared<FileSeqIndex>(_dir, names);
+		if (watcher && watcher->ok()) {
+			watcher->readEvents(); // events before this index are of no use
+			watcher->subscribe(index);
+			index->watcher = watcher;
+		}
+		index->list();
+		return index;
+	}
 
-			// check if this file is the findLastCanReadFile()
-			if (checkLaterFileExisting) {
-				int lastCanReadFile = this->findLastCanReadFile();
-				if (idx < lastCanReadFile)
-				{
-                    this->log("# Warning from FileSeq::waitForFile: "
-						+ std::string("File ") + to_string(lastCanReadFile) +
-						" is found while you are still waiting for file "
-						+ to_string(idx) + ": " + this->filename(idx));
-                    std::cerr << "# Warning from FileSeq::waitForFile: "
-						<< "File " << lastCanReadFile << " is found while you are "
-						<< "still waiting for file " << idx << endl;
-					// Only warn once. If warned, it does not check anymore.
-					checkLaterFileExisting = 0; 
+	// applies pending events of the watcher, or lists the directory again if not watching
+	void sync()
+	{
+		if (watcher) 
+			watcher->readEvents();
+		else
+			list();
+	}
+
+	void mark(const std::string & name, bool exist)
+	{
+		auto it = idxOfName.find(key(name));
+		if (it == idxOfName.end()) return;
+		int i = it->second;
+		exists[i] = exist ? 1 : 0;
+		if (exist) existing.insert(i);
+		else existing.erase(i);
+	}
+	void list()
+	{
+		std::fill(exists.begin(), exists.end(), 0);
+		existing.clear();
+		std::error_code ec;
+		for (fs::directory_iterator it(dir.length() > 0 ? dir : std::string("."), ec), end;
+			!ec && it != end; it.increment(ec))
+			mark(it->path().filename().string(), true);
+	}
+
+	std::string dir;
+	size_t nNames;
+	std::vector<char> exists;   // exists[i]: file i is in the directory
+	std::set<int> existing;     // indices of existing files (sorted, for the last one)
+	std::vector<int> unindexed; // indices of files which are not in the directory listing
+
+private:
+	static std::string key(const std::string & name)
+	{
+#ifdef _WIN32
+		std::string k(name); // file names are case insensitive on Windows
+		for (size_t i = 0; i < k.length(); i++) k[i] = (char) toupper(k[i]);
+		return k;
+#else
+		return name;
+#endif
+	}
+
+	std::unordered_map<std::string, int> idxOfName;
+	std::shared_ptr<FileSeqDirWatcher> watcher; // NULL if not watching
+};
+
+int FileSeqDirWatcher::readEvents(std::vector<std::string> * names)
+{
+	int count = 0;
+#ifdef __linux__
+	if (!ok()) 
+		return 0;
+	// indices which are still in use
+	std::vector<std::shared_ptr<FileSeqIndex> > live;
+	for (size_t i = 0; i < indices.size(); i++)
+		if (std::shared_ptr<FileSeqIndex> index = indices[i].lock())
+			live.push_back(index);
+	indices.assign(live.begin(), live.end());
+	alignas(struct inotify_event) char buf[4096];
+	ssize_t len;
+	bool overflow = false;
+	while ((len = read(fd, buf, sizeof(buf))) > 0) {
+		for (char * p = buf; p < buf + len; ) {
+			struct inotify_event * ev = (struct inotify_event *) p;
+			if (ev->mask & IN_Q_OVERFLOW)
+				overflow = true;
+			else if (ev->len > 0) {
+				bool arrived = (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0;
+				for (size_t i = 0; i < live.size(); i++)
+					live[i]->mark(std::string(ev->name), arrived);
+				if (arrived) {
+					if (names != NULL) names->push_back(std::string(ev->name));
+					count++;
 				}
 			}
-			// wait 
-			std::this_thread::sleep_for(std::chrono::milliseconds(waitTimeEach));
-			waitCount++;
+			p += sizeof(struct inotify_event) + ev->len;
 		}
 	}
-	return 0;
+	if (overflow)
+		for (size_t i = 0; i < live.size(); i++)
+			live[i]->list();
+#endif
+	return count;
 }
 
-int FileSeq::waitForImageFile(int idx, cv::Mat & img, int imread_flag, 
-	int waitTimeEach, int maxTotalWait)
+std::shared_ptr<FileSeqDirWatcher> FileSeq::syncedDirWatcher() const
+{
+	if (!this->dirWatcher || this->dirWatcher->dir != this->theDir)
+		this->dirWatcher = std::make_shared<FileSeqDirWatcher>(this->theDir);
+	return this->dirWatcher;
+}
+
+const FileSeqIndex & FileSeq::syncedIndex() const
+{
+	if (!this->fileIndex || this->fileIndex->dir != this->theDir ||
+		this->fileIndex->nNames != this->filenames.size())
+		this->fileIndex = FileSeqIndex::create(this->theDir, this->filenames, this->syncedDirWatcher());
+	else
+		this->fileIndex->sync();
+	return *this->fileIndex;
+}
+
+int FileSeq::countCanRead() const
+{
+	const FileSeqIndex & index = this->syncedIndex();
+	int count = (int) index.existing.size();
+	for (size_t i = 0; i < index.unindexed.size(); i++)
+		if (this->canRead(index.unindexed[i]))
+			count++;
+	return count;
+}
+
+int FileSeq::waitForDirChange(int timeoutMs, std::vector<std::string> & names)
+{
+	return this->syncedDirWatcher()->wait(timeoutMs, names);
+}
+
+int FileSeq::waitForFileOrImage(int idx, cv::Mat * img, int imread_flag,
+	int waitTimeEach, int maxTotalWait, const std::string & funcName)
 {
 	// Check arguments
 	if (idx >= this->num_files())
 	{
-        this->log("# Error: from FileSeq::waitForImageFile: Wrong idx: " + to_string(idx));
-        std::cerr << "# Error from FileSeq::waitForImageFile: "
-			<< "Wrong idx: " << idx << ". \n";
+        this->log("# Error: from FileSeq::" + funcName + ": Wrong idx: " + to_string(idx));
+		std::cerr << "Error from FileSeq::" << funcName << ": "
+            << "# Wrong idx: " << idx << ". \n";
 		return -1;
 	}
 	if (waitTimeEach < 1)
 	{
-        this->log("# Warning from FileSeq::waitForImageFile: waitTimeEach of a non-positive "
-			+ std::string("value means waiting forever."));
-        std::cerr << "# Warning from FileSeq::waitForImageFile: "
+        this->log("# Warning from FileSeq::" + funcName + ": waitTimeEach of a non-positive "
+			+ std::string("value means waiting forever.")); 
+        std::cerr << "# Warning from FileSeq::" << funcName << ": "
 			<< "waitTimeEach of a non-positive value means waiting forever.\n";
 	}
 
 	// 
-	int waitCount = 0;
+	auto tStart = std::chrono::steady_clock::now();
 	int checkLaterFileExisting = 1;
 	int checkEndOfFileSeq = 1;
+	int laterFilesUnknown = 1; // 1: needs to scan files (findLastCanReadFile()) for later files
+	std::vector<std::string> arrivedNames;
 	while (true)
 	{
-		// try to open the file
+		// try to open the file (and read the image)
 		if (this->canRead(idx)) {
-			img = cv::imread(this->fullPathOfFile(idx), imread_flag); 
-			if (img.cols > 0 && img.rows > 0)
+			if (img == NULL)
 				break;
+			imreadScaledRoi(this->fullPathOfFile(idx), *img, imread_flag, 
+				this->imgDecodeScale, this->imgDecodeRoi);
+			if (img->cols > 0 && img->rows > 0)
+				break;
+			// the file exists but cannot be decoded yet (probably being written)
+		}
+		// check if waited too long
+		long long waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - tStart).count();
+		if (maxTotalWait >= 0 && waitTimeEach >= 1 && waited >= maxTotalWait)
+		{ // give up waiting
+            this->log("# Warning from FileSeq::" + funcName + ": Gave up waiting file index " +
+				to_string(idx) + ": " + this->filename(idx)); 
+            std::cerr << "# Warning from FileSeq::" << funcName << ": "
+                << "# Gave up waiting file index " << idx << ".\n";
+			// 1. refresh number of files
+			this->filenames.resize((size_t) idx); 
+			// 2. generate file list file
+			this->generateFileList("fileList.txt");
+			this->generateFileIndex("fileIndex.txt");
+			return -1;
+		}
+		// check if eofs file exists (signal of end of files)
+		if (checkEndOfFileSeq == 1 && this->checkEndOfFiles()) {
+            this->log("# Signal of end-of-files (eofs) exists " +
+				std::string("while waiting for file idx ") + to_string(idx) + 
+				+ ": " + this->filename(idx) 
+				+ ". File list refreshes and written to fileList.txt");
+			// 1. refresh number of files
+			this->filenames.resize((size_t) idx); 
+			// 2. generate file list file
+			this->generateFileList("fileList.txt");
+			this->generateFileIndex("fileIndex.txt");
+			// 3. return the value indicating eofs
+			return -2;
 		}
-		else
-		{
-			// check if waited too long
-			if (maxTotalWait >= 0 && waitCount * waitTimeEach >= maxTotalWait)
-			{ // give up waiting
-                this->log("# Warning from FileSeq::waitForFile: Gave up waiting file index " +
-					to_string(idx) + ": " + this->filename(idx));
-                std::cerr << "# Warning from FileSeq::waitForFile: "
-                    << "# Gave up waiting file index " << idx << ".\n";
-				// 1. refresh number of files
-				this->filenames.resize((size_t)idx);
-				// 2. generate file list file
-				this->generateFileList("fileList.txt");
-				return -1;
-			}
-			// check if eofs file exists (signal of end of files)
-			if (checkEndOfFileSeq == 1 && this->checkEndOfFiles()) {
-                this->log("# Signal of end-of-files (eofs) exists " +
-					std::string("while waiting for file idx ") + to_string(idx) +
-					+": " + this->filename(idx)
-					+ ". File list refreshes and written to fileList.txt");
-				// 1. refresh number of files
-				this->filenames.resize((size_t)idx);
-				// 2. generate file list file
-				this->generateFileList("fileList.txt");
-				// 3. return the value indicating eofs
-				return -2;
-			}
 
-			// check if this file is the findLastCanReadFile()
-			if (checkLaterFileExisting) {
-				int lastCanReadFile = this->findLastCanReadFile();
-				if (idx < lastCanReadFile)
-				{
-                    this->log("# Warning from FileSeq::waitForFile: "
-						+ std::string("File ") + to_string(lastCanReadFile) +
-						" is found while you are still waiting for file "
-						+ to_string(idx) + ": " + this->filename(idx));
-                    std::cerr << "# Warning from FileSeq::waitForFile: "
-                        << "# File " << lastCanReadFile << " is found while you are "
-						<< "still waiting for file " << idx << endl;
-					// Only warn once. If warned, it does not check anymore.
-					checkLaterFileExisting = 0;
-				}
+		// check if a later file exists (scans all files only if arrivals are unknown,
+		// i.e., the first check or polling without inotify)
+		if (checkLaterFileExisting) {
+			int lastCanReadFile = -1;
+			if (laterFilesUnknown)
+				lastCanReadFile = this->findLastCanReadFile();
+			else
+				for (size_t i = 0; i < arrivedNames.size(); i++)
+					lastCanReadFile = std::max(lastCanReadFile, this->findIndexOfFile(arrivedNames[i]));
+			if (idx < lastCanReadFile)
+			{
+                this->log("# Warning from FileSeq::" + funcName + ": "
+					+ std::string("File ") + to_string(lastCanReadFile) +
+					" is found while you are still waiting for file "
+					+ to_string(idx) + ": " + this->filename(idx));
+                std::cerr << "# Warning from FileSeq::" << funcName << ": "
+					<< "File " << lastCanReadFile << " is found while you are "
+					<< "still waiting for file " << idx << endl;
+				// Only warn once. If warned, it does not check anymore.
+				checkLaterFileExisting = 0; 
 			}
-			// wait 
-			std::this_thread::sleep_for(std::chrono::milliseconds(waitTimeEach));
-			waitCount++;
 		}
+		// wait (until a file arrives, or waitTimeEach)
+		arrivedNames.clear();
+		laterFilesUnknown = (this->waitForDirChange(std::max(waitTimeEach, 1), arrivedNames) < 0) ? 1 : 0;
 	}
 	return 0;
 }
 
+int FileSeq::waitForFile(int idx, int waitTimeEach, int maxTotalWait) 
+{
+	return this->waitForFileOrImage(idx, NULL, 0, waitTimeEach, maxTotalWait, "waitForFile");
+}
 
-int FileSeq::findLastCanReadFile() const
+int FileSeq::waitForImageFile(int idx, cv::Mat & img, int imread_flag, 
+	int waitTimeEach, int maxTotalWait)
 {
-	for (int i = this->num_files() - 1; i >= 0; i--)
-	{
-		if (this->canRead(i))
-			return i;
-	}	
+	return this->waitForFileOrImage(idx, &img, imread_flag, waitTimeEach, maxTotalWait, "waitForImageFile");
+}
+int FileSeq::setDecodeOption(int scale, cv::Rect roi)
+{
+	if (reducedImreadFlag(cv::IMREAD_GRAYSCALE, scale) < 0) {
+		std::cerr << "# Error from FileSeq::setDecodeOption: Scale must be 1, 2, 4, or 8 (" 
+			<< scale << ").\n";
+		return -1;
+	}
+	// (the region does not start at negative coordinates)
+	if (roi.x < 0) { roi.width += roi.x; roi.x = 0; }
+	if (roi.y < 0) { roi.height += roi.y; roi.y = 0; }
+	if (roi.width <= 0 || roi.height <= 0) 
+		roi = cv::Rect();
+	this->imgDecodeScale = scale;
+	this->imgDecodeRoi = roi;
+	return 0;
+}
+
+int FileSeq::decodeScale() const
+{
+	return this->imgDecodeScale;
+}
+
+cv::Rect FileSeq::decodeRoi() const
+{
+	return this->imgDecodeRoi;
+}
+
+cv::Point FileSeq::decodeOffset() const
+{
+	int s = this->imgDecodeScale;
+	return cv::Point(this->imgDecodeRoi.x / s * s, this->imgDecodeRoi.y / s * s);
+}
+
+int FileSeq::reducedImreadFlag(int imread_flag, int scale)
+{
+	if (scale == 1) 
+		return imread_flag;
+	if (imread_flag == cv::IMREAD_GRAYSCALE) {
+		if (scale == 2) return cv::IMREAD_REDUCED_GRAYSCALE_2;
+		if (scale == 4) return cv::IMREAD_REDUCED_GRAYSCALE_4;
+		if (scale == 8) return cv::IMREAD_REDUCED_GRAYSCALE_8;
+	}
+	else if (imread_flag == cv::IMREAD_COLOR) {
+		if (scale == 2) return cv::IMREAD_REDUCED_COLOR_2;
+		if (scale == 4) return cv::IMREAD_REDUCED_COLOR_4;
+		if (scale == 8) return cv::IMREAD_REDUCED_COLOR_8;
+	}
 	return -1;
 }
 
+int FileSeq::imreadScaledRoi(const std::string & path, cv::Mat & img, int imread_flag,
+	int scale, cv::Rect roi)
+{
+	int flag = reducedImreadFlag(imread_flag, scale);
+	if (flag == -1) {
+		img.release();
+		return -1;
+	}
+	img = cv::imread(path, flag);
+	if (img.cols <= 0 || img.rows <= 0)
+		return -1;
+	if (roi.width > 0 && roi.height > 0) {
+		// region in the decoded (reduced) image, covering roi
+		int x0 = std::max(roi.x, 0) / scale, y0 = std::max(roi.y, 0) / scale;
+		int x1 = (roi.x + roi.width + scale - 1) / scale, y1 = (roi.y + roi.height + scale - 1) / scale;
+		cv::Rect r = cv::Rect(x0, y0, x1 - x0, y1 - y0) & cv::Rect(0, 0, img.cols, img.rows);
+		if (r.width <= 0 || r.height <= 0) {
+			img.release();
+			return -1;
+		}
+		img = img(r).clone(); // (the full image is released)
+	}
+	return 0;
+}
+
+int FileSeq::findLastCanReadFile() const
+{
+	const FileSeqIndex & index = this->syncedIndex();
+	int last = -1;
+	for (auto it = index.unindexed.rbegin(); it != index.unindexed.rend(); ++it)
+		if (this->canRead(*it)) {
+			last = *it;
+			break;
+		}
+	// the last existing file is normally readable, unless it is being written
+	for (auto it = index.existing.rbegin(); it != index.existing.rend() && *it > last; ++it)
+		if (this->canRead(*it))
+			return *it;
+	return last;
+}
+
 int FileSeq::checkEndOfFiles(std::string eofs) const
 {
 	ifstream if_eofs(this->theDir + eofs);
@@ -619,6 +865,28 @@ int FileSeq::generateFileList(std::string fileListFile)
 	return 0;
 }
 
+int FileSeq::generateFileIndex(std::string fileIndexFile) const
+{
+	const FileSeqIndex & index = this->syncedIndex();
+	std::ofstream of(this->theDir + fileIndexFile);
+	if (!of.is_open()) {
+		std::cerr << "# Error from FileSeq::generateFileIndex: Cannot open " 
+			<< this->theDir + fileIndexFile << "\n";
+		return -1;
+	}
+	for (int i = 0; i < this->num_files(); i++)
+	{
+		bool exists = i < (int) index.exists.size() && index.exists[i] != 0;
+		if (!exists && std::find(index.unindexed.begin(), index.unindexed.end(), i) 
+			!= index.unindexed.end())
+			exists = this->canRead(i) != 0;
+		of << i << " " << (exists ? 1 : 0) << " " << this->filenames[i] << endl;
+	}
+	this->log("Generated a file-index file: " + fileIndexFile); 
+	of.close(); 
+	return 0;
+}
+
 //! Returns vector of full-path file names
 //!
 std::vector<std::string> FileSeq::allFullPathFileNames() const
@@ -5,11 +5,15 @@
 #include <vector>
 #include <cstring>
 #include <cstdlib>
+#include <memory>
 
 #include <opencv2/opencv.hpp> // for cv::imread
 
 using namespace std;
 
+class FileSeqDirWatcher; // waits for files arriving in a directory (see FileSeq.cpp)
+class FileSeqIndex; // index of existing files of a FileSeq (see FileSeq.cpp)
+
 //! FileSeq manages a sequence of files. 
 /*!
   FileSeq manages a sequence of files. It is originally designed for 
@@ -207,6 +211,10 @@ public:
 
 	//! Counts existing files (which can be read) 
 	/*! 
+	\details Files are counted from an index of existing files, which is built 
+	from one listing of the directory and then updated by inotify events on Linux 
+	(elsewhere the directory is listed again at each call). Files are not opened 
+	one by one, so a file still being written may be counted. 
 	\return number of files which exist and can be read
 	*/
 	int countCanRead() const;
@@ -219,6 +227,10 @@ public:
 	the eofs file appears (see int checkEndOfFiles()), this function returns.
 	This function is not const because if eofs (signal of end-of-files) appears, this 
 	function cut off the filenames vectors. 
+	On Linux, it sleeps on inotify of the directory and wakes up as soon as a file 
+	is closed after writing (or moved in), with waitTimeEach as the longest sleep 
+	(polling as a fallback, e.g., for network drives). Elsewhere it polls every 
+	waitTimeEach. 
 	\param idx index of the file
 	\param waitTimeEach waiting time (in ms) between each check
 	\param maxTotalWait maximum waiting time (in ms) before giving up. 
@@ -255,10 +267,48 @@ public:
 	int waitForImageFile(int idx, cv::Mat & img, int imread_flag = cv::IMREAD_COLOR, 
 		int waitTimeEach = 50, int maxTotalWait = 86400 * 1000);
 
+	//! Sets how images are decoded by waitForImageFile() (and FileSeqPrefetcher).
+	/*!
+	\details
+	Large still images (24 to 50 MP) can be decoded at a reduced scale 
+	(cv::IMREAD_REDUCED_GRAYSCALE_2/4/8 or cv::IMREAD_REDUCED_COLOR_2/4/8; JPEG 
+	images are then decoded with DCT scaling, much faster than full decoding), 
+	e.g., for previews. A region (roi) of the image can also be given, e.g., the 
+	bounding region of all search windows of tracking, so that only the region is 
+	kept. (cv::imread() cannot decode a part of an image, so the region is cut out 
+	right after decoding and the full image is released at once.) 
+	Pixel (x, y) of a decoded image is pixel (decodeOffset().x + x * scale, 
+	decodeOffset().y + y * scale) of the full image. 
+	\param scale 1 (full scale), 2, 4, or 8
+	\param roi region in the full image. An empty rect for the whole image. 
+	\return 0: success. -1: invalid scale. 
+	*/
+	int setDecodeOption(int scale = 1, cv::Rect roi = cv::Rect());
+	int decodeScale() const;
+	cv::Rect decodeRoi() const;
+
+	//! Returns the position (in the full image) of pixel (0, 0) of decoded images
+	//! (see setDecodeOption()).
+	cv::Point decodeOffset() const;
+
+	//! Reads an image file at a reduced scale and only keeps a region (see setDecodeOption()).
+	/*!
+	\return 0: success. -1: the image cannot be read (or invalid scale or flag).
+	*/
+	static int imreadScaledRoi(const std::string & path, cv::Mat & img, int imread_flag,
+		int scale = 1, cv::Rect roi = cv::Rect());
+
+	//! Returns the cv::imread() flag which decodes at a reduced scale (cv::IMREAD_REDUCED_...),
+	//! imread_flag itself if scale is 1, or -1 if not available (scale is not 1, 2, 4, or 8, 
+	//! or imread_flag is neither cv::IMREAD_GRAYSCALE nor cv::IMREAD_COLOR). 
+	static int reducedImreadFlag(int imread_flag, int scale);
+
 	
 	//! Returns the index of the last file.
 	/*! For example, if there are files 0, 1, 2, 3, 9, the
 	    findLastCanReadFile() returns 9. 
+	    The last file is found from the index of existing files (see countCanRead())
+	    and then checked by canRead(). 
 	\return the index of the last existing (can-read) file.
 	        If no file can be read, it returns -1.
 	*/
@@ -280,6 +330,17 @@ public:
 	*/
 	int generateFileList(std::string fileListFile);
 
+	//! Generates file-index file. 
+	/*!
+	\details 
+	Writes a line "index exists(0/1) filename" of every file, according to the
+	index of existing files (see countCanRead()). The file is written in the 
+	directory of the files, normally next to the file-list file. 
+	\param fileIndexFile the file name of the file-index file. 
+	\return 0: success. -1: the file cannot be written. 
+	*/
+	int generateFileIndex(std::string fileIndexFile = std::string("fileIndex.txt")) const;
+
     //! Returns vector of full-path file names
     //!
     std::vector<std::string> allFullPathFileNames() const;
@@ -313,12 +374,30 @@ public:
         node["FileSeq_theDir"] >> this->theDir;
         node["FileSeq_filenames"] >> this->filenames;
         node["FileSeq_logFilename"] >> this->logFilename;
+        this->fileIndex.reset();
     }
 
 protected:
+	//! the implementation of waitForFile() (img is NULL) and waitForImageFile()
+	int waitForFileOrImage(int idx, cv::Mat * img, int imread_flag,
+		int waitTimeEach, int maxTotalWait, const std::string & funcName);
+	//! waits up to timeoutMs for files to arrive in the directory. 
+	//! \return number of arrived files (their names appended to names), 0 for time-out,
+	//! -1 if arrivals are unknown (no inotify, only slept)
+	int waitForDirChange(int timeoutMs, std::vector<std::string> & names);
+	//! returns the index of existing files, (re)built if the files are changed, 
+	//! otherwise brought up to date
+	const FileSeqIndex & syncedIndex() const;
+	//! returns the watcher of the directory (shared by waiting and the index of existing files)
+	std::shared_ptr<FileSeqDirWatcher> syncedDirWatcher() const;
+
 	std::string theDir; 
 	std::vector<std::string> filenames; 
 	std::string logFilename; 
+	int imgDecodeScale = 1;   // decode option of images (see setDecodeOption())
+	cv::Rect imgDecodeRoi;
+	mutable std::shared_ptr<FileSeqDirWatcher> dirWatcher; // (shared by copies, created when waiting or indexing)
+	mutable std::shared_ptr<FileSeqIndex> fileIndex; // index of existing files (built when queried)
 };
 
 static void write(cv::FileStorage& fs, const std::string&, const FileSeq& fsq)
@@ -0,0 +1,170 @@
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+#include <opencv2/opencv.hpp>
+
+#include "FileSeqPrefetcher.h"
+
+using namespace std;
+
+static size_t bytesOfImage(const cv::Mat & img)
+{
+	return img.total() * img.elemSize();
+}
+
+FileSeqPrefetcher::FileSeqPrefetcher()
+{
+}
+
+FileSeqPrefetcher::~FileSeqPrefetcher()
+{
+	this->stop();
+}
+
+int FileSeqPrefetcher::start(FileSeq & _fsq, int _imreadFlag, int _nAhead, int nThreads,
+	double maxMegaBytes, int _waitTimeEach)
+{
+	if (_nAhead < 1 || nThreads < 1 || maxMegaBytes < 0. || _waitTimeEach < 1)
+		return -1;
+	this->stop();
+	this->fsq = &_fsq;
+	this->paths = _fsq.allFullPathFileNames();
+	this->nPaths = (int) this->paths.size();
+	this->imreadFlag = _imreadFlag;
+	this->decodeScale = _fsq.decodeScale();
+	this->decodeRoi = _fsq.decodeRoi();
+	this->nAhead = _nAhead;
+	this->waitTimeEach = _waitTimeEach;
+	this->maxBytes = (size_t) (maxMegaBytes * 1024. * 1024.);
+	this->queuedBytes = this->lastImgBytes = 0;
+	this->next = 0;
+	this->stopping = false;
+	this->nHits = this->nMisses = 0;
+	for (int i = 0; i < nThreads; i++)
+		this->workers.push_back(std::thread(&FileSeqPrefetcher::workerLoop, this));
+	return 0;
+}
+
+void FileSeqPrefetcher::stop()
+{
+	{
+		std::lock_guard<std::mutex> lk(mtx);
+		stopping = true;
+	}
+	cvWork.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+	slots.clear();
+	queuedBytes = 0;
+}
+
+void FileSeqPrefetcher::dropSlotsOutside(int first, int last)
+{
+	for (auto it = slots.begin(); it != slots.end(); ) {
+		if (it->first < first || it->first > last) {
+			if (it->second.state == SLOT_DONE)
+				queuedBytes -= bytesOfImage(it->second.img);
+			it = slots.erase(it); // (a worker decoding it discards its result)
+		}
+		else
+			++it;
+	}
+}
+
+void FileSeqPrefetcher::workerLoop()
+{
+	std::unique_lock<std::mutex> lk(mtx);
+	while (!stopping) {
+		// the first index in window which is neither decoded nor being decoded,
+		// or missing and due to retry
+		int64 now = cv::getTickCount();
+		int idx = -1;
+		int last = std::min(next + nAhead, nPaths) - 1;
+		for (int i = next; i <= last; i++) {
+			auto it = slots.find(i);
+			if (it == slots.end() ||
+				(it->second.state == SLOT_MISSING && it->second.retryTick <= now)) {
+				idx = i;
+				break;
+			}
+		}
+		bool memoryOk = queuedBytes == 0 || queuedBytes + lastImgBytes <= maxBytes;
+		if (idx < 0 || memoryOk == false) {
+			cvWork.wait_for(lk, std::chrono::milliseconds(waitTimeEach));
+			continue;
+		}
+		slots[idx].state = SLOT_DECODING;
+		string path = paths[idx];
+
+		// decode (unlocked)
+		lk.unlock();
+		cv::Mat img;
+		std::ifstream file(path);
+		if (file.is_open()) {
+			file.close();
+			FileSeq::imreadScaledRoi(path, img, imreadFlag, decodeScale, decodeRoi);
+		}
+		lk.lock();
+
+		auto it = slots.find(idx);
+		if (it == slots.end())
+			continue; // dropped while decoding
+		if (img.cols > 0 && img.rows > 0) {
+			it->second.state = SLOT_DONE;
+			it->second.img = img;
+			lastImgBytes = bytesOfImage(img);
+			queuedBytes += lastImgBytes;
+		}
+		else {
+			it->second.state = SLOT_MISSING;
+			it->second.retryTick = cv::getTickCount() +
+				(int64) (waitTimeEach * 1e-3 * cv::getTickFrequency());
+		}
+		cvDone.notify_all();
+	}
+}
+
+int FileSeqPrefetcher::waitForImageFile(int idx, cv::Mat & img, int maxTotalWait)
+{
+	if (fsq == NULL)
+		return -1;
+	std::unique_lock<std::mutex> lk(mtx);
+	if (running() && idx >= 0 && idx < nPaths) {
+		dropSlotsOutside(idx, idx + nAhead);
+		next = idx;
+		// wait if a worker is decoding it
+		cvDone.wait(lk, [&]() {
+			auto it = slots.find(idx);
+			return it == slots.end() || it->second.state != SLOT_DECODING;
+		});
+		auto it = slots.find(idx);
+		if (it != slots.end() && it->second.state == SLOT_DONE) {
+			img = it->second.img;
+			queuedBytes -= bytesOfImage(img);
+			slots.erase(it);
+			next = idx + 1;
+			nHits++;
+			lk.unlock();
+			cvWork.notify_all();
+			return 0;
+		}
+		// not readable yet: this thread waits (below); workers go on with following files
+		if (it != slots.end())
+			slots.erase(it);
+		next = idx + 1;
+	}
+	nMisses++;
+	lk.unlock();
+	cvWork.notify_all();
+
+	int ret = fsq->waitForImageFile(idx, img, imreadFlag, waitTimeEach, maxTotalWait);
+	if (ret != 0) {
+		// the file list is truncated (time-out or eofs)
+		std::lock_guard<std::mutex> lk2(mtx);
+		nPaths = std::min(nPaths, fsq->num_files());
+		dropSlotsOutside(0, nPaths - 1);
+	}
+	return ret;
+}
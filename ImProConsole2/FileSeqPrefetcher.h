@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <opencv2/opencv.hpp>
+
+#include "FileSeq.h"
+
+//! FileSeqPrefetcher reads (decodes) images of a FileSeq ahead on background threads
+/*!
+\details While the analysis of frame i runs, frames i + 1 ... i + nAhead are decoded by
+background threads into a bounded queue, so that decoding large (e.g., 24 MP JPEG) images
+is not on the analysis thread. waitForImageFile() has the same semantics as
+FileSeq::waitForImageFile(): if a file is not decoded yet (e.g., it is still being
+written in an online test), it waits on the calling thread with the FileSeq (time-out,
+eofs signal and truncation of the file list), while background threads keep retrying
+the following files every waitTimeEach ms. The FileSeq must not be changed by others
+while prefetching (the prefetcher truncates it the same as FileSeq::waitForImageFile()).
+Usage:
+    FileSeqPrefetcher prefetcher;
+    prefetcher.start(fsq, cv::IMREAD_GRAYSCALE);
+    for (int i = 0; i < fsq.num_files(); i++) {
+        if (prefetcher.waitForImageFile(i, img) != 0) break;
+        ...
+    }
+*/
+class FileSeqPrefetcher
+{
+public:
+	FileSeqPrefetcher();
+	~FileSeqPrefetcher();
+
+	//! starts background threads that decode images of fsq ahead.
+	//! \param fsq file sequence (must live longer than prefetching)
+	//! \param imreadFlag flag of cv::imread() (with the decode option of fsq, see FileSeq::setDecodeOption())
+	//! \param nAhead maximum number of images decoded ahead of the last requested one
+	//! \param nThreads number of background threads
+	//! \param maxMegaBytes memory cap of decoded images in queue (at least one image is always allowed)
+	//! \param waitTimeEach waiting time (ms) between checks of a file which cannot be read yet
+	//! \return 0: success. -1: invalid arguments.
+	int start(FileSeq & fsq, int imreadFlag = cv::IMREAD_COLOR, int nAhead = 4, int nThreads = 2,
+		double maxMegaBytes = 2048., int waitTimeEach = 50);
+
+	//! gets image idx, the same as FileSeq::waitForImageFile(idx, img, imreadFlag, waitTimeEach, maxTotalWait).
+	//! Requesting indices in increasing order (not necessarily consecutive) makes the best use of prefetching.
+	//! \return 0: the file is read. -1: time-out. -2: a signal of end of FileSeq is found.
+	int waitForImageFile(int idx, cv::Mat & img, int maxTotalWait = 86400 * 1000);
+
+	//! stops and joins background threads, and releases decoded images.
+	void stop();
+
+	bool running() const { return workers.size() > 0; }
+
+	int nHits = 0;   // statistics: images that were ready when requested
+	int nMisses = 0; // statistics: images read (or waited for) on the calling thread
+
+protected:
+	enum SlotState { SLOT_DECODING, SLOT_DONE, SLOT_MISSING };
+	struct Slot {
+		int state = SLOT_DECODING;
+		cv::Mat img;
+		int64 retryTick = 0; // tick count after which a missing file is tried again
+	};
+	void workerLoop();
+	void dropSlotsOutside(int first, int last); // (with mutex locked)
+
+	FileSeq * fsq = NULL;
+	std::vector<std::string> paths; // full paths (copied, so that threads do not access fsq)
+	int nPaths = 0;
+	int imreadFlag = cv::IMREAD_COLOR;
+	int decodeScale = 1;  // decode option (copied from fsq, see FileSeq::setDecodeOption())
+	cv::Rect decodeRoi;
+	int nAhead = 4;
+	int waitTimeEach = 50;
+	size_t maxBytes = 0, queuedBytes = 0, lastImgBytes = 0;
+
+	std::map<int, Slot> slots; // images decoded (or being decoded, or missing) ahead
+	int next = 0;              // first index to decode
+	bool stopping = false;
+	std::mutex mtx;
+	std::condition_variable cvWork, cvDone;
+	std::vector<std::thread> workers;
+};
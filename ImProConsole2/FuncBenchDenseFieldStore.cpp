@@ -0,0 +1,113 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "impro_util.h"
+#include "DenseFieldStore.h"
+
+using namespace std;
+
+// byte-wise comparison of two CV_32FC2 fields of the same size
+static bool identicalFields(const cv::Mat & a, const cv::Mat & b)
+{
+	if (a.type() != b.type() || a.rows != b.rows || a.cols != b.cols)
+		return false;
+	size_t rowBytes = a.cols * a.elemSize();
+	for (int i = 0; i < a.rows; i++)
+		if (memcmp(a.ptr(i), b.ptr(i), rowBytes) != 0)
+			return false;
+	return true;
+}
+
+// Round-trip check and benchmark of DenseFieldStore: writes random drifting fields
+// (as image points of vidTrack) to a store (raw and compressed), closes and reopens it, and
+// reads all frames (frame by frame, and by ranges), compared with the xml(.gz) export.
+int FuncBenchDenseFieldStore(int argc, char** argv)
+{
+	printf("# Enter number of frames (e.g., 300):\n");
+	int nFrame = readIntFromCin(1, 10000000);
+	printf("# Enter number of points in x and y (e.g., 192 108):\n");
+	int nx = readIntFromCin(1, 100000);
+	int ny = readIntFromCin(1, 100000);
+
+	DenseFieldInfo info;
+	info.videoWidth = 1920;
+	info.videoHeight = 1080;
+	info.nFrames = nFrame;
+	info.fps = 29.97;
+	info.nxPoint = nx;
+	info.nyPoint = ny;
+	info.winSize = cv::Size(32, 32);
+	cv::RNG rng(12345);
+	vector<cv::Mat> fields(nFrame);
+	cv::Mat field(1, nx * ny, CV_32FC2), drift(1, nx * ny, CV_32FC2);
+	rng.fill(field, cv::RNG::UNIFORM, 0., 1000.);
+	for (int i = 0; i < nFrame; i++) {
+		rng.fill(drift, cv::RNG::NORMAL, 0., 0.05);
+		field += drift;
+		fields[i] = field.clone();
+	}
+
+	string names[2] = { "store, raw", "store, compressed" };
+	string files[2] = { "benchDenseFieldStore_raw.dfs", "benchDenseFieldStore_cmp.dfs" };
+	bool allOk = true;
+	printf("# %d frames, %d x %d points\n", nFrame, nx, ny);
+	printf("# %-20s %12s %14s %14s %14s %10s\n", "Method", "Write(ms)", "ReadFrame(ms)", "ReadRange(ms)", "Bytes", "Identical");
+	for (int k = 0; k < 2; k++) {
+		DenseFieldStore store;
+		double t0 = getWallTime();
+		bool ok = store.create(files[k], info, 32, k == 1) == 0;
+		for (int i = 0; ok && i < nFrame; i++)
+			ok = store.appendFrame(fields[i]) == 0;
+		ok = store.close() == 0 && ok;
+		double t1 = getWallTime();
+		// reopens the store, and reads frame by frame and by ranges
+		ok = ok && store.open(files[k]) == 0 && store.nFrames() == nFrame && store.info().nPoints() == nx * ny;
+		cv::Mat f, range;
+		for (int i = 0; ok && i < nFrame; i++)
+			ok = store.readFrame(i, f) == 0 && identicalFields(f, fields[i]);
+		double t2 = getWallTime();
+		for (int i = 0; ok && i < nFrame; i += 50) {
+			int n = std::min(50, nFrame - i);
+			ok = store.readFrames(i, n, range) == 0;
+			for (int j = 0; ok && j < n; j++)
+				ok = identicalFields(range.row(j), fields[i + j]);
+		}
+		double t3 = getWallTime();
+		store.close();
+		FILE * fp = NULL;
+		long long bytes = 0;
+		if (fopen_s(&fp, files[k].c_str(), "rb") == 0 && fp != NULL) {
+			fseek(fp, 0, SEEK_END);
+			bytes = (long long) ftell(fp);
+			fclose(fp);
+		}
+		printf("  %-20s %12.3f %14.3f %14.3f %14lld %10s\n", names[k].c_str(),
+			(t1 - t0) * 1000., (t2 - t1) * 1000., (t3 - t2) * 1000., bytes, ok ? "yes" : "no");
+		allOk = allOk && ok;
+	}
+	// export to xml.gz and read it back (as vidImPointsQ4 or vidOptflowToVelocity does)
+	string fileXml = "benchDenseFieldStore.xml.gz";
+	double t0 = getWallTime();
+	int nExported = DenseFieldStore::exportXml(files[1], fileXml);
+	double t1 = getWallTime();
+	DenseFieldStore xml;
+	bool ok = nExported == nFrame && xml.open(fileXml) == 0 && xml.nFrames() == nFrame;
+	cv::Mat f;
+	for (int i = 0; ok && i < nFrame; i++)
+		ok = xml.readFrame(i, f) == 0 && identicalFields(f, fields[i]);
+	double t2 = getWallTime();
+	xml.close();
+	printf("  %-20s %12.3f %14.3f %14s %14s %10s\n", "xml.gz (export)", (t1 - t0) * 1000., (t2 - t1) * 1000.,
+		"-", "-", ok ? "yes" : "no");
+	allOk = allOk && ok;
+	remove(files[0].c_str());
+	remove(files[1].c_str());
+	remove(fileXml.c_str());
+	printf("# Round trip %s.\n", allOk ? "passed" : "FAILED");
+	return allOk ? 0 : -1;
+}
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "impro_util.h"
+#include "Points2fHistoryData.h"
+#include "Points3dHistoryData.h"
+
+using namespace std;
+
+// byte-wise comparison of two Mats (type, size, and every byte of data)
+static bool identicalMats(const cv::Mat & a, const cv::Mat & b)
+{
+	if (a.type() != b.type() || a.size() != b.size())
+		return false;
+	size_t rowBytes = a.cols * a.elemSize();
+	for (int i = 0; i < a.rows; i++)
+		if (memcmp(a.ptr(i), b.ptr(i), rowBytes) != 0)
+			return false;
+	return true;
+}
+
+// times nRepeat serialize() + deserialize() round trips of a into b, by the
+// in-memory form (a.serialize()) or by the former temporary xml file
+// (a.IoData::serialize()), and checks b against a.
+template <class T>
+static void benchSerialize(T & a, T & b, int nRepeat, bool inMemory,
+	double & tSer, double & tDes, size_t & nBytes, bool & identical)
+{
+	tSer = tDes = 0.0;
+	identical = true;
+	for (int i = 0; i < nRepeat; i++) {
+		double t0 = getWallTime();
+		vector<unsigned char> bytes = inMemory ? a.serialize() : a.IoData::serialize();
+		double t1 = getWallTime();
+		int ret = inMemory ? b.deserialize(bytes) : b.IoData::deserialize(bytes);
+		double t2 = getWallTime();
+		tSer += t1 - t0;
+		tDes += t2 - t1;
+		nBytes = bytes.size();
+		identical = identical && ret == 0 && identicalMats(a.getMat(), b.getMat());
+		if (inMemory)
+			identical = identical && b.serialize() == bytes;
+	}
+}
+
+// Benchmark of IoData serialization: in-memory binary form vs. the former
+// temporary xml file, on random point histories (Points2fHistoryData with
+// template rects, and Points3dHistoryData).
+int FuncBenchIoData(int argc, char** argv)
+{
+	printf("# Enter number of steps (e.g., 1000):\n");
+	int nStep = readIntFromCin(1, 10000000);
+	printf("# Enter number of points (e.g., 100):\n");
+	int nPoint = readIntFromCin(1, 10000000);
+	printf("# Enter number of repeats (e.g., 10):\n");
+	int nRepeat = readIntFromCin(1, 100000);
+
+	cv::RNG rng(12345);
+	Points2fHistoryData p2a, p2b;
+	p2a.resize(nStep, nPoint);
+	rng.fill(p2a.getMat(), cv::RNG::UNIFORM, -1e4, 1e4);
+	for (int iPoint = 0; iPoint < nPoint; iPoint++)
+		p2a.setRect(iPoint, cv::Rect(rng.uniform(0, 4000), rng.uniform(0, 3000),
+			rng.uniform(8, 128), rng.uniform(8, 128)));
+	Points3dHistoryData p3a, p3b;
+	p3a.resize(nStep, nPoint);
+	rng.fill(p3a.getMat(), cv::RNG::UNIFORM, -1e4, 1e4);
+
+	vector<string> names{ "Points2f, xml file", "Points2f, in memory",
+		"Points3d, xml file", "Points3d, in memory" };
+	vector<double> tSer(4), tDes(4);
+	vector<size_t> nBytes(4);
+	bool identical[4];
+	benchSerialize(p2a, p2b, nRepeat, false, tSer[0], tDes[0], nBytes[0], identical[0]);
+	benchSerialize(p2a, p2b, nRepeat, true, tSer[1], tDes[1], nBytes[1], identical[1]);
+	benchSerialize(p3a, p3b, nRepeat, false, tSer[2], tDes[2], nBytes[2], identical[2]);
+	benchSerialize(p3a, p3b, nRepeat, true, tSer[3], tDes[3], nBytes[3], identical[3]);
+
+	printf("# %d steps, %d points, %d repeats\n", nStep, nPoint, nRepeat);
+	printf("# %-22s %16s %18s %14s %10s\n", "Method", "Serialize(ms)", "Deserialize(ms)", "Bytes", "Identical");
+	for (int i = 0; i < 4; i++)
+		printf("  %-22s %16.3f %18.3f %14zu %10s\n", names[i].c_str(),
+			tSer[i] * 1000. / nRepeat, tDes[i] * 1000. / nRepeat, nBytes[i], identical[i] ? "yes" : "no");
+	printf("# Speedup of round trip: Points2f %.1fx, Points3d %.1fx\n",
+		(tSer[0] + tDes[0]) / std::max(tSer[1] + tDes[1], 1e-9),
+		(tSer[2] + tDes[2]) / std::max(tSer[3] + tDes[3], 1e-9));
+	return 0;
+}
@@ -0,0 +1,165 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <opencv2/opencv.hpp>
+
+#include "impro_util.h"
+#include "Points2fHistoryData.h"
+#include "TextNumberParser.h"
+#include "improFileIO.h"
+
+using namespace std;
+
+// byte-wise comparison of two Mats (type, size, and every byte of data)
+static bool identicalMats(const cv::Mat & a, const cv::Mat & b)
+{
+	if (a.type() != b.type() || a.size() != b.size())
+		return false;
+	size_t rowBytes = a.cols * a.elemSize();
+	for (int i = 0; i < a.rows; i++)
+		if (memcmp(a.ptr(i), b.ptr(i), rowBytes) != 0)
+			return false;
+	return true;
+}
+
+// the former readMatFromCsvFile<double>() (getline, stringstream, and stod per value),
+// kept as the reference of FuncBenchTextRead
+static cv::Mat legacyReadMatFromCsvFile(string fname, char commentChar = '#')
+{
+	std::ifstream inputfile(fname);
+	std::string current_line;
+	std::vector<std::vector<double> > all_data;
+	while (std::getline(inputfile, current_line)) {
+		std::vector<double> values;
+		std::stringstream temp(current_line);
+		std::string single_value;
+		while (std::getline(temp, single_value, ',')) {
+			single_value.erase(std::remove_if(single_value.begin(), single_value.end(),
+				[](char c) { return (c == ' ' || c == '\t'); }), single_value.end());
+			if (single_value[0] == commentChar) break;
+			try {
+				values.push_back(std::stod(single_value));
+			}
+			catch (...) {
+			}
+			if (single_value.find(commentChar) != std::string::npos) break;
+		}
+		if (values.size() > 0)
+			all_data.push_back(values);
+	}
+	cv::Mat mat;
+	if (all_data.size() >= 1 && all_data[0].size() >= 1) {
+		mat = cv::Mat::zeros((int) all_data.size(), (int) all_data[0].size(), CV_64F);
+		for (int row = 0; row < (int) all_data.size(); row++)
+			for (int col = 0; col < mat.cols && col < (int) all_data[row].size(); col++)
+				mat.at<double>(row, col) = all_data[row][col];
+	}
+	return mat;
+}
+
+// the former Points2fHistoryData::readFromTxt() (readDoubleFromIstream per value),
+// kept as the reference of FuncBenchTextRead
+static int legacyReadPoints2fTxt(string fileTxt, cv::Mat & dat, vector<cv::Rect> & rects)
+{
+	ifstream ifTxt(fileTxt);
+	if (ifTxt.is_open() == false)
+		return -1;
+	int nStep = readIntFromIstream(ifTxt);
+	int nPoint = readIntFromIstream(ifTxt);
+	if (nStep <= 0 || nPoint <= 0)
+		return -1;
+	dat = cv::Mat::zeros(nStep, nPoint, CV_32FC2);
+	for (int iStep = 0; iStep < nStep; iStep++) {
+		for (int iPoint = 0; iPoint < nPoint; iPoint++) {
+			dat.at<cv::Point2f>(iStep, iPoint).x = (float) readDoubleFromIstream(ifTxt);
+			dat.at<cv::Point2f>(iStep, iPoint).y = (float) readDoubleFromIstream(ifTxt);
+		}
+	}
+	rects.clear();
+	for (int iPoint = 0; iPoint < nPoint; iPoint++) {
+		if (ifTxt.eof()) break;
+		int x = readIntFromIstream(ifTxt);
+		int y = readIntFromIstream(ifTxt);
+		int w = readIntFromIstream(ifTxt);
+		int h = readIntFromIstream(ifTxt);
+		if (ifTxt.eof()) break;
+		rects.push_back(cv::Rect(x, y, w, h));
+	}
+	return 0;
+}
+
+// Benchmark of text readers: the former istream/stod readers vs. TextNumberParser
+// (memory-mapped, from_chars), on a random point history written as txt
+// (Points2fHistoryData::writeToTxt()) and as csv (writeMatToCsvFile()).
+int FuncBenchTextRead(int argc, char** argv)
+{
+	printf("# Enter number of steps (e.g., 1000):\n");
+	int nStep = readIntFromCin(1, 10000000);
+	printf("# Enter number of points (e.g., 100):\n");
+	int nPoint = readIntFromCin(1, 10000000);
+	printf("# Enter number of repeats (e.g., 3):\n");
+	int nRepeat = readIntFromCin(1, 100000);
+
+	cv::RNG rng(12345);
+	Points2fHistoryData p2a, p2b;
+	p2a.resize(nStep, nPoint);
+	rng.fill(p2a.getMat(), cv::RNG::UNIFORM, -1e4, 1e4);
+	for (int iPoint = 0; iPoint < nPoint; iPoint++)
+		p2a.setRect(iPoint, cv::Rect(rng.uniform(0, 4000), rng.uniform(0, 3000),
+			rng.uniform(8, 128), rng.uniform(8, 128)));
+	string fileTxt = "benchTextRead_tmp.txt", fileCsv = "benchTextRead_tmp.csv";
+	cv::Mat table = p2a.getMat().reshape(1, nStep);
+	if (p2a.writeToTxt(fileTxt) != 0 || writeMatToCsvFile(table, fileCsv) != 0) {
+		cerr << "# Error: Cannot write " << fileTxt << " or " << fileCsv << ".\n";
+		return -1;
+	}
+
+	vector<string> names{ "txt, istream (former)", "txt, TextNumberParser",
+		"csv, getline (former)", "csv, TextNumberParser" };
+	vector<double> t(4, 0.0);
+	bool identical[4] = { true, true, true, true };
+	cv::Mat txtRef, csvRef;
+	vector<cv::Rect> rectsRef;
+	for (int i = 0; i < nRepeat; i++) {
+		double t0 = getWallTime();
+		legacyReadPoints2fTxt(fileTxt, txtRef, rectsRef);
+		double t1 = getWallTime();
+		int ret = p2b.readFromTxt(fileTxt);
+		double t2 = getWallTime();
+		csvRef = legacyReadMatFromCsvFile(fileCsv);
+		double t3 = getWallTime();
+		cv::Mat csv = readMatFromCsvFile<double>(fileCsv);
+		double t4 = getWallTime();
+		t[0] += t1 - t0;
+		t[1] += t2 - t1;
+		t[2] += t3 - t2;
+		t[3] += t4 - t3;
+		identical[1] = identical[1] && ret == 0 && identicalMats(txtRef, p2b.getMat());
+		for (int iPoint = 0; iPoint < (int) rectsRef.size(); iPoint++)
+			identical[1] = identical[1] && p2b.getRect(iPoint) == rectsRef[iPoint];
+		identical[3] = identical[3] && identicalMats(csvRef, csv);
+	}
+	size_t bytes[4];
+	{
+		TextNumberParser txt, csv;
+		txt.open(fileTxt);
+		csv.open(fileCsv);
+		bytes[0] = bytes[1] = txt.size();
+		bytes[2] = bytes[3] = csv.size();
+	}
+	remove(fileTxt.c_str());
+	remove(fileCsv.c_str());
+
+	printf("# %d steps, %d points, %d repeats\n", nStep, nPoint, nRepeat);
+	printf("# %-24s %14s %14s %10s\n", "Method", "Read(ms)", "Bytes", "Identical");
+	for (int i = 0; i < 4; i++)
+		printf("  %-24s %14.3f %14zu %10s\n", names[i].c_str(), t[i] * 1000. / nRepeat, bytes[i],
+			i % 2 == 0 ? "(ref.)" : (identical[i] ? "yes" : "no"));
+	printf("# Speedup: txt %.1fx, csv %.1fx\n", t[0] / std::max(t[1], 1e-9), t[2] / std::max(t[3], 1e-9));
+	return 0;
+}
@@ -0,0 +1,102 @@
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+#include "impro_util.h"
+#include "matchTemplateWithRotPyr.h"
+#include "matchTemplateFft.h"
+
+using namespace std;
+
+// Benchmark of matchTemplateWithRotPyr() with direct (cv::matchTemplate) and
+// frequency-domain (FFT) correlation, and with sub-pixel peak fit, on a synthetic
+// speckle image sequence.
+// Each frame is the initial image moved by a known sub-pixel displacement and
+// rotation, and the same template (initial image) is searched in every frame.
+int FuncBenchTmatchFft(int argc, char** argv)
+{
+	printf("# Enter template size (in pixels, e.g., 64):\n");
+	int tSize = readIntFromCin(8, 1024);
+	printf("# Enter search range (in pixels, e.g., 40):\n");
+	double searchRange = readDoubleFromCin(1., 1024.);
+	printf("# Enter rotation search range (in degrees, 0 for no rotation, e.g., 4):\n");
+	double rotRange = readDoubleFromCin(0., 90.);
+	printf("# Enter precision (in pixels, e.g., 0.05):\n");
+	double prec = readDoubleFromCin(0.001, 1.);
+	printf("# Enter number of frames (e.g., 20):\n");
+	int nFrame = readIntFromCin(1, 100000);
+
+	// synthetic speckle image
+	int imgSize = tSize * 4 + (int)searchRange * 2;
+	cv::Mat noise(imgSize, imgSize, CV_32F), imgInit;
+	cv::RNG rng(12345);
+	rng.fill(noise, cv::RNG::UNIFORM, 0., 255.);
+	cv::GaussianBlur(noise, noise, cv::Size(0, 0), 2.0);
+	cv::normalize(noise, noise, 0, 255, cv::NORM_MINMAX);
+	noise.convertTo(imgInit, CV_8U);
+	cv::Point2f tPoint(imgSize * .5f, imgSize * .5f);
+	cv::Point2f ref;
+	cv::Rect tRect = getTmpltRectFromImage(imgInit, tPoint, cv::Size(tSize, tSize), ref);
+	cv::Mat imgTmplt = imgInit(tRect).clone();
+
+	// methods to compare
+	vector<string> names{ "Direct (cv::matchTemplate)", "FFT (no cache)", "FFT (cached spectra)", "FFT auto (cached spectra)",
+		"Direct + quadratic fit", "Direct + Gaussian fit" };
+	vector<int> methods{ cv::TM_CCORR_NORMED, cv::TM_CCORR_NORMED | TM_FFT,
+		cv::TM_CCORR_NORMED | TM_FFT, cv::TM_CCORR_NORMED | TM_FFT_AUTO,
+		cv::TM_CCORR_NORMED | TM_SUBPIX_QUADRATIC, cv::TM_CCORR_NORMED | TM_SUBPIX_GAUSSIAN };
+	vector<bool> cached{ false, false, true, true, false, false };
+	vector<int> nFitFail(methods.size(), 0);
+	vector<double> wallTime(methods.size(), 0.0), maxErr(methods.size(), 0.0), maxDiff(methods.size(), 0.0);
+	vector<MatchTemplateFftCache> caches(methods.size());
+
+	for (int iFrame = 0; iFrame < nFrame; iFrame++) {
+		// moved image
+		double ux = rng.uniform(-searchRange * .4, searchRange * .4);
+		double uy = rng.uniform(-searchRange * .4, searchRange * .4);
+		double rot = rotRange > 0 ? rng.uniform(-rotRange * .4, rotRange * .4) : 0.0;
+		cv::Mat r = cv::getRotationMatrix2D(tPoint, rot, 1.0);
+		r.at<double>(0, 2) += ux;
+		r.at<double>(1, 2) += uy;
+		cv::Mat imgCurr;
+		cv::warpAffine(imgInit, imgCurr, r, imgInit.size(), cv::INTER_CUBIC);
+		vector<double> direct;
+		for (int iMethod = 0; iMethod < (int)methods.size(); iMethod++) {
+			vector<double> result(10, 0.0);
+			double t0 = getWallTime();
+			matchTemplateWithRotPyr(imgCurr, imgTmplt, ref.x, ref.y,
+				tPoint.x - searchRange / 2, tPoint.x + searchRange / 2, prec,
+				tPoint.y - searchRange / 2, tPoint.y + searchRange / 2, prec,
+				-rotRange / 2, rotRange / 2, rotRange > 0 ? 0.5 : 1.0,
+				result, methods[iMethod], -1, -1, -1,
+				cached[iMethod] ? &caches[iMethod] : NULL);
+			wallTime[iMethod] += getWallTime() - t0;
+			if ((methods[iMethod] & (TM_SUBPIX_QUADRATIC | TM_SUBPIX_GAUSSIAN)) && result[9] == 0.0)
+				nFitFail[iMethod]++;
+			double err = std::max(std::fabs(result[0] - (tPoint.x + ux)), std::fabs(result[1] - (tPoint.y + uy)));
+			maxErr[iMethod] = std::max(maxErr[iMethod], err);
+			if (iMethod == 0) direct = result;
+			else maxDiff[iMethod] = std::max(maxDiff[iMethod],
+				std::max(std::fabs(result[0] - direct[0]), std::fabs(result[1] - direct[1])));
+		}
+		printf("\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\bFrame %d/%d", iFrame + 1, nFrame);
+	}
+	printf("\n# Template %d x %d, search range %.1f px, rotation range %.1f deg, precision %.3f px, %d frames\n",
+		tSize, tSize, searchRange, rotRange, prec, nFrame);
+	printf("# %-28s %16s %16s %16s\n", "Method", "Time/frame(ms)", "MaxErr(px)", "MaxDiff(px)");
+	for (int iMethod = 0; iMethod < (int)methods.size(); iMethod++)
+		printf("  %-28s %16.3f %16.4f %16.4f\n", names[iMethod].c_str(),
+			wallTime[iMethod] * 1000. / nFrame, maxErr[iMethod], maxDiff[iMethod]);
+	for (int iMethod = 0; iMethod < (int)methods.size(); iMethod++)
+		if (cached[iMethod])
+			printf("# %s: spectrum cache hits %d, misses %d\n", names[iMethod].c_str(),
+				caches[iMethod].nHit, caches[iMethod].nMiss);
+	for (int iMethod = 0; iMethod < (int)methods.size(); iMethod++)
+		if (methods[iMethod] & (TM_SUBPIX_QUADRATIC | TM_SUBPIX_GAUSSIAN))
+			printf("# %s: fit failed (fell back to pyramid) in %d of %d frames\n", names[iMethod].c_str(),
+				nFitFail[iMethod], nFrame);
+	return 0;
+}
@@ -0,0 +1,26 @@
+#include <iostream>
+#include <cstdio>
+#include <string>
+
+#include "impro_util.h"
+#include "BigTableLog.h"
+
+using namespace std;
+
+// Converts a binary big table log (e.g., of storyDispV8 with a .bin big table file)
+// to the csv text that would have been written in text mode.
+int FuncBigTableCsv(int argc, char** argv)
+{
+	std::cout << "# Enter full path of the binary big table log (.bin):\n";
+	string fnameLog = readStringLineFromCin();
+	std::cout << "# Enter full path of the csv file to write:\n";
+	string fnameCsv = readStringLineFromCin();
+	double t0 = getWallTime();
+	int nRecord = BigTableLog::toCsv(fnameLog, fnameCsv);
+	if (nRecord < 0) {
+		cerr << "# Cannot convert " << fnameLog << ".\n";
+		return -1;
+	}
+	printf("# %d records are converted to %s in %.3f sec.\n", nRecord, fnameCsv.c_str(), getWallTime() - t0);
+	return 0;
+}
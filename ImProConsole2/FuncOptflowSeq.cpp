@@ -3,13 +3,20 @@
 #include <string>
 #include <vector>
 #include <cmath>
+#include <cstdarg>
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/video/tracking.hpp>
 
 #include "impro_util.h"
+#include "FieldColormap.h"
 
 #include "FileSeq.h"
+#include "OutputSink.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -19,290 +26,215 @@ const cv::String keys =
 "{omfile                  |   | full path of output matlab file.}" 
 ;
 
-int FuncOptflowSeq(int argc, char** argv)
+// appends printf-formatted text to a string (so that outputs of frames processed
+// in parallel can be printed in order)
+static void appendf(string & log, const char * fmt, ...)
 {
-	// variables
-	string fsq_str;
-	string omfile_str;
-	FileSeq fsq;
-	cv::Size imgSize; 
-	cv::Mat imgPrev, imgCurr; 
-	cv::Mat flow, exx, eyy, exy, crack_opening, crack_sliding;
-
-	// Step 0: Build parser 
-	cv::CommandLineParser parser(argc, argv, keys);
-	if (parser.has("fileseq"))
-		fsq_str = parser.get<string>("fileseq");
-	else
-	{
-		fsq.setDirFilesByConsole();
-	}
-
-	// Step 1: File output setting
-	//if (parser.has("omfile"))
-	//	omfile_str = parser.get<string>("omfile");
-	//else {
-	//	cout << "Input full path of output matlab file (input xxx means xxx:\n";
-	//	omfile_str = readStringFromIstream(std::cin);
-	//}
+	char buf[1000];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(buf, 1000, fmt, args);
+	va_end(args);
+	log += buf;
+}
 
-	// Step 2: Optical flow settings 
+// Farneback optical flow (from the first image) of an image, with the flow of 
+// the previous image as the initial flow
+static void optflowOfFrame(const cv::Mat & imgPrev, const cv::Mat & imgCurr, cv::Mat & flow)
+{
+	double pyr_scale = 0.5; 
+	int level = 5; 
+	int winsize = 151;
+	int iterations = 10; 
+	int poly_n = 5; // Typically, polyN = 5 or 7.
+	double poly_sigma = 1.1; // For polyN=5 , you can set polySigma=1.1 . For polyN=7 , a good value would be polySigma=1.5 .
+	int flags = cv::OPTFLOW_USE_INITIAL_FLOW | cv::OPTFLOW_FARNEBACK_GAUSSIAN; 
+	cv::calcOpticalFlowFarneback(imgPrev, imgCurr, flow, pyr_scale, level,
+		winsize, iterations, poly_n, poly_sigma, flags);
+}
 
-	   
-	// Step 3: While loop
-	printf("There are %d files, from %s to %s.\n", fsq.num_files(), fsq.filename(0).c_str(), fsq.filename(fsq.num_files() - 1).c_str());
+// post-processing of the flow of a frame: statistics (appended to log), 
+// colormap images of ux, uy, strains and cracks, and the matlab field file. 
+// Files are named after fullPath (the image file of the frame), and are written 
+// by sink (images and fields of this frame only, flow is copied).
+static void postprocessOptflowFrame(const cv::Mat & flow, int iPhoto, const string & fullPath, string & log,
+	OutputSink & sink)
+{
+	cv::Mat exx, eyy, exy, crack_opening, crack_sliding;
 
-	// Step 4: Get image size
-	cout << "Waiting for first photo " << fsq.filename(0) << "...";
-	fsq.waitForFile(0);
-	cout << "Got it.";
-	imgPrev = cv::imread(fsq.fullPathOfFile(0), cv::IMREAD_GRAYSCALE);
-	imgSize.width = imgPrev.cols;
-	imgSize.height = imgPrev.rows;
-	printf(" image size (%d x %d).\n", imgSize.height, imgSize.width); 
+	// resize flow to a (much) smaller size
+//	cv::resize(flow, flow, cv::Size(0, 0), 0.5, 0.5, cv::INTER_LINEAR); 
 
-	// Step 5: Run loop
-	for (int iPhoto = 1; iPhoto < fsq.num_files(); iPhoto++)
+	appendf(log, "Opt flow of frame %d is sized %dx%d in type %d.\n", iPhoto, flow.rows, flow.cols, flow.type()); 
+	if (flow.type() == CV_32FC2)
 	{
-		// read image
-		imgCurr = cv::imread(fsq.fullPathOfFile(iPhoto), cv::IMREAD_GRAYSCALE); 
-
-		// optical flow
-		double pyr_scale = 0.5; 
-		int level = 5; 
-		int winsize = 151;
-		int iterations = 10; 
-		int poly_n = 5; // Typically, polyN = 5 or 7.
-		double poly_sigma = 1.1; // For polyN=5 , you can set polySigma=1.1 . For polyN=7 , a good value would be polySigma=1.5 .
-		int flags = cv::OPTFLOW_USE_INITIAL_FLOW | cv::OPTFLOW_FARNEBACK_GAUSSIAN; 
-		cv::calcOpticalFlowFarneback(imgPrev, imgCurr, flow, pyr_scale, level,
-			winsize, iterations, poly_n, poly_sigma, flags);
-
-		// resize flow to a (much) smaller size
-//		cv::resize(flow, flow, cv::Size(0, 0), 0.5, 0.5, cv::INTER_LINEAR); 
-
-		printf("Opt flow of frame %d is sized %dx%d in type %d.\n", iPhoto, flow.rows, flow.cols, flow.type()); 
-		if (flow.type() == CV_32FC2)
+		float ux_sum = 0.f, uy_sum = 0.f, ux_s2 = 0.f, uy_s2 = 0.f;
+		float ux_max, ux_min, uy_max, uy_min; 
+		float ux_avg, uy_avg, ux_std, uy_std;
+		ux_max = ux_min = flow.at<cv::Point2f>(0, 0).x;
+		uy_max = uy_min = flow.at<cv::Point2f>(0, 0).y;
+		for (int i = 0; i < flow.rows; i++)
 		{
-			float ux_sum = 0.f, uy_sum = 0.f, ux_s2 = 0.f, uy_s2 = 0.f;
-			float ux_max, ux_min, uy_max, uy_min; 
-			float ux_avg, uy_avg, ux_std, uy_std;
-			ux_max = ux_min = flow.at<cv::Point2f>(0, 0).x;
-			uy_max = uy_min = flow.at<cv::Point2f>(0, 0).y;
-			for (int i = 0; i < flow.rows; i++)
+			for (int j = 0; j < flow.cols; j++)
 			{
-				for (int j = 0; j < flow.cols; j++)
-				{
-					float ux = flow.at<cv::Point2f>(i, j).x;
-					float uy = flow.at<cv::Point2f>(i, j).y;
-					ux_sum += ux; 
-					uy_sum += uy; 
-					ux_s2 += ux * ux; 
-					uy_s2 += uy * uy;
-					if (ux > ux_max) ux_max = ux; 
-					if (ux < ux_min) ux_min = ux; 
-					if (uy > uy_max) uy_max = uy;
-					if (uy < uy_min) uy_min = uy;
-				}
-			}
-			ux_avg = ux_sum / (flow.rows * flow.cols); 
-			uy_avg = uy_sum / (flow.rows * flow.cols);
-			ux_std = sqrt(ux_s2 / (flow.rows * flow.cols) - ux_avg * ux_avg); 
-			uy_std = sqrt(uy_s2 / (flow.rows * flow.cols) - uy_avg * uy_avg);
-			printf("  Ux/Uy max are: %12.4e %12.4e\n", ux_max, uy_max);
-			printf("  Ux/Uy min are: %12.4e %12.4e\n", ux_min, uy_min);
-			printf("  Ux/Uy avg are: %12.4e %12.4e\n", ux_avg, uy_avg);
-			printf("  Ux/Uy std are: %12.4e %12.4e\n", ux_std, uy_std);
-
-			// convert flow to ux and uy to images img_ux and img_uy (in Jet-256 colormap)
-			float u_color_max = .5f; 
-			float u_color_min = -.5f;
-			cv::Mat img_ux(flow.rows, flow.cols, CV_8UC3);
-			cv::Mat img_uy(flow.rows, flow.cols, CV_8UC3);
-			for (int i = 0; i < flow.rows; i++)
-			{
-				for (int j = 0; j < flow.cols; j++)
-				{
-					float ux = flow.at<cv::Point2f>(i, j).x;
-					float uy = flow.at<cv::Point2f>(i, j).y;
-					int ux_256_i = (int) (255 * ((ux - u_color_min) / (u_color_max - u_color_min)) + .5f);
-					int uy_256_i = (int) (255 * ((uy - u_color_min) / (u_color_max - u_color_min)) + .5f);
-					unsigned char ux256 = min(255, max(0, ux_256_i)); 
-					unsigned char uy256 = min(255, max(0, uy_256_i));
-					img_ux.at<cv::Vec3b>(i, j).val[0] = jet_bgr[ux256][0];
-					img_ux.at<cv::Vec3b>(i, j).val[1] = jet_bgr[ux256][1];
-					img_ux.at<cv::Vec3b>(i, j).val[2] = jet_bgr[ux256][2];
-					img_uy.at<cv::Vec3b>(i, j).val[0] = jet_bgr[uy256][0];
-					img_uy.at<cv::Vec3b>(i, j).val[1] = jet_bgr[uy256][1];
-					img_uy.at<cv::Vec3b>(i, j).val[2] = jet_bgr[uy256][2];
-				}
+				float ux = flow.at<cv::Point2f>(i, j).x;
+				float uy = flow.at<cv::Point2f>(i, j).y;
+				ux_sum += ux; 
+				uy_sum += uy; 
+				ux_s2 += ux * ux; 
+				uy_s2 += uy * uy;
+				if (ux > ux_max) ux_max = ux; 
+				if (ux < ux_min) ux_min = ux; 
+				if (uy > uy_max) uy_max = uy;
+				if (uy < uy_min) uy_min = uy;
 			}
-			// print text of max/max values in the images
-			char buf[1000];
+		}
+		ux_avg = ux_sum / (flow.rows * flow.cols); 
+		uy_avg = uy_sum / (flow.rows * flow.cols);
+		ux_std = sqrt(ux_s2 / (flow.rows * flow.cols) - ux_avg * ux_avg); 
+		uy_std = sqrt(uy_s2 / (flow.rows * flow.cols) - uy_avg * uy_avg);
+		appendf(log, "  Ux/Uy max are: %12.4e %12.4e\n", ux_max, uy_max);
+		appendf(log, "  Ux/Uy min are: %12.4e %12.4e\n", ux_min, uy_min);
+		appendf(log, "  Ux/Uy avg are: %12.4e %12.4e\n", ux_avg, uy_avg);
+		appendf(log, "  Ux/Uy std are: %12.4e %12.4e\n", ux_std, uy_std);
+
+		// convert flow to ux and uy to images img_ux and img_uy (in Jet-256 colormap)
+		float u_color_max = .5f; 
+		float u_color_min = -.5f;
+		cv::Mat img_ux, img_uy, uxy[2];
+		cv::split(flow, uxy);
+		fieldToColormap(uxy[0], img_ux, u_color_min, u_color_max);
+		fieldToColormap(uxy[1], img_uy, u_color_min, u_color_max);
+		// print text of max/max values in the images
+		char buf[1000];
             snprintf(buf, 1000, "Max(red)/Min(blue): %12.4e %12.4e", u_color_max, u_color_min);
-			cv::putText(img_ux, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2); 
+		cv::putText(img_ux, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2); 
             snprintf(buf, 1000, "Max(red)/Min(blue): %12.4e %12.4e", u_color_max, u_color_min);
-			cv::putText(img_uy, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2);
-			// write images to files
-			string ux_fname = extFilenameRemoved(fsq.fullPathOfFile(iPhoto)) + "_result_ux.JPG"; 
-			string uy_fname = extFilenameRemoved(fsq.fullPathOfFile(iPhoto)) + "_result_uy.JPG";
-			cv::imwrite(ux_fname, img_ux); 
-			cv::imwrite(uy_fname, img_uy); 
-
-			//// flow to strain
-			uToStrain(flow, exx, eyy, exy); 
-			float exx_sum = 0.f, exx_s2 = 0.f, exx_max, exx_min, exx_avg, exx_std;
-			float eyy_sum = 0.f, eyy_s2 = 0.f, eyy_max, eyy_min, eyy_avg, eyy_std;
-			float exy_sum = 0.f, exy_s2 = 0.f, exy_max, exy_min, exy_avg, exy_std;
-			exx_max = exx_min = exx.at<float>(0, 0);
-			eyy_max = eyy_min = eyy.at<float>(0, 0);
-			exy_max = exy_min = exy.at<float>(0, 0);
-			for (int i = 0; i < flow.rows; i++)
-			{
-				for (int j = 0; j < flow.cols; j++)
-				{
-					float exx_ij = exx.at<float>(i, j);
-					float eyy_ij = eyy.at<float>(i, j);
-					float exy_ij = exy.at<float>(i, j);
-					exx_sum += exx_ij;
-					eyy_sum += eyy_ij;
-					exy_sum += exy_ij;
-					exx_s2 += exx_ij * exx_ij;
-					eyy_s2 += eyy_ij * eyy_ij;
-					exy_s2 += exy_ij * exy_ij;
-					if (exx_ij > exx_max) exx_max = exx_ij;
-					if (eyy_ij > eyy_max) eyy_max = eyy_ij;
-					if (exy_ij > exy_max) exy_max = exy_ij;
-					if (exx_ij < exx_min) exx_min = exx_ij;
-					if (eyy_ij < eyy_min) eyy_min = eyy_ij;
-					if (exy_ij < exy_min) exy_min = exy_ij;
-				}
-			}
-			exx_avg = exx_sum / (flow.rows * flow.cols);
-			eyy_avg = eyy_sum / (flow.rows * flow.cols);
-			exy_avg = exy_sum / (flow.rows * flow.cols);
-			exx_std = sqrt(exx_s2 / (flow.rows * flow.cols) - exx_avg * exx_avg);
-			eyy_std = sqrt(eyy_s2 / (flow.rows * flow.cols) - eyy_avg * eyy_avg);
-			exy_std = sqrt(exy_s2 / (flow.rows * flow.cols) - exy_avg * exy_avg);
-			printf("  Exx/Eyy/Exy max are: %12.4e %12.4e %12.4e\n", exx_max, eyy_max, exy_max);
-			printf("  Exx/Eyy/Exy min are: %12.4e %12.4e %12.4e\n", exx_min, eyy_min, exy_min);
-			printf("  Exx/Eyy/Exy avg are: %12.4e %12.4e %12.4e\n", exx_avg, eyy_avg, exy_avg);
-			printf("  Exx/Eyy/Exy std are: %12.4e %12.4e %12.4e\n", exx_std, eyy_std, exy_std);
-
-			//// convert strain to images img_exx, img_eyy, img_exy (in Jet-256 colormap)
-			u_color_max =  .005f;
-			u_color_min = -.005f;
-			cv::Mat img_exx(exx.rows, exx.cols, CV_8UC3);
-			cv::Mat img_eyy(eyy.rows, eyy.cols, CV_8UC3);
-			cv::Mat img_exy(exy.rows, exy.cols, CV_8UC3);
-			for (int i = 0; i < img_exx.rows; i++)
+		cv::putText(img_uy, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2);
+		// write images to files
+		string ux_fname = extFilenameRemoved(fullPath) + "_result_ux.JPG"; 
+		string uy_fname = extFilenameRemoved(fullPath) + "_result_uy.JPG";
+		sink.writeImage(ux_fname, img_ux); 
+		sink.writeImage(uy_fname, img_uy); 
+
+		//// flow to strain and crack (in one pass)
+		uToStrainCrack(flow, exx, eyy, exy, crack_opening, crack_sliding);
+		float exx_sum = 0.f, exx_s2 = 0.f, exx_max, exx_min, exx_avg, exx_std;
+		float eyy_sum = 0.f, eyy_s2 = 0.f, eyy_max, eyy_min, eyy_avg, eyy_std;
+		float exy_sum = 0.f, exy_s2 = 0.f, exy_max, exy_min, exy_avg, exy_std;
+		exx_max = exx_min = exx.at<float>(0, 0);
+		eyy_max = eyy_min = eyy.at<float>(0, 0);
+		exy_max = exy_min = exy.at<float>(0, 0);
+		for (int i = 0; i < flow.rows; i++)
+		{
+			for (int j = 0; j < flow.cols; j++)
 			{
-				for (int j = 0; j < img_exx.cols; j++)
-				{
-					float exx_ij = exx.at<float>(i, j);
-					float eyy_ij = eyy.at<float>(i, j);
-					float exy_ij = exy.at<float>(i, j);
-					int exx_256_i = (int)(255 * ((exx_ij - u_color_min) / (u_color_max - u_color_min)) + .5f);
-					int eyy_256_i = (int)(255 * ((eyy_ij - u_color_min) / (u_color_max - u_color_min)) + .5f);
-					int exy_256_i = (int)(255 * ((exy_ij - u_color_min) / (u_color_max - u_color_min)) + .5f);
-					unsigned char exx256 = min(255, max(0, exx_256_i));
-					unsigned char eyy256 = min(255, max(0, eyy_256_i));
-					unsigned char exy256 = min(255, max(0, exy_256_i));
-					for (int ch = 0; ch < 3; ch++)
-					{
-						img_exx.at<cv::Vec3b>(i, j).val[ch] = jet_bgr[exx256][ch];
-						img_eyy.at<cv::Vec3b>(i, j).val[ch] = jet_bgr[eyy256][ch];
-						img_exy.at<cv::Vec3b>(i, j).val[ch] = jet_bgr[exy256][ch];
-					}
-				}
+				float exx_ij = exx.at<float>(i, j);
+				float eyy_ij = eyy.at<float>(i, j);
+				float exy_ij = exy.at<float>(i, j);
+				exx_sum += exx_ij;
+				eyy_sum += eyy_ij;
+				exy_sum += exy_ij;
+				exx_s2 += exx_ij * exx_ij;
+				eyy_s2 += eyy_ij * eyy_ij;
+				exy_s2 += exy_ij * exy_ij;
+				if (exx_ij > exx_max) exx_max = exx_ij;
+				if (eyy_ij > eyy_max) eyy_max = eyy_ij;
+				if (exy_ij > exy_max) exy_max = exy_ij;
+				if (exx_ij < exx_min) exx_min = exx_ij;
+				if (eyy_ij < eyy_min) eyy_min = eyy_ij;
+				if (exy_ij < exy_min) exy_min = exy_ij;
 			}
-			// print text of max/max values in the images
+		}
+		exx_avg = exx_sum / (flow.rows * flow.cols);
+		eyy_avg = eyy_sum / (flow.rows * flow.cols);
+		exy_avg = exy_sum / (flow.rows * flow.cols);
+		exx_std = sqrt(exx_s2 / (flow.rows * flow.cols) - exx_avg * exx_avg);
+		eyy_std = sqrt(eyy_s2 / (flow.rows * flow.cols) - eyy_avg * eyy_avg);
+		exy_std = sqrt(exy_s2 / (flow.rows * flow.cols) - exy_avg * exy_avg);
+		appendf(log, "  Exx/Eyy/Exy max are: %12.4e %12.4e %12.4e\n", exx_max, eyy_max, exy_max);
+		appendf(log, "  Exx/Eyy/Exy min are: %12.4e %12.4e %12.4e\n", exx_min, eyy_min, exy_min);
+		appendf(log, "  Exx/Eyy/Exy avg are: %12.4e %12.4e %12.4e\n", exx_avg, eyy_avg, exy_avg);
+		appendf(log, "  Exx/Eyy/Exy std are: %12.4e %12.4e %12.4e\n", exx_std, eyy_std, exy_std);
+
+		//// convert strain to images img_exx, img_eyy, img_exy (in Jet-256 colormap)
+		u_color_max =  .005f;
+		u_color_min = -.005f;
+		cv::Mat img_exx, img_eyy, img_exy;
+		fieldToColormap(exx, img_exx, u_color_min, u_color_max);
+		fieldToColormap(eyy, img_eyy, u_color_min, u_color_max);
+		fieldToColormap(exy, img_exy, u_color_min, u_color_max);
+		// print text of max/max values in the images
             snprintf(buf, 1000, "Max(red)/Min(blue): %12.4e %12.4e", u_color_max, u_color_min);
-			cv::putText(img_exx, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2);
-			cv::putText(img_eyy, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2);
-			cv::putText(img_exy, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2);
-			// write images to files
-			string exx_fname = extFilenameRemoved(fsq.fullPathOfFile(iPhoto)) + "_result_exx.JPG";
-			string eyy_fname = extFilenameRemoved(fsq.fullPathOfFile(iPhoto)) + "_result_eyy.JPG";
-			string exy_fname = extFilenameRemoved(fsq.fullPathOfFile(iPhoto)) + "_result_exy.JPG";
-			cv::imwrite(exx_fname, img_exx);
-			cv::imwrite(eyy_fname, img_eyy);
-			cv::imwrite(exy_fname, img_exy);
-			//string opn_fname = extFilenameRemoved(fsq.fullPathOfFile(iPhoto)) + "_cr_opn.JPG";
-			//string sld_fname = extFilenameRemoved(fsq.fullPathOfFile(iPhoto)) + "_cr_sld.JPG";
-			//cv::imwrite(opn_fname, img_cr_opn);
-			//cv::imwrite(sld_fname, img_cr_sld);
-
-			// flow to crack
-			uToCrack(flow, crack_opening, crack_sliding, 999);
-			float opn_sum = 0.f, sld_sum = 0.f, opn_s2 = 0.f, sld_s2 = 0.f;
-			float opn_max, opn_min, sld_max, sld_min;
-			float opn_avg, sld_avg, opn_std, sld_std;
-			opn_max = opn_min = crack_opening.at<float>(0, 0);
-			sld_max = sld_min = crack_sliding.at<float>(0, 0);
-			for (int i = 0; i < flow.rows; i++)
-			{
-				for (int j = 0; j < flow.cols; j++)
-				{
-					float opn = crack_opening.at<float>(i, j);
-					float sld = crack_sliding.at<float>(i, j);
-					opn_sum += opn;
-					sld_sum += sld;
-					opn_s2 += opn * opn;
-					sld_s2 += sld * sld;
-					if (opn > opn_max) opn_max = opn;
-					if (opn < opn_min) opn_min = opn;
-					if (sld > sld_max) sld_max = sld;
-					if (sld < sld_min) sld_min = sld;
-				}
-			}
-			opn_avg = opn_sum / (flow.rows * flow.cols);
-			sld_avg = sld_sum / (flow.rows * flow.cols);
-			opn_std = sqrt(opn_s2 / (flow.rows * flow.cols) - opn_avg * opn_avg);
-			sld_std = sqrt(sld_s2 / (flow.rows * flow.cols) - sld_avg * sld_avg);
-			printf("  Opn/Sld max are: %12.4e %12.4e\n", opn_max, sld_max);
-			printf("  Opn/Sld min are: %12.4e %12.4e\n", opn_min, sld_min);
-			printf("  Opn/Sld avg are: %12.4e %12.4e\n", opn_avg, sld_avg);
-			printf("  Opn/Sld std are: %12.4e %12.4e\n", opn_std, sld_std);
-			// convert crack_opening/sliding to images img_cr_opn and img_cr_sld (in Jet-256 colormap)
-			u_color_max = .1f;
-			u_color_min = -.1f;
-			cv::Mat img_cr_opn(crack_opening.rows, crack_opening.cols, CV_8UC3);
-			cv::Mat img_cr_sld(crack_sliding.rows, crack_sliding.cols, CV_8UC3);
-			for (int i = 0; i < img_cr_opn.rows; i++)
+		cv::putText(img_exx, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2);
+		cv::putText(img_eyy, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2);
+		cv::putText(img_exy, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2);
+		// write images to files
+		string exx_fname = extFilenameRemoved(fullPath) + "_result_exx.JPG";
+		string eyy_fname = extFilenameRemoved(fullPath) + "_result_eyy.JPG";
+		string exy_fname = extFilenameRemoved(fullPath) + "_result_exy.JPG";
+		sink.writeImage(exx_fname, img_exx);
+		sink.writeImage(eyy_fname, img_eyy);
+		sink.writeImage(exy_fname, img_exy);
+		//string opn_fname = extFilenameRemoved(fullPath) + "_cr_opn.JPG";
+		//string sld_fname = extFilenameRemoved(fullPath) + "_cr_sld.JPG";
+		//cv::imwrite(opn_fname, img_cr_opn);
+		//cv::imwrite(sld_fname, img_cr_sld);
+
+		// flow to crack
+		// (calculated by uToStrainCrack() above)
+		float opn_sum = 0.f, sld_sum = 0.f, opn_s2 = 0.f, sld_s2 = 0.f;
+		float opn_max, opn_min, sld_max, sld_min;
+		float opn_avg, sld_avg, opn_std, sld_std;
+		opn_max = opn_min = crack_opening.at<float>(0, 0);
+		sld_max = sld_min = crack_sliding.at<float>(0, 0);
+		for (int i = 0; i < flow.rows; i++)
+		{
+			for (int j = 0; j < flow.cols; j++)
 			{
-				for (int j = 0; j < img_cr_opn.cols; j++)
-				{
-					float opn = crack_opening.at<float>(i, j);
-					float sld = crack_sliding.at<float>(i, j);
-					int opn_256_i = (int)(255 * ((opn - u_color_min) / (u_color_max - u_color_min)) + .5f);
-					int sld_256_i = (int)(255 * ((sld - u_color_min) / (u_color_max - u_color_min)) + .5f);
-					unsigned char opn256 = min(255, max(0, opn_256_i));
-					unsigned char sld256 = min(255, max(0, sld_256_i));
-					img_cr_opn.at<cv::Vec3b>(i, j).val[0] = jet_bgr[opn256][0];
-					img_cr_opn.at<cv::Vec3b>(i, j).val[1] = jet_bgr[opn256][1];
-					img_cr_opn.at<cv::Vec3b>(i, j).val[2] = jet_bgr[opn256][2];
-					img_cr_sld.at<cv::Vec3b>(i, j).val[0] = jet_bgr[sld256][0];
-					img_cr_sld.at<cv::Vec3b>(i, j).val[1] = jet_bgr[sld256][1];
-					img_cr_sld.at<cv::Vec3b>(i, j).val[2] = jet_bgr[sld256][2];
-				}
+				float opn = crack_opening.at<float>(i, j);
+				float sld = crack_sliding.at<float>(i, j);
+				opn_sum += opn;
+				sld_sum += sld;
+				opn_s2 += opn * opn;
+				sld_s2 += sld * sld;
+				if (opn > opn_max) opn_max = opn;
+				if (opn < opn_min) opn_min = opn;
+				if (sld > sld_max) sld_max = sld;
+				if (sld < sld_min) sld_min = sld;
 			}
-			// print text of max/max values in the images
+		}
+		opn_avg = opn_sum / (flow.rows * flow.cols);
+		sld_avg = sld_sum / (flow.rows * flow.cols);
+		opn_std = sqrt(opn_s2 / (flow.rows * flow.cols) - opn_avg * opn_avg);
+		sld_std = sqrt(sld_s2 / (flow.rows * flow.cols) - sld_avg * sld_avg);
+		appendf(log, "  Opn/Sld max are: %12.4e %12.4e\n", opn_max, sld_max);
+		appendf(log, "  Opn/Sld min are: %12.4e %12.4e\n", opn_min, sld_min);
+		appendf(log, "  Opn/Sld avg are: %12.4e %12.4e\n", opn_avg, sld_avg);
+		appendf(log, "  Opn/Sld std are: %12.4e %12.4e\n", opn_std, sld_std);
+		// convert crack_opening/sliding to images img_cr_opn and img_cr_sld (in Jet-256 colormap)
+		u_color_max = .1f;
+		u_color_min = -.1f;
+		cv::Mat img_cr_opn, img_cr_sld;
+		fieldToColormap(crack_opening, img_cr_opn, u_color_min, u_color_max);
+		fieldToColormap(crack_sliding, img_cr_sld, u_color_min, u_color_max);
+		// print text of max/max values in the images
             snprintf(buf, 1000, "Max(red)/Min(blue): %12.4e %12.4e", u_color_max, u_color_min);
-			cv::putText(img_cr_opn, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2);
+		cv::putText(img_cr_opn, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2);
             snprintf(buf, 1000, "Max(red)/Min(blue): %12.4e %12.4e", u_color_max, u_color_min);
-			cv::putText(img_cr_sld, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2);
-			// write images to files
-			string opn_fname = extFilenameRemoved(fsq.fullPathOfFile(iPhoto)) + "_result_cr_opn.JPG";
-			string sld_fname = extFilenameRemoved(fsq.fullPathOfFile(iPhoto)) + "_result_cr_sld.JPG";
-			cv::imwrite(opn_fname, img_cr_opn);
-			cv::imwrite(sld_fname, img_cr_sld);
-
-			// write fields to files (_ux.m, _uy.m, _cr_opn.m, _cr_sld.m, _exx.m, _eyy.m, _exy.m)
-			string ux__m_fname = extFilenameRemoved(fsq.fullPathOfFile(iPhoto)) + "_result_fields.m";
+		cv::putText(img_cr_sld, buf, cv::Point(100, 100), 0, 3, cv::Scalar(0, 0, 0), 2);
+		// write images to files
+		string opn_fname = extFilenameRemoved(fullPath) + "_result_cr_opn.JPG";
+		string sld_fname = extFilenameRemoved(fullPath) + "_result_cr_sld.JPG";
+		sink.writeImage(opn_fname, img_cr_opn);
+		sink.writeImage(sld_fname, img_cr_sld);
+
+		// write fields to files (_ux.m, _uy.m, _cr_opn.m, _cr_sld.m, _exx.m, _eyy.m, _exy.m)
+		string ux__m_fname = extFilenameRemoved(fullPath) + "_result_fields.m";
+		sink.run([ux__m_fname, flow = flow.clone(), crack_opening, crack_sliding, exx, eyy, exy]() {
 			FILE * if_fields_m; // = fopen(ux__m_fname.c_str(), "w");
 			int if_fields_ok = fopen_s(&if_fields_m, ux__m_fname.c_str(), "w");
-			
+		
 			if (if_fields_ok == 0) {
 				// write ux
 				fprintf(if_fields_m, "ux=[");
@@ -370,11 +302,146 @@ int FuncOptflowSeq(int argc, char** argv)
 
 				fclose(if_fields_m);
 			} // if m-file is opened
-		} // end of if type() is CV_32FC2
+		});
+	} // end of if type() is CV_32FC2
+}
+
+static int optflowSeq(int argc, char** argv, bool pipelined)
+{
+	// variables
+	string fsq_str;
+	string omfile_str;
+	FileSeq fsq;
+	cv::Size imgSize; 
+	cv::Mat imgPrev, imgCurr; 
+	cv::Mat flow;
+
+	// Step 0: Build parser 
+	cv::CommandLineParser parser(argc, argv, keys);
+	if (parser.has("fileseq"))
+		fsq_str = parser.get<string>("fileseq");
+	else
+	{
+		fsq.setDirFilesByConsole();
+	}
+
+	// Step 1: File output setting
+	//if (parser.has("omfile"))
+	//	omfile_str = parser.get<string>("omfile");
+	//else {
+	//	cout << "Input full path of output matlab file (input xxx means xxx:\n";
+	//	omfile_str = readStringFromIstream(std::cin);
+	//}
+
+	// Step 2: Optical flow settings 
+
+	   
+	// Step 3: While loop
+	printf("There are %d files, from %s to %s.\n", fsq.num_files(), fsq.filename(0).c_str(), fsq.filename(fsq.num_files() - 1).c_str());
+
+	// Step 4: Get image size
+	cout << "Waiting for first photo " << fsq.filename(0) << "...";
+	fsq.waitForFile(0);
+	cout << "Got it.";
+	imgPrev = cv::imread(fsq.fullPathOfFile(0), cv::IMREAD_GRAYSCALE);
+	imgSize.width = imgPrev.cols;
+	imgSize.height = imgPrev.rows;
+	printf(" image size (%d x %d).\n", imgSize.height, imgSize.width); 
+
+	// output files (pictures and matlab fields) are written by a background thread
+	OutputSink sink;
+	sink.start(1);
+
+	// Step 5: Run loop
+	if (pipelined == false) {
+		for (int iPhoto = 1; iPhoto < fsq.num_files(); iPhoto++)
+		{
+			// read image
+			imgCurr = cv::imread(fsq.fullPathOfFile(iPhoto), cv::IMREAD_GRAYSCALE); 
+
+			// optical flow
+			optflowOfFrame(imgPrev, imgCurr, flow);
+
+			// post-processing
+			string log;
+			postprocessOptflowFrame(flow, iPhoto, fsq.fullPathOfFile(iPhoto), log, sink);
+			printf("%s", log.c_str());
+		}
+		sink.close();
+		return 0;
+	}
+
+	// Step 5 (pipelined): frames are processed in batches of nBatch frames. 
+	// Each round runs three stages at the same time, as jobs of a parallel loop:
+	//   decoding the images of batch k + 2 (one job per image), 
+	//   optical flows of batch k + 1 (one job, as the flow of a frame is the 
+	//     initial flow of the next one, flows are calculated in order), and
+	//   post-processing of batch k (one job per frame).
+	// Then the logs of batch k are printed in order. Output files are the same
+	// as the non-pipelined run.
+	int nThreads = 1;
+#ifdef _OPENMP
+	nThreads = omp_get_max_threads();
+#endif
+	int nBatch = std::max(1, nThreads - 1);
+	int nFrame = fsq.num_files() - 1; // frames 1 ... num_files() - 1 are processed
+	int nRound = (nFrame + nBatch - 1) / nBatch;
+	// buffers of three batches (slot k % 3 for batch k)
+	vector<vector<cv::Mat> > imgs(3, vector<cv::Mat>(nBatch));
+	vector<vector<cv::Mat> > flows(3, vector<cv::Mat>(nBatch));
+	vector<vector<string> > logs(3, vector<string>(nBatch));
+	printf("# Pipelined optical flow: %d threads, %d frames per batch.\n", nThreads, nBatch);
+	for (int round = -2; round < nRound; round++)
+	{
+		int bDecode = round + 2, bFlow = round + 1, bPost = round;
+		int nDecode = (bDecode < nRound) ? std::min(nBatch, nFrame - bDecode * nBatch) : 0;
+		int nPost = (bPost >= 0) ? std::min(nBatch, nFrame - bPost * nBatch) : 0;
+		int nJob = nDecode + 1 + nPost;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if (nThreads > 1)
+		for (int job = 0; job < nJob; job++) {
+			if (job == 0) {
+				// optical flows of batch bFlow (in order)
+				if (bFlow < 0 || bFlow >= nRound) continue;
+				int n = std::min(nBatch, nFrame - bFlow * nBatch);
+				for (int k = 0; k < n; k++) {
+					optflowOfFrame(imgPrev, imgs[bFlow % 3][k], flow);
+					flow.copyTo(flows[bFlow % 3][k]);
+					imgs[bFlow % 3][k].release();
+				}
+			}
+			else if (job <= nDecode) {
+				// decoding an image of batch bDecode
+				int k = job - 1;
+				int iPhoto = 1 + bDecode * nBatch + k;
+				imgs[bDecode % 3][k] = cv::imread(fsq.fullPathOfFile(iPhoto), cv::IMREAD_GRAYSCALE);
+			}
+			else {
+				// post-processing a frame of batch bPost
+				int k = job - 1 - nDecode;
+				int iPhoto = 1 + bPost * nBatch + k;
+				logs[bPost % 3][k].clear();
+				postprocessOptflowFrame(flows[bPost % 3][k], iPhoto, fsq.fullPathOfFile(iPhoto), logs[bPost % 3][k], sink);
+				flows[bPost % 3][k].release();
+			}
+		}
+		// ordered output of batch bPost
+		for (int k = 0; k < nPost; k++)
+			printf("%s", logs[bPost % 3][k].c_str());
 	}
 
 	// output to matlab script
 
 	// end of function 
+	sink.close();
 	return 0;
 }
+
+int FuncOptflowSeq(int argc, char** argv)
+{
+	return optflowSeq(argc, argv, false);
+}
+
+int FuncOptflowSeqPipelined(int argc, char** argv)
+{
+	return optflowSeq(argc, argv, true);
+}
@@ -39,6 +39,11 @@ int estimateStoryDisp(
 	cv::Mat& projNewTrkImgPoints    // new projection tracking points in image coord.
 );
 
+const cv::String keys =
+"{help h usage ?     |      | print this message   }"
+"{nThreads   nThr    |      | number of threads of template matching of points (default: number of CPUs) }"
+;
+
 int FuncStoryDispV2(int argc, char** argv)
 {
 	int num_fixed_points, num_track_points;
@@ -48,9 +53,17 @@ int FuncStoryDispV2(int argc, char** argv)
 	string fnameImgInit("");
 	cv::Mat imgInit;
 	int trackMethod; // tracking method. 1:Template match (with rotation and pyramid), 2:Ecc, 3:Optical flow (sparse, LK Pyr.)
+	int nThreads = cv::getNumberOfCPUs(); // threads of template matching (calcTMatchRotPyr())
 	int trackUpdateFreq; // tracking template updating frequency. 0:Not updating (using initial template). 1:Update every frame. 2:Update every other frame. Etc.
 	int trackPredictionMethod; // tracking prediction method. 0:Previous point. 1:Linear approx. 2:2nd-order approx.
 	int winSize; // window size of template size 
+
+	cv::CommandLineParser parser(argc, argv, keys);
+	if (parser.has("help"))
+		parser.printMessage();
+	if (parser.has("nThreads"))
+		nThreads = std::max(1, parser.get<int>("nThreads"));
+
 	string fnameBigTable("./bigTable.txt");
 
 	// Step 0: Ready to output file
@@ -453,7 +466,9 @@ int FuncStoryDispV2(int argc, char** argv)
 				vector<float>(n, 0.05f),
 				vector<float>(n, 0.0f),
 				vector<float>(n, 0.0f),
-				rot_deg);
+				rot_deg,
+				cv::TM_CCORR_NORMED, -1, -1, -1,
+				nThreads);
 		}
 
 		if (trackMethod == 3)
@@ -489,7 +504,9 @@ int FuncStoryDispV2(int argc, char** argv)
 				vector<float>(n, 0.05f),
 				vector<float>(n, 0.0f),
 				vector<float>(n, 0.0f),
-				rot_deg);
+				rot_deg,
+				cv::TM_CCORR_NORMED, -1, -1, -1,
+				nThreads);
 		}
 		if (trackMethod == 3)
 			cv::calcOpticalFlowPyrLK(imgTmpl, imgCurr, trackPoints2f_Tmpl, trackPoints2f_Curr,
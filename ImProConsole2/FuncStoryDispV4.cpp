@@ -6,12 +6,14 @@
 #include <cstdlib>
 #include <cmath>
 #include <string>
+#include <sstream>
 #include <vector>
 #include <opencv2/opencv.hpp>
 
 #include "impro_util.h"
 #include "improDraw.h"
 #include "trackings.h"
+#include "OutputSink.h"
 
 using namespace std;
 
@@ -39,6 +41,11 @@ int estimateStoryDispV4(
     cv::Mat & projNewTrkImgPoints    // new projection tracking points in image coord.
 );
 
+const cv::String keys =
+"{help h usage ?     |      | print this message   }"
+"{nThreads   nThr    |      | number of threads of template matching of points (default: number of CPUs) }"
+;
+
 int FuncStoryDispV4(int argc, char ** argv)
 {
     int num_fixed_points, num_track_points;
@@ -48,9 +55,17 @@ int FuncStoryDispV4(int argc, char ** argv)
     string fnameImgInit("");
     cv::Mat imgInit;
     int trackMethod; // tracking method. 1:Template match (with rotation and pyramid), 2:Ecc, 3:Optical flow (sparse, LK Pyr.)
+    int nThreads = cv::getNumberOfCPUs(); // threads of template matching (calcTMatchRotPyr())
     int trackUpdateFreq; // tracking template updating frequency. 0:Not updating (using initial template). 1:Update every frame. 2:Update every other frame. Etc.
     int trackPredictionMethod; // tracking prediction method. 0:Previous point. 1:Linear approx. 2:2nd-order approx.
     int winSize; // window size of template size
+
+    cv::CommandLineParser parser(argc, argv, keys);
+    if (parser.has("help"))
+        parser.printMessage();
+    if (parser.has("nThreads"))
+        nThreads = std::max(1, parser.get<int>("nThreads"));
+
 //    string fnameBigTable("./bigTable.txt");
 	string fnameBigTable; 
 
@@ -309,6 +324,8 @@ int FuncStoryDispV4(int argc, char ** argv)
 
     // Step 5: start the tracking loop
     cv::Mat imgCurr, imgTmpl;
+    OutputSink sink; // data.txt lines are formatted by the tracking loop and appended by a background thread
+    sink.start(1);
 //	cv::VideoCapture vid("v4l2src ! video/x-raw,format=NV12,width=1640,height=1232 ! videoconvert ! appsink");
     if (vid.isOpened() == false) {
         cerr << "Cannot open camera.\n";
@@ -458,7 +475,9 @@ int FuncStoryDispV4(int argc, char ** argv)
                 vector<float>(n, 0.05f),
                 vector<float>(n, 0.0f),
                 vector<float>(n, 0.0f),
-                rot_deg);
+                rot_deg,
+                cv::TM_CCORR_NORMED, -1, -1, -1,
+                nThreads);
         }
 
         if (trackMethod == 3)
@@ -494,7 +513,9 @@ int FuncStoryDispV4(int argc, char ** argv)
                 vector<float>(n, 0.05f),
                 vector<float>(n, 0.0f),
                 vector<float>(n, 0.0f),
-                rot_deg);
+                rot_deg,
+                cv::TM_CCORR_NORMED, -1, -1, -1,
+                nThreads);
         }
         if (trackMethod == 3)
             cv::calcOpticalFlowPyrLK(imgTmpl, imgCurr, trackPoints2f_Tmpl, trackPoints2f_Curr,
@@ -551,12 +572,15 @@ int FuncStoryDispV4(int argc, char ** argv)
         p = localtime(&t);
         printf("Floor disp: %16.4f %16.4f    Tortion (degrees): %16.4f      ",
             newDisp.at<double>(0, 0), newDisp.at<double>(1, 0), newDisp.at<double>(2, 0) /*  * 180. / 3.14159265358979323846 */ );
-        ofstream outputfile;
         char str[100];
         sprintf(str,"/home/pi/Desktop/picture/data.txt");
-        outputfile.open(str,ios::app);
-        outputfile<<iStep<<"\t"<<"time:\t"<<1900+p->tm_year<<1+p->tm_mon<<p->tm_mday<<p->tm_hour<<p->tm_min<<"\t"<<p->tm_sec<<"\t"<<"Floor disp:\t"<< newDisp.at<double>(0, 0)<<"\t\t"<< newDisp.at<double>(1, 0)<<"\t"<<    "Tortion (degrees):"<<"\t"<<newDisp.at<double>(2, 0)
-                 <<endl;
+        std::ostringstream dataLine;
+        dataLine<<iStep<<"\t"<<"time:\t"<<1900+p->tm_year<<1+p->tm_mon<<p->tm_mday<<p->tm_hour<<p->tm_min<<"\t"<<p->tm_sec<<"\t"<<"Floor disp:\t"<< newDisp.at<double>(0, 0)<<"\t\t"<< newDisp.at<double>(1, 0)<<"\t"<<    "Tortion (degrees):"<<"\t"<<newDisp.at<double>(2, 0)
+                 <<"\n";
+        sink.run([fnameData = string(str), line = dataLine.str()]() {
+            ofstream outputfile(fnameData, ios::app);
+            outputfile << line;
+        });
      //   outputfile<<iStep<<"\t"<<"time:\t"<<1900+p->tm_year<<1+p->tm_mon<<p->tm_mday<<p->tm_hour<<p->tm_min<<p->tm_sec<<"\t"
      //            <<"Floor disp:\t"<<  newDisp.at<double>(0, 0)<<"\t"
      //            << newDisp.at<double>(1, 0)<<"\t"
@@ -568,7 +592,6 @@ int FuncStoryDispV4(int argc, char ** argv)
 
 
 
-        outputfile.close();
 
             // updating tmplt if necessary
         if (trackUpdateFreq > 0)
@@ -626,6 +649,7 @@ int FuncStoryDispV4(int argc, char ** argv)
 
     } // end of tracking loop
 
+    sink.close();
     if (fBigTable) fclose(fBigTable);
 
     cv::destroyAllWindows();
@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <cmath>
 #include <string>
+#include <sstream>
 #include <vector>
 #include <opencv2/opencv.hpp>
 #include <ctime>
@@ -16,6 +17,7 @@
 #include "impro_util.h"
 #include "improDraw.h"
 #include "trackings.h"
+#include "OutputSink.h"
 
 
 
@@ -50,6 +52,11 @@ int estimateStoryDispV4(
 #pragma once 
 
 
+const cv::String keys =
+"{help h usage ?     |      | print this message   }"
+"{nThreads   nThr    |      | number of threads of template matching of points (default: number of CPUs) }"
+;
+
 int FuncStoryDispV6(int argc, char ** argv)
 {
 
@@ -63,9 +70,17 @@ int FuncStoryDispV6(int argc, char ** argv)
 	string fnameImgInit("");
 	cv::Mat imgInit;
 	int trackMethod; // tracking method. 1:Template match (with rotation and pyramid), 2:Ecc, 3:Optical flow (sparse, LK Pyr.)
+	int nThreads = cv::getNumberOfCPUs(); // threads of template matching (calcTMatchRotPyr())
 	int trackUpdateFreq; // tracking template updating frequency. 0:Not updating (using initial template). 1:Update every frame. 2:Update every other frame. Etc.
 	int trackPredictionMethod; // tracking prediction method. 0:Previous point. 1:Linear approx. 2:2nd-order approx.
 	int winSize; // window size of template size
+
+	cv::CommandLineParser parser(argc, argv, keys);
+	if (parser.has("help"))
+		parser.printMessage();
+	if (parser.has("nThreads"))
+		nThreads = std::max(1, parser.get<int>("nThreads"));
+
 //    string fnameBigTable("./bigTable.txt");
 	string fnameBigTable;
 
@@ -352,6 +367,9 @@ int FuncStoryDispV6(int argc, char ** argv)
 
 	// Step 5: start the tracking loop
 	cv::Mat imgCurr, imgTmpl;
+	vector<RotTmpltBank> banksFixed, banksTrack; // template banks of points (trackMethod 1), cleared when template is updated
+	OutputSink sink; // data.txt lines are formatted by the tracking loop and appended by a background thread
+	sink.start(1);
 	//	cv::VideoCapture vid("v4l2src ! video/x-raw,format=NV12,width=1640,height=1232 ! videoconvert ! appsink");
 	//if (vid.isOpened() == false) {
 	//	cerr << "Cannot open camera.\n";
@@ -768,7 +786,10 @@ int FuncStoryDispV6(int argc, char ** argv)
 					vector<float>(n, 0.05f),
 					vector<float>(n, 0.0f),
 					vector<float>(n, 0.0f),
-					rot_deg);
+					rot_deg,
+					cv::TM_CCORR_NORMED, -1, -1, -1,
+					nThreads,
+					&banksFixed);
 			}
 
 			if (trackMethod == 3)
@@ -804,7 +825,10 @@ int FuncStoryDispV6(int argc, char ** argv)
 					vector<float>(n, 0.05f),
 					vector<float>(n, 0.0f),
 					vector<float>(n, 0.0f),
-					rot_deg);
+					rot_deg,
+					cv::TM_CCORR_NORMED, -1, -1, -1,
+					nThreads,
+					&banksTrack);
 			}
 			if (trackMethod == 3)
 				cv::calcOpticalFlowPyrLK(imgTmpl, imgCurr, trackPoints2f_Tmpl, trackPoints2f_Curr,
@@ -862,12 +886,15 @@ int FuncStoryDispV6(int argc, char ** argv)
 			printf("Floor disp: %16.4f %16.4f    Tortion (degrees): %16.4f      ",
 				newDisp.at<double>(0, 0), newDisp.at<double>(1, 0), newDisp.at<double>(2, 0) /*  * 180. / 3.14159265358979323846 */);
 			//cout << buf << endl;
-			ofstream outputfile;
 			char str[1000];
 			snprintf(str, 1000, "H:\\pic\\data.txt");
-			outputfile.open(str, ios::app);
-			outputfile << stepnumber << "\t" << "time:\t" << 1900 + p2->tm_year << 1 + p2->tm_mon << p2->tm_mday << p2->tm_hour << p2->tm_min << p2->tm_sec << "\t" << 1 << "\t" << "Floor disp:\t" << newDisp.at<double>(0, 0) << "\t\t" << newDisp.at<double>(1, 0) << "\t" << "Tortion (degrees):" << "\t" << newDisp.at<double>(2, 0)
-				<< endl;
+			std::ostringstream dataLine;
+			dataLine << stepnumber << "\t" << "time:\t" << 1900 + p2->tm_year << 1 + p2->tm_mon << p2->tm_mday << p2->tm_hour << p2->tm_min << p2->tm_sec << "\t" << 1 << "\t" << "Floor disp:\t" << newDisp.at<double>(0, 0) << "\t\t" << newDisp.at<double>(1, 0) << "\t" << "Tortion (degrees):" << "\t" << newDisp.at<double>(2, 0)
+				<< "\n";
+			sink.run([fnameData = string(str), line = dataLine.str()]() {
+				ofstream outputfile(fnameData, ios::app);
+				outputfile << line;
+			});
 
 			//   outputfile<<iStep<<"\t"<<"time:\t"<<1900+p->tm_year<<1+p->tm_mon<<p->tm_mday<<p->tm_hour<<p->tm_min<<p->tm_sec<<"\t"
 			//            <<"Floor disp:\t"<<  newDisp.at<double>(0, 0)<<"\t"
@@ -969,7 +996,6 @@ int FuncStoryDispV6(int argc, char ** argv)
 			} // end of if plot == true	
 
 
-			outputfile.close();
 			//
 			//if (fre_type == 1 && abs(newDisp.at<double>(0, 0)) > 0.025) {
 			//	//each_fram_sec = 2;
@@ -999,7 +1025,8 @@ int FuncStoryDispV6(int argc, char ** argv)
 					imgTmpl = imgCurr.clone();
 					fixedPoints2f_Tmpl = fixedPoints2f_Curr;
 					trackPoints2f_Tmpl = trackPoints2f_Curr;
-
+					for (size_t iPoint = 0; iPoint < banksFixed.size(); iPoint++) banksFixed[iPoint].clear();
+					for (size_t iPoint = 0; iPoint < banksTrack.size(); iPoint++) banksTrack[iPoint].clear();
 				}
 			}
 
@@ -1049,6 +1076,7 @@ int FuncStoryDispV6(int argc, char ** argv)
 		}//end of 31
 	}// end of tracking loop
 
+	sink.close();
 	if (fBigTable) fclose(fBigTable);
 
 	cv::destroyAllWindows();
@@ -12,6 +12,7 @@
 #include <cstdlib>
 #include <cmath>
 #include <string>
+#include <sstream>
 #include <vector>
 #include <ctime>
 #include <thread>
@@ -22,7 +23,9 @@
 #include "impro_util.h"
 #include "improDraw.h"
 #include "trackings.h"
+#include "LkPyramid.h"
 #include "RollingPlot.h"
+#include "OutputSink.h"
 
 using namespace std;
 using namespace cv;
@@ -51,6 +54,11 @@ int estimateStoryDispV4(
 
 const float r2d = 180.f / 3.1415926536f; 
 
+const cv::String keys =
+"{help h usage ?     |      | print this message   }"
+"{nThreads   nThr    |      | number of threads of template matching of points (default: number of CPUs) }"
+;
+
 int FuncStoryDispV7(int argc, char** argv)
 {
 	int num_fixed_points, num_track_points;
@@ -59,10 +67,18 @@ int FuncStoryDispV7(int argc, char** argv)
 	cv::Point3d tortionalCenter;
 	string fnameImgInit("");
 	cv::Mat imgInit;
-	int trackMethod; // tracking method. 1:Template match (with rotation and pyramid), 2:Ecc, 3:Optical flow (sparse, LK Pyr.)
+	int trackMethod; // tracking method. 1:Template match (with rotation and pyramid), 2:Ecc, 3:Optical flow (sparse, LK Pyr.), 4:Template match and optical flow (mtm_opfs())
+	int nThreads = cv::getNumberOfCPUs(); // threads of template matching (calcTMatchRotPyr(), mtm_opfs())
 	int trackUpdateFreq; // tracking template updating frequency. 0:Not updating (using initial template). 1:Update every frame. 2:Update every other frame. Etc.
 	int trackPredictionMethod; // tracking prediction method. 0:Previous point. 1:Linear approx. 2:2nd-order approx.
 	int winSize; // window size of template size
+
+	cv::CommandLineParser parser(argc, argv, keys);
+	if (parser.has("help"))
+		parser.printMessage();
+	if (parser.has("nThreads"))
+		nThreads = std::max(1, parser.get<int>("nThreads"));
+
 	string fnameBigTable;
 	string fDirImgSource; 
 	std::vector<RollingPlot> plots{
@@ -309,8 +325,8 @@ int FuncStoryDispV7(int argc, char** argv)
 	//   4.2: Target updating frequency (default 1, update each frame, 0 for not-updated and using initial template)
 	//   4.3: Prediction method (default: 2-nd order)
 	//
-	std::cout << "# Select tracking method: (1)Template match, (2)Ecc, (3)Optical flow:\n";
-	trackMethod = readIntFromIstream(std::cin, 1, 3);
+	std::cout << "# Select tracking method: (1)Template match, (2)Ecc, (3)Optical flow, (4)Template match and optical flow:\n";
+	trackMethod = readIntFromIstream(std::cin, 1, 4);
 	std::cout << "# Your selection is " << trackMethod << endl;
 	std::cout << "# Target updating frequency: (0)Not updating (N)Updating every N frames: \n";
 	trackUpdateFreq = readIntFromIstream(std::cin, 0, 99999999);
@@ -332,6 +348,10 @@ int FuncStoryDispV7(int argc, char** argv)
 
 	// Step 5: start the tracking loop
 	cv::Mat imgCurr, imgTmpl;
+	vector<RotTmpltBank> banksFixed, banksTrack; // template banks of points (trackMethod 1), cleared when template is updated
+	LkPyramid pyrTmpl, pyrCurr; // pyramids for optical flow of mtm_opfs() (trackMethod 4), rebuilt when the image changes
+	OutputSink sink; // data.txt lines are formatted by the tracking loop and appended by a background thread
+	sink.start(1);
 
 	vector<cv::Point2f> fixedPoints2f_Curr = fixedPoints2f;
 	vector<cv::Point2f> fixedPoints2f_Prev = fixedPoints2f;
@@ -692,7 +712,10 @@ int FuncStoryDispV7(int argc, char** argv)
 					vector<float>(n, 0.05f),
 					vector<float>(n, 0.0f),
 					vector<float>(n, 0.0f),
-					rot_deg);
+					rot_deg,
+					cv::TM_CCORR_NORMED, -1, -1, -1,
+					nThreads,
+					&banksFixed);
 			}
 
 			if (trackMethod == 3)
@@ -704,6 +727,28 @@ int FuncStoryDispV7(int argc, char** argv)
 					cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 50 /* ecc max count */, 0.001 /* eps */),
 					cv::OPTFLOW_USE_INITIAL_FLOW
 				);
+			if (trackMethod == 4)
+			{
+				// all fixed points are matched as a batch, then refined by one optical flow
+				int n = (int)fixedPoints2f_Curr.size();
+				vector<cv::Point3f> fixedPoints3f_Curr(n);
+				for (int i = 0; i < n; i++)
+					fixedPoints3f_Curr[i] = cv::Point3f(fixedPoints2f_Curr[i].x, fixedPoints2f_Curr[i].y, 0.f);
+				vector<float> maxMove = { 5.f, 5.f, 0.f }; // search range (as trackMethod 1), no rotation
+				vector<float> timing;
+				mtm_opfs(imgTmpl, imgCurr, fixedPoints2f_Tmpl, fixedPoints3f_Curr, maxMove,
+					optFlow_status,
+					optFlow_error,
+					timing,
+					cv::Size(winSize, winSize),
+					maxLevel,
+					cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 50 /* ecc max count */, 0.001 /* eps */),
+					cv::OPTFLOW_USE_INITIAL_FLOW,
+					&pyrTmpl, &pyrCurr,
+					nThreads);
+				for (int i = 0; i < n; i++)
+					fixedPoints2f_Curr[i] = cv::Point2f(fixedPoints3f_Curr[i].x, fixedPoints3f_Curr[i].y);
+			}
 
 			// Step 7:		track tracking points (tracking points)
 
@@ -723,7 +768,10 @@ int FuncStoryDispV7(int argc, char** argv)
 					vector<float>(n, 0.05f),
 					vector<float>(n, 0.0f),
 					vector<float>(n, 0.0f),
-					rot_deg);
+					rot_deg,
+					cv::TM_CCORR_NORMED, -1, -1, -1,
+					nThreads,
+					&banksTrack);
 			}
 			if (trackMethod == 3)
 				cv::calcOpticalFlowPyrLK(imgTmpl, imgCurr, trackPoints2f_Tmpl, trackPoints2f_Curr,
@@ -734,6 +782,28 @@ int FuncStoryDispV7(int argc, char** argv)
 					cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 50 /* ecc max count */, 0.001 /* eps */),
 					cv::OPTFLOW_USE_INITIAL_FLOW
 				);
+			if (trackMethod == 4)
+			{
+				// all tracking points are matched as a batch, then refined by one optical flow
+				int n = (int)trackPoints2f_Curr.size();
+				vector<cv::Point3f> trackPoints3f_Curr(n);
+				for (int i = 0; i < n; i++)
+					trackPoints3f_Curr[i] = cv::Point3f(trackPoints2f_Curr[i].x, trackPoints2f_Curr[i].y, 0.f);
+				vector<float> maxMove = { 5.f, 5.f, 0.f }; // search range (as trackMethod 1), no rotation
+				vector<float> timing;
+				mtm_opfs(imgTmpl, imgCurr, trackPoints2f_Tmpl, trackPoints3f_Curr, maxMove,
+					optFlow_status,
+					optFlow_error,
+					timing,
+					cv::Size(winSize, winSize),
+					maxLevel,
+					cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 50 /* ecc max count */, 0.001 /* eps */),
+					cv::OPTFLOW_USE_INITIAL_FLOW,
+					&pyrTmpl, &pyrCurr,
+					nThreads);
+				for (int i = 0; i < n; i++)
+					trackPoints2f_Curr[i] = cv::Point2f(trackPoints3f_Curr[i].x, trackPoints3f_Curr[i].y);
+			}
 
 			int ikey = cv::waitKey(1);
 			if (ikey == 27 || ikey == 32)
@@ -788,14 +858,16 @@ int FuncStoryDispV7(int argc, char** argv)
 			std::printf("Floor disp: %16.4f %16.4f    Tortion (degrees): %16.4f      ",
 				newDisp.at<double>(0, 0), newDisp.at<double>(1, 0), newDisp.at<double>(2, 0) /*  * 180. / 3.14159265358979323846 */);
 			//std::cout << buf << endl;
-			ofstream outputfile;
 			char str[1000];
 //			snprintf(str, 1000, "H:\\pic\\data.txt");
 			std::snprintf(str, 1000, "%sdata.txt", directoryOfFullPathFile(fnameBigTable).c_str());
-			outputfile.open(str, ios::app);
-			outputfile << stepnumber << "\t" << "time:\t" << 1900 + p2->tm_year << 1 + p2->tm_mon << p2->tm_mday << p2->tm_hour << p2->tm_min << p2->tm_sec << "\t" << 1 << "\t" << "Floor disp:\t" << newDisp.at<double>(0, 0) << "\t\t" << newDisp.at<double>(1, 0) << "\t" << "Tortion (degrees):" << "\t" << newDisp.at<double>(2, 0)
-				<< endl;
-			outputfile.close();
+			std::ostringstream dataLine;
+			dataLine << stepnumber << "\t" << "time:\t" << 1900 + p2->tm_year << 1 + p2->tm_mon << p2->tm_mday << p2->tm_hour << p2->tm_min << p2->tm_sec << "\t" << 1 << "\t" << "Floor disp:\t" << newDisp.at<double>(0, 0) << "\t\t" << newDisp.at<double>(1, 0) << "\t" << "Tortion (degrees):" << "\t" << newDisp.at<double>(2, 0)
+				<< "\n";
+			sink.run([fnameData = string(str), line = dataLine.str()]() {
+				ofstream outputfile(fnameData, ios::app);
+				outputfile << line;
+			});
 
 			// plot
 			ikey = plots[0].addDataAndPlot((float)newDisp.at<double>(0)); 
@@ -813,7 +885,8 @@ int FuncStoryDispV7(int argc, char** argv)
 					imgTmpl = imgCurr.clone();
 					fixedPoints2f_Tmpl = fixedPoints2f_Curr;
 					trackPoints2f_Tmpl = trackPoints2f_Curr;
-
+					for (size_t iPoint = 0; iPoint < banksFixed.size(); iPoint++) banksFixed[iPoint].clear();
+					for (size_t iPoint = 0; iPoint < banksTrack.size(); iPoint++) banksTrack[iPoint].clear();
 				}
 			}
 
@@ -865,6 +938,7 @@ int FuncStoryDispV7(int argc, char** argv)
 		}//end of 31
 	}// end of tracking loop
 
+	sink.close();
 	if (fBigTable) fclose(fBigTable);
 
 	cv::waitKey(0); 
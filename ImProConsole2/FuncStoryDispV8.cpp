@@ -8,11 +8,14 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <cstdio>
 #include <cstdlib>
+#include <cstdarg>
 #include <cmath>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <ctime>
 #include <thread>
 #include <chrono>
@@ -23,6 +26,10 @@
 #include "improDraw.h"
 #include "trackings.h"
 #include "RollingPlot.h"
+#include "LkPyramid.h"
+#include "PointsPredictor.h"
+#include "BigTableLog.h"
+#include "OutputSink.h"
 
 using namespace std;
 using namespace cv;
@@ -51,6 +58,22 @@ int estimateStoryDispV4(
 
 const float r2d = 180.f / 3.1415926536f;
 
+const cv::String keys =
+"{help h usage ?     |      | print this message   }"
+"{nThreads   nThr    |      | number of threads of template matching of points (default: number of CPUs) }"
+;
+
+// returns printf-formatted text (for lines of the big table)
+static string strf(const char * fmt, ...)
+{
+	char buf[1000];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(buf, 1000, fmt, args);
+	va_end(args);
+	return string(buf);
+}
+
 int FuncStoryDispV8(int argc, char** argv)
 {
 	int num_fixed_points, num_track_points;
@@ -61,9 +84,16 @@ int FuncStoryDispV8(int argc, char** argv)
 	cv::Mat imgInit;
 	int trackMethod; // tracking method. 1:Template match (with rotation and pyramid), 2:Ecc, 3:Optical flow (sparse, LK Pyr.)
 	int trackUpdateFreq; // tracking template updating frequency. 0:Not updating (using initial template). 1:Update every frame. 2:Update every other frame. Etc.
-	int trackPredictionMethod; // tracking prediction method. 0:Previous point. 1:Linear approx. 2:2nd-order approx.
+	int trackPredictionMethod; // tracking prediction method. 0:Previous point. 1:Linear approx. 2:2nd-order approx. 3:Kalman (const. acceleration, with per-point search ranges)
 	int winSize; // window size of template size
 	int iiStep = 0; // the Step to output to the big table
+	int nThreads = cv::getNumberOfCPUs(); // threads of template matching (calcTMatchRotPyr())
+
+	cv::CommandLineParser parser(argc, argv, keys);
+	if (parser.has("help"))
+		parser.printMessage();
+	if (parser.has("nThreads"))
+		nThreads = std::max(1, parser.get<int>("nThreads"));
 
 	string fnameBigTable;
 	string fDirImgSource;
@@ -126,12 +156,11 @@ int FuncStoryDispV8(int argc, char** argv)
 	fDirImgSource = readStringFromIstream(std::cin);
 	fDirImgSource = appendSlashOrBackslashAfterDirectoryIfNecessary(fDirImgSource);
 
-	// Ready to output big table file
-	FILE* fBigTable;
-	int ferr;
-	std::cout << "# Enter full path of the big table file:\n";
+	// Ready to output big table file (settings are kept in bigTable, and the file 
+	// is written when tracking starts)
+	BigTableLog bigTable;
+	std::cout << "# Enter full path of the big table file (.bin for a binary log, which bigTableCsv converts to csv text):\n";
 	fnameBigTable = readStringFromIstream(std::cin);
-	ferr = fopen_s(&fBigTable, fnameBigTable.c_str(), "w");
 	std::printf("# Big table file is at: %s\n", fnameBigTable.c_str()); std::cout.flush();
 
 	//eric get intial image
@@ -174,24 +203,24 @@ int FuncStoryDispV8(int argc, char** argv)
 	std::cout << "camPos:\n" << campos << "\ncamdir:\n" << camdir << endl;
 
 	// output to big table
-	if (fBigTable) fprintf(fBigTable, "Fx: , %25.17e\n", cmat.at<double>(0, 0));
-	if (fBigTable) fprintf(fBigTable, "Fy: , %25.17e\n", cmat.at<double>(1, 1));
-	if (fBigTable) fprintf(fBigTable, "Cx: , %25.17e\n", cmat.at<double>(0, 2));
-	if (fBigTable) fprintf(fBigTable, "Cy: , %25.17e\n", cmat.at<double>(1, 2));
-	if (fBigTable) fprintf(fBigTable, "K1: , %25.17e\n", dvec.at<double>(0, 0));
-	if (fBigTable) if (dvec.cols > 1) fprintf(fBigTable, "K2: , %25.17e\n", dvec.at<double>(0, 1));
-	if (fBigTable) if (dvec.cols > 2) fprintf(fBigTable, "P1: , %25.17e\n", dvec.at<double>(0, 2));
-	if (fBigTable) if (dvec.cols > 3) fprintf(fBigTable, "P2: , %25.17e\n", dvec.at<double>(0, 3));
-	if (fBigTable) if (dvec.cols > 4) fprintf(fBigTable, "K3: , %25.17e\n", dvec.at<double>(0, 4));
-	if (fBigTable) if (dvec.cols > 5) fprintf(fBigTable, "K4: , %25.17e\n", dvec.at<double>(0, 5));
-	if (fBigTable) if (dvec.cols > 6) fprintf(fBigTable, "K5: , %25.17e\n", dvec.at<double>(0, 6));
-	if (fBigTable) if (dvec.cols > 7) fprintf(fBigTable, "K6: , %25.17e\n", dvec.at<double>(0, 7));
-	if (fBigTable) fprintf(fBigTable, "rx: , %25.17e\n", ((double*)rvec.data)[0]);
-	if (fBigTable) fprintf(fBigTable, "ry: , %25.17e\n", ((double*)rvec.data)[1]);
-	if (fBigTable) fprintf(fBigTable, "rz: , %25.17e\n", ((double*)rvec.data)[2]);
-	if (fBigTable) fprintf(fBigTable, "tx: , %25.17e\n", ((double*)tvec.data)[0]);
-	if (fBigTable) fprintf(fBigTable, "ty: , %25.17e\n", ((double*)tvec.data)[1]);
-	if (fBigTable) fprintf(fBigTable, "tz: , %25.17e\n", ((double*)tvec.data)[2]);
+	bigTable.addPreambleLine(strf("Fx: , %25.17e", cmat.at<double>(0, 0)));
+	bigTable.addPreambleLine(strf("Fy: , %25.17e", cmat.at<double>(1, 1)));
+	bigTable.addPreambleLine(strf("Cx: , %25.17e", cmat.at<double>(0, 2)));
+	bigTable.addPreambleLine(strf("Cy: , %25.17e", cmat.at<double>(1, 2)));
+	bigTable.addPreambleLine(strf("K1: , %25.17e", dvec.at<double>(0, 0)));
+	if (dvec.cols > 1) bigTable.addPreambleLine(strf("K2: , %25.17e", dvec.at<double>(0, 1)));
+	if (dvec.cols > 2) bigTable.addPreambleLine(strf("P1: , %25.17e", dvec.at<double>(0, 2)));
+	if (dvec.cols > 3) bigTable.addPreambleLine(strf("P2: , %25.17e", dvec.at<double>(0, 3)));
+	if (dvec.cols > 4) bigTable.addPreambleLine(strf("K3: , %25.17e", dvec.at<double>(0, 4)));
+	if (dvec.cols > 5) bigTable.addPreambleLine(strf("K4: , %25.17e", dvec.at<double>(0, 5)));
+	if (dvec.cols > 6) bigTable.addPreambleLine(strf("K5: , %25.17e", dvec.at<double>(0, 6)));
+	if (dvec.cols > 7) bigTable.addPreambleLine(strf("K6: , %25.17e", dvec.at<double>(0, 7)));
+	bigTable.addPreambleLine(strf("rx: , %25.17e", ((double*)rvec.data)[0]));
+	bigTable.addPreambleLine(strf("ry: , %25.17e", ((double*)rvec.data)[1]));
+	bigTable.addPreambleLine(strf("rz: , %25.17e", ((double*)rvec.data)[2]));
+	bigTable.addPreambleLine(strf("tx: , %25.17e", ((double*)tvec.data)[0]));
+	bigTable.addPreambleLine(strf("ty: , %25.17e", ((double*)tvec.data)[1]));
+	bigTable.addPreambleLine(strf("tz: , %25.17e", ((double*)tvec.data)[2]));
 
 	// Step 2: Ask user to define reference points (supposed to be fixed) both 2D (image) and 3D (world).
 	std::cout << "# Enter number of reference points (fixed points): \n";
@@ -225,12 +254,12 @@ int FuncStoryDispV8(int argc, char** argv)
 	}
 
 	// output to big table
-	if (fBigTable) fprintf(fBigTable, "numRefPoints: , %4d\n", num_fixed_points);
+	bigTable.addPreambleLine(strf("numRefPoints: , %4d", num_fixed_points));
 	for (int i = 0; i < num_fixed_points; i++) {
-		if (fBigTable) fprintf(fBigTable, "refPoints2f[ %4d ]: , %16.9e , %16.9e , "
-			"refPoints3d[ %4d ]: , %25.17e , %25.17e , %25.17e\n",
+		bigTable.addPreambleLine(strf("refPoints2f[ %4d ]: , %16.9e , %16.9e , "
+			"refPoints3d[ %4d ]: , %25.17e , %25.17e , %25.17e",
 			i, fixedPoints2f[i].x, fixedPoints2f[i].y,
-			i, fixedPoints3d[i].x, fixedPoints3d[i].y, fixedPoints3d[i].z);
+			i, fixedPoints3d[i].x, fixedPoints3d[i].y, fixedPoints3d[i].z));
 	}
 
 	// Step 3: Ask user to define tracking points (supposed to move within constrained surface) both 2D (image) and 3D (world).
@@ -279,12 +308,12 @@ int FuncStoryDispV8(int argc, char** argv)
 	zTrack /= num_track_points;
 
 	// output to big table
-	if (fBigTable) fprintf(fBigTable, "numTrkPoints: , %4d\n", num_fixed_points);
+	bigTable.addPreambleLine(strf("numTrkPoints: , %4d", num_fixed_points));
 	for (int i = 0; i < num_track_points; i++) {
-		if (fBigTable) fprintf(fBigTable, "trackPoints2f[ %4d ]: , %16.9e , %16.9e , "
-			"trackPoints3d[ %4d ]: , %25.17e , %25.17e , %25.17e\n",
+		bigTable.addPreambleLine(strf("trackPoints2f[ %4d ]: , %16.9e , %16.9e , "
+			"trackPoints3d[ %4d ]: , %25.17e , %25.17e , %25.17e",
 			i, trackPoints2f[i].x, trackPoints2f[i].y,
-			i, trackPoints3d[i].x, trackPoints3d[i].y, trackPoints3d[i].z);
+			i, trackPoints3d[i].x, trackPoints3d[i].y, trackPoints3d[i].z));
 	}
 
 	std::cout << "# Define tortional center (xc yc zc): \n";
@@ -293,8 +322,8 @@ int FuncStoryDispV8(int argc, char** argv)
 	tortionalCenter.z = readDoubleFromIstream(std::cin);
 
 	// output to big table
-	if (fBigTable) fprintf(fBigTable, "tortionalCenter: , %25.17e , %25.17e , %25.17e\n",
-		tortionalCenter.x, tortionalCenter.y, tortionalCenter.z);
+	bigTable.addPreambleLine(strf("tortionalCenter: , %25.17e , %25.17e , %25.17e",
+		tortionalCenter.x, tortionalCenter.y, tortionalCenter.z));
 
 	cv::Mat matFixedPoints2f(fixedPoints2f);
 	cv::Mat matFixedPoints3d(fixedPoints3d);
@@ -317,8 +346,8 @@ int FuncStoryDispV8(int argc, char** argv)
 	std::cout << "# Target updating frequency: (0)Not updating (N)Updating every N frames: \n";
 	trackUpdateFreq = readIntFromIstream(std::cin, 0, 99999999);
 	std::cout << "# Your selection is " << trackUpdateFreq << endl;
-	std::cout << "# Prediction method: (0)Previous point, (1)Linear approx, (2)2nd-order approx.:\n";
-	trackPredictionMethod = readIntFromIstream(std::cin, 0, 2);
+	std::cout << "# Prediction method: (0)Previous point, (1)Linear approx, (2)2nd-order approx., (3)Kalman filter:\n";
+	trackPredictionMethod = readIntFromIstream(std::cin, 0, 3);
 	std::cout << "# Your selection is " << trackPredictionMethod << endl;
 	int defaultWinSize = std::min(imgInit.cols, imgInit.rows) / 50;
 	std::cout << "# Window size (or template size) (0 for 1/50 of min(image width, height), " << defaultWinSize << "):\n";
@@ -327,13 +356,26 @@ int FuncStoryDispV8(int argc, char** argv)
 	std::cout << "Window size is " << winSize << endl;
 
 	// output to big table
-	if (fBigTable) fprintf(fBigTable, "trackMethod: , %d\n", trackMethod);
-	if (fBigTable) fprintf(fBigTable, "trackUpdateFreq: , %d\n", trackUpdateFreq);
-	if (fBigTable) fprintf(fBigTable, "trackPredictionMethod: , %d\n", trackPredictionMethod);
-	if (fBigTable) fprintf(fBigTable, "winSize: , %d\n", winSize);
+	bigTable.addPreambleLine(strf("trackMethod: , %d", trackMethod));
+	bigTable.addPreambleLine(strf("trackUpdateFreq: , %d", trackUpdateFreq));
+	bigTable.addPreambleLine(strf("trackPredictionMethod: , %d", trackPredictionMethod));
+	bigTable.addPreambleLine(strf("winSize: , %d", winSize));
+
+	// settings of the analysis (in the header of a binary big table)
+	bigTable.meta() << "cameraMatrix" << cmat << "distortionVector" << dvec << "R4" << r4
+		<< "rvec" << rvec << "tvec" << tvec;
+	bigTable.meta() << "refPoints2f" << fixedPoints2f << "refPoints3d" << fixedPoints3d
+		<< "trackPoints2f" << trackPoints2f << "trackPoints3d" << trackPoints3d
+		<< "tortionalCenter" << tortionalCenter;
+	bigTable.meta() << "trackMethod" << trackMethod << "trackUpdateFreq" << trackUpdateFreq
+		<< "trackPredictionMethod" << trackPredictionMethod << "winSize" << winSize;
 
 	// Step 5: start the tracking loop
 	cv::Mat imgCurr, imgTmpl;
+	LkPyramid pyrTmpl, pyrCurr; // pyramids for optical flow (template pyramid is kept until template is updated)
+	PointsPredictor predFixed, predTrack; // Kalman predictors (trackPredictionMethod 3)
+	vector<RotTmpltBank> banksFixed, banksTrack; // template banks of points (trackMethod 1), cleared when template is updated
+	vector<cv::Point2f> sigmaFixed, sigmaTrack; // uncertainties of predictions (pixels)
 
 	vector<cv::Point2f> fixedPoints2f_Curr = fixedPoints2f;
 	vector<cv::Point2f> fixedPoints2f_Prev = fixedPoints2f;
@@ -347,38 +389,41 @@ int FuncStoryDispV8(int argc, char** argv)
 	vector<cv::Point2f> trackPoints2f_Pre3 = trackPoints2f;
 	vector<cv::Point2f> trackPoints2f_Tmpl = trackPoints2f;
 
-	// output to big table (header line)
-	if (fBigTable) fprintf(fBigTable, " Step , "); // 8 chars (including ending space)
-	if (fBigTable) fprintf(fBigTable, "           Time , "); // YYYYMMDDhhmmsssss (18 chars including ending space)
+	// columns of big table (the header line of csv text), and the file is written
+	// (the time column is YYYYMMDDhhmmss and the frame number, as YYYYMMDDhhmmsssss)
+	bigTable.addColumn("Step", BigTableLog::Int32, "%7d, ", " Step , "); // 8 chars (including ending space)
+	bigTable.addColumn("Time", BigTableLog::Int64, "%014lld", "           Time , "); // YYYYMMDDhhmmsssss (18 chars including ending space)
+	bigTable.addColumn("Frame", BigTableLog::Int32, "%03d, ", "");
 	for (int i = 0; i < num_fixed_points; i++) {
-		if (fBigTable) fprintf(fBigTable, "   RefPnt2f[%d].x, ", i); // 17 chars
-		if (fBigTable) fprintf(fBigTable, "   RefPnt2f[%d].y, ", i); // 17 chars
+		bigTable.addColumn(strf("RefPnt2f[%d].x", i), BigTableLog::Float32, "%16.9e, ", strf("   RefPnt2f[%d].x, ", i)); // 17 chars
+		bigTable.addColumn(strf("RefPnt2f[%d].y", i), BigTableLog::Float32, "%16.9e, ", strf("   RefPnt2f[%d].y, ", i)); // 17 chars
 	}
 	for (int i = 0; i < num_track_points; i++) {
-		if (fBigTable) fprintf(fBigTable, "   TrkPnt2f[%d].x, ", i); // 17 chars
-		if (fBigTable) fprintf(fBigTable, "   TrkPnt2f[%d].y, ", i); // 17 chars
+		bigTable.addColumn(strf("TrkPnt2f[%d].x", i), BigTableLog::Float32, "%16.9e, ", strf("   TrkPnt2f[%d].x, ", i)); // 17 chars
+		bigTable.addColumn(strf("TrkPnt2f[%d].y", i), BigTableLog::Float32, "%16.9e, ", strf("   TrkPnt2f[%d].y, ", i)); // 17 chars
 	}
-	if (fBigTable) fprintf(fBigTable, "             FloorDisp.ux, "); // 26 chars
-	if (fBigTable) fprintf(fBigTable, "             FloorDisp.uy, "); // 26 chars
-	if (fBigTable) fprintf(fBigTable, "        FloorDisp.tortion, "); // 26 chars
-	if (fBigTable) fprintf(fBigTable, "                camRot.rx, "); // 26 chars
-	if (fBigTable) fprintf(fBigTable, "                camRot.ry, "); // 26 chars
-	if (fBigTable) fprintf(fBigTable, "                camRot.rz, "); // 26 chars
+	bigTable.addColumn("FloorDisp.ux", BigTableLog::Float64, "%25.17e, ", "             FloorDisp.ux, "); // 26 chars
+	bigTable.addColumn("FloorDisp.uy", BigTableLog::Float64, "%25.17e, ", "             FloorDisp.uy, "); // 26 chars
+	bigTable.addColumn("FloorDisp.tortion", BigTableLog::Float64, "%25.17e, ", "        FloorDisp.tortion, "); // 26 chars
+	bigTable.addColumn("camRot.rx", BigTableLog::Float64, "%25.17e, ", "                camRot.rx, "); // 26 chars
+	bigTable.addColumn("camRot.ry", BigTableLog::Float64, "%25.17e, ", "                camRot.ry, "); // 26 chars
+	bigTable.addColumn("camRot.rz", BigTableLog::Float64, "%25.17e, ", "                camRot.rz, "); // 26 chars
 
 	for (int i = 0; i < num_track_points; i++) {
-		if (fBigTable) fprintf(fBigTable, "            CalTrk3d[%d].x, ", i); // 26 chars
-		if (fBigTable) fprintf(fBigTable, "            CalTrk3d[%d].y, ", i); // 26 chars
-		if (fBigTable) fprintf(fBigTable, "            CalTrk3d[%d].z, ", i); // 26 chars
+		bigTable.addColumn(strf("CalTrk3d[%d].x", i), BigTableLog::Float64, "%25.17e, ", strf("            CalTrk3d[%d].x, ", i)); // 26 chars
+		bigTable.addColumn(strf("CalTrk3d[%d].y", i), BigTableLog::Float64, "%25.17e, ", strf("            CalTrk3d[%d].y, ", i)); // 26 chars
+		bigTable.addColumn(strf("CalTrk3d[%d].z", i), BigTableLog::Float64, "%25.17e, ", strf("            CalTrk3d[%d].z, ", i)); // 26 chars
 	}
 	for (int i = 0; i < num_fixed_points; i++) {
-		if (fBigTable) fprintf(fBigTable, "   PrjRef2f[%d].x, ", i); // 17 chars
-		if (fBigTable) fprintf(fBigTable, "   PrjRef2f[%d].y, ", i); // 17 chars
+		bigTable.addColumn(strf("PrjRef2f[%d].x", i), BigTableLog::Float32, "%16.9e, ", strf("   PrjRef2f[%d].x, ", i)); // 17 chars
+		bigTable.addColumn(strf("PrjRef2f[%d].y", i), BigTableLog::Float32, "%16.9e, ", strf("   PrjRef2f[%d].y, ", i)); // 17 chars
 	}
 	for (int i = 0; i < num_track_points; i++) {
-		if (fBigTable) fprintf(fBigTable, "   PrjTrk2f[%d].x, ", i); // 17 chars
-		if (fBigTable) fprintf(fBigTable, "   PrjTrk2f[%d].y, ", i); // 17 chars
+		bigTable.addColumn(strf("PrjTrk2f[%d].x", i), BigTableLog::Float32, "%16.9e, ", strf("   PrjTrk2f[%d].x, ", i)); // 17 chars
+		bigTable.addColumn(strf("PrjTrk2f[%d].y", i), BigTableLog::Float32, "%16.9e, ", strf("   PrjTrk2f[%d].y, ", i)); // 17 chars
 	}
-	if (fBigTable) fprintf(fBigTable, "\n");
+	if (bigTable.open(fnameBigTable) != 0)
+		std::cerr << "# Warning: Cannot write big table file " << fnameBigTable << ".\n";
 
 	//----eric photo frequence
 
@@ -483,6 +528,17 @@ int FuncStoryDispV8(int argc, char** argv)
 	user_next_finish_time.tm_year -= 1900;
 	user_next_finish_time.tm_mon--;
 
+	// data.txt (in the directory of the big table) is kept open and appended every step
+	ofstream outputfile;
+	char str[1000];
+	//			snprintf(str, 1000, "H:\\pic\\data.txt");
+	std::snprintf(str, 1000, "%sdata.txt", directoryOfFullPathFile(fnameBigTable).c_str());
+	outputfile.open(str, ios::app);
+	// data.txt lines are formatted by the tracking loop and appended by a background thread
+	// (the big table is a binary log written by one write per record, so it stays here)
+	OutputSink sink;
+	sink.start(1);
+
 	int stepnumber = 0;
 	for (size_t iStep = 0; true; iStep++)
 	{
@@ -634,6 +690,15 @@ int FuncStoryDispV8(int argc, char** argv)
 			if (iStep == 0)
 			{
 				// trackPoints2f_Curr = trackPoint2f;
+				if (trackPredictionMethod == 3) {
+					predFixed.init(fixedPoints2f_Curr);
+					predTrack.init(trackPoints2f_Curr);
+				}
+			}
+			else if (trackPredictionMethod == 3)
+			{
+				predFixed.predict(fixedPoints2f_Curr, sigmaFixed);
+				predTrack.predict(trackPoints2f_Curr, sigmaTrack);
 			}
 			else if (iStep == 1 || trackPredictionMethod <= 0)
 			{
@@ -675,30 +740,64 @@ int FuncStoryDispV8(int argc, char** argv)
 			}
 
 			// Step 6:      track reference points (fixed points)
-			vector<uchar> optFlow_status(trackPoints2f_Curr.size());
-			vector<float> optFlow_error(trackPoints2f_Curr.size());
+			// (status and error are sized by the points being tracked, fixed points here and tracking points in Step 7)
+			vector<uchar> optFlow_status(fixedPoints2f_Curr.size());
+			vector<float> optFlow_error(fixedPoints2f_Curr.size());
 			int maxLevel = 3;
+			if (trackMethod == 3)
+			{
+				// pyramids are built once and shared by fixed and tracking points
+				pyrTmpl.update(imgTmpl, cv::Size(winSize, winSize), maxLevel);
+				pyrCurr.build(imgCurr, cv::Size(winSize, winSize), maxLevel, false);
+			}
 			if (trackMethod == 1)
 			{
 				int n = (int)fixedPoints2f_Curr.size();
 				float search_x = 10, search_y = 10, search_r = 0.0;
 				vector<float> rot_deg(n, 0.0);
+				vector<float> search_xs(n, search_x), search_ys(n, search_y);
+				if (trackPredictionMethod == 3 && iStep > 0)
+					for (int iPoint = 0; iPoint < n; iPoint++) {
+						// (searchRange() is a half width, search_xs and search_ys are full widths)
+						cv::Point2f range = predFixed.searchRange(iPoint, 3.0f, 1.0f, 0.5f * std::max(search_x, search_y));
+						search_xs[iPoint] = std::min(2.0f * range.x, search_x);
+						search_ys[iPoint] = std::min(2.0f * range.y, search_y);
+					}
 				calcTMatchRotPyr(imgTmpl, imgCurr, fixedPoints2f_Tmpl, fixedPoints2f_Curr,
 					optFlow_status,
 					optFlow_error,
 					vector<cv::Size>(n, cv::Size(winSize, winSize)),
 					vector<cv::Point2f>(n, cv::Point2f(0.5f, 0.5f)),
-					vector<float>(n, search_x),
+					search_xs,
 					vector<float>(n, 0.05f),
-					vector<float>(n, search_y),
+					search_ys,
 					vector<float>(n, 0.05f),
 					vector<float>(n, 0.0f),
 					vector<float>(n, 0.0f),
-					rot_deg);
+					rot_deg,
+					cv::TM_CCORR_NORMED, -1, -1, -1,
+					nThreads,
+					&banksFixed);
 			}
 
-			if (trackMethod == 3)
-				cv::calcOpticalFlowPyrLK(imgTmpl, imgCurr, fixedPoints2f_Tmpl, fixedPoints2f_Curr,
+			if (trackMethod == 3 && trackPredictionMethod == 3 && iStep > 0)
+			{
+				// coarse levels only for points whose predictions are uncertain
+				vector<int> levels(fixedPoints2f_Curr.size());
+				for (int iPoint = 0; iPoint < (int)levels.size(); iPoint++)
+					levels[iPoint] = PointsPredictor::lkMaxLevel(predFixed.searchRange(iPoint),
+						cv::Size(winSize, winSize), maxLevel);
+				calcOpticalFlowPyrLKPerLevel(pyrTmpl, pyrCurr, fixedPoints2f_Tmpl, fixedPoints2f_Curr,
+					optFlow_status,
+					optFlow_error,
+					cv::Size(winSize, winSize),
+					levels,
+					cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 50 /* ecc max count */, 0.001 /* eps */),
+					cv::OPTFLOW_USE_INITIAL_FLOW
+				);
+			}
+			else if (trackMethod == 3)
+				cv::calcOpticalFlowPyrLK(pyrTmpl.levels(), pyrCurr.levels(), fixedPoints2f_Tmpl, fixedPoints2f_Curr,
 					optFlow_status,
 					optFlow_error,
 					cv::Size(winSize, winSize),
@@ -706,29 +805,60 @@ int FuncStoryDispV8(int argc, char** argv)
 					cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 50 /* ecc max count */, 0.001 /* eps */),
 					cv::OPTFLOW_USE_INITIAL_FLOW
 				);
+			if (trackPredictionMethod == 3 && iStep > 0)
+				predFixed.correct(fixedPoints2f_Curr, optFlow_status);
 
 			// Step 7:		track tracking points (tracking points)
+			optFlow_status.assign(trackPoints2f_Curr.size(), 0);
+			optFlow_error.assign(trackPoints2f_Curr.size(), 0.f);
 
 			if (trackMethod == 1)
 			{
 				int n = (int)trackPoints2f_Curr.size();
 				float search_x = 10, search_y = 10, search_r = 0.0;
 				vector<float> rot_deg(n, 0.0);
+				vector<float> search_xs(n, search_x), search_ys(n, search_y);
+				if (trackPredictionMethod == 3 && iStep > 0)
+					for (int iPoint = 0; iPoint < n; iPoint++) {
+						// (searchRange() is a half width, search_xs and search_ys are full widths)
+						cv::Point2f range = predTrack.searchRange(iPoint, 3.0f, 1.0f, 0.5f * std::max(search_x, search_y));
+						search_xs[iPoint] = std::min(2.0f * range.x, search_x);
+						search_ys[iPoint] = std::min(2.0f * range.y, search_y);
+					}
 				calcTMatchRotPyr(imgTmpl, imgCurr, trackPoints2f_Tmpl, trackPoints2f_Curr,
 					optFlow_status,
 					optFlow_error,
 					vector<cv::Size>(n, cv::Size(winSize, winSize)),
 					vector<cv::Point2f>(n, cv::Point2f(0.5f, 0.5f)),
-					vector<float>(n, search_x),
+					search_xs,
 					vector<float>(n, 0.05f),
-					vector<float>(n, search_y),
+					search_ys,
 					vector<float>(n, 0.05f),
 					vector<float>(n, 0.0f),
 					vector<float>(n, 0.0f),
-					rot_deg);
+					rot_deg,
+					cv::TM_CCORR_NORMED, -1, -1, -1,
+					nThreads,
+					&banksTrack);
 			}
-			if (trackMethod == 3)
-				cv::calcOpticalFlowPyrLK(imgTmpl, imgCurr, trackPoints2f_Tmpl, trackPoints2f_Curr,
+			if (trackMethod == 3 && trackPredictionMethod == 3 && iStep > 0)
+			{
+				// coarse levels only for points whose predictions are uncertain
+				vector<int> levels(trackPoints2f_Curr.size());
+				for (int iPoint = 0; iPoint < (int)levels.size(); iPoint++)
+					levels[iPoint] = PointsPredictor::lkMaxLevel(predTrack.searchRange(iPoint),
+						cv::Size(winSize, winSize), maxLevel);
+				calcOpticalFlowPyrLKPerLevel(pyrTmpl, pyrCurr, trackPoints2f_Tmpl, trackPoints2f_Curr,
+					optFlow_status,
+					optFlow_error,
+					cv::Size(winSize, winSize),
+					levels,
+					cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 50 /* ecc max count */, 0.001 /* eps */),
+					cv::OPTFLOW_USE_INITIAL_FLOW
+				);
+			}
+			else if (trackMethod == 3)
+				cv::calcOpticalFlowPyrLK(pyrTmpl.levels(), pyrCurr.levels(), trackPoints2f_Tmpl, trackPoints2f_Curr,
 					optFlow_status,
 					optFlow_error,
 					cv::Size(winSize, winSize),
@@ -736,6 +866,8 @@ int FuncStoryDispV8(int argc, char** argv)
 					cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 50 /* ecc max count */, 0.001 /* eps */),
 					cv::OPTFLOW_USE_INITIAL_FLOW
 				);
+			if (trackPredictionMethod == 3 && iStep > 0)
+				predTrack.correct(trackPoints2f_Curr, optFlow_status);
 
 			int ikey = cv::waitKey(1);
 			if (ikey == 27 || ikey == 32)
@@ -790,14 +922,10 @@ int FuncStoryDispV8(int argc, char** argv)
 			std::printf("Floor disp: %16.4f %16.4f    Tortion (degrees): %16.4f      ",
 				newDisp.at<double>(0, 0), newDisp.at<double>(1, 0), newDisp.at<double>(2, 0) /*  * 180. / 3.14159265358979323846 */);
 			//std::cout << buf << endl;
-			ofstream outputfile;
-			char str[1000];
-			//			snprintf(str, 1000, "H:\\pic\\data.txt");
-			std::snprintf(str, 1000, "%sdata.txt", directoryOfFullPathFile(fnameBigTable).c_str());
-			outputfile.open(str, ios::app);
-			outputfile << stepnumber << "\t" << "time:\t" << 1900 + p2->tm_year << 1 + p2->tm_mon << p2->tm_mday << p2->tm_hour << p2->tm_min << p2->tm_sec << "\t" << 1 << "\t" << "Floor disp:\t" << newDisp.at<double>(0, 0) << "\t\t" << newDisp.at<double>(1, 0) << "\t" << "Tortion (degrees):" << "\t" << newDisp.at<double>(2, 0)
-				<< endl;
-			outputfile.close();
+			std::ostringstream dataLine;
+			dataLine << stepnumber << "\t" << "time:\t" << 1900 + p2->tm_year << 1 + p2->tm_mon << p2->tm_mday << p2->tm_hour << p2->tm_min << p2->tm_sec << "\t" << 1 << "\t" << "Floor disp:\t" << newDisp.at<double>(0, 0) << "\t\t" << newDisp.at<double>(1, 0) << "\t" << "Tortion (degrees):" << "\t" << newDisp.at<double>(2, 0)
+				<< "\n";
+			sink.run([&outputfile, line = dataLine.str()]() { outputfile << line << flush; });
 
 			// plot
 			ikey = plots[0].addDataAndPlot((float)newDisp.at<double>(0));
@@ -815,6 +943,8 @@ int FuncStoryDispV8(int argc, char** argv)
 					imgTmpl = imgCurr.clone();
 					fixedPoints2f_Tmpl = fixedPoints2f_Curr;
 					trackPoints2f_Tmpl = trackPoints2f_Curr;
+					for (size_t iPoint = 0; iPoint < banksFixed.size(); iPoint++) banksFixed[iPoint].clear();
+					for (size_t iPoint = 0; iPoint < banksTrack.size(); iPoint++) banksTrack[iPoint].clear();
 				}
 			}
 
@@ -827,46 +957,49 @@ int FuncStoryDispV8(int argc, char** argv)
 			trackPoints2f_Pre2 = trackPoints2f_Prev;
 			trackPoints2f_Prev = trackPoints2f_Curr;
 
-			// output to bigTable
-			if (fBigTable) fprintf(fBigTable, "%7d, ", iiStep++);
-			if (fBigTable) fprintf(fBigTable, "%04d%02d%02d%02d%02d%02d%03d, ", 1900 + p2->tm_year, 1 + p2->tm_mon, p2->tm_mday,
-				p2->tm_hour, p2->tm_min, p2->tm_sec, i);  // i is the frame number 
+			// output to bigTable (a record, by one write)
+			bigTable.put(iiStep++);
+			bigTable.put((int64_t) (1900 + p2->tm_year) * 10000000000LL + (int64_t) (1 + p2->tm_mon) * 100000000LL +
+				(int64_t) p2->tm_mday * 1000000LL + p2->tm_hour * 10000LL + p2->tm_min * 100LL + p2->tm_sec);
+			bigTable.put(i);  // i is the frame number 
 			for (int i = 0; i < num_fixed_points; i++) {
-				if (fBigTable) fprintf(fBigTable, "%16.9e, ", fixedPoints2f_Curr[i].x); // 17 chars
-				if (fBigTable) fprintf(fBigTable, "%16.9e, ", fixedPoints2f_Curr[i].y); // 17 chars
+				bigTable.put(fixedPoints2f_Curr[i].x);
+				bigTable.put(fixedPoints2f_Curr[i].y);
 			}
 			for (int i = 0; i < num_track_points; i++) {
-				if (fBigTable) fprintf(fBigTable, "%16.9e, ", trackPoints2f_Curr[i].x); // 17 chars
-				if (fBigTable) fprintf(fBigTable, "%16.9e, ", trackPoints2f_Curr[i].y); // 17 chars
+				bigTable.put(trackPoints2f_Curr[i].x);
+				bigTable.put(trackPoints2f_Curr[i].y);
 			}
-			if (fBigTable) fprintf(fBigTable, "%25.17e, ", newDisp.at<double>(0, 0)); // 26 chars
-			if (fBigTable) fprintf(fBigTable, "%25.17e, ", newDisp.at<double>(1, 0)); // 26 chars
-			if (fBigTable) fprintf(fBigTable, "%25.17e, ", newDisp.at<double>(2, 0)); // 26 chars
-			if (fBigTable) fprintf(fBigTable, "%25.17e, ", camRot.at<double>(0, 0)); // 26 chars
-			if (fBigTable) fprintf(fBigTable, "%25.17e, ", camRot.at<double>(1, 0)); // 26 chars
-			if (fBigTable) fprintf(fBigTable, "%25.17e, ", camRot.at<double>(2, 0)); // 26 chars
+			bigTable.put(newDisp.at<double>(0, 0));
+			bigTable.put(newDisp.at<double>(1, 0));
+			bigTable.put(newDisp.at<double>(2, 0));
+			bigTable.put(camRot.at<double>(0, 0));
+			bigTable.put(camRot.at<double>(1, 0));
+			bigTable.put(camRot.at<double>(2, 0));
 
 			for (int i = 0; i < num_track_points; i++) {
-				if (fBigTable) fprintf(fBigTable, "%25.17e, ", newTrkObjPoints.at<cv::Point3d>(i, 0).x); // 26 chars
-				if (fBigTable) fprintf(fBigTable, "%25.17e, ", newTrkObjPoints.at<cv::Point3d>(i, 0).y); // 26 chars
-				if (fBigTable) fprintf(fBigTable, "%25.17e, ", newTrkObjPoints.at<cv::Point3d>(i, 0).z); // 26 chars
+				bigTable.put(newTrkObjPoints.at<cv::Point3d>(i, 0).x);
+				bigTable.put(newTrkObjPoints.at<cv::Point3d>(i, 0).y);
+				bigTable.put(newTrkObjPoints.at<cv::Point3d>(i, 0).z);
 			}
 
 			for (int i = 0; i < num_fixed_points; i++) {
-				if (fBigTable) fprintf(fBigTable, "%16.9e, ", projNewRefImgPoints.at<cv::Point2f>(i, 0).x); // 17 chars
-				if (fBigTable) fprintf(fBigTable, "%16.9e, ", projNewRefImgPoints.at<cv::Point2f>(i, 0).y); // 17 chars
+				bigTable.put(projNewRefImgPoints.at<cv::Point2f>(i, 0).x);
+				bigTable.put(projNewRefImgPoints.at<cv::Point2f>(i, 0).y);
 			}
 			for (int i = 0; i < num_track_points; i++) {
-				if (fBigTable) fprintf(fBigTable, "%16.9e, ", projNewTrkImgPoints.at<cv::Point2f>(i, 0).x); // 17 chars
-				if (fBigTable) fprintf(fBigTable, "%16.9e, ", projNewTrkImgPoints.at<cv::Point2f>(i, 0).y); // 17 chars
+				bigTable.put(projNewTrkImgPoints.at<cv::Point2f>(i, 0).x);
+				bigTable.put(projNewTrkImgPoints.at<cv::Point2f>(i, 0).y);
 			}
 
-			if (fBigTable) fprintf(fBigTable, "\n");
+			if (bigTable.isOpen()) bigTable.writeRecord();
 
 		}//end of 31
 	}// end of tracking loop
 
-	if (fBigTable) fclose(fBigTable);
+	bigTable.close();
+	sink.close();
+	outputfile.close();
 
 	cv::waitKey(0);
 	cv::destroyAllWindows();
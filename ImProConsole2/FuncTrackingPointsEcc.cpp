@@ -4,15 +4,23 @@
 #include <cstdio>
 #include <cmath>
 #include <iomanip>
+#include <algorithm>
 #include <string>
 #include <vector>
 
+#ifdef _OPENMP
 #include <omp.h>
+#endif
 
 #include <opencv2/opencv.hpp>
 
 #include "FileSeq.h"
+#include "FileSeqPrefetcher.h"
 #include "impro_util.h"
+#include "EccIcTracker.h"
+#include "Points2fHistoryData.h"
+#include "OutputSink.h"
+#include "ChunkedTable.h"
 
 using namespace std;
 
@@ -30,9 +38,41 @@ const cv::String keys =
 "{outVideo   oVideo  |      | output video which plots boxes on each point.}"
 "{showBoxes  showBx  |      | 1 for showing tracked boxes }"
 "{noAsk      noAsk   |      | 1 for automatic mode, not asking any questions for optional settings }"
+"{outHist    oHist   |      | output binary history of tracked points (nFrame x nPoint, appended every frame, readable while tracking by Points2fHistoryData::readFromBin()).}"
+"{decodeRoi  decRoi  |      | 1 for decoding frames in gray and only around the points (not with oFrame or oVideo), for large images }"
+"{writers    nWrite  |      | number of threads writing frame results, pictures and video in the background (default 2, 0 for writing on the tracking thread) }"
 ;
 
-int FuncTrackingPointsEcc(int argc, char** argv)
+// eccSearchRegion() returns the region of an image that ECC of a template (tmplt) 
+// needs, if the template origin is at (tx, ty) and it moves up to (maxMoveX, maxMoveY).
+// (It covers the search rect of getTmpltRectFromImage() around (tx, ty).)
+static cv::Rect eccSearchRegion(const cv::Rect & tmplt, float tx, float ty, int maxMoveX, int maxMoveY)
+{
+	int x0 = (int) std::floor(tx) - tmplt.width / 2 - maxMoveX - 1;
+	int y0 = (int) std::floor(ty) - tmplt.height / 2 - maxMoveY - 1;
+	int x1 = (int) std::ceil(tx) + tmplt.width + maxMoveX + 1;
+	int y1 = (int) std::ceil(ty) + tmplt.height + maxMoveY + 1;
+	return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+// shiftWarp() shifts the image coordinates of a warp (2x3 or 3x3, CV_32F) by (dx, dy)
+static void shiftWarp(cv::Mat & warp, float dx, float dy)
+{
+	if (warp.rows == 3) {
+		cv::Mat r0 = warp.row(0), r1 = warp.row(1);
+		r0 += dx * warp.row(2);
+		r1 += dy * warp.row(2);
+	}
+	else {
+		warp.at<float>(0, 2) += dx;
+		warp.at<float>(1, 2) += dy;
+	}
+}
+
+// trackingPointsEcc() tracks points by cv::findTransformECC() (useIcEcc false)
+// or by EccIcTracker (useIcEcc true, inverse-compositional ECC with template
+// gradients and Hessian precomputed once per point).
+static int trackingPointsEcc(int argc, char** argv, bool useIcEcc)
 {
 	// Arguments
 	string fnameImgPts(""); // file of image points (of each point)
@@ -43,6 +83,7 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 	string oSum;            // file of summary result
 	string oCpt;            // file of compact (only x and y for each point) of summary result
 	bool   showBx;          // boolean of showing pictures of tracked boxes 
+	bool   decodeRoi;       // boolean of decoding frames in gray and only around the points
 
 	int nFrame, nPoint;
 	FileSeq fseq;
@@ -56,7 +97,7 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 
 	cv::Mat imgInit, imgCurr, imgBoxed;
 
-	cv::Mat bigTableEcc; // Each row contains data of a frame.
+	ChunkedTable bigTableEcc; // Each row contains data of a frame. (Only the latest chunks of rows are in memory.)
 	int nfFrm = 5;  // number of floats for each frame-based data
 	int nfPnt = 20; // number of floats for each point-based data 
 	// column 0: frame number (0-base index)
@@ -299,13 +340,39 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 			showBx = false;
 	}
 
+	// decode frames in gray and only around the points --> decodeRoi (command line only)
+	decodeRoi = false;
+	if (pparser) {
+		std::string decodeRoiStr = (*pparser).get<string>("decRoi");
+		if (decodeRoiStr.length() >= 1 && decodeRoiStr[0] == '1')
+			decodeRoi = true;
+	}
+
+	// binary history (log) of tracked points --> oHist (command line only)
+	std::string oHist;
+	if (pparser)
+		oHist = (*pparser).get<string>("oHist");
+
+	// number of background writer threads --> nWriters (command line only)
+	int nWriters = 2;
+	if (pparser && (*pparser).has("nWrite"))
+		nWriters = std::max(0, (*pparser).get<int>("nWrite"));
+
 	printf("Motion type of point %d is %d \n", 0, mTypes[0]);
 	printf("Motion type of point %d is %d \n", nPoint - 1, mTypes[nPoint - 1]);
 	printf("Tmplt size of point %d is %d %d\n", 0, tmpltBoxes[0].width, tmpltBoxes[0].height);
 	printf("Tmplt size of point %d is %d %d\n", nPoint - 1, tmpltBoxes[nPoint - 1].width, tmpltBoxes[nPoint - 1].height);
 
 	// initialize big table  
-	bigTableEcc = cv::Mat::zeros(nFrame, nfFrm + nfPnt * nPoint, CV_32F);
+	// (kept as chunks of rows. Past chunks are spilled to a temporary binary file if the 
+	//  summary is output, which streams over the chunks, or otherwise discarded.)
+	string spillFile;
+	if (oSum.length() > 0 || oCpt.length() > 0)
+		spillFile = (oSum.length() > 0 ? oSum : oCpt) + ".chunks.bin";
+	if (bigTableEcc.create(nFrame, nfFrm + nfPnt * nPoint, 0, spillFile) != 0) {
+		cerr << "Cannot create the big table (spill file " << spillFile << ").\n";
+		return -1;
+	}
 
 	// Frame 0 operations
 	int iFrame = 0;
@@ -317,11 +384,11 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 		return -1;
 	}
 	t_imreadFrm0 = ((double)cv::getTickCount() - t_imreadFrm0) / cv::getTickFrequency();
-	bigTableEcc.at<float>(iFrame, 0) = (float)iFrame;
-	bigTableEcc.at<float>(iFrame, 1) = (float)nPoint;
-	bigTableEcc.at<float>(iFrame, 2) = (float)t_imreadFrm0; // execution time (sec) to read image file
-	bigTableEcc.at<float>(iFrame, 3) = (float) 0.f; //	execution time (sec) to write frame result file 
-	bigTableEcc.at<float>(iFrame, 4) = (float) 0.f; //	execution time (sec) to write frame boxed image
+	bigTableEcc.at(iFrame, 0) = (float)iFrame;
+	bigTableEcc.at(iFrame, 1) = (float)nPoint;
+	bigTableEcc.at(iFrame, 2) = (float)t_imreadFrm0; // execution time (sec) to read image file
+	bigTableEcc.at(iFrame, 3) = (float) 0.f; //	execution time (sec) to write frame result file 
+	bigTableEcc.at(iFrame, 4) = (float) 0.f; //	execution time (sec) to write frame boxed image
 	for (int iPoint = 0; iPoint < nPoint; iPoint++)
 	{
 		cv::Point2f ref;
@@ -329,84 +396,210 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 		//			cv::Point2f(imgPoints.at<float>(iPoint, 0), imgPoints.at<float>(iPoint, 1)),
 		//			cv::Size(tmpltBoxes[iPoint].width, tmpltBoxes[iPoint].height),
 		//			ref);
-		bigTableEcc.at<float>(iFrame, nfFrm + 0 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].x;      // Will not change with iFrame
-		bigTableEcc.at<float>(iFrame, nfFrm + 1 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].y;		 // Will not change with iFrame
-		bigTableEcc.at<float>(iFrame, nfFrm + 2 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].width;	 // Will not change with iFrame
-		bigTableEcc.at<float>(iFrame, nfFrm + 3 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].height; // Will not change with iFrame
-		bigTableEcc.at<float>(iFrame, nfFrm + 4 + iPoint * nfPnt) = (float)mTypes[iPoint];            // Will not change with iFrame
-		bigTableEcc.at<float>(iFrame, nfFrm + 5 + iPoint * nfPnt) = 1.0f;
-		bigTableEcc.at<float>(iFrame, nfFrm + 6 + iPoint * nfPnt) = 0.0f;
-		bigTableEcc.at<float>(iFrame, nfFrm + 7 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].x;
-		bigTableEcc.at<float>(iFrame, nfFrm + 8 + iPoint * nfPnt) = 0.0f;
-		bigTableEcc.at<float>(iFrame, nfFrm + 9 + iPoint * nfPnt) = 1.0f;
-		bigTableEcc.at<float>(iFrame, nfFrm + 10 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].y;
-		bigTableEcc.at<float>(iFrame, nfFrm + 11 + iPoint * nfPnt) = 0.0f;
-		bigTableEcc.at<float>(iFrame, nfFrm + 12 + iPoint * nfPnt) = 0.0f;
-		bigTableEcc.at<float>(iFrame, nfFrm + 13 + iPoint * nfPnt) = 1.0f;
-		bigTableEcc.at<float>(iFrame, nfFrm + 14 + iPoint * nfPnt) = imgPoints.at<float>(iPoint, 0);
-		bigTableEcc.at<float>(iFrame, nfFrm + 15 + iPoint * nfPnt) = imgPoints.at<float>(iPoint, 1);
-		bigTableEcc.at<float>(iFrame, nfFrm + 16 + iPoint * nfPnt) = 0.0f;
-		bigTableEcc.at<float>(iFrame, nfFrm + 17 + iPoint * nfPnt) = 0.0f;	// execution time (sec) for pre-processing
-		bigTableEcc.at<float>(iFrame, nfFrm + 18 + iPoint * nfPnt) = 0.0f;	// execution time (sec) for tracking (ECC)
-		bigTableEcc.at<float>(iFrame, nfFrm + 19 + iPoint * nfPnt) = 0.0f;	// execution time (sec) for post-processing
+		bigTableEcc.at(iFrame, nfFrm + 0 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].x;      // Will not change with iFrame
+		bigTableEcc.at(iFrame, nfFrm + 1 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].y;		 // Will not change with iFrame
+		bigTableEcc.at(iFrame, nfFrm + 2 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].width;	 // Will not change with iFrame
+		bigTableEcc.at(iFrame, nfFrm + 3 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].height; // Will not change with iFrame
+		bigTableEcc.at(iFrame, nfFrm + 4 + iPoint * nfPnt) = (float)mTypes[iPoint];            // Will not change with iFrame
+		bigTableEcc.at(iFrame, nfFrm + 5 + iPoint * nfPnt) = 1.0f;
+		bigTableEcc.at(iFrame, nfFrm + 6 + iPoint * nfPnt) = 0.0f;
+		bigTableEcc.at(iFrame, nfFrm + 7 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].x;
+		bigTableEcc.at(iFrame, nfFrm + 8 + iPoint * nfPnt) = 0.0f;
+		bigTableEcc.at(iFrame, nfFrm + 9 + iPoint * nfPnt) = 1.0f;
+		bigTableEcc.at(iFrame, nfFrm + 10 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].y;
+		bigTableEcc.at(iFrame, nfFrm + 11 + iPoint * nfPnt) = 0.0f;
+		bigTableEcc.at(iFrame, nfFrm + 12 + iPoint * nfPnt) = 0.0f;
+		bigTableEcc.at(iFrame, nfFrm + 13 + iPoint * nfPnt) = 1.0f;
+		bigTableEcc.at(iFrame, nfFrm + 14 + iPoint * nfPnt) = imgPoints.at<float>(iPoint, 0);
+		bigTableEcc.at(iFrame, nfFrm + 15 + iPoint * nfPnt) = imgPoints.at<float>(iPoint, 1);
+		bigTableEcc.at(iFrame, nfFrm + 16 + iPoint * nfPnt) = 0.0f;
+		bigTableEcc.at(iFrame, nfFrm + 17 + iPoint * nfPnt) = 0.0f;	// execution time (sec) for pre-processing
+		bigTableEcc.at(iFrame, nfFrm + 18 + iPoint * nfPnt) = 0.0f;	// execution time (sec) for tracking (ECC)
+		bigTableEcc.at(iFrame, nfFrm + 19 + iPoint * nfPnt) = 0.0f;	// execution time (sec) for post-processing
+	}
+
+	// the history of tracked points starts with frame 0 
+	Points2fHistoryData histPoints;
+	vector<cv::Point2f> histStep(nPoint);
+	if (oHist.length() > 0) {
+		if (histPoints.openLog(oHist) != 0) {
+			cerr << "Warning: Cannot write history of points to " << oHist << ".\n";
+			oHist = "";
+		}
+		for (int iPoint = 0; iPoint < nPoint; iPoint++)
+			histStep[iPoint] = cv::Point2f(bigTableEcc.at(iFrame, nfFrm + 14 + iPoint * nfPnt),
+				bigTableEcc.at(iFrame, nfFrm + 15 + iPoint * nfPnt));
+		if (oHist.length() > 0)
+			histPoints.appendStep(histStep);
 	}
 
 	// Main loop. 
 	float ecc_threshold = 0.9f;
+
+	// inverse-compositional ECC trackers (templates do not change, so their 
+	// gradients and Hessians are computed once here)
+	vector<EccIcTracker> eccIcTrackers;
+	if (useIcEcc) {
+		eccIcTrackers.resize(nPoint);
+		for (int iPoint = 0; iPoint < nPoint; iPoint++)
+			if (eccIcTrackers[iPoint].setTemplate(imgInit(tmpltBoxes[iPoint]), mTypes[iPoint]) != 0)
+				cerr << "Warning: Cannot set template of point " << iPoint << " for inverse-compositional ECC (textureless template?).\n";
+	}
+
+	// thread workspaces (preallocated buffers of template, search image, warp 
+	// and big-table row of a point)
+	struct EccWorkspace {
+		cv::Mat imgTmplt, imgSearch, warp, pntRow;
+	};
+	int nThreads = 1;
+#ifdef _OPENMP
+	nThreads = omp_get_max_threads();
+#endif
+	vector<EccWorkspace> workspaces(nThreads);
+	for (int i = 0; i < nThreads; i++) {
+		workspaces[i].warp.create(3, 3, CV_32F);
+		workspaces[i].pntRow.create(1, nfPnt, CV_32F);
+	}
+	const double minParallelEccTime = 0.005; // min. ECC time (sec) of a frame to run points in parallel
+	double t_eccPrevFrame = 0.0;             // ECC time (sec) of previous frame (0: run first frame in serial)
+
+	// decodeRoi: frames are decoded in gray (the color image is not needed as no 
+	// pictures or video of boxes are output), and only the region around the points 
+	// is kept (with room for moving 2 more search ranges). If a point moves out of the 
+	// region, frames are fully decoded from then on. Boxes are shown on a color image 
+	// decoded at a reduced scale (boxedScale). 
+	bool grayOnly = false;     // frames are decoded in gray (imgBoxed is only for showing)
+	bool roiDecoding = false;  // frames are decoded only in the region around the points
+	int boxedScale = 1;        // scale of imgBoxed (1: full image)
+	cv::Point imgOffset(0, 0); // position of imgCurr in the full frame 
+	cv::Rect imgFullRect(0, 0, imgInit.cols, imgInit.rows);
+	if (decodeRoi) {
+		if (oFrame.length() > 0 || oVideo.length() > 0)
+			printf("# decodeRoi is ignored as pictures or video of tracked boxes are output.\n");
+		else {
+			grayOnly = true;
+			cv::Rect roi = eccSearchRegion(tmpltBoxes[0], (float)tmpltBoxes[0].x, (float)tmpltBoxes[0].y,
+				3 * maxSearchSizeX[0], 3 * maxSearchSizeY[0]);
+			for (int iPoint = 1; iPoint < nPoint; iPoint++)
+				roi |= eccSearchRegion(tmpltBoxes[iPoint], (float)tmpltBoxes[iPoint].x, (float)tmpltBoxes[iPoint].y,
+					3 * maxSearchSizeX[iPoint], 3 * maxSearchSizeY[iPoint]);
+			roi &= imgFullRect;
+			if (roi.area() < imgFullRect.area()) {
+				roiDecoding = true;
+				fseq.setDecodeOption(1, roi);
+				imgOffset = fseq.decodeOffset();
+			}
+			while (boxedScale < 8 && imgInit.cols / (2 * boxedScale) >= 1280 && imgInit.rows / (2 * boxedScale) >= 720)
+				boxedScale *= 2;
+			printf("# Frames are decoded in gray, in region x %d y %d w %d h %d.\n", roi.x, roi.y, roi.width, roi.height);
+		}
+	}
+
+	// images are decoded ahead by background threads
+	FileSeqPrefetcher prefetcher;
+	prefetcher.start(fseq, grayOnly ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR);
+
+	// frame results, pictures and video are written by background threads, in frame 
+	// order. (T_WriteTxt and T_WriteImg are the time the tracking thread spends on them.)
+	OutputSink sink;
+	sink.start(nWriters);
+
 	int64 tickCountStart = cv::getTickCount();
 	for (int iFrame = 1; iFrame < nFrame; iFrame++)
 	{
 		// read image
 		double t_imreadFrm = (double)cv::getTickCount();
-		fseq.waitForFile(iFrame);
-		imgBoxed = cv::imread(fseq.fullPathOfFile(iFrame), cv::IMREAD_COLOR);
-		cv::cvtColor(imgBoxed, imgCurr, cv::COLOR_BGR2GRAY);
+		if (grayOnly) {
+			if (prefetcher.waitForImageFile(iFrame, imgCurr) != 0)
+				imgCurr.release();
+		}
+		else if (prefetcher.waitForImageFile(iFrame, imgBoxed) == 0)
+			cv::cvtColor(imgBoxed, imgCurr, cv::COLOR_BGR2GRAY);
+		else
+			imgCurr.release();
 		if (imgCurr.cols <= 0 || imgCurr.rows <= 0) {
 			cerr << "Cannot read image " << iFrame << ": " << fseq.fullPathOfFile(iFrame) << ".\n";
 			cerr.flush();
 			return -1;
 		}
+		// if a point (at its last position) needs more than the decoded region, 
+		// this frame and the rest are fully decoded
+		if (roiDecoding) {
+			cv::Rect imgRect(imgOffset, imgCurr.size());
+			for (int iPoint = 0; iPoint < nPoint; iPoint++) {
+				cv::Rect need = imgFullRect & eccSearchRegion(tmpltBoxes[iPoint],
+					bigTableEcc.at(iFrame - 1, nfFrm + 7 + iPoint * nfPnt),
+					bigTableEcc.at(iFrame - 1, nfFrm + 10 + iPoint * nfPnt),
+					maxSearchSizeX[iPoint], maxSearchSizeY[iPoint]);
+				if ((need & imgRect) == need)
+					continue;
+				printf("# Point %d moves out of the decoded region at frame %d. Frames are fully decoded from now on.\n", iPoint, iFrame);
+				roiDecoding = false;
+				prefetcher.stop();
+				fseq.setDecodeOption();
+				imgOffset = cv::Point(0, 0);
+				if (fseq.waitForImageFile(iFrame, imgCurr, cv::IMREAD_GRAYSCALE) != 0) {
+					cerr << "Cannot read image " << iFrame << ": " << fseq.fullPathOfFile(iFrame) << ".\n";
+					cerr.flush();
+					return -1;
+				}
+				prefetcher.start(fseq, cv::IMREAD_GRAYSCALE);
+				break;
+			}
+		}
 		t_imreadFrm = ((double)cv::getTickCount() - t_imreadFrm) / cv::getTickFrequency();
 
-		bigTableEcc.at<float>(iFrame, 0) = (float)iFrame;
-		bigTableEcc.at<float>(iFrame, 1) = (float)nPoint;
-		bigTableEcc.at<float>(iFrame, 2) = (float)t_imreadFrm0; // execution time (sec) to read image file
-		bigTableEcc.at<float>(iFrame, 3) = (float) 0.f; //	execution time (sec) to write frame result file 
-		bigTableEcc.at<float>(iFrame, 4) = (float) 0.f; //	execution time (sec) to write frame boxed image
-
-// If OpenMP is disabled, probably it is because ECC computing time is relatively small, openMP is not helping significantly but increasing threading load.
-//#pragma omp parallel for
+		bigTableEcc.at(iFrame, 0) = (float)iFrame;
+		bigTableEcc.at(iFrame, 1) = (float)nPoint;
+		bigTableEcc.at(iFrame, 2) = (float)t_imreadFrm; // execution time (sec) to read image file
+		bigTableEcc.at(iFrame, 3) = (float) 0.f; //	execution time (sec) to write frame result file 
+		bigTableEcc.at(iFrame, 4) = (float) 0.f; //	execution time (sec) to write frame boxed image
+
+		// Points are tracked in parallel only if the previous frame took long enough,
+		// as the threading load outweighs the gain for a few small templates. 
+		// Each point only reads previous rows of the big table and fills its own 
+		// row buffer in the thread workspace, which is copied to the big table once.
+		bool parallelEcc = nThreads > 1 && nPoint > 1 && t_eccPrevFrame >= minParallelEccTime;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if (parallelEcc)
 		for (int iPoint = 0; iPoint < nPoint; iPoint++)
 		{
+#ifdef _OPENMP
+			int iThread = omp_get_thread_num();
+#else
+			int iThread = 0;
+#endif
+			EccWorkspace & ws = workspaces[iThread];
+			float * pntRow = ws.pntRow.ptr<float>(0);
+
 			// timing pre-processing
 			double t_point_pre = (double)cv::getTickCount();
 
 			// template
-			bigTableEcc.at<float>(iFrame, nfFrm + 0 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].x;      // Will not change with iFrame
-			bigTableEcc.at<float>(iFrame, nfFrm + 1 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].y;		// Will not change with iFrame
-			bigTableEcc.at<float>(iFrame, nfFrm + 2 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].width;	// Will not change with iFrame
-			bigTableEcc.at<float>(iFrame, nfFrm + 3 + iPoint * nfPnt) = (float)tmpltBoxes[iPoint].height; // Will not change with iFrame
+			pntRow[0] = (float)tmpltBoxes[iPoint].x;      // Will not change with iFrame
+			pntRow[1] = (float)tmpltBoxes[iPoint].y;		// Will not change with iFrame
+			pntRow[2] = (float)tmpltBoxes[iPoint].width;	// Will not change with iFrame
+			pntRow[3] = (float)tmpltBoxes[iPoint].height; // Will not change with iFrame
 
 			// motion type 
-			bigTableEcc.at<float>(iFrame, nfFrm + 4 + iPoint * nfPnt) = (float)mTypes[iPoint];
+			pntRow[4] = (float)mTypes[iPoint];
 
 			// initial guess of warp
-			cv::Mat warp(3, 3, CV_32F);
+			cv::Mat & warp = ws.warp;
 
 			// initial guess of warp is the previous warp (find closest frame that ECC coefficient > 0.9)
 			int iFramePreviousValid;
 			for (iFramePreviousValid = iFrame - 1; iFramePreviousValid > 0; iFramePreviousValid--) {
-				if (bigTableEcc.at<float>(iFrame - 1, nfFrm + 13 + iPoint * nfPnt) >= ecc_threshold)
+				if (bigTableEcc.at(iFramePreviousValid, nfFrm + 13 + iPoint * nfPnt) >= ecc_threshold)
 					break;
 			}
-			warp.at<float>(0, 0) = bigTableEcc.at<float>(iFramePreviousValid, nfFrm + 5 + iPoint * nfPnt);
-			warp.at<float>(0, 1) = bigTableEcc.at<float>(iFramePreviousValid, nfFrm + 6 + iPoint * nfPnt);
-			warp.at<float>(0, 2) = bigTableEcc.at<float>(iFramePreviousValid, nfFrm + 7 + iPoint * nfPnt);
-			warp.at<float>(1, 0) = bigTableEcc.at<float>(iFramePreviousValid, nfFrm + 8 + iPoint * nfPnt);
-			warp.at<float>(1, 1) = bigTableEcc.at<float>(iFramePreviousValid, nfFrm + 9 + iPoint * nfPnt);
-			warp.at<float>(1, 2) = bigTableEcc.at<float>(iFramePreviousValid, nfFrm + 10 + iPoint * nfPnt);
-			warp.at<float>(2, 0) = bigTableEcc.at<float>(iFramePreviousValid, nfFrm + 11 + iPoint * nfPnt);
-			warp.at<float>(2, 1) = bigTableEcc.at<float>(iFramePreviousValid, nfFrm + 12 + iPoint * nfPnt);
+			warp.at<float>(0, 0) = bigTableEcc.at(iFramePreviousValid, nfFrm + 5 + iPoint * nfPnt);
+			warp.at<float>(0, 1) = bigTableEcc.at(iFramePreviousValid, nfFrm + 6 + iPoint * nfPnt);
+			warp.at<float>(0, 2) = bigTableEcc.at(iFramePreviousValid, nfFrm + 7 + iPoint * nfPnt);
+			warp.at<float>(1, 0) = bigTableEcc.at(iFramePreviousValid, nfFrm + 8 + iPoint * nfPnt);
+			warp.at<float>(1, 1) = bigTableEcc.at(iFramePreviousValid, nfFrm + 9 + iPoint * nfPnt);
+			warp.at<float>(1, 2) = bigTableEcc.at(iFramePreviousValid, nfFrm + 10 + iPoint * nfPnt);
+			warp.at<float>(2, 0) = bigTableEcc.at(iFramePreviousValid, nfFrm + 11 + iPoint * nfPnt);
+			warp.at<float>(2, 1) = bigTableEcc.at(iFramePreviousValid, nfFrm + 12 + iPoint * nfPnt);
 			warp.at<float>(2, 2) = 1.0f;
 
 			// timing pre-processing
@@ -415,14 +608,14 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 			//			cv::imshow("TMPLT", imgInit(tmpltBoxes[iPoint])); 
 			//			cv::waitKey(0); 
 			//			cv::destroyWindow("TMPLT"); 
-			//			std::cout << "Motion type: " << bigTableEcc.at<float>(iFrame, nfFrm +  4 + iPoint * nfPnt) << endl;
+			//			std::cout << "Motion type: " << pntRow[4] << endl;
 			//			cout.flush(); 
 
 						// timing tracking
 			double t_point_tracking = (double)cv::getTickCount();
 
 			// ECC Tracking 
-			int motion_type = (int)bigTableEcc.at<float>(iFrame, nfFrm + 4 + iPoint * nfPnt);
+			int motion_type = (int)pntRow[4];
 			double ecc_Coef;
 			cv::Mat warpX3;
 			if (motion_type == cv::MOTION_HOMOGRAPHY)
@@ -431,10 +624,31 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 				warpX3 = warp(cv::Rect(0, 0, 3, 2));
 			//				std::cout << "Warp before: \n" << warp << endl;
 			try {
+				// imgCurr may be a region of the frame (decodeRoi), at imgOffset
+				if (imgOffset.x != 0 || imgOffset.y != 0)
+					shiftWarp(warpX3, (float) -imgOffset.x, (float) -imgOffset.y);
 				int criteriaCount = 50;
 				double eps = 0.01;
 				int cloneImagesBeforeEcc = 1;
-				if (cloneImagesBeforeEcc == 0) {
+				cv::TermCriteria criteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, criteriaCount, eps);
+				if (useIcEcc) {
+					// template gradients and Hessian are precomputed. Only a search region 
+					// of the current image is needed (not copied). 
+					if (eccIcTrackers[iPoint].empty())
+						CV_Error(cv::Error::StsBadArg, "Template is not set.");
+					int maxMoveX = maxSearchSizeX[iPoint];
+					int maxMoveY = maxSearchSizeY[iPoint];
+					cv::Point2f refPoint;
+					cv::Rect rectSearch =
+						getTmpltRectFromImage(imgCurr, cv::Point2f(warpX3.at<float>(0, 2), warpX3.at<float>(1, 2)),
+							cv::Size(tmpltBoxes[iPoint].width + 2 * maxMoveX, tmpltBoxes[iPoint].height + 2 * maxMoveY), refPoint);
+					warpX3.at<float>(0, 2) -= rectSearch.x;
+					warpX3.at<float>(1, 2) -= rectSearch.y;
+					ecc_Coef = eccIcTrackers[iPoint].track(imgCurr(rectSearch), warpX3, criteria);
+					warpX3.at<float>(0, 2) += rectSearch.x;
+					warpX3.at<float>(1, 2) += rectSearch.y;
+				}
+				else if (cloneImagesBeforeEcc == 0) {
 					ecc_Coef = cv::findTransformECC(
 						imgInit(tmpltBoxes[iPoint]),
 						imgCurr,
@@ -447,7 +661,7 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 					int maxMoveX = maxSearchSizeX[iPoint];
 					int maxMoveY = maxSearchSizeY[iPoint];
 					cv::Point2f refPoint;
-					cv::Mat imgTmplt, imgSearch;
+					cv::Mat & imgTmplt = ws.imgTmplt, & imgSearch = ws.imgSearch;
 					imgInit(tmpltBoxes[iPoint]).copyTo(imgTmplt);
 					cv::Rect rectSearch =
 						getTmpltRectFromImage(imgCurr, cv::Point2f(warpX3.at<float>(0, 2), warpX3.at<float>(1, 2)),
@@ -464,17 +678,19 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 					warpX3.at<float>(0, 2) += rectSearch.x;
 					warpX3.at<float>(1, 2) += rectSearch.y;
 				}
+				if (imgOffset.x != 0 || imgOffset.y != 0)
+					shiftWarp(warpX3, (float) imgOffset.x, (float) imgOffset.y);
 			}
 			catch (...) {
 				// If ECC fails, use previous frame result with coefficiet = 0.0f
-				warp.at<float>(0, 0) = bigTableEcc.at<float>(iFrame - 1, nfFrm + 5 + iPoint * nfPnt);
-				warp.at<float>(0, 1) = bigTableEcc.at<float>(iFrame - 1, nfFrm + 6 + iPoint * nfPnt);
-				warp.at<float>(0, 2) = bigTableEcc.at<float>(iFrame - 1, nfFrm + 7 + iPoint * nfPnt);
-				warp.at<float>(1, 0) = bigTableEcc.at<float>(iFrame - 1, nfFrm + 8 + iPoint * nfPnt);
-				warp.at<float>(1, 1) = bigTableEcc.at<float>(iFrame - 1, nfFrm + 9 + iPoint * nfPnt);
-				warp.at<float>(1, 2) = bigTableEcc.at<float>(iFrame - 1, nfFrm + 10 + iPoint * nfPnt);
-				warp.at<float>(2, 0) = bigTableEcc.at<float>(iFrame - 1, nfFrm + 11 + iPoint * nfPnt);
-				warp.at<float>(2, 1);  bigTableEcc.at<float>(iFrame - 1, nfFrm + 12 + iPoint * nfPnt);
+				warp.at<float>(0, 0) = bigTableEcc.at(iFrame - 1, nfFrm + 5 + iPoint * nfPnt);
+				warp.at<float>(0, 1) = bigTableEcc.at(iFrame - 1, nfFrm + 6 + iPoint * nfPnt);
+				warp.at<float>(0, 2) = bigTableEcc.at(iFrame - 1, nfFrm + 7 + iPoint * nfPnt);
+				warp.at<float>(1, 0) = bigTableEcc.at(iFrame - 1, nfFrm + 8 + iPoint * nfPnt);
+				warp.at<float>(1, 1) = bigTableEcc.at(iFrame - 1, nfFrm + 9 + iPoint * nfPnt);
+				warp.at<float>(1, 2) = bigTableEcc.at(iFrame - 1, nfFrm + 10 + iPoint * nfPnt);
+				warp.at<float>(2, 0) = bigTableEcc.at(iFrame - 1, nfFrm + 11 + iPoint * nfPnt);
+				warp.at<float>(2, 1) = bigTableEcc.at(iFrame - 1, nfFrm + 12 + iPoint * nfPnt);
 				ecc_Coef = 0.f;
 			}
 
@@ -488,15 +704,15 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 			double t_point_post = (double)cv::getTickCount();
 
 			// Update result to big table
-			bigTableEcc.at<float>(iFrame, nfFrm + 5 + iPoint * nfPnt) = warp.at<float>(0, 0);
-			bigTableEcc.at<float>(iFrame, nfFrm + 6 + iPoint * nfPnt) = warp.at<float>(0, 1);
-			bigTableEcc.at<float>(iFrame, nfFrm + 7 + iPoint * nfPnt) = warp.at<float>(0, 2);
-			bigTableEcc.at<float>(iFrame, nfFrm + 8 + iPoint * nfPnt) = warp.at<float>(1, 0);
-			bigTableEcc.at<float>(iFrame, nfFrm + 9 + iPoint * nfPnt) = warp.at<float>(1, 1);
-			bigTableEcc.at<float>(iFrame, nfFrm + 10 + iPoint * nfPnt) = warp.at<float>(1, 2);
-			bigTableEcc.at<float>(iFrame, nfFrm + 11 + iPoint * nfPnt) = warp.at<float>(2, 0);
-			bigTableEcc.at<float>(iFrame, nfFrm + 12 + iPoint * nfPnt) = warp.at<float>(2, 1);
-			bigTableEcc.at<float>(iFrame, nfFrm + 13 + iPoint * nfPnt) = (float)ecc_Coef;
+			pntRow[5] = warp.at<float>(0, 0);
+			pntRow[6] = warp.at<float>(0, 1);
+			pntRow[7] = warp.at<float>(0, 2);
+			pntRow[8] = warp.at<float>(1, 0);
+			pntRow[9] = warp.at<float>(1, 1);
+			pntRow[10] = warp.at<float>(1, 2);
+			pntRow[11] = warp.at<float>(2, 0);
+			pntRow[12] = warp.at<float>(2, 1);
+			pntRow[13] = (float)ecc_Coef;
 
 			// Find current image point by warp matrix multiplication 
 			cv::Mat refPoint(3, 1, CV_32F);
@@ -504,8 +720,8 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 			refPoint.at<float>(1, 0) = imgPoints.at<float>(iPoint, 1) - (float)tmpltBoxes[iPoint].y;
 			refPoint.at<float>(2, 0) = 1.f;
 			refPoint = warp * refPoint;
-			bigTableEcc.at<float>(iFrame, nfFrm + 14 + iPoint * nfPnt) = refPoint.at<float>(0, 0);
-			bigTableEcc.at<float>(iFrame, nfFrm + 15 + iPoint * nfPnt) = refPoint.at<float>(1, 0);
+			pntRow[14] = refPoint.at<float>(0, 0);
+			pntRow[15] = refPoint.at<float>(1, 0);
 
 			// Find rotation by cv::Rodrigues (in degree)
 			cv::Mat m33 = cv::Mat::eye(3, 3, CV_32F), rv3 = cv::Mat::zeros(3, 1, CV_32F);
@@ -514,31 +730,40 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 			m33.at<float>(1, 0) = warp.at<float>(1, 0);
 			m33.at<float>(1, 1) = warp.at<float>(1, 1);
 			cv::Rodrigues(m33, rv3);
-			bigTableEcc.at<float>(iFrame, nfFrm + 16 + iPoint * nfPnt) = rv3.at<float>(2, 0) * 180.f / 3.141592653589f;
+			pntRow[16] = rv3.at<float>(2, 0) * 180.f / 3.141592653589f;
 
 			t_point_post = ((double)cv::getTickCount() - t_point_post) / cv::getTickFrequency();
 
-			bigTableEcc.at<float>(iFrame, nfFrm + 17 + iPoint * nfPnt) = (float)t_point_pre;      // execution time (sec) for pre-processing 
-			bigTableEcc.at<float>(iFrame, nfFrm + 18 + iPoint * nfPnt) = (float)t_point_tracking; // execution time (sec) for tracking (ECC)
-			bigTableEcc.at<float>(iFrame, nfFrm + 19 + iPoint * nfPnt) = (float)t_point_post;     // execution time (sec) for post-processing
+			pntRow[17] = (float)t_point_pre;      // execution time (sec) for pre-processing 
+			pntRow[18] = (float)t_point_tracking; // execution time (sec) for tracking (ECC)
+			pntRow[19] = (float)t_point_post;     // execution time (sec) for post-processing
 
+			ws.pntRow.copyTo(bigTableEcc.row(iFrame).colRange(nfFrm + iPoint * nfPnt, nfFrm + (iPoint + 1) * nfPnt));
 		} // next point
 
+		// ECC time of this frame (for the serial/parallel decision of the next frame)
+		t_eccPrevFrame = 0.0;
+		for (int iPoint = 0; iPoint < nPoint; iPoint++)
+			t_eccPrevFrame += bigTableEcc.at(iFrame, nfFrm + 18 + iPoint * nfPnt);
+
 		// print marked boxes picture of each frame
 		double t_writeImg = (double)cv::getTickCount();
 		if (oFrame.length() > 0 || showBx == true || oVideo.length() > 0) {
+			// (with decodeRoi, imgBoxed is only for showing, and decoded at a reduced scale)
+			if (grayOnly)
+				FileSeq::imreadScaledRoi(fseq.fullPathOfFile(iFrame), imgBoxed, cv::IMREAD_COLOR, boxedScale);
 			// plot boxes on imgBoxed
 			for (int iPoint = 0; iPoint < nPoint; iPoint++) {
 				// get warp matrix of iPoint of iFrame
 				cv::Mat warp(3, 3, CV_32F);
-				warp.at<float>(0, 0) = bigTableEcc.at<float>(iFrame, nfFrm + 5 + iPoint * nfPnt);
-				warp.at<float>(0, 1) = bigTableEcc.at<float>(iFrame, nfFrm + 6 + iPoint * nfPnt);
-				warp.at<float>(0, 2) = bigTableEcc.at<float>(iFrame, nfFrm + 7 + iPoint * nfPnt);
-				warp.at<float>(1, 0) = bigTableEcc.at<float>(iFrame, nfFrm + 8 + iPoint * nfPnt);
-				warp.at<float>(1, 1) = bigTableEcc.at<float>(iFrame, nfFrm + 9 + iPoint * nfPnt);
-				warp.at<float>(1, 2) = bigTableEcc.at<float>(iFrame, nfFrm + 10 + iPoint * nfPnt);
-				warp.at<float>(2, 0) = bigTableEcc.at<float>(iFrame, nfFrm + 11 + iPoint * nfPnt);
-				warp.at<float>(2, 1) = bigTableEcc.at<float>(iFrame, nfFrm + 12 + iPoint * nfPnt);
+				warp.at<float>(0, 0) = bigTableEcc.at(iFrame, nfFrm + 5 + iPoint * nfPnt);
+				warp.at<float>(0, 1) = bigTableEcc.at(iFrame, nfFrm + 6 + iPoint * nfPnt);
+				warp.at<float>(0, 2) = bigTableEcc.at(iFrame, nfFrm + 7 + iPoint * nfPnt);
+				warp.at<float>(1, 0) = bigTableEcc.at(iFrame, nfFrm + 8 + iPoint * nfPnt);
+				warp.at<float>(1, 1) = bigTableEcc.at(iFrame, nfFrm + 9 + iPoint * nfPnt);
+				warp.at<float>(1, 2) = bigTableEcc.at(iFrame, nfFrm + 10 + iPoint * nfPnt);
+				warp.at<float>(2, 0) = bigTableEcc.at(iFrame, nfFrm + 11 + iPoint * nfPnt);
+				warp.at<float>(2, 1) = bigTableEcc.at(iFrame, nfFrm + 12 + iPoint * nfPnt);
 				warp.at<float>(2, 2) = 1.0f;
 				// define un-warp box
 				cv::Mat p4m(3, 5, CV_32F);
@@ -546,12 +771,12 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 				p4m.at<float>(1, 0) = 0.f;
 				p4m.at<float>(2, 0) = 1.f;
 				p4m.at<float>(0, 1) = 0.f;
-				p4m.at<float>(1, 1) = bigTableEcc.at<float>(iFrame, nfFrm + 3 + iPoint * nfPnt); // h
+				p4m.at<float>(1, 1) = bigTableEcc.at(iFrame, nfFrm + 3 + iPoint * nfPnt); // h
 				p4m.at<float>(2, 1) = 1.f;
-				p4m.at<float>(0, 2) = bigTableEcc.at<float>(iFrame, nfFrm + 2 + iPoint * nfPnt); // w
-				p4m.at<float>(1, 2) = bigTableEcc.at<float>(iFrame, nfFrm + 3 + iPoint * nfPnt); // h
+				p4m.at<float>(0, 2) = bigTableEcc.at(iFrame, nfFrm + 2 + iPoint * nfPnt); // w
+				p4m.at<float>(1, 2) = bigTableEcc.at(iFrame, nfFrm + 3 + iPoint * nfPnt); // h
 				p4m.at<float>(2, 2) = 1.f;
-				p4m.at<float>(0, 3) = bigTableEcc.at<float>(iFrame, nfFrm + 2 + iPoint * nfPnt); // w
+				p4m.at<float>(0, 3) = bigTableEcc.at(iFrame, nfFrm + 2 + iPoint * nfPnt); // w
 				p4m.at<float>(1, 3) = 0.f;
 				p4m.at<float>(2, 3) = 1.f;
 				p4m.at<float>(0, 4) = imgPoints.at<float>(iPoint, 0) - (float)tmpltBoxes[iPoint].x;
@@ -570,7 +795,8 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 				p4m.at<float>(1, 3) /= p4m.at<float>(2, 3);
 				p4m.at<float>(1, 4) /= p4m.at<float>(2, 4);
 				// plot box 
-				int shift = 3, shFact = 1 << shift;
+				int shift = 3;
+				float shFact = (float) (1 << shift) / boxedScale;
 				cv::Point p0 = cv::Point((int)(p4m.at<float>(0, 0) * shFact + .5), (int)(p4m.at<float>(1, 0) * shFact + .5));
 				cv::Point p1 = cv::Point((int)(p4m.at<float>(0, 1) * shFact + .5), (int)(p4m.at<float>(1, 1) * shFact + .5));
 				cv::Point p2 = cv::Point((int)(p4m.at<float>(0, 2) * shFact + .5), (int)(p4m.at<float>(1, 2) * shFact + .5));
@@ -578,13 +804,13 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 				cv::Point p4 = cv::Point((int)(p4m.at<float>(0, 4) * shFact + .5), (int)(p4m.at<float>(1, 4) * shFact + .5));
 				int thickness = 2;
 				int linetype = cv::LINE_AA;
-				if (bigTableEcc.at<float>(iFrame, nfFrm + 13 + iPoint * nfPnt) <= 0.0f)
+				if (bigTableEcc.at(iFrame, nfFrm + 13 + iPoint * nfPnt) <= 0.0f)
 					thickness = 1;
 				cv::line(imgBoxed, p0, p1, cv::Scalar(127, 255, 127), thickness, linetype, shift);
 				cv::line(imgBoxed, p1, p2, cv::Scalar(127, 255, 127), thickness, linetype, shift);
 				cv::line(imgBoxed, p2, p3, cv::Scalar(127, 255, 127), thickness, linetype, shift);
 				cv::line(imgBoxed, p3, p0, cv::Scalar(127, 255, 127), thickness, linetype, shift);
-				if (bigTableEcc.at<float>(iFrame, nfFrm + 13 + iPoint * nfPnt) > ecc_threshold) {
+				if (bigTableEcc.at(iFrame, nfFrm + 13 + iPoint * nfPnt) > ecc_threshold) {
 					cv::line(imgBoxed, p0, p4, cv::Scalar(127, 255, 127), 1, linetype, shift);
 					cv::line(imgBoxed, p1, p4, cv::Scalar(127, 255, 127), 1, linetype, shift);
 					cv::line(imgBoxed, p2, p4, cv::Scalar(127, 255, 127), 1, linetype, shift);
@@ -593,18 +819,22 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 
 			} // end of point loop
 
+			// (imgBoxed is a new image every frame, so the sink keeps it without copying)
 			if (oFrame.length() > 1) {
 				char ofsFrame[1000];
                 snprintf(ofsFrame, 1000, "_%06d.jpg", iFrame);
 				std::string ofsFrameStr = oFrame + std::string(ofsFrame);
-				cv::imwrite(ofsFrameStr, imgBoxed);
+				sink.writeImage(ofsFrameStr, imgBoxed);
 			}
 			if (oVideo.length() > 1 && iFrame <= 1) {
 				int f4cc = preferredFourcc();
-				oVideoWriter.open(oVideo, f4cc, 30.0, imgBoxed.size());
+				cv::Size videoSize = imgBoxed.size();
+				sink.run([&oVideoWriter, oVideo, f4cc, videoSize]() {
+					oVideoWriter.open(oVideo, f4cc, 30.0, videoSize);
+				});
 			}
-			if (oVideo.length() > 0 && oVideo[0] != 'n' && oVideoWriter.isOpened())
-				oVideoWriter << imgBoxed;
+			if (oVideo.length() > 0 && oVideo[0] != 'n')
+				sink.writeVideoFrame(oVideoWriter, imgBoxed);
 
 			// show boxes 
 			if (showBx == true) {
@@ -619,47 +849,43 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 			}
 		} // end if output box plot
 		t_writeImg = ((double)cv::getTickCount() - t_writeImg) / cv::getTickFrequency();
-		bigTableEcc.at<float>(iFrame, 4) = (float)t_writeImg; //	execution time (sec) to write frame boxed image
+		bigTableEcc.at(iFrame, 4) = (float)t_writeImg; //	execution time (sec) to write frame boxed image
 
 		// print result of this frame to a file
 		double t_writeTxt = (double)cv::getTickCount();
 		if (oDat.length() > 0) {
-			// txt file
+			// txt file (formatted by a writer thread, from a copy of the row of this frame)
 			char ofsFname[1000];
             snprintf(ofsFname, 1000, "_%06d.txt", iFrame);
 			std::string ofsFnameStr = oDat + std::string(ofsFname);
-			FILE * ofile;
-			fopen_s(&ofile, ofsFnameStr.c_str(), "w");
-			fprintf(ofile, "  Frame NumPts       T_ReadImg      T_WriteTxt      T_WriteImg");
-			for (int iPoint = 0; iPoint < nPoint; iPoint++) {
-				fprintf(ofile, " X0_%03d Y0_%03d  W_%03d  H_%03d MT_%03d         W00_%03d         W01_%03d         W02_%03d         W10_%03d         W11_%03d         W12_%03d         W20_%03d         W21_%03d         Ecf_%03d         Xcr_%03d         Ycr_%03d         Rot_%03d        Tpre_%03d      Ttrack_%03d       Tpost_%03d",
-					iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint);
-			}
-			fprintf(ofile, "\n");
-			fprintf(ofile, " %6d %6d", iFrame, nPoint);
-			for (int i = 2; i < nfFrm; i++)
-				fprintf(ofile, " %15.7f", bigTableEcc.at<float>(iFrame, i));
-			for (int iPoint = 0; iPoint < nPoint; iPoint++) {
-				for (int i = 0 + nfFrm + iPoint * nfPnt; i <= 4 + nfFrm + iPoint * nfPnt; i++)
-					fprintf(ofile, " %6d", (int)(bigTableEcc.at<float>(iFrame, i) + .5f));
-				for (int i = 5 + nfFrm + iPoint * nfPnt; i < nfFrm + (iPoint + 1) * nfPnt; i++)
-					fprintf(ofile, " %15.7e", bigTableEcc.at<float>(iFrame, i));
-			}
-			fprintf(ofile, "\n");
-			std::fclose(ofile);
+			cv::Mat row = bigTableEcc.row(iFrame).clone();
+			sink.writeFile(ofsFnameStr, [row, iFrame, nPoint, nfFrm, nfPnt](vector<uchar> & out) {
+				string text;
+				frameResultText(row, iFrame, nPoint, nfFrm, nfPnt, text);
+				out.assign(text.begin(), text.end());
+			}, row.total() * row.elemSize());
 			// xml file
 			vector<cv::Point2f> trackedImgPoints(nPoint);
 			for (int iPoint = 0; iPoint < nPoint; iPoint++) {
-				trackedImgPoints[iPoint].x = bigTableEcc.at<float>(iFrame, nfFrm + 14 + iPoint * nfPnt);
-				trackedImgPoints[iPoint].y = bigTableEcc.at<float>(iFrame, nfFrm + 15 + iPoint * nfPnt);
+				trackedImgPoints[iPoint].x = bigTableEcc.at(iFrame, nfFrm + 14 + iPoint * nfPnt);
+				trackedImgPoints[iPoint].y = bigTableEcc.at(iFrame, nfFrm + 15 + iPoint * nfPnt);
 			}
             snprintf(ofsFname, 1000, "_%06d.xml", iFrame);
-			cv::FileStorage ofsFileTrackedImgPoints(oDat + ofsFname, cv::FileStorage::WRITE);
-			ofsFileTrackedImgPoints << "VecPoint2f" << trackedImgPoints;
-			ofsFileTrackedImgPoints.release();
+			sink.writeFile(oDat + ofsFname, [trackedImgPoints](vector<uchar> & out) {
+				cv::FileStorage ofsFileTrackedImgPoints(".xml", cv::FileStorage::WRITE | cv::FileStorage::MEMORY);
+				ofsFileTrackedImgPoints << "VecPoint2f" << trackedImgPoints;
+				string xml = ofsFileTrackedImgPoints.releaseAndGetString();
+				out.assign(xml.begin(), xml.end());
+			}, trackedImgPoints.size() * sizeof(cv::Point2f));
 		} // end of output frame result
+		if (oHist.length() > 0) {
+			for (int iPoint = 0; iPoint < nPoint; iPoint++)
+				histStep[iPoint] = cv::Point2f(bigTableEcc.at(iFrame, nfFrm + 14 + iPoint * nfPnt),
+					bigTableEcc.at(iFrame, nfFrm + 15 + iPoint * nfPnt));
+			histPoints.appendStep(histStep);
+		}
 		t_writeTxt = ((double)cv::getTickCount() - t_writeTxt) / cv::getTickFrequency();
-		bigTableEcc.at<float>(iFrame, 3) = (float)t_writeTxt; //	execution time (sec) to write frame result file 
+		bigTableEcc.at(iFrame, 3) = (float)t_writeTxt; //	execution time (sec) to write frame result file 
 
 		if (iFrame % 10 == 0) {
 			std::cout << "\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b"
@@ -674,7 +900,20 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 
 	} // next frame 
 
+	// waits until all frame results, pictures and video are written
+	sink.run([&oVideoWriter]() { oVideoWriter.release(); });
+	sink.close();
+	if (sink.nBlocked > 0 || sink.nErrors > 0)
+		printf("\n# Output writers: %d outputs written, %d errors, waited %.3f sec for %d outputs.\n",
+			sink.nWritten, sink.nErrors, sink.blockedTime, sink.nBlocked);
+
+	if (oHist.length() > 0 && histPoints.closeLog() == 0) {
+		std::cout << oHist << " is written.\n"; cout.flush();
+	}
+
 	// print result of all frames to a summary file
+	// (by streaming over chunks of the big table)
+	cv::Mat rows; // rows of a chunk of the big table
 	if (oSum.length() > 0) {
 		FILE * ofile;
 		fopen_s(&ofile, oSum.c_str(), "w");
@@ -685,14 +924,17 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 		}
 		fprintf(ofile, "\n");
 		for (int iFrame = 0; iFrame < nFrame; iFrame++) {
+			int iRow = iFrame % bigTableEcc.chunkRows();
+			if (iRow == 0 && bigTableEcc.readChunk(iFrame / bigTableEcc.chunkRows(), rows) != 0)
+				break;
 			fprintf(ofile, " %6d %6d", iFrame, nPoint);
 			for (int i = 2; i < nfFrm; i++)
-				fprintf(ofile, " %15.7f", bigTableEcc.at<float>(iFrame, i));
+				fprintf(ofile, " %15.7f", rows.at<float>(iRow, i));
 			for (int iPoint = 0; iPoint < nPoint; iPoint++) {
 				for (int i = 0 + nfFrm + iPoint * nfPnt; i <= 4 + nfFrm + iPoint * nfPnt; i++)
-					fprintf(ofile, " %6d", (int)(bigTableEcc.at<float>(iFrame, i) + .5f));
+					fprintf(ofile, " %6d", (int)(rows.at<float>(iRow, i) + .5f));
 				for (int i = 5 + nfFrm + iPoint * nfPnt; i < nfFrm + (iPoint + 1) * nfPnt; i++)
-					fprintf(ofile, " %15.7e", bigTableEcc.at<float>(iFrame, i));
+					fprintf(ofile, " %15.7e", rows.at<float>(iRow, i));
 			}
 			fprintf(ofile, "\n");
 		}
@@ -704,49 +946,54 @@ int FuncTrackingPointsEcc(int argc, char** argv)
 	if (oCpt.length() > 0) {
 		FILE * ofile;
 		fopen_s(&ofile, oCpt.c_str(), "w");
-		//		fprintf(ofile, "  Frame NumPts       T_ReadImg      T_WriteTxt      T_WriteImg");
 		for (int iPoint = 0; iPoint < nPoint; iPoint++) {
-			//			fprintf(ofile, " X0_%03d Y0_%03d  W_%03d  H_%03d MT_%03d         W00_%03d         W01_%03d         W02_%03d         W10_%03d         W11_%03d         W12_%03d         W20_%03d         W21_%03d         Ecf_%03d         Xcr_%03d         Ycr_%03d         Rot_%03d        Tpre_%03d      Ttrack_%03d       Tpost_%03d",
-			//				iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint);
 			fprintf(ofile, "         Xcr_%03d         Ycr_%03d", iPoint, iPoint);
 		}
 		fprintf(ofile, "\n");
-		for (int iFrame = 0; iFrame < nFrame; iFrame++) {
-			//			fprintf(ofile, " %6d %6d", iFrame, nPoint);
-			//			for (int i = 2; i < nfFrm; i++)
-			//				fprintf(ofile, " %15.7f", bigTableEcc.at<float>(iFrame, i));
-			for (int iPoint = 0; iPoint < nPoint; iPoint++) {
-				//				for (int i = 0 + nfFrm + iPoint * nfPnt; i <= 4 + nfFrm + iPoint * nfPnt; i++)
-				//					fprintf(ofile, " %6d", (int)(bigTableEcc.at<float>(iFrame, i) + .5f));
-				//				for (int i = 5 + nfFrm + iPoint * nfPnt; i < nfFrm + (iPoint + 1) * nfPnt; i++)
-				//					fprintf(ofile, " %15.7e", bigTableEcc.at<float>(iFrame, i));
-				for (int i = 14 + nfFrm + iPoint * nfPnt; i <= 15 + nfFrm + iPoint * nfPnt; i++)
-					fprintf(ofile, " %15.7e", bigTableEcc.at<float>(iFrame, i));
-			}
-			fprintf(ofile, "\n");
-		}
-		fclose(ofile);
-		std::cout << oCpt << " is written.\n"; cout.flush();
-		// xml compact
-		vector<vector<cv::Point2f> >trackedImgPointsHistory(nFrame, vector<cv::Point2f>(nPoint));
-		for (int iFrame = 0; iFrame < nFrame; iFrame++) {
-			for (int iPoint = 0; iPoint < nPoint; iPoint++) {
-				trackedImgPointsHistory[iFrame][iPoint].x = bigTableEcc.at<float>(iFrame, nfFrm + 14 + iPoint * nfPnt);
-				trackedImgPointsHistory[iFrame][iPoint].y = bigTableEcc.at<float>(iFrame, nfFrm + 15 + iPoint * nfPnt);
-			}
-		}
+		// xml compact (written with the text, one frame at a time, as operator<< writes 
+		// a vector of vectors)
 		string fnameCompact = extFilenameRemoved(oCpt) + ".xml";
 		cv::FileStorage ofsFileCompact(fnameCompact, cv::FileStorage::WRITE);
 		ofsFileCompact << "numSteps" << nFrame;
 		ofsFileCompact << "numPoints" << nPoint;
-		ofsFileCompact << "VecVecPoint2f" << trackedImgPointsHistory;
+		{
+			cv::internal::WriteStructContext wsHistory(ofsFileCompact, "VecVecPoint2f", cv::FileNode::SEQ);
+			vector<cv::Point2f> trackedImgPoints(nPoint);
+			for (int iFrame = 0; iFrame < nFrame; iFrame++) {
+				int iRow = iFrame % bigTableEcc.chunkRows();
+				if (iRow == 0 && bigTableEcc.readChunk(iFrame / bigTableEcc.chunkRows(), rows) != 0)
+					break;
+				for (int iPoint = 0; iPoint < nPoint; iPoint++) {
+					for (int i = 14 + nfFrm + iPoint * nfPnt; i <= 15 + nfFrm + iPoint * nfPnt; i++)
+						fprintf(ofile, " %15.7e", rows.at<float>(iRow, i));
+					trackedImgPoints[iPoint].x = rows.at<float>(iRow, nfFrm + 14 + iPoint * nfPnt);
+					trackedImgPoints[iPoint].y = rows.at<float>(iRow, nfFrm + 15 + iPoint * nfPnt);
+				}
+				fprintf(ofile, "\n");
+				cv::internal::WriteStructContext wsFrame(ofsFileCompact, cv::String(), cv::FileNode::SEQ + cv::FileNode::FLOW);
+				cv::write(ofsFileCompact, trackedImgPoints);
+			}
+		}
 		ofsFileCompact.release();
+		fclose(ofile);
+		std::cout << oCpt << " is written.\n"; cout.flush();
 	}  // end of output summary 
+	bigTableEcc.close();
 
 	cv::destroyWindow("Tracked points");
 	return 0;
 }
 
+int FuncTrackingPointsEcc(int argc, char** argv)
+{
+	return trackingPointsEcc(argc, argv, false);
+}
+
+int FuncTrackingPointsEccIc(int argc, char** argv)
+{
+	return trackingPointsEcc(argc, argv, true);
+}
+
 //const cv::String keys =
 //"{help h usage ?     |      | print this message   }"
 //"{fileList   fList   |      | file of file list. Each row is a file name without directory, assuming files are in the same directory with the file-list file.}"
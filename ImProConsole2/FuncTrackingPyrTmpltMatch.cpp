@@ -4,6 +4,7 @@
 #include <cstdio>
 #include <cmath>
 #include <iomanip>
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -13,6 +14,7 @@
 
 #include "FileSeq.h"
 #include "impro_util.h"
+#include "OutputSink.h"
 
 #include "matchTemplateWithRotPyr.h"
 
@@ -38,6 +40,8 @@ const cv::String keys =
 "{outVideo   oVideo  |      | output video which plots boxes on each point.}"
 "{showBoxes  showBx  |      | 1 for showing tracked boxes }"
 "{noAsk      noAsk   |      | 1 for automatic mode, not asking any questions for optional settings }"
+"{writers    nWrite  |      | number of threads writing frame results, pictures and video in the background (default 2, 0 for writing on the tracking thread) }"
+"{tmFft      tmFft   |      | correlation of template matching. 0: spatial domain (default), 1: frequency domain (FFT), 2: FFT or spatial domain chosen by template and search sizes }"
 ;
 
 #define motion_type_tm_1   11
@@ -258,6 +262,23 @@ int FuncTrackingPyrTmpltMatch(int argc, char** argv)
 			showBx = false;
 	}
 
+	// number of background writer threads --> nWriters (command line only)
+	int nWriters = 2;
+	if (pparser && (*pparser).has("nWrite"))
+		nWriters = std::max(0, (*pparser).get<int>("nWrite"));
+
+	// correlation domain of template matching --> tmMethod (command line only)
+	int tmMethod = cv::TM_CCORR_NORMED;
+	if (pparser && (*pparser).has("tmFft")) {
+		int tmFft = (*pparser).get<int>("tmFft");
+		if (tmFft == 1)
+			tmMethod |= TM_FFT;
+		else if (tmFft == 2)
+			tmMethod |= TM_FFT_AUTO;
+	}
+	// template spectra of each point (FFT only). Templates are fixed views of imgInit.
+	vector<MatchTemplateFftCache> fftCaches(nPoint);
+
 	printf("Motion type of point %d is %d \n", 0, mTypes[0]);
 	printf("Motion type of point %d is %d \n", nPoint - 1, mTypes[nPoint - 1]);
 	printf("Tmplt size of point %d is %d %d\n", 0, tmpltBoxes[0].width, tmpltBoxes[0].height);
@@ -310,6 +331,11 @@ int FuncTrackingPyrTmpltMatch(int argc, char** argv)
 		bigTableTm.at<float>(iFrame, nfFrm + 19 + iPoint * nfPnt) = 0.0f;	// execution time (sec) for post-processing
 	}
 
+	// frame results, pictures and video are written by background threads, in frame 
+	// order. (T_WriteTxt and T_WriteImg are the time the tracking thread spends on them.)
+	OutputSink sink;
+	sink.start(nWriters);
+
 	// Main loop. 
 	float coef_threshold = 0.95f;
 	int64 tickCountStart = cv::getTickCount();
@@ -422,7 +448,9 @@ int FuncTrackingPyrTmpltMatch(int argc, char** argv)
 					min_x, max_x, prc_x,
 					min_y, max_y, prc_y,
 					min_r, max_r, prc_r,
-					tmRes);
+					tmRes,
+					tmMethod, -1, -1, -1,
+					&fftCaches[iPoint]);
 			}
 			else if (cloneImagesBeforeTracking == 1) {
 				// copy to smaller clone images
@@ -442,7 +470,8 @@ int FuncTrackingPyrTmpltMatch(int argc, char** argv)
 					min_x - rectSearch.x, max_x - rectSearch.x, prc_x,
 					min_y - rectSearch.y, max_y - rectSearch.y, prc_y,
 					min_r, max_r, prc_r,
-					tmRes);
+					tmRes,
+					tmMethod);
 				tmRes[0] += rectSearch.x; 
 				tmRes[1] += rectSearch.y;
 			}
@@ -574,18 +603,22 @@ int FuncTrackingPyrTmpltMatch(int argc, char** argv)
 
 			} // end of point loop
 
+			// (imgBoxed is a new image every frame, so the sink keeps it without copying)
 			if (oFrame.length() > 1) {
 				char ofsFrame[1000];
                 snprintf(ofsFrame, 1000, "_%06d.jpg", iFrame);
 				std::string ofsFrameStr = oFrame + std::string(ofsFrame);
-				cv::imwrite(ofsFrameStr, imgBoxed);
+				sink.writeImage(ofsFrameStr, imgBoxed);
 			}
 			if (oVideo.length() > 1 && iFrame <= 1) {
 				int f4cc = preferredFourcc();
-				oVideoWriter.open(oVideo, f4cc, 30.0, imgBoxed.size());
+				cv::Size videoSize = imgBoxed.size();
+				sink.run([&oVideoWriter, oVideo, f4cc, videoSize]() {
+					oVideoWriter.open(oVideo, f4cc, 30.0, videoSize);
+				});
 			}
-			if (oVideo.length() > 0 && oVideo[0] != 'n' && oVideoWriter.isOpened())
-				oVideoWriter << imgBoxed;
+			if (oVideo.length() > 0 && oVideo[0] != 'n')
+				sink.writeVideoFrame(oVideoWriter, imgBoxed);
 
 			// show boxes 
 			if (showBx == true) {
@@ -605,29 +638,16 @@ int FuncTrackingPyrTmpltMatch(int argc, char** argv)
 		// print result of this frame to a file
 		double t_writeTxt = (double)cv::getTickCount();
 		if (oDat.length() > 0) {
-			// txt file
+			// txt file (formatted by a writer thread, from a copy of the row of this frame)
 			char ofsFname[1000];
             snprintf(ofsFname, 1000, "_%06d.txt", iFrame);
 			std::string ofsFnameStr = oDat + std::string(ofsFname);
-			FILE * ofile;
-			fopen_s(&ofile, ofsFnameStr.c_str(), "w");
-			fprintf(ofile, "  Frame NumPts       T_ReadImg      T_WriteTxt      T_WriteImg");
-			for (int iPoint = 0; iPoint < nPoint; iPoint++) {
-				fprintf(ofile, " X0_%03d Y0_%03d  W_%03d  H_%03d MT_%03d         W00_%03d         W01_%03d         W02_%03d         W10_%03d         W11_%03d         W12_%03d         W20_%03d         W21_%03d         Ecf_%03d         Xcr_%03d         Ycr_%03d         Rot_%03d        Tpre_%03d      Ttrack_%03d       Tpost_%03d",
-					iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint);
-			}
-			fprintf(ofile, "\n");
-			fprintf(ofile, " %6d %6d", iFrame, nPoint);
-			for (int i = 2; i < nfFrm; i++)
-				fprintf(ofile, " %15.7f", bigTableTm.at<float>(iFrame, i));
-			for (int iPoint = 0; iPoint < nPoint; iPoint++) {
-				for (int i = 0 + nfFrm + iPoint * nfPnt; i <= 4 + nfFrm + iPoint * nfPnt; i++)
-					fprintf(ofile, " %6d", (int)(bigTableTm.at<float>(iFrame, i) + .5f));
-				for (int i = 5 + nfFrm + iPoint * nfPnt; i < nfFrm + (iPoint + 1) * nfPnt; i++)
-					fprintf(ofile, " %15.7e", bigTableTm.at<float>(iFrame, i));
-			}
-			fprintf(ofile, "\n");
-			std::fclose(ofile);
+			cv::Mat row = bigTableTm.row(iFrame).clone();
+			sink.writeFile(ofsFnameStr, [row, iFrame, nPoint, nfFrm, nfPnt](vector<uchar> & out) {
+				string text;
+				frameResultText(row, iFrame, nPoint, nfFrm, nfPnt, text);
+				out.assign(text.begin(), text.end());
+			}, row.total() * row.elemSize());
 			// xml file
 			vector<cv::Point2f> trackedImgPoints(nPoint);
 			for (int iPoint = 0; iPoint < nPoint; iPoint++) {
@@ -635,9 +655,12 @@ int FuncTrackingPyrTmpltMatch(int argc, char** argv)
 				trackedImgPoints[iPoint].y = bigTableTm.at<float>(iFrame, nfFrm + 15 + iPoint * nfPnt);
 			}
             snprintf(ofsFname, 1000, "_%06d.xml", iFrame);
-			cv::FileStorage ofsFileTrackedImgPoints(oDat + ofsFname, cv::FileStorage::WRITE);
-			ofsFileTrackedImgPoints << "VecPoint2f" << trackedImgPoints;
-			ofsFileTrackedImgPoints.release();
+			sink.writeFile(oDat + ofsFname, [trackedImgPoints](vector<uchar> & out) {
+				cv::FileStorage ofsFileTrackedImgPoints(".xml", cv::FileStorage::WRITE | cv::FileStorage::MEMORY);
+				ofsFileTrackedImgPoints << "VecPoint2f" << trackedImgPoints;
+				string xml = ofsFileTrackedImgPoints.releaseAndGetString();
+				out.assign(xml.begin(), xml.end());
+			}, trackedImgPoints.size() * sizeof(cv::Point2f));
 		} // end of output frame result
 		t_writeTxt = ((double)cv::getTickCount() - t_writeTxt) / cv::getTickFrequency();
 		bigTableTm.at<float>(iFrame, 3) = (float)t_writeTxt; //	execution time (sec) to write frame result file 
@@ -655,6 +678,13 @@ int FuncTrackingPyrTmpltMatch(int argc, char** argv)
 
 	} // next frame 
 
+	// waits until all frame results, pictures and video are written
+	sink.run([&oVideoWriter]() { oVideoWriter.release(); });
+	sink.close();
+	if (sink.nBlocked > 0 || sink.nErrors > 0)
+		printf("\n# Output writers: %d outputs written, %d errors, waited %.3f sec for %d outputs.\n",
+			sink.nWritten, sink.nErrors, sink.blockedTime, sink.nBlocked);
+
 	// print result of all frames to a summary file
 	if (oSum.length() > 0) {
 		FILE * ofile;
@@ -12,8 +12,9 @@
 #include <opencv2/opencv.hpp>
 
 #include "impro_util.h"
-#include "impro_fileIO.h"
+#include "improFileIO.h"
 #include "FileSeq.h"
+#include "FileSeqPrefetcher.h"
 #include "improStrings.h"
 
 using std::string; 
@@ -300,6 +301,8 @@ int FuncUndistortOnline(int argc, char** argv)
 	printf("# Undistoring images.\n");
     printf("# The full path of the first image is %s\n", fsq1.fullPathOfFile(0).c_str());
     printf("File_name  Wait_time  Read_time  Undist_time  Write_time (ms)\n");
+	FileSeqPrefetcher prefetcher; // source images are decoded ahead by background threads
+	prefetcher.start(fsq1);
 	for (int i = 0; i < fsq1.num_files(); i++)
 	{
         cv::Mat imgIn, imgOut;
@@ -335,7 +338,7 @@ int FuncUndistortOnline(int argc, char** argv)
 
         // read file
         /* timing */ auto ticReading = std::chrono::steady_clock::now();
-        fsq1.waitForImageFile(i, imgIn);
+        prefetcher.waitForImageFile(i, imgIn);
         /* timing */ auto tocReading = std::chrono::steady_clock::now();
         /* timing */ double tReading = std::chrono::duration<double>(tocReading - ticReading).count();
         /* timing */ printf(" %8.3f", tReading);
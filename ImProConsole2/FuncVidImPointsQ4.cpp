@@ -12,6 +12,7 @@
 #include "Points2fHistoryData.h"
 #include "impro_util.h"
 #include "pickAPoint.h"
+#include "DenseFieldStore.h"
 
 using namespace std;
 
@@ -42,12 +43,14 @@ using namespace std;
 //  2.89500000e+02 9.50000000e+00 3.09500000e+02 9.50000000e+00
 // (etc.) 
 // -------------------------------------------------------------- -
+// The output can also be a dense field store (.dfs) of vidTrack(), which is read frame by frame
+// without parsing the whole file (see DenseFieldStore).
 
 int FuncVidImPointsQ4(int argc, char** argv)
 {
 	// Declare all variables
 	std::string fnameDensePoints, fnameInitImg; 
-	cv::FileStorage fsDensePoints;
+	DenseFieldStore fsDensePoints;
 	int videoWidth = -1, videoHeight = -1, nFrames = -1, nxPoint = -1, nyPoint = -1;
 	float fps = -1;
 	cv::Size winSize = cv::Size(0, 0); 
@@ -61,21 +64,20 @@ int FuncVidImPointsQ4(int argc, char** argv)
 	std::vector<cv::Point2f> qPointsAllQ4; 
 
 	// Read full path of xml output of vidTrack()
-	printf("# Enter full file path of the xml output of vidTrack():\n");
+	printf("# Enter full file path of the xml (or .dfs) output of vidTrack():\n");
 	fnameDensePoints = readStringFromIstream(std::cin); 
-	fsDensePoints.open(fnameDensePoints, cv::FileStorage::READ); 
-	if (fsDensePoints.isOpened() == false) {
+	if (fsDensePoints.open(fnameDensePoints) != 0) {
 		std::cerr << "Error: Cannot open file: " << fnameDensePoints << std::endl;
 		return -1;
 	}
 
-	// Print basic information of the xml file
-	fsDensePoints["videoWidth"] >> videoWidth; 
-	fsDensePoints["videoHeight"] >> videoHeight;
-	fsDensePoints["nFrames"] >> nFrames;
-	fsDensePoints["fps"] >> fps;
-	fsDensePoints["nxPoint"] >> nxPoint;
-	fsDensePoints["nyPoint"] >> nyPoint;
+	// Print basic information of the dense points file
+	videoWidth = fsDensePoints.info().videoWidth;
+	videoHeight = fsDensePoints.info().videoHeight;
+	nFrames = fsDensePoints.info().nFrames;
+	fps = (float) fsDensePoints.info().fps;
+	nxPoint = fsDensePoints.info().nxPoint;
+	nyPoint = fsDensePoints.info().nyPoint;
 
 	printf("videoWidth: %d \n", videoWidth);
 	printf("videoHeight: %d \n", videoHeight);
@@ -83,6 +85,7 @@ int FuncVidImPointsQ4(int argc, char** argv)
 	printf("fps: %f \n", fps);
 	printf("nxPoint: %d \n", nxPoint);
 	printf("nyPoint: %d \n", nyPoint);
+	printf("frames stored: %d \n", fsDensePoints.nFrames());
 
 	// Pick four points of a quad.
 	printf("# Enter full file path of the initial image: \n"); 
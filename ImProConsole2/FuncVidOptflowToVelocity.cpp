@@ -12,6 +12,7 @@
 #include "Points2fHistoryData.h"
 #include "impro_util.h"
 #include "pickAPoint.h"
+#include "DenseFieldStore.h"
 
 
 using namespace std;
@@ -43,6 +44,8 @@ using namespace std;
 //  2.89500000e+02 9.50000000e+00 3.09500000e+02 9.50000000e+00
 // (etc.) 
 // -------------------------------------------------------------- -
+// The output can also be a dense field store (.dfs) of vidTrack(), which is read frame by frame
+// without parsing the whole file (see DenseFieldStore).
 
 int FuncVidOptflowToVelocity(int argc, char** argv)
 {
@@ -51,7 +54,8 @@ int FuncVidOptflowToVelocity(int argc, char** argv)
 	FileSeq fsq, voFsq;
 	std::string fnameDensePoints, fnameInitImg;
 	std::string fnameIntrinsic, fnameExtrinsic; 
-	cv::FileStorage fsDensePoints, fsIntrinsic, fsExtrinsic; 
+	DenseFieldStore fsDensePoints;
+	cv::FileStorage fsIntrinsic, fsExtrinsic; 
 	cv::Mat cmat, dvec, rvec, tvec; 
 	int videoWidth = -1, videoHeight = -1, nFrames = -1, nxPoint = -1, nyPoint = -1;
 	float fps = -1;
@@ -138,21 +142,20 @@ int FuncVidOptflowToVelocity(int argc, char** argv)
 
 
 	// Read full path of xml output of vidTrack()
-	printf("# Enter full file path of the xml output of vidTrack():\n");
+	printf("# Enter full file path of the xml (or .dfs) output of vidTrack():\n");
 	fnameDensePoints = readStringFromIstream(std::cin);
-	fsDensePoints.open(fnameDensePoints, cv::FileStorage::READ);
-	if (fsDensePoints.isOpened() == false) {
+	if (fsDensePoints.open(fnameDensePoints) != 0) {
 		std::cerr << "Error: Cannot open file: " << fnameDensePoints << std::endl;
 		return -1;
 	}
 
-	// Print basic information of the xml file
-	fsDensePoints["videoWidth"] >> videoWidth;
-	fsDensePoints["videoHeight"] >> videoHeight;
-	fsDensePoints["nFrames"] >> nFrames;
-	fsDensePoints["fps"] >> fps;
-	fsDensePoints["nxPoint"] >> nxPoint;
-	fsDensePoints["nyPoint"] >> nyPoint;
+	// Print basic information of the dense points file
+	videoWidth = fsDensePoints.info().videoWidth;
+	videoHeight = fsDensePoints.info().videoHeight;
+	nFrames = fsDensePoints.info().nFrames;
+	fps = (float) fsDensePoints.info().fps;
+	nxPoint = fsDensePoints.info().nxPoint;
+	nyPoint = fsDensePoints.info().nyPoint;
 
 	printf("videoWidth: %d \n", videoWidth);
 	printf("videoHeight: %d \n", videoHeight);
@@ -160,6 +163,7 @@ int FuncVidOptflowToVelocity(int argc, char** argv)
 	printf("fps: %f \n", fps);
 	printf("nxPoint: %d \n", nxPoint);
 	printf("nyPoint: %d \n", nyPoint);
+	printf("frames stored: %d \n", fsDensePoints.nFrames());
 
 
 
@@ -3,6 +3,9 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
 #include <opencv2/opencv.hpp>
 #include <thread>
 #include <chrono>
@@ -11,17 +14,97 @@
 #include "FileSeq.h"
 #include "Points2fHistoryData.h"
 #include "impro_util.h"
+#include "LkPyramid.h"
+#include "PointsPredictor.h"
+#include "FieldColormap.h"
+#include "OutputSink.h"
+#include "DenseFieldStore.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 
 // Step 1: Read file sequence fseq
 // Step 2: Set nyPoint, nxPoint, winSize, (and nImg if necessary)
 // Step 3: Set output file (binary boFile, .xml.zip xoFile)
+//         (dense field stores (.dfs), exported to xml(.gz) at the end unless .dfs is given)
 // Step 4: Start tracking (--> xyDat.at<Point2f>(iImg, iPoint).x/y, --> success.at<uint8>(iImg, iPoint))
 // Step 5: Save file to boFile, xoFile
 // Step 6: Visualization
+//
+// In tiled mode the grid is split into tiles of neighboring points. Each tile
+// is tracked on the pyramids of its own region (the bounding box of its points
+// plus the reach of optical flow), and tiles run in parallel. The pyramid of
+// the current frame of a tile is kept and used as the previous one in the next
+// step, so each frame is read and its pyramids are built only once.
 
-int FuncVideoDenseTracking(int argc, char ** argv)
+// a tile of grid points and its region and pyramids
+struct DenseTrackTile {
+	cv::Rect rect;            // region of the tile in image
+	vector<int> idx;          // indices of grid points of the tile
+	LkPyramid pyrPrev, pyrCurr;
+	vector<cv::Point2f> p0, p1; // points in tile coordinates
+	vector<uchar> status;
+	vector<float> err;
+	vector<int> levels;
+};
+
+// splits the grid (nyPoint x nxPoint, row major) into about nTiles tiles
+static void splitDenseGridToTiles(const cv::Mat & pos, int nyPoint, int nxPoint,
+	cv::Size imgSize, int margin, int nTiles, vector<DenseTrackTile> & tiles)
+{
+	int nTileX = std::max(1, std::min(nxPoint, (int) (std::sqrt((double) nTiles * nxPoint / nyPoint) + 0.5)));
+	int nTileY = std::max(1, std::min(nyPoint, (nTiles + nTileX - 1) / nTileX));
+	cv::Rect imgRect(0, 0, imgSize.width, imgSize.height);
+	tiles.clear();
+	tiles.resize((size_t) nTileX * nTileY);
+	for (int ty = 0; ty < nTileY; ty++) {
+		for (int tx = 0; tx < nTileX; tx++) {
+			DenseTrackTile & tile = tiles[ty * nTileX + tx];
+			float xmin = 1e30f, ymin = 1e30f, xmax = -1e30f, ymax = -1e30f;
+			for (int i = ty * nyPoint / nTileY; i < (ty + 1) * nyPoint / nTileY; i++)
+				for (int j = tx * nxPoint / nTileX; j < (tx + 1) * nxPoint / nTileX; j++) {
+					int ij = i * nxPoint + j;
+					cv::Point2f p = pos.at<cv::Point2f>(0, ij);
+					tile.idx.push_back(ij);
+					xmin = std::min(xmin, p.x); xmax = std::max(xmax, p.x);
+					ymin = std::min(ymin, p.y); ymax = std::max(ymax, p.y);
+				}
+			if (tile.idx.size() == 0) continue;
+			cv::Rect rect((int) std::floor(xmin) - margin, (int) std::floor(ymin) - margin,
+				(int) std::ceil(xmax - xmin) + 2 * margin + 1, (int) std::ceil(ymax - ymin) + 2 * margin + 1);
+			tile.rect = rect & imgRect;
+		}
+	}
+}
+
+// file of the dense field store of an output file: the file itself if it is .dfs, otherwise file + ".dfs"
+static std::string denseFieldStoreName(const std::string & file)
+{
+	size_t n = file.length();
+	if (n >= 4 && file.compare(n - 4, 4, ".dfs") == 0)
+		return file;
+	return file + ".dfs";
+}
+
+// exports a dense field store to the xml(.gz) output file (unless the output file is the store itself),
+// and removes the (temporary) store if it is exported.
+static void exportDenseFieldStoreXml(const std::string & storeName, const std::string & xmlName)
+{
+	if (storeName == xmlName)
+		return;
+	int nFrames = DenseFieldStore::exportXml(storeName, xmlName);
+	if (nFrames >= 0) {
+		printf("# %d frames of %s are exported to %s.\n", nFrames, storeName.c_str(), xmlName.c_str());
+		std::remove(storeName.c_str());
+	}
+	else
+		printf("# Warning: %s is not exported to %s. The store is kept.\n", storeName.c_str(), xmlName.c_str());
+}
+
+static int videoDenseTracking(int argc, char ** argv, bool tiled)
 {
 	// Variables
 	FileSeq fsq, voFsq; 
@@ -30,20 +113,21 @@ int FuncVideoDenseTracking(int argc, char ** argv)
 	cv::Size imgSize, winSize; 
 	int optfMaxLevel;
 	std::string uoFilename, voFilename;
-	cv::FileStorage uoFile, voFile;
+	DenseFieldStore uoStore, voStore;
 	cv::Mat imgInit;
 	cv::Mat imgPrev; 
 	cv::Mat imgCurr; 
 	cv::Mat posInit; // initial positions of points. In Mat(nyPoint,nxPoint,CV_32FC2), iStepInit = 0
 	cv::Mat posPrev; // previous positions of points. In Mat(nyPoint,nxPoint,CV_32FC2), iStepPrev = iStep - k, where k could be 1, 2, 3 ...
 	cv::Mat posCurr; // current positions of points. In Mat(nyPoint,nxPoint,CV_32FC2), iStepCurr = iStep
-	cv::Mat posPrv1; // the one before posCurr. In Mat(nyPoint,nxPoint,CV_32FC2), iStepPrv1 = iStep - 1
-	cv::Mat posPrv2; // the one before posPrv1. In Mat(nyPoint,nxPoint,CV_32FC2), iStepPrv2 = iStep - 2
-	cv::Mat posPrv3; // the one before posPrv2. In Mat(nyPoint,nxPoint,CV_32FC2), iStepPrv3 = iStep - 3
+	PointsPredictor posPred; // predicts posCurr (and its uncertainty) from the past steps
+	vector<cv::Point2f> vecPosCurr, vecSigma; // predicted (then tracked) positions, and uncertainties
+	vector<int> optfLevels; // maxLevel of optical flow of each point
+	LkPyramid pyrPrev, pyrCurr;
+	vector<DenseTrackTile> tiles; // tiles of grid (tiled mode)
 	cv::Mat velCurr;
 
 
-	char buf[1000]; 
 	float colormapMax;
 
 	// Step 1: Read file sequence fseq
@@ -75,9 +159,9 @@ int FuncVideoDenseTracking(int argc, char ** argv)
 	colormapMax = (float) readDoubleFromIstream(std::cin, 0.0, 1000);
 
 	// Step 3: Set output file (binary boFile, .xml.zip xoFile)
-	printf("# Enter full path of optical point output file (image coord., in pixels) (e.g., c:/temp/vidTracking_imgxy.xml.gz ):\n");
+	printf("# Enter full path of optical point output file (image coord., in pixels) (e.g., c:/temp/vidTracking_imgxy.xml.gz or .dfs):\n");
 	uoFilename = readStringLineFromIstream(std::cin);
-	printf("# Enter full path of optical velocity output file (delta image coord., pixels per frame) (e.g., c:/temp/vidTracking_vel.xml.gz ):\n");
+	printf("# Enter full path of optical velocity output file (delta image coord., pixels per frame) (e.g., c:/temp/vidTracking_vel.xml.gz or .dfs):\n");
 	voFilename = readStringLineFromIstream(std::cin);
 	printf("# Enter output file sequence of colormap images:\n");
 	voFsq.setDirFilesByConsole();
@@ -87,9 +171,6 @@ int FuncVideoDenseTracking(int argc, char ** argv)
 	nImg = fsq.num_files();
 	posInit = cv::Mat::zeros(1, nyPoint * nxPoint, CV_32FC2); 
 	posPrev = cv::Mat::zeros(1, nyPoint * nxPoint, CV_32FC2);
-	posPrv1 = cv::Mat::zeros(1, nyPoint * nxPoint, CV_32FC2);
-	posPrv2 = cv::Mat::zeros(1, nyPoint * nxPoint, CV_32FC2);
-	posPrv3 = cv::Mat::zeros(1, nyPoint * nxPoint, CV_32FC2);
 	posCurr = cv::Mat::zeros(1, nyPoint * nxPoint, CV_32FC2);
 	velCurr = cv::Mat::zeros(1, nyPoint * nxPoint, CV_32FC2);
 	//  4.2  initial points locations
@@ -100,69 +181,86 @@ int FuncVideoDenseTracking(int argc, char ** argv)
 			posInit.at<cv::Point2f>(0, i * nxPoint + j).y = (float)(-0.5 + imgSize.height * (0.5 + i) / nyPoint);
 		}
 	// 4.3  tracking settings
-	cv::Mat prevImg, nextImg; 
 	vector<uchar> optfStatus((size_t)(nyPoint * nxPoint), 0); 
 	vector<float> optfErr((size_t)(nyPoint * nxPoint), 0.0f);
+	optfLevels.assign((size_t)(nyPoint * nxPoint), optfMaxLevel);
+	cv::Mat jetLut = colormapLut(cv::COLORMAP_JET); // colormap of velocity
+	cv::TermCriteria optfCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, 0.01);
+	int nThreads = 1;
+#ifdef _OPENMP
+	if (tiled) nThreads = omp_get_max_threads();
+#endif
+	if (tiled) {
+		// margin of tile region: reach of the top pyramid level plus half window
+		int margin = std::max(winSize.width, winSize.height) * ((1 << optfMaxLevel) + 1);
+		splitDenseGridToTiles(posInit, nyPoint, nxPoint, imgSize, margin, 4 * nThreads, tiles);
+		printf("# Tiled tracking: %d tiles, %d threads.\n", (int) tiles.size(), nThreads);
+	}
 
 	// 4.4  start tracking (running iStep loop)
-	//  4.4.1 open xml(.gz) files and write initial data 
-	//  Prints to uoFile (image points of each point each frame)
-	uoFile.open(uoFilename, cv::FileStorage::WRITE);
-	if (uoFile.isOpened())
-		printf("# XML file %s is opened successfully.\n", uoFilename.c_str());
+	//  4.4.1 create dense field stores and write initial data 
+	//        (a .dfs file is the store itself. Otherwise the store is name.dfs, exported to the xml(.gz) at the end.)
+	DenseFieldInfo fieldInfo;
+	fieldInfo.videoWidth = imgInit.cols;
+	fieldInfo.videoHeight = imgInit.rows;
+	fieldInfo.nFrames = nImg;
+	fieldInfo.fps = 29.97;
+	fieldInfo.nxPoint = nxPoint;
+	fieldInfo.nyPoint = nyPoint;
+	fieldInfo.winSize = winSize;
+	std::string uoStoreName = denseFieldStoreName(uoFilename), voStoreName = denseFieldStoreName(voFilename);
+	//  Prints to uoStore (image points of each point each frame)
+	fieldInfo.fieldName = "imgPoints";
+	if (uoStore.create(uoStoreName, fieldInfo) == 0)
+		printf("# Dense field store %s is created successfully.\n", uoStoreName.c_str());
 	else
-		printf("# Warning: XML file %s is not opened.\n", uoFilename.c_str());
-	if (uoFile.isOpened()) uoFile << "videoWidth" << imgInit.cols;
-	if (uoFile.isOpened()) uoFile << "videoHeight" << imgInit.rows;
-	if (uoFile.isOpened()) uoFile << "nFrames" << nImg;
-	if (uoFile.isOpened()) uoFile << "fps" << 29.97;
-	if (uoFile.isOpened()) uoFile << "nxPoint" << nxPoint;
-	if (uoFile.isOpened()) uoFile << "nyPoint" << nyPoint;
-	if (uoFile.isOpened()) uoFile << "winSize" << winSize;
-	snprintf(buf, 1000, "imgPoints%d", 0); 
-	if (uoFile.isOpened()) uoFile << buf << posInit;
-	//  Prints to voFile (increment of image points of each point each frame, i.e., image velocity of each point each frame)
-	voFile.open(voFilename, cv::FileStorage::WRITE);
-	if (voFile.isOpened())
-		printf("XML file %s is opened successfully.\n", voFilename.c_str());
+		printf("# Warning: Dense field store %s is not created.\n", uoStoreName.c_str());
+	if (uoStore.isOpen()) uoStore.appendFrame(posInit);
+	//  Prints to voStore (increment of image points of each point each frame, i.e., image velocity of each point each frame)
+	fieldInfo.fieldName = "imgVelocities";
+	if (voStore.create(voStoreName, fieldInfo) == 0)
+		printf("# Dense field store %s is created successfully.\n", voStoreName.c_str());
 	else
-		printf("Warning: XML file %s is not opened.\n", voFilename.c_str());
-	if (voFile.isOpened()) voFile << "videoWidth" << imgInit.cols;
-	if (voFile.isOpened()) voFile << "videoHeight" << imgInit.rows;
-	if (voFile.isOpened()) voFile << "nFrames" << nImg;
-	if (voFile.isOpened()) voFile << "fps" << 29.97;
-	if (voFile.isOpened()) voFile << "nxPoint" << nxPoint;
-	if (voFile.isOpened()) voFile << "nyPoint" << nyPoint;
-	if (voFile.isOpened()) voFile << "winSize" << winSize;
-	snprintf(buf, 1000, "imgVelocities%d", 0);
-	if (voFile.isOpened()) voFile << buf << velCurr; // at this step, velCurr are zeros. 
+		printf("# Warning: Dense field store %s is not created.\n", voStoreName.c_str());
+	if (voStore.isOpen()) voStore.appendFrame(velCurr); // at this step, velCurr are zeros. 
+	//  colormap images and the stores are written by a background thread, in step order
+	OutputSink sink;
+	sink.start(1);
+	//  optical flow wall time is printed as an average of every optfReportSteps steps
+	const int optfReportSteps = 100;
+	double optfWallTimeSum = 0.0;
 	//  4.4.2 start the time loop 
 	for (int iStep = 1; iStep < nImg; iStep++)
 	{
 		// 4.5 estimate the position --> posCurr
+		//     (Kalman prediction from the positions of past steps. Points of which the
+		//      prediction is certain are tracked with fewer pyramid levels.)
 		if (iStep == 1) { // 0-order. Copy from initial step
 			posInit.copyTo(posPrev);
 			posInit.copyTo(posCurr);
-			posInit.copyTo(posPrv1);
-			posInit.copyTo(posPrv2);
-			posInit.copyTo(posPrv3);
+			posPred.init(vector<cv::Point2f>(posInit.begin<cv::Point2f>(), posInit.end<cv::Point2f>()));
 			if (imgInit.cols <= 0 || imgInit.rows <= 0)
 				imgInit = cv::imread(fsq.fullPathOfFile(0), cv::IMREAD_GRAYSCALE);
 		}
-		else if (iStep == 2) { // 1st order. Linear extrapolation
-			posCurr = 2 * posPrv1 - posPrv2; 
-		}
-		else if (iStep >= 3) { // 2nd order extrapolation 
-			posCurr = posPrv1 - 3 * posPrv2 + 3 * posPrv3; 
-		}
+		posPred.predict(vecPosCurr, vecSigma);
+		if (iStep > 1)
+			for (int i = 0; i < nxPoint * nyPoint; i++)
+				optfLevels[i] = PointsPredictor::lkMaxLevel(posPred.searchRange(i), winSize, optfMaxLevel);
 
 		// 4.6 Define which step (frame) is the previous one for optical flow 
 		int iStepPrev = std::max(iStep - 1, 0);
 		int iStepCurr = iStep; 
 
-		// 4.7 Read images
-		imgPrev = cv::imread(fsq.fullPathOfFile(iStepPrev), cv::IMREAD_GRAYSCALE);
+		// 4.7 Read images (the previous one is kept from the last step)
+		if (iStep == 1)
+			imgPrev = imgInit;
+		else
+			imgPrev = imgCurr;
 		imgCurr = cv::imread(fsq.fullPathOfFile(iStepCurr), cv::IMREAD_GRAYSCALE);
+		if (imgPrev.empty() || imgCurr.empty()) {
+			printf("# Error: Cannot read image of step %d or %d.\n", iStepPrev, iStepCurr);
+			break;
+		}
 
 		// 4.8 Show images
 //		cv::destroyAllWindows(); 
@@ -172,12 +270,60 @@ int FuncVideoDenseTracking(int argc, char ** argv)
 		cv::waitKey(10);
 
 		// 4.9 Run optical flow 
-//		std::vector<cv::Point2f> vecPosPrev((cv::Point2f*) posPrev.data, (cv::Point2f*) posPrev.data + nyPoint * nxPoint); 
-//		std::vector<cv::Point2f> vecPosCurr((cv::Point2f*) posCurr.data, (cv::Point2f*) posCurr.data + nyPoint * nxPoint);
-		cv::calcOpticalFlowPyrLK(imgPrev, imgCurr, posPrev, posCurr,
-			optfStatus, optfErr,
-			winSize,
-			optfMaxLevel); 
+		//     (pyramids of current image are built with derivatives so that they
+		//      are swapped to be the previous ones in the next step)
+		std::vector<cv::Point2f> vecPosPrev((cv::Point2f*) posPrev.data, (cv::Point2f*) posPrev.data + nyPoint * nxPoint); 
+		double optfWallTime = getWallTime();
+		if (tiled == false) {
+			pyrPrev.update(imgPrev, winSize, optfMaxLevel);
+			pyrCurr.build(imgCurr, winSize, optfMaxLevel);
+			calcOpticalFlowPyrLKPerLevel(pyrPrev, pyrCurr, vecPosPrev, vecPosCurr,
+				optfStatus, optfErr,
+				winSize,
+				optfLevels,
+				optfCriteria,
+				cv::OPTFLOW_USE_INITIAL_FLOW);
+			pyrPrev.swap(pyrCurr);
+		}
+		else {
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if (nThreads > 1)
+			for (int iTile = 0; iTile < (int) tiles.size(); iTile++) {
+				DenseTrackTile & tile = tiles[iTile];
+				int n = (int) tile.idx.size();
+				if (n <= 0) continue;
+				cv::Point2f tl((float) tile.rect.x, (float) tile.rect.y);
+				tile.p0.resize(n); tile.p1.resize(n); tile.levels.resize(n);
+				for (int k = 0; k < n; k++) {
+					tile.p0[k] = vecPosPrev[tile.idx[k]] - tl;
+					tile.p1[k] = vecPosCurr[tile.idx[k]] - tl;
+					tile.levels[k] = optfLevels[tile.idx[k]];
+				}
+				tile.pyrPrev.update(imgPrev(tile.rect), winSize, optfMaxLevel);
+				tile.pyrCurr.build(imgCurr(tile.rect), winSize, optfMaxLevel);
+				calcOpticalFlowPyrLKPerLevel(tile.pyrPrev, tile.pyrCurr, tile.p0, tile.p1,
+					tile.status, tile.err,
+					winSize,
+					tile.levels,
+					optfCriteria,
+					cv::OPTFLOW_USE_INITIAL_FLOW);
+				tile.pyrPrev.swap(tile.pyrCurr);
+				for (int k = 0; k < n; k++) {
+					vecPosCurr[tile.idx[k]] = tile.p1[k] + tl;
+					optfStatus[tile.idx[k]] = tile.status[k];
+					optfErr[tile.idx[k]] = tile.err[k];
+				}
+			}
+		}
+		optfWallTime = getWallTime() - optfWallTime;
+		optfWallTimeSum += optfWallTime;
+		if (iStep % optfReportSteps == 0 || iStep == nImg - 1) {
+			int nReport = (iStep - 1) % optfReportSteps + 1;
+			printf("# Optical flow of steps %d-%d takes %.3f sec. per step (wall time)\n",
+				iStep - nReport + 1, iStep, optfWallTimeSum / nReport);
+			optfWallTimeSum = 0.0;
+		}
+		posPred.correct(vecPosCurr, optfStatus);
+		cv::Mat(vecPosCurr).reshape(2, 1).copyTo(posCurr);
 
 		// 4.10 Show result
 		// calculate absolute velocity (pixels per frame time)
@@ -185,7 +331,6 @@ int FuncVideoDenseTracking(int argc, char ** argv)
 			velCurr.at<cv::Point2f>(0, i) = posCurr.at<cv::Point2f>(0, i) - posPrev.at<cv::Point2f>(0, i);
 		}
 		cv::Mat imgDrawCurr = imgCurr.clone();
-		cv::Mat imgColormap = cv::Mat(imgCurr.size(), CV_8UC3); 
 		cv::cvtColor(imgDrawCurr, imgDrawCurr, cv::COLOR_GRAY2BGR); 
 		//drawPointsOnImage(imgDrawCurr, posCurr,
 		//	std::string("o"),
@@ -196,41 +341,44 @@ int FuncVideoDenseTracking(int argc, char ** argv)
 		//	-1, /* put text */
 		//	0 /* shift */
 		//);
-		for (int i = 0; i < nyPoint; i++) {
-			for (int j = 0; j < nxPoint; j++) {
-				int ij = i * nxPoint + j;
-				int dw = imgCurr.cols / nxPoint;
-				int dh = imgCurr.rows / nyPoint; 
-				float velx = velCurr.at<cv::Point2f>(ij).x; 
-				float vely = velCurr.at<cv::Point2f>(ij).y;
-				float vel = sqrt(velx * velx + vely * vely); 
-				uchar graylevel = (uchar) (255 * (vel / colormapMax));
-				cv::Point p1(j * dw, i * dh); 
-				cv::Point p2((j + 1) * dw - 1, (i + 1) * dw - 1); 
-				cv::rectangle(imgColormap, p1, p2,
-					cv::Scalar(graylevel, graylevel, graylevel),
-					cv::FILLED, cv::LineTypes::LINE_8, 0 /*shift*/); 
-			}
-		}
-		cv::applyColorMap(imgColormap, imgColormap, cv::COLORMAP_JET); 
+		// velocity magnitude of each point to colormap (a cell per point, enlarged to image size)
+		cv::Mat velxy[2], velMag, imgColormap;
+		cv::split(velCurr.reshape(2, nyPoint), velxy);
+		cv::magnitude(velxy[0], velxy[1], velMag);
+		cellFieldToColormap(velMag, imgCurr.size(), imgColormap, 0.f, std::max(colormapMax, 1e-6f), jetLut);
 		imgDrawCurr = 0.2 * imgDrawCurr + 0.8 * imgColormap;
 		imshow_resize("Curr", imgDrawCurr, 0.25);
 		cv::waitKey(10);
 
-		// write to colormap image
-		cv::imwrite(voFsq.fullPathOfFile(iStep), imgDrawCurr);
+		// write to colormap image (imgDrawCurr is a new image every step)
+		sink.writeImage(voFsq.fullPathOfFile(iStep), imgDrawCurr);
 
 		// Step 5: Save file to boFile, xoFile
-		snprintf(buf, 1000, "imgPoints%d", iStep);
-		if (uoFile.isOpened()) uoFile << buf << posCurr;
-		snprintf(buf, 1000, "imgVelocities%d", iStep);
-		if (voFile.isOpened()) voFile << buf << velCurr;
+		//         (by the writer thread, with copies as posCurr and velCurr are reused)
+		cv::Mat posSave = posCurr.clone(), velSave = velCurr.clone();
+		sink.run([&uoStore, &voStore, posSave, velSave]() {
+			if (uoStore.isOpen()) uoStore.appendFrame(posSave);
+			if (voStore.isOpen()) voStore.appendFrame(velSave);
+		});
 
 		// Step 6: Visualization
 	}
 	// 
-	if (uoFile.isOpened()) uoFile.release(); 
-	if (voFile.isOpened()) voFile.release();
+	sink.close();
+	uoStore.close();
+	voStore.close();
+	exportDenseFieldStoreXml(uoStoreName, uoFilename);
+	exportDenseFieldStoreXml(voStoreName, voFilename);
 
 	return 0;
-}
\ No newline at end of file
+}
+
+int FuncVideoDenseTracking(int argc, char ** argv)
+{
+	return videoDenseTracking(argc, argv, false);
+}
+
+int FuncVideoDenseTrackingTiled(int argc, char ** argv)
+{
+	return videoDenseTracking(argc, argv, true);
+}
@@ -12,6 +12,8 @@
 #include <opencv2/opencv.hpp>
 
 #include "FileSeq.h"
+#include "FileSeqPrefetcher.h"
+#include "OutputSink.h"
 #include "matchTemplateWithRotPyr.h"
 #include "ImagePointsPicker.h"
 #include "enhancedCorrelationWithReference.h"
@@ -19,6 +21,7 @@
 #include "impro_util.h"
 #include "Points2fHistoryData.h"
 #include "Points3dHistoryData.h"
+#include "LkPyramid.h"
 
 // Step 1: Read camera parameters (cmat, dvec, rvec, tvec) (single cam)
 //         cv::Mat cmat(3, 3, CV_64F), dvec(1, n, CV_64F) (?or (n, 1, CV_64F)), rvec(3, 1, CV_64F), tvec(3, 1, CV_64F)
@@ -41,6 +44,14 @@
 //         (You probably need to reshape Qmesh and qmesh from (h*w, 1) to (h, w). (Use interpolation of CUBIC, or higher order)
 //         cv::Mat imgRectf;
 
+// deep copy of a history (set() copies into the existing buffer, so an output queued to a
+// sink needs its own data)
+template <class T>
+static T historyCopy(T & hist)
+{
+	return T(hist.getMat());
+}
+
 int FuncWallSingleCam(int argc, char** argv)
 {	// variables
 	string fnameCalib;
@@ -57,6 +68,7 @@ int FuncWallSingleCam(int argc, char** argv)
 	int wImgRectf, hImgRectf;
 	cv::Mat qwmesh, qimesh;
 	cv::Mat img, imgRectf, imgSobelRectf, imgInitRectf, imgPrev, imgCurr, imgNewRectf;
+	LkPyramid pyrPrev, pyrCurr; // optical-flow pyramids (pyramid of current image is reused as previous in the next step)
 	FileSeq fsqSourceImg, fsqRectfImg;
 	int nCellsWidth, nCellsHeight;
 	std::vector<cv::Point2f> InitprevPts, prevPts, nextPts;
@@ -260,6 +272,10 @@ int FuncWallSingleCam(int argc, char** argv)
 	//	xyFeatures.writeToXml((extFilenameRemoved(fsqRectfImg.fullPathOfFile(0)) + "_xyFeatures.xml"));
 
 		// start the loop
+	FileSeqPrefetcher prefetcher; // source images are decoded ahead by background threads
+	prefetcher.start(fsqSourceImg);
+	OutputSink sink; // rectified images and scripts are written by a background thread
+	sink.start(1);
 	for (int iStep = 0; iStep < fsqSourceImg.num_files(); iStep++)
 	{
 		// define the previous image
@@ -275,7 +291,7 @@ int FuncWallSingleCam(int argc, char** argv)
 			prevPts = nextPts;
 		}
 		// Read or Wait source image
-		fsqSourceImg.waitForImageFile(iStep, imgCurr);
+		prefetcher.waitForImageFile(iStep, imgCurr);
 		// Rectification by remapping
 		cv::remap(imgCurr, imgRectf, qimesh, cv::noArray(), cv::INTER_CUBIC);
 		imgRectf.copyTo(imgNewRectf);
@@ -287,7 +303,7 @@ int FuncWallSingleCam(int argc, char** argv)
 		cv::waitKey(1);
 		// save rectified image to file
 		std::string fnameImgRectf = fsqRectfImg.fullPathOfFile(iStep);
-		cv::imwrite(fnameImgRectf, imgRectf);
+		sink.writeImage(fnameImgRectf, imgRectf.clone());
 
 		// displacement (image tracking)
 		cv::Mat optFlow_status, optFlow_error, infoTM_Acc;
@@ -300,9 +316,16 @@ int FuncWallSingleCam(int argc, char** argv)
 		int maxLevel = 3;
 		cv::TermCriteria criteria = cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 50, 0.001);
 
+		// each image pyramid is built once (as current) and reused (as previous) 
+		if (iStep == 0)
+			pyrPrev.build(imgPrev, winSize, maxLevel);
+		else
+			pyrPrev.swap(pyrCurr);
+		pyrCurr.build(imgCurr, winSize, maxLevel);
+
 		cv::calcOpticalFlowPyrLK(
-			imgPrev,	// previous photo
-			imgCurr,	// current photo
+			pyrPrev.levels(),	// previous photo
+			pyrCurr.levels(),	// current photo
 			prevPts,
 			nextPts,
 			optFlow_status,
@@ -339,7 +362,8 @@ int FuncWallSingleCam(int argc, char** argv)
 		for (int i = 0; i < nextPts.size(); i++) {
 			rangeTracing.set(0, i, nextPts[i]);
 		}
-		rangeTracing.writeScriptMatAdvanced((extFilenameRemoved(fsqRectfImg.fullPathOfFile(iStep)) + "_rangeTracing.m"), fnameImgRectf, false, 1, 1 /* only data */);
+		sink.run([out = historyCopy(rangeTracing), fileM = extFilenameRemoved(fsqRectfImg.fullPathOfFile(iStep)) + "_rangeTracing.m", fnameImgRectf]() mutable {
+			out.writeScriptMatAdvanced(fileM, fnameImgRectf, false, 1, 1 /* only data */); });
 		//		rangeTracing.writeToXml((extFilenameRemoved(fsqRectfImg.fullPathOfFile(iStep)) + "_rangeTracing.xml"));
 
 				// strain2Dxx_yy_xy (nCellsHeight * nCellsWidth) G the strain component of the region.
@@ -631,7 +655,8 @@ int FuncWallSingleCam(int argc, char** argv)
 			}
 		}
 		// Save strain2D_xx_yy_xy to file
-		strain2DPlotTf.writeScriptMatAdvanced((extFilenameRemoved(fsqRectfImg.fullPathOfFile(iStep)) + "_strain2Dxx_yy_xy.m"), false, 1, 1 /* only data */);
+		sink.run([out = historyCopy(strain2DPlotTf), fileM = extFilenameRemoved(fsqRectfImg.fullPathOfFile(iStep)) + "_strain2Dxx_yy_xy.m"]() mutable {
+			out.writeScriptMatAdvanced(fileM, false, 1, 1 /* only data */); });
 		//		strain2DPlotTf.writeToXml((extFilenameRemoved(fsqRectfImg.fullPathOfFile(iStep)) + "_strain2Dxx_yy_xy.xml"));
 
 				// Displacement field
@@ -650,7 +675,8 @@ int FuncWallSingleCam(int argc, char** argv)
 			}
 		}
 		// Save Ux_Uy to file (in mm)
-		uxyGridPlot.writeScriptMatAdvanced((extFilenameRemoved(fsqRectfImg.fullPathOfFile(iStep)) + "_Ux_Uy.m"), fnameImgRectf, false, 1, 1 /* only data */);
+		sink.run([out = historyCopy(uxyGridPlot), fileM = extFilenameRemoved(fsqRectfImg.fullPathOfFile(iStep)) + "_Ux_Uy.m", fnameImgRectf]() mutable {
+			out.writeScriptMatAdvanced(fileM, fnameImgRectf, false, 1, 1 /* only data */); });
 		//		uxyGridPlot.writeToXml((extFilenameRemoved(fsqRectfImg.fullPathOfFile(iStep)) + "_Ux_Uy.xml"));
 
 				// Crack Field
@@ -777,10 +803,12 @@ int FuncWallSingleCam(int argc, char** argv)
 				crack2D.set(0, i * nCellsWidth + j, crack);
 			}
 		}
-		crack2D.writeScriptMatAdvanced((extFilenameRemoved(fsqRectfImg.fullPathOfFile(iStep)) + "_crack2D.m"), false, 1, 1 /* only data */);
+		sink.run([out = historyCopy(crack2D), fileM = extFilenameRemoved(fsqRectfImg.fullPathOfFile(iStep)) + "_crack2D.m"]() mutable {
+			out.writeScriptMatAdvanced(fileM, false, 1, 1 /* only data */); });
 		//		crack2D.writeToXml((extFilenameRemoved(fsqRectfImg.fullPathOfFile(iStep)) + "_crack2D.xml"));
 
 	}
+	sink.close();
 
 	cv::destroyWindow("Rectf");
 	cv::destroyWindow("imgPrev");
@@ -4,8 +4,19 @@ CONFIG -= app_bundle
 CONFIG -= qt
 
 SOURCES += \
+        BigTableLog.cpp \
         CamMoveCorrector.cpp \
+        ChunkedTable.cpp \
+        DenseFieldStore.cpp \
+        EccIcTracker.cpp \
+        FieldColormap.cpp \
         FileSeq.cpp \
+        FileSeqPrefetcher.cpp \
+        FuncBenchDenseFieldStore.cpp \
+        FuncBenchIoData.cpp \
+        FuncBenchTextRead.cpp \
+        FuncBenchTmatchFft.cpp \
+        FuncBigTableCsv.cpp \
         FuncCalibInLabOnSite.cpp \
         FuncCalibOnSiteUserPoints.cpp \
         FuncCalibOnlyExtrinsic.cpp \
@@ -47,10 +58,15 @@ SOURCES += \
         ImageSequence.cpp \
         IntrinsicCalibrator.cpp \
         IoData.cpp \
+        LkPyramid.cpp \
+        OutputSink.cpp \
         Points2fHistoryData.cpp \
         Points3dHistoryData.cpp \
+        PointsPredictor.cpp \
         RollingPlot.cpp \
+        RotTmpltBank.cpp \
         Submenu.cpp \
+        TextNumberParser.cpp \
         enhancedCorrelationWithReference.cpp \
         estimateStoryDisp.cpp \
         estimateStoryDispV4.cpp \
@@ -64,6 +80,7 @@ SOURCES += \
         improTargetTracking.cpp \
         impro_util.cpp \
         main.cpp \
+        matchTemplateFft.cpp \
         matchTemplateWithRot.cpp \
         matchTemplateWithRotPyr.cpp \
         pickAPoint.cpp \
@@ -77,16 +94,27 @@ DISTFILES += \
     ImProConsole2.pro.user
 
 HEADERS += \
+    BigTableLog.h \
     CamMoveCorrector.h \
+    ChunkedTable.h \
+    DenseFieldStore.h \
+    EccIcTracker.h \
+    FieldColormap.h \
     FileSeq.h \
+    FileSeqPrefetcher.h \
     ImagePointsPicker.h \
     ImageSequence.h \
     IntrinsicCalibrator.h \
     IoData.h \
+    LkPyramid.h \
+    OutputSink.h \
     Points2fHistoryData.h \
     Points3dHistoryData.h \
+    PointsPredictor.h \
     RollingPlot.h \
+    RotTmpltBank.h \
     Submenu.h \
+    TextNumberParser.h \
     enhancedCorrelationWithReference.h \
     improCalib.h \
     improDraw.h \
@@ -96,6 +124,7 @@ HEADERS += \
     improStrings.h \
     improTargetTracking.h \
     impro_util.h \
+    matchTemplateFft.h \
     matchTemplateWithRot.h \
     matchTemplateWithRotPyr.h \
     pickAPoint.h \
@@ -105,6 +134,11 @@ HEADERS += \
     triangulatepoints2.h \
     uigetfile.h
 
+# OpenMP (parallel point loops, e.g., calcTMatchRotPyr())
+msvc: QMAKE_CXXFLAGS += -openmp
+else: QMAKE_CXXFLAGS += -fopenmp
+!msvc: QMAKE_LFLAGS += -fopenmp
+
 # OpenCV
 win32:CONFIG(release, debug|release): LIBS += -LC:/opencv/opencv451x/opencv-4.5.1/build/install/x64/vc16/lib/ -lopencv_world451
 else:win32:CONFIG(debug, debug|release): LIBS += -LC:/opencv/opencv451x/opencv-4.5.1/build/install/x64/vc16/lib/ -lopencv_world451d
@@ -5,6 +5,7 @@
 #include "pickAPoint.h"
 #include "impro_util.h"
 #include "ImagePointsPicker.h"
+#include "TextNumberParser.h"
 
 // #include "basic_def.h"
 using namespace std; 
@@ -451,15 +452,15 @@ int ImagePointsPicker::readPointsFromTxtFile(std::string fname)
 
 	if (this->existPointsTxtFile(fname) == false)
 		return -1;
-	ifstream ifs(fname); 
+	TextNumberParser txt;
+	if (txt.open(fname) != 0)
+		return -1;
 	this->points.clear();
 	while (true) {
 		cv::Point2f p; 
-		ifs >> p.x >> p.y;
-		if (ifs.eof()) break;
+		if (txt.next(p.x) == false || txt.next(p.y) == false) break;
 		this->points.push_back(p); 
 	}
-	ifs.close(); 
 	return 0;
 }
 
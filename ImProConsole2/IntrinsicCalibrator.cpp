@@ -17,6 +17,7 @@
 //#include "ImProUtil.h"
 #include "impro_util.h"
 #include "ImagePointsPicker.h"
+#include "TextNumberParser.h"
 
 using namespace std;
 using namespace cv;
@@ -1268,22 +1269,20 @@ int IntrinsicCalibrator::writeIntrinsicParamteresToFile(string filename) const
 
 int IntrinsicCalibrator::readIntrinsicParamteresToFile(string fullpathfile)
 {
-	ifstream ifile(fullpathfile);
-	if (ifile.is_open() == false)
+	TextNumberParser txt;
+	if (txt.open(fullpathfile) != 0)
 		return -1;
-	double fx, fy, cx, cy;
+	double fx = 0.0, fy = 0.0, cx = 0.0, cy = 0.0;
 	vector<double> k(4, 0.0); 
-	ifile >> fx >> fy >> cx >> cy;
+	txt.next(fx); txt.next(fy); txt.next(cx); txt.next(cy);
 	for (int i = 0; i < 12; i++) {
 		double val = 0.0; 
-		ifile >> val;
-		if (ifile.eof() && val == 0.0)
+		if (txt.next(val) == false)
 			break;
 		if (i >= k.size())
 			k.resize(i + 1);
 		k[i] = val;
 	}
-	ifile.close();
 	this->cmat = cv::Mat::eye(3, 3, CV_64F);
 	this->cmat.at<double>(0, 0) = fx;
 	this->cmat.at<double>(1, 1) = fy;
@@ -3,6 +3,20 @@
 #include <iostream>
 #include <cstdio>  // for remove
 #include <cstdlib> // for FILE
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "IoData.h"
 
@@ -28,6 +42,7 @@ bool fileExist(const char * name) {
 vector<unsigned char> IoData::serialize()
 {
 // write this object to xml file, read it as binary array
+// (fallback of data types without an in-memory form, see writeMatToBytes())
 	vector<unsigned char> barray; 
 	// find an available file name
 	unsigned int i; 
@@ -68,6 +83,7 @@ vector<unsigned char> IoData::serialize()
 int IoData::deserialize(const vector<unsigned char>& barray)
 {
 // assuming the array is a binary form of an xml file (see ::serialize())
+// (fallback of data types without an in-memory form, see readMatFromBytes())
 // write the array to a binary file (.xml) file and read it
 
 	// find an available file name
@@ -94,6 +110,417 @@ int IoData::deserialize(const vector<unsigned char>& barray)
 	return ret;
 }
 
+int IoData::readFromBin(string fileBin)
+{
+	cerr << "IoData::readFromBin(): Binary file is not supported by this data type.\n";
+	return -1;
+}
+
+int IoData::writeToBin(string fileBin)
+{
+	cerr << "IoData::writeToBin(): Binary file is not supported by this data type.\n";
+	return -1;
+}
+
+// Binary container of IoData:
+//   header (64 bytes, IoDataBinHeader), 
+//   data (dataBytes bytes, rows of the cv::Mat, contiguous), 
+//   extra (nExtra int32 values, e.g., template rects of points). 
+// Values are in the byte order of the machine that writes the file (little-endian 
+// on x86 and ARM). Readers check the magic, the version, and the sizes. 
+// A log being written by IoDataBinLog has rows 0 and dataBytes -1 (ioDataBinLogBytes): 
+// its data are the complete rows between the header and the end of the file, and 
+// there are no extra values. IoDataBinLog::close() writes the final header. 
+struct IoDataBinHeader {
+	char    magic[8];     // "IMPROBIN"
+	int32_t version;      // 1
+	int32_t type;         // cv::Mat type, e.g., CV_32FC2 for Points2fHistoryData
+	int32_t rows;         // nStep
+	int32_t cols;         // nPoint
+	int32_t nExtra;       // number of int32 values after data
+	int32_t headerBytes;  // offset of data (64)
+	int64_t dataBytes;    // rows * cols * element size
+	char    reserved[24];
+};
+static_assert(sizeof(IoDataBinHeader) == 64, "IoDataBinHeader must be 64 bytes");
+static const char ioDataBinMagic[8] = { 'I', 'M', 'P', 'R', 'O', 'B', 'I', 'N' };
+static const int32_t ioDataBinVersion = 1;
+static const int64_t ioDataBinLogBytes = -1;
+
+// size of an open file (64-bit, also on Windows). The position is moved to the end.
+static int64_t fileSize64(FILE * file)
+{
+#if defined(_WIN32)
+	_fseeki64(file, 0, SEEK_END);
+	return (int64_t) _ftelli64(file);
+#else
+	fseeko(file, 0, SEEK_END);
+	return (int64_t) ftello(file);
+#endif
+}
+
+// IoDataMappedFile maps a whole file to memory (copy-on-write). 
+class IoDataMappedFile
+{
+public:
+	explicit IoDataMappedFile(const string & fname)
+	{
+#if defined(_WIN32)
+		HANDLE hFile = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (hFile == INVALID_HANDLE_VALUE) return;
+		LARGE_INTEGER fsize;
+		if (GetFileSizeEx(hFile, &fsize) && fsize.QuadPart > 0) {
+			HANDLE hMap = CreateFileMappingA(hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+			if (hMap != NULL) {
+				addr = MapViewOfFile(hMap, FILE_MAP_COPY, 0, 0, 0);
+				if (addr != NULL) size = (size_t) fsize.QuadPart;
+				CloseHandle(hMap); // (the view keeps the mapping)
+			}
+		}
+		CloseHandle(hFile);
+#else
+		int fd = open(fname.c_str(), O_RDONLY);
+		if (fd < 0) return;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void * p = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				addr = p;
+				size = (size_t) st.st_size;
+			}
+		}
+		close(fd); // (the mapping stays)
+#endif
+	}
+	~IoDataMappedFile()
+	{
+		if (addr == NULL) return;
+#if defined(_WIN32)
+		UnmapViewOfFile(addr);
+#else
+		munmap(addr, size);
+#endif
+	}
+	void * addr = NULL;
+	size_t size = 0;
+};
+
+// IoDataMappedMatAllocator releases the mapping (userdata of UMatData) when the 
+// last cv::Mat that refers to a memory-mapped file is released. New data of those
+// Mats (e.g., by create() of another size) are allocated by the standard allocator. 
+class IoDataMappedMatAllocator : public cv::MatAllocator
+{
+public:
+	cv::UMatData * allocate(int dims, const int * sizes, int type, void * data, size_t * step,
+		cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override
+	{
+		return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+	}
+	bool allocate(cv::UMatData * u, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override
+	{
+		return cv::Mat::getStdAllocator()->allocate(u, accessFlags, usageFlags);
+	}
+	void deallocate(cv::UMatData * u) const override
+	{
+		if (u == NULL) return;
+		delete (IoDataMappedFile *) u->userdata;
+		u->userdata = NULL;
+		delete u;
+	}
+};
+static IoDataMappedMatAllocator ioDataMappedMatAllocator;
+
+// fills the header of the binary container of a rows x cols cv::Mat of type
+static void fillIoDataBinHeader(IoDataBinHeader & header, int type, int rows, int cols, size_t nExtra)
+{
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, ioDataBinMagic, sizeof(header.magic));
+	header.version = ioDataBinVersion;
+	header.type = type;
+	header.rows = rows;
+	header.cols = cols;
+	header.nExtra = (int32_t) nExtra;
+	header.headerBytes = (int32_t) sizeof(header);
+	header.dataBytes = (int64_t) rows * cols * CV_ELEM_SIZE(type);
+}
+
+int IoData::writeMatToBin(string fileBin, const cv::Mat & mat, const vector<int> & extra)
+{
+	if (mat.dims != 2 || mat.rows <= 0 || mat.cols <= 0) {
+		cerr << "IoData::writeMatToBin(): Data is empty or not 2D.\n";
+		return -1;
+	}
+	IoDataBinHeader header;
+	fillIoDataBinHeader(header, mat.type(), mat.rows, mat.cols, extra.size());
+	// The data are written to a temporary file which then replaces fileBin, as mat 
+	// can be a memory-mapped view of fileBin (see readMatFromBin()), which must not 
+	// be truncated while it is mapped. 
+	string fileTmp = fileBin + ".tmp";
+	FILE * file;
+	errno_t err = fopen_s(&file, fileTmp.c_str(), "wb");
+	if (err != 0) {
+		cerr << "IoData::writeMatToBin(): Cannot open " << fileTmp << " to write.\n";
+		return -1;
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	size_t rowBytes = mat.cols * mat.elemSize();
+	if (mat.isContinuous())
+		ok = ok && fwrite(mat.data, (size_t) header.dataBytes, 1, file) == 1;
+	else
+		for (int i = 0; ok && i < mat.rows; i++)
+			ok = fwrite(mat.ptr(i), rowBytes, 1, file) == 1;
+	vector<int32_t> extra32(extra.begin(), extra.end());
+	if (ok && extra32.size() > 0)
+		ok = fwrite(extra32.data(), sizeof(int32_t), extra32.size(), file) == extra32.size();
+	ok = (fclose(file) == 0) && ok;
+	if (!ok) {
+		cerr << "IoData::writeMatToBin(): Failed to write " << fileTmp << ".\n";
+		remove(fileTmp.c_str());
+		return -1;
+	}
+#if defined(_WIN32)
+	ok = MoveFileExA(fileTmp.c_str(), fileBin.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	ok = rename(fileTmp.c_str(), fileBin.c_str()) == 0;
+#endif
+	if (!ok) {
+		cerr << "IoData::writeMatToBin(): Cannot replace " << fileBin << " by " << fileTmp << ".\n";
+		remove(fileTmp.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+// checks a header (and the size of the file) of the binary container. 
+// The header of a log (see IoDataBinLog) is completed with the rows in the file. 
+static bool checkIoDataBinHeader(IoDataBinHeader & header, int type, int64_t fileBytes, 
+	const string & fileBin)
+{
+	if (memcmp(header.magic, ioDataBinMagic, sizeof(header.magic)) != 0) {
+		cerr << "IoData::readMatFromBin(): " << fileBin << " is not an IoData binary file.\n";
+		return false;
+	}
+	if (header.version != ioDataBinVersion) {
+		cerr << "IoData::readMatFromBin(): " << fileBin << " is of version " << header.version 
+			<< " (supports version " << ioDataBinVersion << ").\n";
+		return false;
+	}
+	if (header.type != type) {
+		cerr << "IoData::readMatFromBin(): " << fileBin << " is of data type " << header.type
+			<< " (expects " << type << ").\n";
+		return false;
+	}
+	if (header.rows == 0 && header.dataBytes == ioDataBinLogBytes && header.nExtra == 0 && 
+		header.cols > 0 && header.headerBytes >= (int32_t) sizeof(header)) {
+		int64_t rowBytes = (int64_t) header.cols * CV_ELEM_SIZE(type);
+		int64_t rows = (fileBytes - header.headerBytes) / rowBytes;
+		if (rows <= 0) {
+			cerr << "IoData::readMatFromBin(): " << fileBin << " (log) has no complete row yet.\n";
+			return false;
+		}
+		header.rows = (int32_t) std::min(rows, (int64_t) INT32_MAX);
+		header.dataBytes = header.rows * rowBytes;
+	}
+	int64_t dataBytes = (int64_t) header.rows * header.cols * CV_ELEM_SIZE(type);
+	if (header.rows <= 0 || header.cols <= 0 || header.nExtra < 0 ||
+		header.headerBytes < (int32_t) sizeof(header) || header.dataBytes != dataBytes ||
+		fileBytes < header.headerBytes + dataBytes + (int64_t) header.nExtra * 4) {
+		cerr << "IoData::readMatFromBin(): " << fileBin << " is broken (wrong size).\n";
+		return false;
+	}
+	return true;
+}
+
+int IoData::readMatFromBin(string fileBin, cv::Mat & mat, vector<int> & extra, int type, bool useMmap)
+{
+	if (useMmap) {
+		IoDataMappedFile * mf = new IoDataMappedFile(fileBin);
+		if (mf->addr != NULL && mf->size >= sizeof(IoDataBinHeader)) {
+			IoDataBinHeader header;
+			memcpy(&header, mf->addr, sizeof(header));
+			if (checkIoDataBinHeader(header, type, (int64_t) mf->size, fileBin) == false) {
+				delete mf;
+				return -1;
+			}
+			uchar * data = (uchar *) mf->addr + header.headerBytes;
+			const int32_t * extra32 = (const int32_t *) (data + header.dataBytes);
+			extra.assign(extra32, extra32 + header.nExtra);
+			// a Mat on the mapping, which owns the mapping through its UMatData
+			cv::Mat view(header.rows, header.cols, type, data);
+			cv::UMatData * u = new cv::UMatData(&ioDataMappedMatAllocator);
+			u->data = u->origdata = data;
+			u->size = (size_t) header.dataBytes;
+			u->userdata = mf;
+			view.u = u;
+			view.addref();
+			view.allocator = &ioDataMappedMatAllocator;
+			mat = view;
+			return 0;
+		}
+		delete mf; // cannot be mapped, read it instead
+	}
+	FILE * file;
+	errno_t err = fopen_s(&file, fileBin.c_str(), "rb");
+	if (err != 0) {
+		cerr << "IoData::readMatFromBin(): Cannot open " << fileBin << ".\n";
+		return -1;
+	}
+	IoDataBinHeader header;
+	bool ok = fread(&header, sizeof(header), 1, file) == 1;
+	if (!ok || checkIoDataBinHeader(header, type, fileSize64(file), fileBin) == false) {
+		fclose(file);
+		return -1;
+	}
+#if defined(_WIN32)
+	_fseeki64(file, header.headerBytes, SEEK_SET);
+#else
+	fseeko(file, header.headerBytes, SEEK_SET);
+#endif
+	cv::Mat m(header.rows, header.cols, type);
+	ok = fread(m.data, (size_t) header.dataBytes, 1, file) == 1;
+	vector<int32_t> extra32(header.nExtra);
+	if (ok && header.nExtra > 0)
+		ok = fread(extra32.data(), sizeof(int32_t), extra32.size(), file) == extra32.size();
+	fclose(file);
+	if (!ok) {
+		cerr << "IoData::readMatFromBin(): Failed to read " << fileBin << ".\n";
+		return -1;
+	}
+	mat = m;
+	extra.assign(extra32.begin(), extra32.end());
+	return 0;
+}
+
+int IoData::writeMatToBytes(const cv::Mat & mat, const vector<int> & extra, vector<unsigned char> & bytes)
+{
+	if (mat.dims != 2 || mat.rows <= 0 || mat.cols <= 0) {
+		cerr << "IoData::writeMatToBytes(): Data is empty or not 2D.\n";
+		bytes.clear();
+		return -1;
+	}
+	IoDataBinHeader header;
+	fillIoDataBinHeader(header, mat.type(), mat.rows, mat.cols, extra.size());
+	bytes.resize(sizeof(header) + (size_t) header.dataBytes + extra.size() * sizeof(int32_t));
+	unsigned char * p = bytes.data();
+	memcpy(p, &header, sizeof(header));
+	p += sizeof(header);
+	size_t rowBytes = mat.cols * mat.elemSize();
+	if (mat.isContinuous()) {
+		memcpy(p, mat.data, (size_t) header.dataBytes);
+		p += header.dataBytes;
+	}
+	else
+		for (int i = 0; i < mat.rows; i++, p += rowBytes)
+			memcpy(p, mat.ptr(i), rowBytes);
+	for (size_t i = 0; i < extra.size(); i++, p += sizeof(int32_t)) {
+		int32_t v = (int32_t) extra[i];
+		memcpy(p, &v, sizeof(v));
+	}
+	return 0;
+}
+
+int IoData::readMatFromBytes(const vector<unsigned char> & bytes, cv::Mat & mat, vector<int> & extra, int type)
+{
+	IoDataBinHeader header;
+	if (bytes.size() < sizeof(header)) {
+		cerr << "IoData::readMatFromBytes(): Serialized data is too short.\n";
+		return -1;
+	}
+	memcpy(&header, bytes.data(), sizeof(header));
+	if (checkIoDataBinHeader(header, type, (int64_t) bytes.size(), "(serialized data)") == false)
+		return -1;
+	const unsigned char * data = bytes.data() + header.headerBytes;
+	mat = cv::Mat(header.rows, header.cols, type, (void *) data).clone();
+	extra.resize(header.nExtra);
+	for (int i = 0; i < header.nExtra; i++) {
+		int32_t v;
+		memcpy(&v, data + header.dataBytes + i * sizeof(int32_t), sizeof(v));
+		extra[i] = v;
+	}
+	return 0;
+}
+
+bool IoData::isBinBytes(const vector<unsigned char> & bytes)
+{
+	return bytes.size() >= sizeof(IoDataBinHeader) &&
+		memcmp(bytes.data(), ioDataBinMagic, sizeof(IoDataBinHeader::magic)) == 0;
+}
+
+IoDataBinLog::~IoDataBinLog()
+{
+	this->close();
+}
+
+int IoDataBinLog::open(string fileBin, int type)
+{
+	this->close();
+	errno_t err = fopen_s(&this->file, fileBin.c_str(), "wb");
+	if (err != 0) {
+		cerr << "IoDataBinLog::open(): Cannot open " << fileBin << " to write.\n";
+		this->file = NULL;
+		return -1;
+	}
+	this->fileBin = fileBin;
+	this->type = type;
+	this->cols = 0;
+	this->rows = 0;
+	return 0;
+}
+
+int IoDataBinLog::append(const cv::Mat & mat)
+{
+	if (this->file == NULL) return -1;
+	if (mat.dims != 2 || mat.rows <= 0 || mat.type() != this->type ||
+		(this->cols > 0 && mat.cols != this->cols)) {
+		cerr << "IoDataBinLog::append(): Data do not fit " << this->fileBin << ".\n";
+		return -1;
+	}
+	bool ok = true;
+	if (this->cols == 0) {
+		// the header is written with the first rows (which define cols)
+		IoDataBinHeader header;
+		fillIoDataBinHeader(header, this->type, 0, mat.cols, 0);
+		header.dataBytes = ioDataBinLogBytes;
+		ok = fwrite(&header, sizeof(header), 1, this->file) == 1;
+		this->cols = mat.cols;
+	}
+	size_t rowBytes = mat.cols * mat.elemSize();
+	if (mat.isContinuous())
+		ok = ok && fwrite(mat.data, rowBytes * mat.rows, 1, this->file) == 1;
+	else
+		for (int i = 0; ok && i < mat.rows; i++)
+			ok = fwrite(mat.ptr(i), rowBytes, 1, this->file) == 1;
+	// to the system (visible to readers, and not lost if this process crashes)
+	ok = (fflush(this->file) == 0) && ok;
+	if (!ok) {
+		cerr << "IoDataBinLog::append(): Failed to write " << this->fileBin << ".\n";
+		return -1;
+	}
+	this->rows += mat.rows;
+	return 0;
+}
+
+int IoDataBinLog::close()
+{
+	if (this->file == NULL) return 0;
+	bool ok = true;
+	if (this->cols > 0) {
+		// final header (a regular binary file of IoData)
+		IoDataBinHeader header;
+		fillIoDataBinHeader(header, this->type, this->rows, this->cols, 0);
+		ok = fseek(this->file, 0, SEEK_SET) == 0 &&
+			fwrite(&header, sizeof(header), 1, this->file) == 1;
+	}
+	ok = (fclose(this->file) == 0) && ok;
+	this->file = NULL;
+	if (!ok) {
+		cerr << "IoDataBinLog::close(): Failed to write " << this->fileBin << ".\n";
+		return -1;
+	}
+	return 0;
+}
+
 void IoData::memoryReallocationClick()
 {
 	this->memoryReallocationCount++;
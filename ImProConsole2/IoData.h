@@ -17,6 +17,11 @@ public:
 	virtual int readFromXml(string fileXml) = 0;
 	virtual int writeToXml(string fileXml)  = 0;
 
+	// to/from binary file (a versioned header followed by contiguous data, which is 
+	// read through a memory mapping without copying). Returns -1 if not supported.
+	virtual int readFromBin(string fileBin);
+	virtual int writeToBin(string fileBin);
+
 	// ask user which format and where to read, then read data
 	virtual int readThruUserInteraction() = 0;
 	virtual int writeThruUserInteraction() = 0;
@@ -25,6 +30,8 @@ public:
 	virtual int writeScriptMat(string fileM) = 0;
 
 	// serialization and deserialization
+	// (the default writes and reads a temporary xml file. Data types that override 
+	// them encode data in memory, in the binary container of writeMatToBytes())
 	virtual vector<unsigned char> serialize();
 	virtual int deserialize(const vector<unsigned char> & dat);
 
@@ -32,6 +39,55 @@ public:
 	virtual void memoryReallocationClick();
 
 protected:
+	// binary container of a cv::Mat (see IoData.cpp for the header):
+	//   writeMatToBin() writes mat (any type, 2D) and extra int values. 
+	//   The file is written as fileBin + ".tmp" and renamed to fileBin, so mat can be 
+	//   a memory-mapped view of fileBin. 
+	//   readMatFromBin() reads a mat of the given type. If useMmap, mat is a view of the 
+	//   memory-mapped file (copy-on-write, the file is not changed), which keeps the 
+	//   mapping until mat (and all its copies) are released. 
+	static int writeMatToBin(string fileBin, const cv::Mat & mat, const vector<int> & extra = vector<int>());
+	static int readMatFromBin(string fileBin, cv::Mat & mat, vector<int> & extra, int type, bool useMmap = true);
+	// the same container in memory (for serialize() and deserialize()):
+	//   writeMatToBytes() encodes mat and extra into bytes.
+	//   readMatFromBytes() decodes a mat of the given type (copied, bytes can be released).
+	//   isBinBytes() tells whether bytes begin with the header of the container 
+	//   (or, e.g., are an xml file from the default serialize()).
+	static int writeMatToBytes(const cv::Mat & mat, const vector<int> & extra, vector<unsigned char> & bytes);
+	static int readMatFromBytes(const vector<unsigned char> & bytes, cv::Mat & mat, vector<int> & extra, int type);
+	static bool isBinBytes(const vector<unsigned char> & bytes);
+
 	int memoryReallocationCount = 0; 
 };
 
+// IoDataBinLog writes a binary file of IoData (see IoData::writeMatToBin()) row by row, 
+// e.g., the points of each step of a history as it grows. Every append() is flushed, 
+// so the file can be read (IoData::readMatFromBin(), readFromBin()) by other processes 
+// while it is written, which gets the complete rows so far, and a crash loses at most 
+// the rows being appended. close() (or the destructor) writes the final header. 
+// The cost of append() is of the appended rows only. There are no extra values. 
+class IoDataBinLog
+{
+public:
+	IoDataBinLog() {};
+	~IoDataBinLog();
+	IoDataBinLog(const IoDataBinLog &) = delete;
+	IoDataBinLog & operator=(const IoDataBinLog &) = delete;
+
+	// creates (or truncates) fileBin for rows of the given cv::Mat type. The header 
+	// is written by the first append(), whose cols are those of the following ones.
+	int open(string fileBin, int type);
+	int append(const cv::Mat & rows);
+	int close();
+
+	bool isOpen() const { return file != NULL; }
+	int nRows() const { return rows; }
+
+protected:
+	FILE * file = NULL;
+	string fileBin;
+	int type = 0;
+	int cols = 0;
+	int rows = 0;
+};
+
@@ -0,0 +1,94 @@
+#include <vector>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+#include "LkPyramid.h"
+
+using namespace std;
+
+int LkPyramid::build(const cv::Mat & _img, cv::Size _winSize, int _maxLevel, bool withDerivatives)
+{
+	this->img = _img;
+	this->winSize = _winSize;
+	this->withDeriv = withDerivatives;
+	this->maxLevel = cv::buildOpticalFlowPyramid(_img, this->pyr, _winSize, _maxLevel, withDerivatives);
+	this->nBuilt++;
+	return this->maxLevel;
+}
+
+bool LkPyramid::isFor(const cv::Mat & _img, cv::Size _winSize, int _maxLevel, bool withDerivatives) const
+{
+	if (this->empty()) return false;
+	if (this->img.data != _img.data || this->img.size() != _img.size() ||
+		this->img.type() != _img.type() || this->img.step != _img.step)
+		return false;
+	if (_winSize.width > this->winSize.width || _winSize.height > this->winSize.height)
+		return false;
+	if (_maxLevel > this->maxLevel) return false;
+	if (withDerivatives && !this->withDeriv) return false;
+	return true;
+}
+
+bool LkPyramid::update(const cv::Mat & _img, cv::Size _winSize, int _maxLevel, bool withDerivatives)
+{
+	if (this->isFor(_img, _winSize, _maxLevel, withDerivatives))
+		return false;
+	this->build(_img, _winSize, _maxLevel, withDerivatives);
+	return true;
+}
+
+void LkPyramid::clear()
+{
+	this->pyr.clear();
+	this->img.release();
+	this->maxLevel = -1;
+}
+
+void LkPyramid::swap(LkPyramid & other)
+{
+	std::swap(this->pyr, other.pyr);
+	std::swap(this->img, other.img);
+	std::swap(this->winSize, other.winSize);
+	std::swap(this->maxLevel, other.maxLevel);
+	std::swap(this->withDeriv, other.withDeriv);
+	std::swap(this->nBuilt, other.nBuilt);
+}
+
+void calcOpticalFlowPyrLKPerLevel(const LkPyramid & prevPyr, const LkPyramid & nextPyr,
+	const vector<cv::Point2f> & prevPts, vector<cv::Point2f> & nextPts,
+	vector<uchar> & status, vector<float> & err,
+	cv::Size winSize, const vector<int> & maxLevels,
+	cv::TermCriteria criteria, int flags, double minEigThreshold)
+{
+	size_t n = prevPts.size();
+	CV_Assert(maxLevels.size() == n);
+	if ((flags & cv::OPTFLOW_USE_INITIAL_FLOW) == 0)
+		nextPts = prevPts;
+	CV_Assert(nextPts.size() == n);
+	status.assign(n, 0);
+	err.assign(n, 0.f);
+	int topLevel = 0;
+	for (size_t i = 0; i < n; i++)
+		topLevel = std::max(topLevel, maxLevels[i]);
+	vector<int> idx;
+	vector<cv::Point2f> p0, p1;
+	vector<uchar> st;
+	vector<float> er;
+	for (int level = 0; level <= topLevel; level++) {
+		idx.clear(); p0.clear(); p1.clear();
+		for (size_t i = 0; i < n; i++) {
+			if (maxLevels[i] != level) continue;
+			idx.push_back((int) i);
+			p0.push_back(prevPts[i]);
+			p1.push_back(nextPts[i]);
+		}
+		if (idx.size() == 0) continue;
+		cv::calcOpticalFlowPyrLK(prevPyr.levels(), nextPyr.levels(), p0, p1, st, er,
+			winSize, level, criteria, flags | cv::OPTFLOW_USE_INITIAL_FLOW, minEigThreshold);
+		for (size_t j = 0; j < idx.size(); j++) {
+			nextPts[idx[j]] = p1[j];
+			status[idx[j]] = st[j];
+			err[idx[j]] = er[j];
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+//! LkPyramid keeps an image pyramid (cv::buildOpticalFlowPyramid) for cv::calcOpticalFlowPyrLK()
+/*!
+\details cv::calcOpticalFlowPyrLK() builds the pyramids of both images in every call. When
+the same image is used by several calls (e.g., fixed points and tracking points of a frame,
+or a template image used until it is updated), the pyramid can be built once and passed to
+every call instead of the image:
+    LkPyramid pyrTmpl, pyrCurr;
+    pyrTmpl.build(imgTmpl, winSize, maxLevel);          // once per template (update)
+    pyrCurr.build(imgCurr, winSize, maxLevel, false);   // once per frame
+    cv::calcOpticalFlowPyrLK(pyrTmpl.levels(), pyrCurr.levels(), pts1, pts2, ...);
+The pyramid of the previous image (prevImg of cv::calcOpticalFlowPyrLK) should be built
+with derivatives. The winSize and maxLevel of the calls must not be larger than those
+of the pyramid.
+*/
+class LkPyramid
+{
+public:
+	//! builds the pyramid of img. Returns the number of levels (maxLevel of the pyramid).
+	int build(const cv::Mat & img, cv::Size winSize, int maxLevel, bool withDerivatives = true);
+
+	//! returns true if the pyramid was built from img (the same data) and is usable
+	//! for winSize and maxLevel (and derivatives, if withDerivatives).
+	bool isFor(const cv::Mat & img, cv::Size winSize, int maxLevel, bool withDerivatives = true) const;
+
+	//! builds the pyramid only if it is not for img (see isFor()). Returns true if built.
+	bool update(const cv::Mat & img, cv::Size winSize, int maxLevel, bool withDerivatives = true);
+
+	const std::vector<cv::Mat> & levels() const { return pyr; }
+	bool empty() const { return pyr.size() == 0; }
+	void clear();
+	void swap(LkPyramid & other);
+
+	int nBuilt = 0; // statistics (number of builds)
+
+protected:
+	std::vector<cv::Mat> pyr;  // pyramid (with derivatives if withDeriv)
+	cv::Mat img;               // header of the source image (for identity check)
+	cv::Size winSize;
+	int maxLevel = -1;
+	bool withDeriv = false;
+};
+
+//! runs cv::calcOpticalFlowPyrLK() on shared pyramids with a maxLevel per point
+/*!
+\details Points are grouped by maxLevels[i] and each group is tracked by one call, so points
+with small expected motion are not searched on coarse levels (which may lock them onto
+a similar pattern nearby). maxLevels[i] must not be larger than the levels of the
+pyramids. nextPts must have the same size as prevPts if cv::OPTFLOW_USE_INITIAL_FLOW
+is set. Other arguments are the same as cv::calcOpticalFlowPyrLK().
+*/
+void calcOpticalFlowPyrLKPerLevel(const LkPyramid & prevPyr, const LkPyramid & nextPyr,
+	const std::vector<cv::Point2f> & prevPts, std::vector<cv::Point2f> & nextPts,
+	std::vector<uchar> & status, std::vector<float> & err,
+	cv::Size winSize, const std::vector<int> & maxLevels,
+	cv::TermCriteria criteria = cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, 0.01),
+	int flags = 0, double minEigThreshold = 1e-4);
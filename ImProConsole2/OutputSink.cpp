@@ -0,0 +1,244 @@
+#include <cstdio>
+#include <cstdarg>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+#include "impro_util.h"
+#include "OutputSink.h"
+
+using namespace std;
+
+OutputSink::OutputSink()
+{
+}
+
+OutputSink::~OutputSink()
+{
+	this->close();
+}
+
+int OutputSink::start(int nThreads, int _maxQueue, double maxMegaBytes)
+{
+	if (nThreads < 0 || _maxQueue < 1 || maxMegaBytes < 0.)
+		return -1;
+	this->close();
+	this->maxQueue = (size_t) _maxQueue;
+	this->maxBytes = (size_t) (maxMegaBytes * 1024. * 1024.);
+	this->queuedBytes = 0;
+	this->stopping = false;
+	this->nWritten = this->nErrors = this->nBlocked = 0;
+	this->blockedTime = 0.0;
+	for (int i = 0; i < nThreads; i++)
+		this->workers.push_back(std::thread(&OutputSink::workerLoop, this));
+	return 0;
+}
+
+void OutputSink::flush()
+{
+	std::unique_lock<std::mutex> lk(mtx);
+	cvDone.wait(lk, [this] { return jobs.empty() && !committing; });
+}
+
+void OutputSink::close()
+{
+	{
+		std::lock_guard<std::mutex> lk(mtx);
+		stopping = true;
+	}
+	cvWork.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join(); // (workers write all queued outputs before they quit)
+	workers.clear();
+	jobs.clear();
+	queuedBytes = 0;
+}
+
+bool OutputSink::writeBytes(const string & fileName, const vector<uchar> & data)
+{
+	FILE * file;
+	errno_t err = fopen_s(&file, fileName.c_str(), "wb");
+	if (err != 0) {
+		cerr << "OutputSink: Cannot open " << fileName << " to write.\n";
+		return false;
+	}
+	bool ok = data.size() == 0 || fwrite(data.data(), 1, data.size(), file) == data.size();
+	ok = (fclose(file) == 0) && ok;
+	if (!ok)
+		cerr << "OutputSink: Failed to write " << fileName << ".\n";
+	return ok;
+}
+
+void OutputSink::writeFile(const string & fileName, std::function<void(vector<uchar> &)> encode, size_t bytes)
+{
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->encode = encode;
+	job->commit = [fileName](const vector<uchar> & data) { return OutputSink::writeBytes(fileName, data); };
+	job->bytes = bytes;
+	this->submit(job);
+}
+
+void OutputSink::writeText(const string & fileName, const string & text)
+{
+	this->writeFile(fileName, [text](vector<uchar> & out) { out.assign(text.begin(), text.end()); },
+		text.size());
+}
+
+void OutputSink::writeImage(const string & fileName, const cv::Mat & img, const vector<int> & params)
+{
+	size_t dot = fileName.find_last_of('.');
+	string ext = dot == string::npos ? string(".png") : fileName.substr(dot);
+	this->writeFile(fileName, [img, ext, params](vector<uchar> & out) { cv::imencode(ext, img, out, params); },
+		img.total() * img.elemSize());
+}
+
+void OutputSink::writeVideoFrame(cv::VideoWriter & writer, const cv::Mat & frame)
+{
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	cv::VideoWriter * pWriter = &writer;
+	job->commit = [pWriter, frame](const vector<uchar> &) {
+		if (pWriter->isOpened()) pWriter->write(frame); // (the writer may be opened by run())
+		return true;
+	};
+	job->bytes = frame.total() * frame.elemSize();
+	this->submit(job);
+}
+
+void OutputSink::run(std::function<void()> func)
+{
+	std::shared_ptr<Job> job = std::make_shared<Job>();
+	job->commit = [func](const vector<uchar> &) { func(); return true; };
+	this->submit(job);
+}
+
+// encodes a job (on the calling thread). Returns false if encoding fails.
+static bool encodeJob(std::function<void(vector<uchar> &)> & encode, vector<uchar> & data)
+{
+	if (!encode) return true;
+	try {
+		encode(data);
+	}
+	catch (const std::exception & e) {
+		cerr << "OutputSink: Failed to encode an output (" << e.what() << ").\n";
+		return false;
+	}
+	return true;
+}
+
+// commits a job (writes a file or a video frame, or runs a function). Returns false if it
+// fails or throws (e.g., cv::Exception of cv::VideoWriter or cv::FileStorage), so that the
+// exception does not escape the writer thread.
+static bool commitJob(std::function<bool(const vector<uchar> &)> & commit, const vector<uchar> & data)
+{
+	try {
+		return commit(data);
+	}
+	catch (const std::exception & e) {
+		cerr << "OutputSink: Failed to write an output (" << e.what() << ").\n";
+	}
+	catch (...) {
+		cerr << "OutputSink: Failed to write an output (unknown exception).\n";
+	}
+	return false;
+}
+
+void OutputSink::submit(std::shared_ptr<Job> job)
+{
+	if (this->running() == false) {
+		// written on the calling thread
+		bool ok = encodeJob(job->encode, job->data) && commitJob(job->commit, job->data);
+		if (ok) nWritten++; else nErrors++;
+		return;
+	}
+	std::unique_lock<std::mutex> lk(mtx);
+	auto hasRoom = [this, &job] {
+		return jobs.size() < maxQueue && (jobs.empty() || queuedBytes + job->bytes <= maxBytes);
+	};
+	if (hasRoom() == false) {
+		int64 tick = cv::getTickCount();
+		nBlocked++;
+		cvDone.wait(lk, hasRoom);
+		blockedTime += (cv::getTickCount() - tick) / cv::getTickFrequency();
+	}
+	jobs.push_back(job);
+	queuedBytes += job->bytes;
+	lk.unlock();
+	cvWork.notify_all();
+}
+
+void OutputSink::workerLoop()
+{
+	std::unique_lock<std::mutex> lk(mtx);
+	while (true) {
+		// commits encoded jobs at the front, in order (by one thread at a time)
+		if (!committing && !jobs.empty() && jobs.front()->encoded) {
+			committing = true;
+			while (!jobs.empty() && jobs.front()->encoded) {
+				std::shared_ptr<Job> job = jobs.front();
+				lk.unlock();
+				bool ok = !job->failed && commitJob(job->commit, job->data);
+				lk.lock();
+				jobs.pop_front();
+				queuedBytes -= job->bytes;
+				if (ok) nWritten++; else nErrors++;
+				cvDone.notify_all();
+			}
+			committing = false;
+			cvDone.notify_all();
+			cvWork.notify_all();
+			continue;
+		}
+		// encodes the oldest job which is not taken
+		std::shared_ptr<Job> job;
+		for (size_t i = 0; i < jobs.size() && !job; i++)
+			if (!jobs[i]->taken)
+				job = jobs[i];
+		if (job) {
+			job->taken = true;
+			lk.unlock();
+			bool ok = encodeJob(job->encode, job->data);
+			lk.lock();
+			job->failed = !ok; // (not committed, counted as an error)
+			job->encoded = true;
+			cvWork.notify_all();
+			continue;
+		}
+		if (stopping && jobs.empty())
+			break;
+		cvWork.wait(lk);
+	}
+}
+
+void appendFormat(string & s, const char * fmt, ...)
+{
+	char buf[1000];
+	va_list args;
+	va_start(args, fmt);
+	int n = vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	if (n > 0) s.append(buf, std::min(n, (int) sizeof(buf) - 1));
+}
+
+void frameResultText(const cv::Mat & row, int iFrame, int nPoint, int nfFrm, int nfPnt, string & text)
+{
+	text.clear();
+	text.reserve(400 * (nPoint + 1));
+	appendFormat(text, "  Frame NumPts       T_ReadImg      T_WriteTxt      T_WriteImg");
+	for (int iPoint = 0; iPoint < nPoint; iPoint++) {
+		appendFormat(text, " X0_%03d Y0_%03d  W_%03d  H_%03d MT_%03d         W00_%03d         W01_%03d         W02_%03d         W10_%03d         W11_%03d         W12_%03d         W20_%03d         W21_%03d         Ecf_%03d         Xcr_%03d         Ycr_%03d         Rot_%03d        Tpre_%03d      Ttrack_%03d       Tpost_%03d",
+			iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint, iPoint);
+	}
+	text += "\n";
+	appendFormat(text, " %6d %6d", iFrame, nPoint);
+	for (int i = 2; i < nfFrm; i++)
+		appendFormat(text, " %15.7f", row.at<float>(0, i));
+	for (int iPoint = 0; iPoint < nPoint; iPoint++) {
+		for (int i = 0 + nfFrm + iPoint * nfPnt; i <= 4 + nfFrm + iPoint * nfPnt; i++)
+			appendFormat(text, " %6d", (int)(row.at<float>(0, i) + .5f));
+		for (int i = 5 + nfFrm + iPoint * nfPnt; i < nfFrm + (iPoint + 1) * nfPnt; i++)
+			appendFormat(text, " %15.7e", row.at<float>(0, i));
+	}
+	text += "\n";
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <opencv2/opencv.hpp>
+
+//! OutputSink writes per-frame outputs (text, xml, images, video frames) on background threads
+/*!
+\details Writes are queued (bounded) and done by writer threads, so that the analysis thread
+does not wait for encoding and disk I/O unless the queue is full. Each output is done in
+two stages: encoding (e.g., cv::imencode(), formatting text), which runs in parallel on
+the writer threads, and committing (writing the encoded bytes to the file, or a frame to
+a cv::VideoWriter), which runs strictly in the order of submission. Files therefore appear
+in frame order, and a program watching them (e.g., by FileSeq) never sees a later frame
+before an earlier one.
+Data given to the sink are kept until they are written: images are not copied, so the
+caller must not modify their data afterwards (pass img.clone() if the buffer is reused).
+If the sink is not started (or nThreads is 0), outputs are written at once on the calling
+thread.
+Usage:
+    OutputSink sink;
+    sink.start(2);
+    for each frame:
+        sink.writeText(fnameTxt, text);
+        sink.writeImage(fnameJpg, imgBoxed);      // imgBoxed is a new image of this frame
+        sink.writeVideoFrame(videoWriter, imgBoxed);
+    sink.close();                                 // waits until all are written
+*/
+class OutputSink
+{
+public:
+	OutputSink();
+	~OutputSink();
+
+	//! starts writer threads.
+	//! \param nThreads number of writer threads (0: outputs are written on the calling thread)
+	//! \param maxQueue maximum number of outputs queued (not written yet)
+	//! \param maxMegaBytes memory cap of data queued (at least one output is always allowed)
+	//! \return 0: success. -1: invalid arguments.
+	int start(int nThreads = 2, int maxQueue = 32, double maxMegaBytes = 1024.);
+
+	//! writes bytes that encode() generates to file fileName. bytes is the
+	//! (approximate) memory size of data captured by encode().
+	void writeFile(const std::string & fileName,
+		std::function<void(std::vector<uchar> & out)> encode, size_t bytes = 0);
+	//! writes a text file
+	void writeText(const std::string & fileName, const std::string & text);
+	//! writes an image file (cv::imencode(), by the extension of fileName)
+	void writeImage(const std::string & fileName, const cv::Mat & img,
+		const std::vector<int> & params = std::vector<int>());
+	//! writes a frame to a video writer (which must live longer than the outputs, e.g., until close())
+	void writeVideoFrame(cv::VideoWriter & writer, const cv::Mat & frame);
+	//! runs a function on the writer in the order of outputs (e.g., to open or release a video writer)
+	void run(std::function<void()> func);
+
+	//! waits until all queued outputs are written
+	void flush();
+	//! writes all queued outputs and stops writer threads
+	void close();
+
+	bool running() const { return workers.size() > 0; }
+
+	int nWritten = 0;  // statistics: outputs written
+	int nErrors = 0;   // statistics: outputs which could not be written
+	int nBlocked = 0;  // statistics: outputs which waited for a full queue
+	double blockedTime = 0.0; // statistics: seconds waited for a full queue
+
+protected:
+	struct Job {
+		std::function<void(std::vector<uchar> &)> encode; // (empty for no encoding stage)
+		std::function<bool(const std::vector<uchar> &)> commit;
+		std::vector<uchar> data; // encoded
+		size_t bytes = 0;
+		bool taken = false;      // being encoded (or encoded)
+		bool encoded = false;
+		bool failed = false;     // encoding failed (not committed)
+	};
+	void submit(std::shared_ptr<Job> job);
+	void workerLoop();
+	static bool writeBytes(const std::string & fileName, const std::vector<uchar> & data);
+
+	size_t maxQueue = 32;
+	size_t maxBytes = 0, queuedBytes = 0;
+	std::deque<std::shared_ptr<Job> > jobs; // in the order of submission
+	bool committing = false;                // a thread commits the front jobs
+	bool stopping = false;
+	std::mutex mtx;
+	std::condition_variable cvWork, cvDone;
+	std::vector<std::thread> workers;
+};
+
+//! appends printf-formatted text to s (at most 999 characters per call)
+void appendFormat(std::string & s, const char * fmt, ...);
+
+//! formats the result of a frame (a row of the big table of trackPoints or trackPointsEcc) as
+//! the frame result text file (a header line and a data line), to be written by writeText().
+void frameResultText(const cv::Mat & row, int iFrame, int nPoint, int nfFrm, int nfPnt, std::string & text);
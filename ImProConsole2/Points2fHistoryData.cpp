@@ -3,8 +3,10 @@
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <cmath>
 
 #include "impro_util.h"
+#include "TextNumberParser.h"
 
 #include "ImagePointsPicker.h"
 
@@ -37,38 +39,30 @@ Points2fHistoryData::~Points2fHistoryData()
 int Points2fHistoryData::readFromTxt(string fileTxt)
 {
 	int nStep = -1, nPoint = -1;
-	// open input stream file. Returns -1 if fails to open. 
-	ifstream ifTxt(fileTxt);
-	if (ifTxt.is_open() == false)
+	// open (map) input file. Returns -1 if fails to open. 
+	TextNumberParser txt;
+	if (txt.open(fileTxt) != 0)
 		return -1;
 	// read data size. Returns -1 if size is not positive.
-	nStep = readIntFromIstream(ifTxt);
-	nPoint = readIntFromIstream(ifTxt);
-	if (nStep <= 0 || nPoint <= 0)
+	if (txt.next(nStep) == false || txt.next(nPoint) == false || nStep <= 0 || nPoint <= 0)
 		return -1;
 	// allocate data 
 	this->dat = cv::Mat::zeros(nStep, nPoint, CV_32FC2); 
-	// read data 
+	// read data (NaN if the file ends)
+	float v;
 	for (int iStep = 0; iStep < nStep; iStep++) {
-		for (int iPoint = 0; iPoint < nPoint; iPoint++) {
-			this->dat.at<cv::Point2f>(iStep, iPoint).x = (float)readDoubleFromIstream(ifTxt);
-			this->dat.at<cv::Point2f>(iStep, iPoint).y = (float)readDoubleFromIstream(ifTxt);
-		}
+		float * row = this->dat.ptr<float>(iStep);
+		for (int i = 0; i < 2 * nPoint; i++)
+			row[i] = txt.next(v) ? v : nanf("");
 	}
 	// read rects
+	this->rects.clear();
 	for (int iPoint = 0; iPoint < nPoint; iPoint++) {
-		if (ifTxt.eof()) break;
-		int x = readIntFromIstream(ifTxt);
-		int y = readIntFromIstream(ifTxt);
-		int w = readIntFromIstream(ifTxt);
-		int h = readIntFromIstream(ifTxt);
-		if (ifTxt.eof()) break;
-		this->rects.resize(iPoint + 1);
-		this->rects[iPoint] = cv::Rect(x, y, w, h);
+		int x, y, w, h;
+		if (txt.next(x) == false || txt.next(y) == false || txt.next(w) == false || txt.next(h) == false)
+			break;
+		this->rects.push_back(cv::Rect(x, y, w, h));
 	}
-
-	// close file
-	ifTxt.close();
 	return 0;
 }
 
@@ -151,6 +145,73 @@ int Points2fHistoryData::writeToXml(string fileXml)
 	return 0;
 }
 
+// initial template rects as extra values of the binary container 
+// (x, y, width, height of each point)
+static vector<int> rectsToExtra(const vector<cv::Rect> & rects)
+{
+	vector<int> extra(rects.size() * 4);
+	for (size_t i = 0; i < rects.size(); i++) {
+		extra[i * 4 + 0] = rects[i].x;
+		extra[i * 4 + 1] = rects[i].y;
+		extra[i * 4 + 2] = rects[i].width;
+		extra[i * 4 + 3] = rects[i].height;
+	}
+	return extra;
+}
+
+static void extraToRects(const vector<int> & extra, vector<cv::Rect> & rects)
+{
+	rects.resize(extra.size() / 4);
+	for (size_t i = 0; i < rects.size(); i++)
+		rects[i] = cv::Rect(extra[i * 4 + 0], extra[i * 4 + 1], extra[i * 4 + 2], extra[i * 4 + 3]);
+}
+
+int Points2fHistoryData::readFromBin(string fileBin)
+{
+	// data (CV_32FC2, nStep x nPoint) is a view of the memory-mapped file. 
+	// Extra values are initial template rects (x, y, width, height of each point).
+	vector<int> extra;
+	int ret = IoData::readMatFromBin(fileBin, this->dat, extra, CV_32FC2);
+	if (ret != 0)
+		return ret;
+	extraToRects(extra, this->rects);
+	return 0;
+}
+
+int Points2fHistoryData::writeToBin(string fileBin)
+{
+	return IoData::writeMatToBin(fileBin, this->dat, rectsToExtra(this->rects));
+}
+
+vector<unsigned char> Points2fHistoryData::serialize()
+{
+	// the binary container (the same as writeToBin()) in memory
+	vector<unsigned char> bytes;
+	if (this->dat.empty())
+		return bytes;
+	IoData::writeMatToBytes(this->dat, rectsToExtra(this->rects), bytes);
+	return bytes;
+}
+
+int Points2fHistoryData::deserialize(const vector<unsigned char> & bytes)
+{
+	// (empty bytes for empty data)
+	if (bytes.size() == 0) {
+		this->dat.release();
+		this->rects.clear();
+		return 0;
+	}
+	// xml bytes (from the former serialize()) are read through a temporary file
+	if (IoData::isBinBytes(bytes) == false)
+		return IoData::deserialize(bytes);
+	vector<int> extra;
+	int ret = IoData::readMatFromBytes(bytes, this->dat, extra, CV_32FC2);
+	if (ret != 0)
+		return ret;
+	extraToRects(extra, this->rects);
+	return 0;
+}
+
 int Points2fHistoryData::readThruUserInteraction()
 {
 	return readThruUserInteraction(-1, -1); 
@@ -160,7 +221,7 @@ int Points2fHistoryData::readThruUserInteraction(int nStep, int nPoint)
 {
 	// ask user to select source: 1. txt file, 2. xml file, 3. manual input 
 	int sourceType;
-	cout << "  Select source type: 1.txt file, 2.xml file, 3.manual input, 4.pick by mouse:\n";
+	cout << "  Select source type: 1.txt file, 2.xml file, 3.manual input, 4.pick by mouse, 5.binary file:\n";
 	cout << "     txt format:\n"
 	        "        nStep nPoint x1 y1 x2 y2 x3 y3 ... xnPoint ynPoint\n";
 	cout << "     xml format:\n"
@@ -203,6 +264,21 @@ int Points2fHistoryData::readThruUserInteraction(int nStep, int nPoint)
 			this->dat.rows, this->dat.cols);
 		return readErrNo;
 	}	
+	// Reading from binary file
+	if (sourceType == 5) {
+		string fname;
+		cout << "    Input binary file name (full-path):\n";
+		fname = readStringLineFromCin();
+		int readErrNo = this->readFromBin(fname);
+		if (readErrNo != 0) {
+			cerr << "  Failed to read " << fname << endl;
+			return readErrNo;
+		}
+		printf("  Read data from %s.\n   nStep = %d, nPoint = %d\n",
+			fname.c_str(),
+			this->dat.rows, this->dat.cols);
+		return readErrNo;
+	}
 	// Reading from manual input (keyboard)
 	if (sourceType == 3) {
 		if (nStep <= 0) {
@@ -296,7 +372,7 @@ int Points2fHistoryData::writeThruUserInteraction()
 {
 	// ask user to select destination: 1. txt file, 2. xml file
 	int destType;
-	cout << "  Select output type: 1.txt file, 2.xml file:\n";
+	cout << "  Select output type: 1.txt file, 2.xml file, 3.binary file:\n";
 	destType = readIntFromCin();
 	// Writing to txt file
 	if (destType == 1) {
@@ -328,6 +404,21 @@ int Points2fHistoryData::writeThruUserInteraction()
 			this->dat.rows, this->dat.cols);
 		return writeErrNo;
 	}
+	// Writing to binary file
+	if (destType == 3) {
+		string fname;
+		cout << "    Input binary file name (full-path):\n";
+		fname = readStringLineFromCin();
+		int writeErrNo = this->writeToBin(fname);
+		if (writeErrNo != 0) {
+			cerr << "  Failed to write to " << fname << endl;
+			return writeErrNo;
+		}
+		printf("  Wrote data to %s.\n   nStep = %d, nPoint = %d\n",
+			fname.c_str(),
+			this->dat.rows, this->dat.cols);
+		return writeErrNo;
+	}
 	return 0;
 }
 
@@ -432,6 +523,17 @@ int Points2fHistoryData::nPoint()
 
 int Points2fHistoryData::resize(int nStep, int nPoint)
 {
+	// more steps of the same points (e.g., appendStep()): grows in place, or reserves
+	// 1.5 times the steps if the capacity is not enough (amortized O(nPoint) per step).
+	// Only if the data are not shared (copies of this object share dat, and would
+	// append into the same spare rows), otherwise a new Mat is allocated.
+	if (nPoint == this->dat.cols && nStep > this->dat.rows && this->dat.rows > 0 &&
+		this->dat.type() == CV_32FC2 && this->dat.u != NULL && this->dat.u->refcount == 1) {
+		if (this->dat.isSubmatrix() || this->dat.data + this->dat.step[0] * nStep > this->dat.datalimit)
+			this->dat.reserve(std::max((size_t) nStep, (size_t) this->dat.rows * 3 / 2 + 1));
+		this->dat.resize(nStep, cv::Scalar::all(0));
+		return 0;
+	}
 	// allocate a new Mat
 	cv::Mat tmp = cv::Mat::zeros(nStep, nPoint, CV_32FC2);
 	// copy original data to the new Mat
@@ -607,6 +709,37 @@ int Points2fHistoryData::setRect(int iPoint, cv::Rect rect)
 	return 0;
 }
 
+int Points2fHistoryData::appendStep(const vector<cv::Point2f> & points)
+{
+	int iStep = this->dat.rows;
+	this->resize(iStep + 1, std::max(this->dat.cols, (int) points.size()));
+	for (int iPoint = 0; iPoint < (int) points.size(); iPoint++)
+		this->dat.at<cv::Point2f>(iStep, iPoint) = points[iPoint];
+	if (this->log && this->log->isOpen())
+		return this->log->append(this->dat.row(iStep));
+	return 0;
+}
+
+int Points2fHistoryData::openLog(string fileBin)
+{
+	this->log = std::make_shared<IoDataBinLog>();
+	int ret = this->log->open(fileBin, CV_32FC2);
+	if (ret == 0 && this->dat.rows > 0)
+		ret = this->log->append(this->dat);
+	if (ret != 0)
+		this->log.reset();
+	return ret;
+}
+
+int Points2fHistoryData::closeLog()
+{
+	int ret = 0;
+	if (this->log)
+		ret = this->log->close();
+	this->log.reset();
+	return ret;
+}
+
 int Points2fHistoryData::appendLine(cv::Point2f p0, cv::Point2f p1, int nPointAdd)
 {
 	// reallocate data size
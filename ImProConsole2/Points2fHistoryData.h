@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <opencv2/opencv.hpp>
 
 #include "IoData.h"
@@ -18,6 +19,10 @@ public:
 	virtual int writeToTxt(string fileTxt) ;
 	virtual int readFromXml(string fileXml) ;
 	virtual int writeToXml(string fileXml) ;
+	virtual int readFromBin(string fileBin) ;
+	virtual int writeToBin(string fileBin) ;
+	virtual vector<unsigned char> serialize();
+	virtual int deserialize(const vector<unsigned char> & dat);
 	virtual int readThruUserInteraction(); 
 	virtual int readThruUserInteraction(int nStep, int nPoint = -1) ;
 	virtual int writeThruUserInteraction() ;
@@ -54,6 +59,14 @@ public:
 	int set(const vector<vector<cv::Point2d> > & dataToClone);
 	int setRect(int iPoint, cv::Rect rect); 
 
+	// append-only history: appendStep() adds a step (row) of points at amortized 
+	// O(nPoint) cost. If a log is open (openLog()), the step is also appended to the 
+	// log, a binary file (see readFromBin()) that other processes can read while it 
+	// grows. openLog() writes the existing steps first. Rects are not in the log. 
+	int appendStep(const vector<cv::Point2f> & points);
+	int openLog(string fileBin);
+	int closeLog();
+
 	// append points
 	int appendLine(cv::Point2f p0, cv::Point2f p1, int nPointAdd);
 	int appendQ4(cv::Point2f p0, cv::Point2f p1, cv::Point2f p2, cv::Point2f p3, int nPoint01, int nPoint12);
@@ -62,6 +75,7 @@ protected:
 	cv::Mat dat;  // point iPoint at time step iStep: dat.at<cv::Point2f>(iStep, iPoint)
 	vector<cv::Rect> rects; // if size is not zero, rects[iPoint] is the initial rect (template) range of point iPoint
 	cv::Size imgSize; 
+	std::shared_ptr<IoDataBinLog> log; // (shared by copies of this object)
 };
 
 void testPoints2fHistoryData();
\ No newline at end of file
@@ -3,8 +3,10 @@
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <cmath>
 
 #include "impro_util.h"
+#include "TextNumberParser.h"
 
 using namespace std;
 
@@ -34,27 +36,22 @@ Points3dHistoryData::~Points3dHistoryData()
 int Points3dHistoryData::readFromTxt(string fileTxt)
 {
 	int nStep = -1, nPoint = -1;
-	// open input stream file. Returns -1 if fails to open. 
-	ifstream ifTxt(fileTxt);
-	if (ifTxt.is_open() == false)
+	// open (map) input file. Returns -1 if fails to open. 
+	TextNumberParser txt;
+	if (txt.open(fileTxt) != 0)
 		return -1;
 	// read data size. Returns -1 if size is not positive.
-	nStep = readIntFromIstream(ifTxt);
-	nPoint = readIntFromIstream(ifTxt);
-	if (nStep <= 0 || nPoint <= 0)
+	if (txt.next(nStep) == false || txt.next(nPoint) == false || nStep <= 0 || nPoint <= 0)
 		return -1;
 	// allocate data 
 	this->dat = cv::Mat::zeros(nStep, nPoint, CV_64FC3);
-	// read data 
+	// read data (NaN if the file ends)
+	double v;
 	for (int iStep = 0; iStep < nStep; iStep++) {
-		for (int iPoint = 0; iPoint < nPoint; iPoint++) {
-			this->dat.at<cv::Point3d>(iStep, iPoint).x = (double)readDoubleFromIstream(ifTxt);
-			this->dat.at<cv::Point3d>(iStep, iPoint).y = (double)readDoubleFromIstream(ifTxt);
-			this->dat.at<cv::Point3d>(iStep, iPoint).z = (double)readDoubleFromIstream(ifTxt);
-		}
+		double * row = this->dat.ptr<double>(iStep);
+		for (int i = 0; i < 3 * nPoint; i++)
+			row[i] = txt.next(v) ? v : nan("");
 	}
-	// close file
-	ifTxt.close();
 	return 0;
 }
 
@@ -118,6 +115,42 @@ int Points3dHistoryData::writeToXml(string fileXml)
 	return 0;
 }
 
+int Points3dHistoryData::readFromBin(string fileBin)
+{
+	// data (CV_64FC3, nStep x nPoint) is a view of the memory-mapped file
+	vector<int> extra;
+	return IoData::readMatFromBin(fileBin, this->dat, extra, CV_64FC3);
+}
+
+int Points3dHistoryData::writeToBin(string fileBin)
+{
+	return IoData::writeMatToBin(fileBin, this->dat);
+}
+
+vector<unsigned char> Points3dHistoryData::serialize()
+{
+	// the binary container (the same as writeToBin()) in memory
+	vector<unsigned char> bytes;
+	if (this->dat.empty())
+		return bytes;
+	IoData::writeMatToBytes(this->dat, vector<int>(), bytes);
+	return bytes;
+}
+
+int Points3dHistoryData::deserialize(const vector<unsigned char> & bytes)
+{
+	// (empty bytes for empty data)
+	if (bytes.size() == 0) {
+		this->dat.release();
+		return 0;
+	}
+	// xml bytes (from the former serialize()) are read through a temporary file
+	if (IoData::isBinBytes(bytes) == false)
+		return IoData::deserialize(bytes);
+	vector<int> extra;
+	return IoData::readMatFromBytes(bytes, this->dat, extra, CV_64FC3);
+}
+
 int Points3dHistoryData::readThruUserInteraction()
 {
 	return this->readThruUserInteraction(-1, -1); 
@@ -126,7 +159,7 @@ int Points3dHistoryData::readThruUserInteraction(int nStep, int nPoint)
 {
 	// ask user to select source: 1. txt file, 2. xml file, 3. manual input 
 	int sourceType;
-	cout << "  Select source type: 1.txt file, 2.xml file, 3.manual input:\n";
+	cout << "  Select source type: 1.txt file, 2.xml file, 3.manual input, 4.binary file:\n";
 	cout << "     txt format:\n"
 		"        nStep nPoint x1 y1 z1 x2 y2 z2 x3 y3 z3 ... xnPoint ynPoint\n";
 	cout << "     xml format:\n"
@@ -169,6 +202,21 @@ int Points3dHistoryData::readThruUserInteraction(int nStep, int nPoint)
 			this->dat.rows, this->dat.cols);
 		return readErrNo;
 	}
+	// Reading from binary file
+	if (sourceType == 4) {
+		string fname;
+		cout << "    Input binary file name (full-path):\n";
+		fname = readStringLineFromCin();
+		int readErrNo = this->readFromBin(fname);
+		if (readErrNo != 0) {
+			cerr << "  Failed to read " << fname << endl;
+			return readErrNo;
+		}
+		printf("  Read data from %s.\n   nStep = %d, nPoint = %d\n",
+			fname.c_str(),
+			this->dat.rows, this->dat.cols);
+		return readErrNo;
+	}
 	// Reading from manual input (keyboard)
 	if (sourceType == 3) {
 		if (nStep <= 0) {
@@ -210,7 +258,7 @@ int Points3dHistoryData::writeThruUserInteraction()
 {
 	// ask user to select destination: 1. txt file, 2. xml file
 	int destType;
-	cout << "  Select output type: 1.txt file, 2.xml file:\n";
+	cout << "  Select output type: 1.txt file, 2.xml file, 3.binary file:\n";
 	destType = readIntFromCin();
 	// Writing to txt file
 	if (destType == 1) {
@@ -242,6 +290,21 @@ int Points3dHistoryData::writeThruUserInteraction()
 			this->dat.rows, this->dat.cols);
 		return writeErrNo;
 	}
+	// Writing to binary file
+	if (destType == 3) {
+		string fname;
+		cout << "    Input binary file name (full-path):\n";
+		fname = readStringLineFromCin();
+		int writeErrNo = this->writeToBin(fname);
+		if (writeErrNo != 0) {
+			cerr << "  Failed to write to " << fname << endl;
+			return writeErrNo;
+		}
+		printf("  Wrote data to %s.\n   nStep = %d, nPoint = %d\n",
+			fname.c_str(),
+			this->dat.rows, this->dat.cols);
+		return writeErrNo;
+	}
 	return 0;
 }
 
@@ -358,6 +421,17 @@ int Points3dHistoryData::nPoint()
 
 int Points3dHistoryData::resize(int nStep, int nPoint)
 {
+	// more steps of the same points (e.g., appendStep()): grows in place, or reserves
+	// 1.5 times the steps if the capacity is not enough (amortized O(nPoint) per step).
+	// Only if the data are not shared (copies of this object share dat, and would
+	// append into the same spare rows), otherwise a new Mat is allocated.
+	if (nPoint == this->dat.cols && nStep > this->dat.rows && this->dat.rows > 0 &&
+		this->dat.type() == CV_64FC3 && this->dat.u != NULL && this->dat.u->refcount == 1) {
+		if (this->dat.isSubmatrix() || this->dat.data + this->dat.step[0] * nStep > this->dat.datalimit)
+			this->dat.reserve(std::max((size_t) nStep, (size_t) this->dat.rows * 3 / 2 + 1));
+		this->dat.resize(nStep, cv::Scalar::all(0));
+		return 0;
+	}
 	// allocate a new Mat
 	cv::Mat tmp = cv::Mat::zeros(nStep, nPoint, CV_64FC3);
 	// copy original data to the new Mat
@@ -519,6 +593,37 @@ int Points3dHistoryData::set(const vector<vector<cv::Point3f> > & theDat)
 	return 0;
 }
 
+int Points3dHistoryData::appendStep(const vector<cv::Point3d> & points)
+{
+	int iStep = this->dat.rows;
+	this->resize(iStep + 1, std::max(this->dat.cols, (int) points.size()));
+	for (int iPoint = 0; iPoint < (int) points.size(); iPoint++)
+		this->dat.at<cv::Point3d>(iStep, iPoint) = points[iPoint];
+	if (this->log && this->log->isOpen())
+		return this->log->append(this->dat.row(iStep));
+	return 0;
+}
+
+int Points3dHistoryData::openLog(string fileBin)
+{
+	this->log = std::make_shared<IoDataBinLog>();
+	int ret = this->log->open(fileBin, CV_64FC3);
+	if (ret == 0 && this->dat.rows > 0)
+		ret = this->log->append(this->dat);
+	if (ret != 0)
+		this->log.reset();
+	return ret;
+}
+
+int Points3dHistoryData::closeLog()
+{
+	int ret = 0;
+	if (this->log)
+		ret = this->log->close();
+	this->log.reset();
+	return ret;
+}
+
 int Points3dHistoryData::appendLine(cv::Point3d p0, cv::Point3d p1, int nPointAdd)
 {
 	// reallocate data size
@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <opencv2/opencv.hpp>
 
 #include "IoData.h"
@@ -18,6 +19,10 @@ public:
 	virtual int writeToTxt(string fileTxt);
 	virtual int readFromXml(string fileXml);
 	virtual int writeToXml(string fileXml);
+	virtual int readFromBin(string fileBin);
+	virtual int writeToBin(string fileBin);
+	virtual vector<unsigned char> serialize();
+	virtual int deserialize(const vector<unsigned char> & dat);
 	virtual int readThruUserInteraction();
 	virtual int readThruUserInteraction(int nStep, int nPoint = -1);
 	virtual int writeThruUserInteraction();
@@ -51,12 +56,18 @@ public:
 	int set(const vector<vector<cv::Point3d> > & dataToClone);
 	int set(const vector<vector<cv::Point3f> > & dataToClone); // will convert to cv::Point3d
 
+	// append-only history (see Points2fHistoryData::appendStep())
+	int appendStep(const vector<cv::Point3d> & points);
+	int openLog(string fileBin);
+	int closeLog();
+
 	// append points
 	int appendLine(cv::Point3d p0, cv::Point3d p1, int nPointAdd);
 	int appendQ4(cv::Point3d p0, cv::Point3d p1, cv::Point3d p2, cv::Point3d p3, int nPoint01, int nPoint12);
 
 protected:
 	cv::Mat dat;
+	std::shared_ptr<IoDataBinLog> log; // (shared by copies of this object)
 };
 
 void testPoints3dHistoryData(); 
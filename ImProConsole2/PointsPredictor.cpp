@@ -0,0 +1,108 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+#include "PointsPredictor.h"
+
+using namespace std;
+
+int PointsPredictor::init(const vector<cv::Point2f> & points, int order,
+	float sigmaMeas, float sigmaProc, float sigmaVel0)
+{
+	if (order < 1 || order > 2 || sigmaMeas <= 0.f || sigmaProc < 0.f || sigmaVel0 < 0.f)
+		return -1;
+	// discrete white-noise model: Q = q * g * g^T, with g the response of the state
+	// to a unit step of the highest derivative over one frame
+	cv::Matx31d g;
+	if (order == 1) {
+		F = cv::Matx33d(1, 1, 0,
+			0, 1, 0,
+			0, 0, 0);
+		g = cv::Matx31d(0.5, 1, 0);
+	}
+	else {
+		F = cv::Matx33d(1, 1, 0.5,
+			0, 1, 1,
+			0, 0, 1);
+		g = cv::Matx31d(1. / 6., 0.5, 1);
+	}
+	Q = (double) sigmaProc * sigmaProc * (g * g.t());
+	R = (double) sigmaMeas * sigmaMeas;
+
+	size_t n = points.size();
+	cv::Matx33d cov0 = cv::Matx33d::zeros();
+	cov0(0, 0) = R;
+	cov0(1, 1) = (double) sigmaVel0 * sigmaVel0;
+	if (order == 2)
+		cov0(2, 2) = (double) sigmaVel0 * sigmaVel0; // acceleration is as unknown as velocity
+	state.assign(n, cv::Matx32d::zeros());
+	cov.assign(n, cov0);
+	innov2.assign(n, cv::Point2d(R, R));
+	sigmaPred.assign(n, cv::Point2f(sigmaVel0, sigmaVel0));
+	for (size_t i = 0; i < n; i++) {
+		state[i](0, 0) = points[i].x;
+		state[i](0, 1) = points[i].y;
+	}
+	return 0;
+}
+
+void PointsPredictor::predict(vector<cv::Point2f> & predicted, vector<cv::Point2f> & sigmas)
+{
+	int n = this->size();
+	predicted.resize(n);
+	sigmas.resize(n);
+	for (int i = 0; i < n; i++) {
+		state[i] = F * state[i];
+		cov[i] = F * cov[i] * F.t() + Q;
+		// expected innovation variance, or the observed one if it is larger
+		double s = cov[i](0, 0) + R;
+		predicted[i] = cv::Point2f((float) state[i](0, 0), (float) state[i](0, 1));
+		sigmaPred[i] = cv::Point2f((float) sqrt(std::max(s, innov2[i].x)),
+			(float) sqrt(std::max(s, innov2[i].y)));
+		sigmas[i] = sigmaPred[i];
+	}
+}
+
+void PointsPredictor::correct(const vector<cv::Point2f> & measured, const vector<uchar> & status)
+{
+	int n = std::min(this->size(), (int) measured.size());
+	for (int i = 0; i < n; i++) {
+		if (status.size() > (size_t) i && status[i] == 0)
+			continue;
+		// gain (H = [1 0 0])
+		double s = cov[i](0, 0) + R;
+		cv::Matx31d k(cov[i](0, 0) / s, cov[i](1, 0) / s, cov[i](2, 0) / s);
+		double ex = measured[i].x - state[i](0, 0);
+		double ey = measured[i].y - state[i](0, 1);
+		for (int r = 0; r < 3; r++) {
+			state[i](r, 0) += k(r, 0) * ex;
+			state[i](r, 1) += k(r, 0) * ey;
+		}
+		// P <- (I - K H) P
+		cv::Matx33d p = cov[i];
+		for (int r = 0; r < 3; r++)
+			for (int c = 0; c < 3; c++)
+				cov[i](r, c) = p(r, c) - k(r, 0) * p(0, c);
+		innov2[i].x += innovAlpha * (ex * ex - innov2[i].x);
+		innov2[i].y += innovAlpha * (ey * ey - innov2[i].y);
+	}
+}
+
+cv::Point2f PointsPredictor::searchRange(int i, float nSigma, float minRange, float maxRange) const
+{
+	cv::Point2f r(nSigma * sigmaPred[i].x, nSigma * sigmaPred[i].y);
+	r.x = std::min(std::max(r.x, minRange), maxRange);
+	r.y = std::min(std::max(r.y, minRange), maxRange);
+	return r;
+}
+
+int PointsPredictor::lkMaxLevel(cv::Point2f range, cv::Size winSize, int maxLevelCap)
+{
+	float reach = 0.5f * std::min(winSize.width, winSize.height);
+	float need = std::max(range.x, range.y);
+	int level = 0;
+	while (level < maxLevelCap && reach * (1 << level) < need)
+		level++;
+	return level;
+}
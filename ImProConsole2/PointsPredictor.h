@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+//! PointsPredictor predicts image positions of points frame by frame (Kalman filter per point)
+/*!
+\details Each point has an independent Kalman filter along x and y, with a constant-velocity
+(order 1) or constant-acceleration (order 2) model in pixels and frames (dt = 1). predict()
+gives the predicted position of every point in the coming frame and its uncertainty (standard
+deviation, in pixels), and correct() feeds the tracked positions back.
+The Kalman covariance itself does not depend on the measured positions, so the uncertainty is
+also bounded below by the running (exponentially weighted) rms of the innovations of each point
+(measured minus predicted). Points that move fast or irregularly get a large uncertainty, and
+points that are quiet or move steadily get a small one. Trackers use the uncertainty to size
+search ranges per point (searchRange(), lkMaxLevel()).
+Usage:
+    PointsPredictor pred;
+    pred.init(points);                        // positions in the first frame
+    for each frame:
+        pred.predict(points, sigmas);         // points: initial guesses for tracking
+        track(points, status);                // e.g., search range: pred.searchRange(i)
+        pred.correct(points, status);         // status 0: the point is not updated
+*/
+class PointsPredictor
+{
+public:
+	//! initializes the filters at the given positions (velocities and accelerations are zero).
+	//! \param order 1: constant velocity. 2: constant acceleration.
+	//! \param sigmaMeas standard deviation of tracking (measurement) error (pixels)
+	//! \param sigmaProc standard deviation of the process noise (pixels per frame^2 for order 1, pixels per frame^3 for order 2)
+	//! \param sigmaVel0 standard deviation of the unknown initial velocity (pixels per frame)
+	//! \return 0:success. -1:invalid arguments.
+	int init(const std::vector<cv::Point2f> & points, int order = 2,
+		float sigmaMeas = 0.5f, float sigmaProc = 1.0f, float sigmaVel0 = 10.0f);
+
+	//! advances the filters by one frame and returns predicted positions and their uncertainties
+	//! (standard deviations along x and y, in pixels).
+	void predict(std::vector<cv::Point2f> & predicted, std::vector<cv::Point2f> & sigmas);
+
+	//! updates the filters with the tracked positions of the frame predicted by predict().
+	//! Points with status[i] == 0 are not updated (their prediction is kept). An empty status
+	//! means all points are updated.
+	void correct(const std::vector<cv::Point2f> & measured,
+		const std::vector<uchar> & status = std::vector<uchar>());
+
+	//! returns the search range (half width along x and y, pixels) of point i, that is
+	//! nSigma times the uncertainty of the last prediction, bounded by [minRange, maxRange].
+	cv::Point2f searchRange(int i, float nSigma = 3.0f, float minRange = 1.0f, float maxRange = 1e6f) const;
+
+	//! returns the smallest maxLevel of cv::calcOpticalFlowPyrLK() that covers the
+	//! search range (half of winSize times 2^level >= range), bounded by maxLevelCap.
+	static int lkMaxLevel(cv::Point2f range, cv::Size winSize, int maxLevelCap);
+
+	int size() const { return (int) state.size(); }
+	bool empty() const { return state.size() == 0; }
+
+protected:
+	// state of a point: (position, velocity, acceleration) along x (col 0) and y (col 1)
+	std::vector<cv::Matx32d> state;
+	// covariance of state (the same for x and y as both use the same model)
+	std::vector<cv::Matx33d> cov;
+	// exponentially weighted mean of squared innovations along x and y
+	std::vector<cv::Point2d> innov2;
+	// uncertainties (std. dev.) of the last prediction
+	std::vector<cv::Point2f> sigmaPred;
+	cv::Matx33d F;   // state transition
+	cv::Matx33d Q;   // process noise
+	double R = 0.25; // measurement noise (variance)
+	double innovAlpha = 0.2; // weight of the newest innovation
+};
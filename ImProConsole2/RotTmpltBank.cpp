@@ -0,0 +1,147 @@
+#include <vector>
+#include <map>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+
+#include "RotTmpltBank.h"
+
+using namespace std;
+
+RotTmpltBank::RotTmpltBank(size_t _maxBytes, int _maxSources)
+{
+	this->maxBytes = _maxBytes;
+	this->maxSources = std::max(_maxSources, 1);
+}
+
+bool RotTmpltBank::Key::operator<(const Key & b) const
+{
+	if (angle != b.angle) return angle < b.angle;
+	if (cx != b.cx) return cx < b.cx;
+	if (cy != b.cy) return cy < b.cy;
+	if (cw != b.cw) return cw < b.cw;
+	if (ch != b.ch) return ch < b.ch;
+	if (sw != b.sw) return sw < b.sw;
+	return sh < b.sh;
+}
+
+RotTmpltBank::Key RotTmpltBank::makeKey(double thdeg, cv::Rect crop, cv::Size scaledSize)
+{
+	Key k;
+	k.angle = (long long) std::llround(thdeg * 1e6);
+	k.cx = crop.x; k.cy = crop.y; k.cw = crop.width; k.ch = crop.height;
+	k.sw = scaledSize.width; k.sh = scaledSize.height;
+	return k;
+}
+
+size_t RotTmpltBank::entryBytes(const Entry & e)
+{
+	size_t b = e.tmplt.total() * e.tmplt.elemSize();
+	for (int c = 0; c < (int)e.spec.spectra.size(); c++)
+		b += e.spec.spectra[c].total() * e.spec.spectra[c].elemSize();
+	return b + e.spec.tmplt.total() * e.spec.tmplt.elemSize();
+}
+
+bool RotTmpltBank::select(const cv::Mat & squareTmplt, cv::Point2f rotationCenter)
+{
+	useCount++;
+	for (int i = 0; i < (int)sources.size(); i++) {
+		const Source & s = sources[i];
+		if (s.center == rotationCenter &&
+			s.squareTmplt.size() == squareTmplt.size() &&
+			s.squareTmplt.type() == squareTmplt.type() &&
+			cv::norm(s.squareTmplt, squareTmplt, cv::NORM_INF) == 0.0) {
+			iSelected = i;
+			sources[i].lastUse = useCount;
+			return true;
+		}
+	}
+	// new source template (e.g., template updated). Remove least recently used one if full.
+	if ((int)sources.size() >= maxSources) {
+		int iOldest = 0;
+		for (int i = 1; i < (int)sources.size(); i++)
+			if (sources[i].lastUse < sources[iOldest].lastUse) iOldest = i;
+		for (auto & e : sources[iOldest].entries)
+			nBytes -= entryBytes(e.second);
+		sources.erase(sources.begin() + iOldest);
+	}
+	sources.emplace_back();
+	squareTmplt.copyTo(sources.back().squareTmplt);
+	sources.back().center = rotationCenter;
+	sources.back().lastUse = useCount;
+	iSelected = (int)sources.size() - 1;
+	return false;
+}
+
+bool RotTmpltBank::find(double thdeg, cv::Rect crop, cv::Size scaledSize, cv::Mat & scaledTmplt)
+{
+	if (iSelected < 0) return false;
+	auto & entries = sources[iSelected].entries;
+	auto it = entries.find(makeKey(thdeg, crop, scaledSize));
+	if (it == entries.end()) {
+		nMiss++;
+		return false;
+	}
+	nHit++;
+	it->second.lastUse = ++useCount;
+	scaledTmplt = it->second.tmplt;
+	return true;
+}
+
+void RotTmpltBank::store(double thdeg, cv::Rect crop, cv::Size scaledSize, const cv::Mat & scaledTmplt)
+{
+	if (iSelected < 0) return;
+	Entry & e = sources[iSelected].entries[makeKey(thdeg, crop, scaledSize)];
+	nBytes -= entryBytes(e);
+	scaledTmplt.copyTo(e.tmplt);
+	e.spec = MatchTemplateFftTmplt();
+	e.lastUse = ++useCount;
+	nBytes += entryBytes(e);
+	trim();
+}
+
+const MatchTemplateFftTmplt & RotTmpltBank::spectrum(double thdeg, cv::Rect crop, cv::Size scaledSize,
+	cv::Size dftSize, int method)
+{
+	static const MatchTemplateFftTmplt emptySpectrum;
+	if (iSelected < 0) return emptySpectrum;
+	auto & entries = sources[iSelected].entries;
+	auto it = entries.find(makeKey(thdeg, crop, scaledSize));
+	if (it == entries.end()) return emptySpectrum;
+	Entry & e = it->second;
+	e.lastUse = ++useCount;
+	if (!e.spec.isFor(e.tmplt, dftSize, method)) {
+		nBytes -= entryBytes(e);
+		e.spec.create(e.tmplt, dftSize, method);
+		nBytes += entryBytes(e);
+	}
+	e.spec.method = method;
+	trim();
+	return e.spec;
+}
+
+void RotTmpltBank::clear()
+{
+	sources.clear();
+	iSelected = -1;
+	nBytes = 0;
+}
+
+// removes least recently used entries until the bank is within maxBytes.
+// The most recently used entry is always kept.
+void RotTmpltBank::trim()
+{
+	while (nBytes > maxBytes) {
+		int iSrc = -1;
+		std::map<Key, Entry>::iterator itOldest;
+		for (int i = 0; i < (int)sources.size(); i++)
+			for (auto it = sources[i].entries.begin(); it != sources[i].entries.end(); it++)
+				if (iSrc < 0 || it->second.lastUse < itOldest->second.lastUse) {
+					iSrc = i;
+					itOldest = it;
+				}
+		if (iSrc < 0 || itOldest->second.lastUse == useCount)
+			break;
+		nBytes -= entryBytes(itOldest->second);
+		sources[iSrc].entries.erase(itOldest);
+	}
+}
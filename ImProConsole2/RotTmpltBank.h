@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <opencv2/opencv.hpp>
+
+#include "matchTemplateFft.h"
+
+//! RotTmpltBank keeps rotated, cropped and scaled templates of a tracking point across frames.
+/*!
+\details matchTemplateWithRot() generates a rotated (cv::warpAffine), cropped and scaled
+(cv::resize) template for every rotation angle. As long as the template does not change
+(e.g., until the template is updated every trackUpdateFreq frames), these templates are
+the same frame after frame. A bank stores them, keyed by rotation angle, crop rectangle
+and scaled size, so that they are built once per template update. If FFT correlation is
+used, the template spectra are stored with them.
+A bank belongs to one tracking point (a bank may hold a few source templates, e.g., the
+templates before and after an update). A bank must not be shared among threads.
+Usage:
+    vector<RotTmpltBank> banks;   // kept between frames, one for each point
+    calcTMatchRotPyr(..., &banks);
+*/
+class RotTmpltBank
+{
+public:
+	RotTmpltBank(size_t maxBytes = 32 * 1024 * 1024, int maxSources = 2);
+
+	//! selects the source (square) template and the rotation center.
+	//! If the template is not in the bank (e.g., template is updated), it is added
+	//! and the least recently used source beyond maxSources is removed.
+	//! \return true if the template was already in the bank
+	bool select(const cv::Mat & squareTmplt, cv::Point2f rotationCenter);
+
+	//! finds the rotated, cropped and scaled template of the selected source.
+	//! \return true if found
+	bool find(double thdeg, cv::Rect crop, cv::Size scaledSize, cv::Mat & scaledTmplt);
+
+	//! stores the rotated, cropped and scaled template of the selected source
+	void store(double thdeg, cv::Rect crop, cv::Size scaledSize, const cv::Mat & scaledTmplt);
+
+	//! returns the spectrum of a stored template (creating it if necessary) for FFT correlation
+	const MatchTemplateFftTmplt & spectrum(double thdeg, cv::Rect crop, cv::Size scaledSize,
+		cv::Size dftSize, int method);
+
+	void clear();
+	size_t bytes() const { return nBytes; }
+
+	size_t maxBytes;   // memory limit of stored templates and spectra
+	int maxSources;    // maximum number of source templates
+	int nHit = 0, nMiss = 0; // statistics
+
+protected:
+	struct Key {
+		long long angle;   // rotation angle in 1e-6 degree
+		int cx, cy, cw, ch; // crop rectangle
+		int sw, sh;        // scaled size
+		bool operator<(const Key & b) const;
+	};
+	struct Entry {
+		cv::Mat tmplt;                 // rotated, cropped and scaled template
+		MatchTemplateFftTmplt spec;    // spectrum of tmplt (empty if FFT is not used)
+		unsigned long long lastUse = 0;
+	};
+	struct Source {
+		cv::Mat squareTmplt;           // copy of source (square) template
+		cv::Point2f center;            // rotation center
+		std::map<Key, Entry> entries;
+		unsigned long long lastUse = 0;
+	};
+	static Key makeKey(double thdeg, cv::Rect crop, cv::Size scaledSize);
+	static size_t entryBytes(const Entry & e);
+	void trim();
+
+	std::vector<Source> sources;
+	int iSelected = -1;
+	size_t nBytes = 0;
+	unsigned long long useCount = 0;
+};
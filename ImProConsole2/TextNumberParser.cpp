@@ -0,0 +1,307 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <charconv>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "TextNumberParser.h"
+
+using namespace std;
+
+// separators of tokens of next()
+static inline bool isTokenSeparator(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == '\v' || c == '\f';
+}
+
+// blanks around csv values
+static inline bool isCsvBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+// parses a real value at the beginning of [b, e) (as std::stod, also with a leading '+').
+// Returns the end of the value, or NULL if there is no value.
+static const char * parseDouble(const char * b, const char * e, double & value)
+{
+	if (b < e && *b == '+' && b + 1 < e && b[1] != '-') b++;
+#if defined(__cpp_lib_to_chars)
+	auto r = std::from_chars(b, e, value);
+	return r.ec == std::errc() ? r.ptr : NULL;
+#else
+	// (no floating-point from_chars) strtod of a null-terminated copy
+	char buf[64];
+	size_t n = std::min((size_t) (e - b), sizeof(buf) - 1);
+	memcpy(buf, b, n);
+	buf[n] = '\0';
+	char * stop = NULL;
+	value = strtod(buf, &stop);
+	return stop != buf ? b + (stop - buf) : NULL;
+#endif
+}
+
+// parses an integer at the beginning of [b, e) (as std::stoi). Returns the end of it, or NULL.
+static const char * parseInt(const char * b, const char * e, int & value)
+{
+	if (b < e && *b == '+' && b + 1 < e && b[1] != '-') b++;
+	auto r = std::from_chars(b, e, value);
+	return r.ec == std::errc() ? r.ptr : NULL;
+}
+
+template <class T>
+static void storeRow(unsigned char * row, const double * values, int n)
+{
+	T * r = (T *) row;
+	for (int i = 0; i < n; i++)
+		r[i] = (T) values[i];
+}
+
+TextNumberParser::TextNumberParser()
+{
+}
+
+TextNumberParser::~TextNumberParser()
+{
+	this->close();
+}
+
+int TextNumberParser::open(const string & fileName, char _commentChar)
+{
+	this->close();
+	this->commentChar = _commentChar;
+#if defined(_WIN32)
+	HANDLE hFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER fsize;
+		if (GetFileSizeEx(hFile, &fsize) && fsize.QuadPart > 0) {
+			HANDLE hMap = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (hMap != NULL) {
+				this->mapped = MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+				if (this->mapped != NULL) this->mappedBytes = (size_t) fsize.QuadPart;
+				CloseHandle(hMap); // (the view keeps the mapping)
+			}
+		}
+		CloseHandle(hFile);
+	}
+#else
+	int fd = ::open(fileName.c_str(), O_RDONLY);
+	if (fd >= 0) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void * p = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				madvise(p, (size_t) st.st_size, MADV_SEQUENTIAL);
+				this->mapped = p;
+				this->mappedBytes = (size_t) st.st_size;
+			}
+		}
+		::close(fd); // (the mapping stays)
+	}
+#endif
+	if (this->mapped != NULL) {
+		this->begin = (const char *) this->mapped;
+		this->end = this->begin + this->mappedBytes;
+	}
+	else {
+		// an empty file, or a file that cannot be mapped
+		ifstream f(fileName, ios::binary);
+		if (f.is_open() == false) {
+			cerr << "TextNumberParser::open(): Cannot open " << fileName << ".\n";
+			return -1;
+		}
+		this->buffer.assign(istreambuf_iterator<char>(f), istreambuf_iterator<char>());
+		this->begin = this->buffer.data();
+		this->end = this->begin + this->buffer.size();
+	}
+	this->pos = this->begin;
+	return 0;
+}
+
+void TextNumberParser::close()
+{
+	if (this->mapped != NULL) {
+#if defined(_WIN32)
+		UnmapViewOfFile(this->mapped);
+#else
+		munmap(this->mapped, this->mappedBytes);
+#endif
+	}
+	this->mapped = NULL;
+	this->mappedBytes = 0;
+	this->buffer.clear();
+	this->begin = this->end = this->pos = NULL;
+}
+
+bool TextNumberParser::nextToken(const char * & tokBegin, const char * & tokEnd)
+{
+	const char * p = this->pos;
+	while (true) {
+		while (p < this->end && isTokenSeparator(*p)) p++;
+		if (p >= this->end) {
+			this->pos = this->end;
+			return false;
+		}
+		if (*p == this->commentChar) {
+			// skip the rest of this line
+			const char * nl = (const char *) memchr(p, '\n', this->end - p);
+			p = nl != NULL ? nl + 1 : this->end;
+			continue;
+		}
+		tokBegin = p;
+		while (p < this->end && !isTokenSeparator(*p)) p++;
+		tokEnd = p;
+		this->pos = p;
+		return true;
+	}
+}
+
+bool TextNumberParser::next(double & value)
+{
+	const char * b, * e;
+	while (this->nextToken(b, e)) {
+		if (parseDouble(b, e, value) != NULL)
+			return true;
+		printf("# Warning: Cannot parse %.*s. Skipped.\n", (int) std::min(e - b, (ptrdiff_t) 64), b);
+	}
+	return false;
+}
+
+bool TextNumberParser::next(float & value)
+{
+	double v;
+	if (this->next(v) == false)
+		return false;
+	value = (float) v;
+	return true;
+}
+
+bool TextNumberParser::next(int & value)
+{
+	const char * b, * e;
+	while (this->nextToken(b, e)) {
+		if (parseInt(b, e, value) != NULL)
+			return true;
+		printf("# Warning: Cannot parse %.*s. Skipped.\n", (int) std::min(e - b, (ptrdiff_t) 64), b);
+	}
+	return false;
+}
+
+// parses the csv line from p (and moves p to the next line). Values (at most nMax) are
+// written to values. Returns the number of values of the line.
+int TextNumberParser::csvLine(const char * & p, double * values, int nMax) const
+{
+	int n = 0;
+	while (p < this->end) {
+		const char * cell = p;
+		while (p < this->end && *p != ',' && *p != '\n') p++;
+		const char * cellEnd = p;
+		bool endOfLine = p >= this->end || *p == '\n';
+		if (p < this->end) p++;
+		while (cell < cellEnd && isCsvBlank(*cell)) cell++;
+		if (cell < cellEnd && *cell == this->commentChar)
+			break; // a comment: skips the rest of the line
+		if (cell < cellEnd) {
+			double v;
+			if (parseDouble(cell, cellEnd, v) != NULL) {
+				if (n < nMax) values[n] = v;
+				n++;
+			}
+			else {
+				const char * last = cellEnd;
+				while (last > cell && isCsvBlank(last[-1])) last--;
+				cerr << "# Exception: " << string(cell, last) << endl;
+			}
+			// if there is a comment after the value, skips the rest of the line
+			if (memchr(cell, this->commentChar, cellEnd - cell) != NULL)
+				break;
+		}
+		if (endOfLine)
+			return n;
+	}
+	// (skipped to the end of the line)
+	if (p < this->end && p[-1] != '\n') {
+		const char * nl = (const char *) memchr(p, '\n', this->end - p);
+		p = nl != NULL ? nl + 1 : this->end;
+	}
+	return n;
+}
+
+// number of rows (at most; lines with something other than a comment) and columns (of the
+// first row) of the csv
+void TextNumberParser::csvShape(int & nRows, int & nCols) const
+{
+	nRows = 0;
+	nCols = 0;
+	const char * p = this->begin;
+	while (p < this->end) {
+		const char * q = p;
+		while (q < this->end && isCsvBlank(*q)) q++;
+		bool content = q < this->end && *q != '\n' && *q != this->commentChar;
+		if (content && nCols == 0) {
+			// the first row (parsed, to count its values)
+			const char * line = p;
+			nCols = this->csvLine(line, NULL, 0);
+			if (nCols > 0) nRows++;
+			p = line;
+			continue;
+		}
+		if (content) nRows++;
+		const char * nl = (const char *) memchr(q, '\n', this->end - q);
+		p = nl != NULL ? nl + 1 : this->end;
+	}
+}
+
+int TextNumberParser::readCsv(cv::Mat & mat, int type)
+{
+	int depth = CV_MAT_DEPTH(type);
+	if (depth != CV_8U && depth != CV_8S && depth != CV_16U && depth != CV_16S &&
+		depth != CV_32S && depth != CV_32F && depth != CV_64F) {
+		cerr << "TextNumberParser::readCsv(): Unsupported type " << type << ".\n";
+		return -1;
+	}
+	int nRowsMax, nCols;
+	this->csvShape(nRowsMax, nCols);
+	if (nRowsMax <= 0 || nCols <= 0) {
+		mat.release();
+		return 0;
+	}
+	mat = cv::Mat::zeros(nRowsMax, nCols, depth);
+	vector<double> values(nCols);
+	int nRows = 0;
+	const char * p = this->begin;
+	while (p < this->end && nRows < nRowsMax) {
+		int n = std::min(this->csvLine(p, values.data(), nCols), nCols);
+		if (n <= 0) continue;
+		unsigned char * row = mat.ptr(nRows++);
+		switch (depth) {
+		case CV_8U:  storeRow<unsigned char>(row, values.data(), n); break;
+		case CV_8S:  storeRow<signed char>(row, values.data(), n); break;
+		case CV_16U: storeRow<unsigned short>(row, values.data(), n); break;
+		case CV_16S: storeRow<short>(row, values.data(), n); break;
+		case CV_32S: storeRow<int>(row, values.data(), n); break;
+		case CV_32F: storeRow<float>(row, values.data(), n); break;
+		case CV_64F: storeRow<double>(row, values.data(), n); break;
+		}
+	}
+	if (nRows < nRowsMax)
+		mat = nRows > 0 ? mat.rowRange(0, nRows) : cv::Mat();
+	return nRows;
+}
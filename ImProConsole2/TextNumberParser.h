@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+//! TextNumberParser reads numbers of a text file (csv, or values separated by spaces, tabs,
+//! commas and new lines) through a read-only memory mapping of the whole file, and parses
+//! them in place by std::from_chars (no getline, stringstream or exceptions per value).
+/*!
+\details Comments start from commentChar ('#' by default):
+- next(): a token (text between separators) starting with commentChar skips the rest of the
+  line, as readIntFromIstream() and readDoubleFromIstream() do. A token that cannot be parsed
+  is skipped with a warning.
+- readCsv(): rows are lines, and cells are separated by commas. A cell starting with
+  commentChar skips the rest of the line. A cell with commentChar after its value adds the
+  value and skips the rest of the line. Spaces and tabs around values are ignored, and lines
+  without values are not rows. The number of columns is that of the first row (missing values
+  of other rows are zeros, extra values are ignored). This is the former readMatFromCsvFile().
+The shape of a csv is counted before it is parsed, so values are parsed directly into the mat.
+If the file cannot be mapped, it is read into memory.
+    TextNumberParser txt;
+    if (txt.open("points.txt") != 0) return -1;
+    int nStep, nPoint;
+    double x;
+    txt.next(nStep); txt.next(nPoint);
+    while (txt.next(x)) ...
+    cv::Mat mat;
+    TextNumberParser csv;
+    if (csv.open("table.csv") == 0) csv.readCsv(mat, CV_64F);
+*/
+class TextNumberParser
+{
+public:
+	TextNumberParser();
+	~TextNumberParser();
+	TextNumberParser(const TextNumberParser &) = delete;
+	TextNumberParser & operator=(const TextNumberParser &) = delete;
+
+	//! opens (maps) a text file and moves to its beginning.
+	//! \return 0: success (an empty file is also a success). -1: cannot open.
+	int open(const std::string & fileName, char commentChar = '#');
+	//! unmaps the file
+	void close();
+
+	//! next number (the integer part of a real value for int)
+	//! \return false at the end of the file
+	bool next(double & value);
+	bool next(float & value);
+	bool next(int & value);
+	//! back to the beginning of the file
+	void rewind() { pos = begin; }
+
+	//! reads the whole file as csv to a mat of type (CV_8U, CV_8S, CV_16U, CV_16S, CV_32S,
+	//! CV_32F or CV_64F; values are converted by C++ casts, as (T) std::stod()).
+	//! \return number of rows. mat is empty if the file has no value.
+	int readCsv(cv::Mat & mat, int type);
+
+	//! bytes of the file
+	size_t size() const { return (size_t) (end - begin); }
+
+protected:
+	bool nextToken(const char * & tokBegin, const char * & tokEnd);
+	void csvShape(int & nRows, int & nCols) const;
+	int csvLine(const char * & p, double * values, int nMax) const;
+
+	const char * begin = NULL;
+	const char * end = NULL;
+	const char * pos = NULL;
+	char commentChar = '#';
+	void * mapped = NULL;        // mapped view (or NULL if the file is read to buffer)
+	size_t mappedBytes = 0;
+	std::string buffer;          // (file read to memory if it cannot be mapped)
+};
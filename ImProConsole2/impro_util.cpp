@@ -1,7 +1,9 @@
 #include "impro_util.h"
 #include <vector>
 #include <opencv2/opencv.hpp>
+#include <opencv2/core/hal/intrin.hpp>
 #include <cmath>
+#include <cfloat>
 #include <iostream>
 #include <fstream>
 #include <cstdio>
@@ -15,6 +17,11 @@
 
 #include "matchTemplateWithRotPyr.h"
 #include "enhancedCorrelationWithReference.h"
+#include "LkPyramid.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace std;
 using namespace cv; 
@@ -824,7 +831,10 @@ int mtm_opfs(cv::Mat imgInit, cv::Mat imgSrch,
 	cv::Size winSize,
 	int maxLevel,
 	cv::TermCriteria criteria,
-	int flags)
+	int flags,
+	LkPyramid * pyrInit,
+	LkPyramid * pyrSrch,
+	int nThreads)
 {
 	double totalCpusTime = getCpusTime();
 	double totalWallTime = getWallTime();
@@ -919,20 +929,42 @@ int mtm_opfs(cv::Mat imgInit, cv::Mat imgSrch,
 	else
 		imgInit_gray = imgInit; 
 
-	// Estimate large-window movement 
+	// Batch of targets: template windows (roi of imgInit_gray, not copied) of all
+	// targets are extracted at once, and the matches of targets run in parallel
+	// (if nThreads is not 1) against the same (shared) search image.
+	int nValid = (int) tPointsInitValid.size();
+#ifdef _OPENMP
+	if (nThreads <= 0) nThreads = omp_get_max_threads();
+#else
+	nThreads = 1;
+#endif
+	if (nThreads > nValid) nThreads = nValid;
+	if (nThreads < 1) nThreads = 1;
+	int largeWinScale = (int)(std::pow(2, maxLevel) + 0.1f); // largeWinScale = 2^maxLevel
+	cv::Size largeWinSize(winSize.width * largeWinScale, winSize.height * largeWinScale);
+	std::vector<cv::Rect> largeWinRects(nValid), smallWinRects(nValid);
+	std::vector<cv::Point2f> refLargeWinPoints(nValid), refSmallWinPoints(nValid);
+	for (int iPoint = 0; iPoint < nValid; iPoint++) {
+		largeWinRects[iPoint] = getTmpltRectFromImage(
+			imgInit_gray, tPointsInitValid[iPoint], largeWinSize, refLargeWinPoints[iPoint]);
+		smallWinRects[iPoint] = getTmpltRectFromImage(
+			imgInit_gray, tPointsInitValid[iPoint], winSize, refSmallWinPoints[iPoint]);
+	}
+	std::vector<std::vector<double> > winResultBuf(nThreads, std::vector<double>(8, 0.0)); // result of each thread
+
+	// Estimate large-window movement
 	//  The precision sets to 1/4 of template size, assuring
-	//  enough precision that is near template, avoiding possible 
-	//  similar pattern around. 
+	//  enough precision that is near template, avoiding possible
+	//  similar pattern around.
 	double largeWinCpusTime = getCpusTime();
 	double largeWinWallTime = getWallTime();
-	int largeWinScale = (int)(std::pow(2, maxLevel) + 0.1f); // largeWinScale = 2^maxLevel 
-	cv::Size largeWinSize(winSize.width * largeWinScale, winSize.height * largeWinScale); 
-    std::vector<double> largeWinResult(8, 0.0);
-	cv::Mat largeWinResultMat(largeWinResult);
-    for (int iPoint = 0; iPoint < (int) tPointsInitValid.size(); iPoint++) {
-		cv::Point2f refLargeWinPoint;
-		cv::Rect largeWinRect = getTmpltRectFromImage(
-			imgInit_gray, tPointsInitValid[iPoint], largeWinSize, refLargeWinPoint);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if (nThreads > 1)
+	for (int iPoint = 0; iPoint < nValid; iPoint++) {
+#ifdef _OPENMP
+		std::vector<double> & largeWinResult = winResultBuf[omp_get_thread_num()];
+#else
+		std::vector<double> & largeWinResult = winResultBuf[0];
+#endif
 		float largeWin_xMin = tPointsSrchValid[iPoint].x - maxMove[0];
 		float largeWin_xMax = tPointsSrchValid[iPoint].x + maxMove[0];
 		float largeWin_yMin = tPointsSrchValid[iPoint].y - maxMove[1];
@@ -942,8 +974,8 @@ int mtm_opfs(cv::Mat imgInit, cv::Mat imgSrch,
 		float largeWin_rMin = tPointsSrchValid[iPoint].z - maxMove[2];
 		float largeWin_rMax = tPointsSrchValid[iPoint].z + maxMove[2];
 		float largeWin_rPcn = (float)(maxMove[2]) / 2.f;
-		matchTemplateWithRotPyr(imgSrch_gray, imgInit_gray(largeWinRect),
-			refLargeWinPoint.x, refLargeWinPoint.y,
+		matchTemplateWithRotPyr(imgSrch_gray, imgInit_gray(largeWinRects[iPoint]),
+			refLargeWinPoints[iPoint].x, refLargeWinPoints[iPoint].y,
 			largeWin_xMin, largeWin_xMax, largeWin_xPcn,
 			largeWin_yMin, largeWin_yMax, largeWin_yPcn,
 			largeWin_rMin, largeWin_rMax, largeWin_rPcn,
@@ -955,30 +987,30 @@ int mtm_opfs(cv::Mat imgInit, cv::Mat imgSrch,
 	}
 	largeWinCpusTime = getCpusTime() - largeWinCpusTime;
 	largeWinWallTime = getWallTime() - largeWinWallTime;
-	//	cout << "Large-win:\n" << largeWinResultMat << endl;
 	timing[2] = (float) largeWinCpusTime;
 	timing[3] = (float) largeWinWallTime;
 
 	// refined match. assuming tPointsSrch are close to final result (less than 1/2 of window size)
 	double smallWinCpusTime = getCpusTime();
 	double smallWinWallTime = getWallTime();
-    std::vector<double> smallWinResult(8, 0.0);
-	cv::Mat smallWinResultMat(smallWinResult);
-    for (int iPoint = 0; iPoint < (int) tPointsInitValid.size(); iPoint++) {
-		cv::Point2f refSmallWinPoint;
-		cv::Rect smallWinRect = getTmpltRectFromImage(
-			imgInit_gray, tPointsInitValid[iPoint], winSize, refSmallWinPoint);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if (nThreads > 1)
+	for (int iPoint = 0; iPoint < nValid; iPoint++) {
+#ifdef _OPENMP
+		std::vector<double> & smallWinResult = winResultBuf[omp_get_thread_num()];
+#else
+		std::vector<double> & smallWinResult = winResultBuf[0];
+#endif
 		float smallWin_xMin = tPointsSrchValid[iPoint].x - winSize.width / 2;
 		float smallWin_xMax = tPointsSrchValid[iPoint].x + winSize.width / 2;
 		float smallWin_yMin = tPointsSrchValid[iPoint].y - winSize.height / 2;
 		float smallWin_yMax = tPointsSrchValid[iPoint].y + winSize.height / 2;
 		float smallWin_xPcn = winSize.width * 0.25f;
 		float smallWin_yPcn = winSize.height * 0.25f;
-		float smallWin_rMin = tPointsSrch[iPoint].z - maxMove[2];
-		float smallWin_rMax = tPointsSrch[iPoint].z + maxMove[2];
+		float smallWin_rMin = tPointsSrchValid[iPoint].z - maxMove[2];
+		float smallWin_rMax = tPointsSrchValid[iPoint].z + maxMove[2];
 		float smallWin_rPcn = (float) 1.0f;
-		matchTemplateWithRotPyr(imgSrch_gray, imgInit_gray(smallWinRect),
-			refSmallWinPoint.x, refSmallWinPoint.y,
+		matchTemplateWithRotPyr(imgSrch_gray, imgInit_gray(smallWinRects[iPoint]),
+			refSmallWinPoints[iPoint].x, refSmallWinPoints[iPoint].y,
 			smallWin_xMin, smallWin_xMax, smallWin_xPcn,
 			smallWin_yMin, smallWin_yMax, smallWin_yPcn,
 			smallWin_rMin, smallWin_rMax, smallWin_rPcn,
@@ -986,11 +1018,10 @@ int mtm_opfs(cv::Mat imgInit, cv::Mat imgSrch,
 		tPointsSrchValid[iPoint].x = (float) smallWinResult[0];
 		tPointsSrchValid[iPoint].y = (float) smallWinResult[1];
 		if (maxMove[2] > 1e-6)
-			tPointsSrchValid[iPoint].z = (float) largeWinResult[2];
+			tPointsSrchValid[iPoint].z = (float) smallWinResult[2];
 	}
 	smallWinCpusTime = getCpusTime() - smallWinCpusTime;
 	smallWinWallTime = getWallTime() - smallWinWallTime;
-	//	cout << "Small-win:\n" << smallWinResultMat << endl;
 	timing[4] = (float)smallWinCpusTime;
 	timing[5] = (float)smallWinWallTime;
 
@@ -1040,10 +1071,24 @@ int mtm_opfs(cv::Mat imgInit, cv::Mat imgSrch,
 		tPointsSrchValid2f[iPoint].y = tPointsSrchValid[iPoint].y;
 	}
 	// optical flow 
-	cv::calcOpticalFlowPyrLK(imgInit_gray, imgSrch_gray,
-		tPointsInitValid, tPointsSrchValid2f, statusValid, errorValid,
-		rotWinSize, maxLevel,
-		criteria, cv::OPTFLOW_USE_INITIAL_FLOW);
+	// (with pyramids given by caller, they are built only if the images are not the
+	// images of the pyramids. imgInit_gray is a new image if it is rotated or converted.)
+	if (pyrInit != NULL || pyrSrch != NULL) {
+		LkPyramid pyrInitLocal, pyrSrchLocal;
+		if (pyrInit == NULL) pyrInit = &pyrInitLocal;
+		if (pyrSrch == NULL) pyrSrch = &pyrSrchLocal;
+		pyrInit->update(imgInit_gray, rotWinSize, maxLevel);
+		pyrSrch->update(imgSrch_gray, rotWinSize, maxLevel, false);
+		cv::calcOpticalFlowPyrLK(pyrInit->levels(), pyrSrch->levels(),
+			tPointsInitValid, tPointsSrchValid2f, statusValid, errorValid,
+			rotWinSize, maxLevel,
+			criteria, cv::OPTFLOW_USE_INITIAL_FLOW);
+	}
+	else
+		cv::calcOpticalFlowPyrLK(imgInit_gray, imgSrch_gray,
+			tPointsInitValid, tPointsSrchValid2f, statusValid, errorValid,
+			rotWinSize, maxLevel,
+			criteria, cv::OPTFLOW_USE_INITIAL_FLOW);
     for (int iPoint = 0; iPoint < (int) tPointsSrchValid.size(); iPoint++) {
 		tPointsSrchValid[iPoint].x = tPointsSrchValid2f[iPoint].x;
 		tPointsSrchValid[iPoint].y = tPointsSrchValid2f[iPoint].y;
@@ -1418,6 +1463,12 @@ int uToCrack(const cv::Mat & u, cv::Mat & crack_opn, cv::Mat & crack_sld,
 	int angle, int oper)
 {
 	// if angle == 999, pick max of angle = 0, 45, 90, and 135
+	// (all angles in a single pass, see uToStrainCrack())
+	if ((angle >= 999 || angle <= -999) && u.rows >= 3 && u.cols >= 3)
+	{
+		cv::Mat noStrain;
+		return uToStrainCrack(u, noStrain, noStrain, noStrain, crack_opn, crack_sld, 0, false, true);
+	}
 	if (angle >= 999 || angle <= -999) 
 	{
 		uToCrack(u, crack_opn, crack_sld,   0, 0); // initialize by angle = 0
@@ -1515,6 +1566,12 @@ int uToStrain(const cv::Mat & u, cv::Mat & exx, cv::Mat & eyy, cv::Mat & exy)
 		cerr << "  but sized " << u.rows << "-by-" << u.cols << " typed " << u.type() << endl;
 		return -1;
 	}
+	// (single pass, see uToStrainCrack())
+	if (u.rows >= 3 && u.cols >= 3)
+	{
+		cv::Mat noCrack;
+		return uToStrainCrack(u, exx, eyy, exy, noCrack, noCrack, 0, true, false);
+	}
 	// reallocate
 	if (exx.rows != u.rows || exx.cols != u.cols || exx.type() != CV_32F)
 		exx = cv::Mat::zeros(u.rows, u.cols, CV_32F);
@@ -1545,6 +1602,135 @@ int uToStrain(const cv::Mat & u, cv::Mat & exx, cv::Mat & eyy, cv::Mat & exy)
 	return 0;
 }
 
+// coefficients of crack opening and sliding of an assumed crack direction
+// (angle in degrees) in terms of dv = u_dn - u_up and dh = u_rt - u_lf:
+//   opn = k[0] * dv.x + k[1] * dh.x + k[2] * dv.y + k[3] * dh.y
+//   sld = k[4] * dv.x + k[5] * dh.x + k[6] * dv.y + k[7] * dh.y
+// (the same linear system as uToCrack(), solved once for the angle)
+static void crackCoefficients(int angle, float k[8])
+{
+	float theta = (float)(angle * M_PI / 180.);
+	float cos_theta = cos(theta), sin_theta = sin(theta);
+	cv::Mat c22(2, 2, CV_32F), c22_inv(2, 2, CV_32F);
+	c22.at<float>(0, 0) = (float)cos(theta + M_PI / 2.);
+	c22.at<float>(0, 1) = (float)cos(theta);
+	c22.at<float>(1, 0) = (float)sin(theta + M_PI / 2.);
+	c22.at<float>(1, 1) = (float)sin(theta);
+	c22_inv = c22.inv();
+	// ua - ub = (dv * cos - dh * sin) / den
+	float den = (angle < 90) ? (cos_theta + sin_theta) : (-cos_theta + sin_theta);
+	float a = cos_theta / den, b = -sin_theta / den;
+	for (int r = 0; r < 2; r++) {
+		k[r * 4 + 0] = c22_inv.at<float>(r, 0) * a;
+		k[r * 4 + 1] = c22_inv.at<float>(r, 0) * b;
+		k[r * 4 + 2] = c22_inv.at<float>(r, 1) * a;
+		k[r * 4 + 3] = c22_inv.at<float>(r, 1) * b;
+	}
+}
+
+int uToStrainCrack(const cv::Mat & u, cv::Mat & exx, cv::Mat & eyy, cv::Mat & exy,
+	cv::Mat & crack_opn, cv::Mat & crack_sld, int nThreads, bool withStrain, bool withCrack)
+{
+	// check
+	if (u.rows < 3 || u.cols < 3 || u.type() != CV_32FC2)
+	{
+		cerr << "uToStrainCrack error: Input u needs to be at least 3-by-3 and CV_32FC2 (i.e., 13).\n";
+		cerr << "  but sized " << u.rows << "-by-" << u.cols << " typed " << u.type() << endl;
+		return -1;
+	}
+	// allocate
+	if (withStrain) {
+		exx.create(u.rows, u.cols, CV_32F);
+		eyy.create(u.rows, u.cols, CV_32F);
+		exy.create(u.rows, u.cols, CV_32F);
+	}
+	if (withCrack) {
+		crack_opn.create(u.rows, u.cols, CV_32F);
+		crack_sld.create(u.rows, u.cols, CV_32F);
+	}
+	// crack coefficients of angles 0, 45, 90, 135
+	const int nAngle = 4;
+	float k[nAngle][8];
+	for (int a = 0; a < nAngle; a++)
+		crackCoefficients(a * 45, k[a]);
+#ifdef _OPENMP
+	if (nThreads <= 0) nThreads = omp_get_max_threads();
+#else
+	nThreads = 1;
+#endif
+	const int rows = u.rows, cols = u.cols;
+
+#pragma omp parallel for schedule(static) num_threads(nThreads) if (nThreads > 1)
+	for (int i = 0; i < rows; i++)
+	{
+		// rows of U_up and U_down (I = i but must be between 1 ~ (u.rows - 2))
+		int I = max(1, min(rows - 2, i));
+		const float * pUp = u.ptr<float>(I - 1);
+		const float * pDn = u.ptr<float>(I + 1);
+		const float * pRow = u.ptr<float>(i);
+		float * pExx = withStrain ? exx.ptr<float>(i) : NULL;
+		float * pEyy = withStrain ? eyy.ptr<float>(i) : NULL;
+		float * pExy = withStrain ? exy.ptr<float>(i) : NULL;
+		float * pOpn = withCrack ? crack_opn.ptr<float>(i) : NULL;
+		float * pSld = withCrack ? crack_sld.ptr<float>(i) : NULL;
+		// scalar kernel of column j (J = j but must be between 1 ~ (u.cols - 2))
+		auto kernel = [&](int j) {
+			int J = max(1, min(cols - 2, j));
+			float dvx = pDn[2 * j] - pUp[2 * j], dvy = pDn[2 * j + 1] - pUp[2 * j + 1];
+			float dhx = pRow[2 * J + 2] - pRow[2 * J - 2], dhy = pRow[2 * J + 3] - pRow[2 * J - 1];
+			if (withStrain) {
+				pExx[j] = dhx / 2.0f;
+				pEyy[j] = dvy / 2.0f;
+				pExy[j] = dhy / 2.0f + dvx / 2.0f;
+			}
+			if (withCrack) {
+				float opn = -FLT_MAX, sld = -FLT_MAX;
+				for (int a = 0; a < nAngle; a++) {
+					opn = max(opn, k[a][0] * dvx + k[a][1] * dhx + k[a][2] * dvy + k[a][3] * dhy);
+					sld = max(sld, k[a][4] * dvx + k[a][5] * dhx + k[a][6] * dvy + k[a][7] * dhy);
+				}
+				pOpn[j] = opn;
+				pSld[j] = sld;
+			}
+		};
+		kernel(0);
+		int j = 1;
+#if CV_SIMD
+		// interior columns, v_float32::nlanes pixels at a time
+		const int nl = cv::v_float32::nlanes;
+		cv::v_float32 half = cv::vx_setall_f32(0.5f);
+		for (; j + nl <= cols - 1; j += nl) {
+			cv::v_float32 upx, upy, dnx, dny, lfx, lfy, rtx, rty;
+			cv::v_load_deinterleave(pUp + 2 * j, upx, upy);
+			cv::v_load_deinterleave(pDn + 2 * j, dnx, dny);
+			cv::v_load_deinterleave(pRow + 2 * j - 2, lfx, lfy);
+			cv::v_load_deinterleave(pRow + 2 * j + 2, rtx, rty);
+			cv::v_float32 dvx = dnx - upx, dvy = dny - upy;
+			cv::v_float32 dhx = rtx - lfx, dhy = rty - lfy;
+			if (withStrain) {
+				cv::v_store(pExx + j, dhx * half);
+				cv::v_store(pEyy + j, dvy * half);
+				cv::v_store(pExy + j, dhy * half + dvx * half);
+			}
+			if (withCrack) {
+				cv::v_float32 opn = cv::vx_setall_f32(-FLT_MAX), sld = opn;
+				for (int a = 0; a < nAngle; a++) {
+					opn = cv::v_max(opn, cv::vx_setall_f32(k[a][0]) * dvx + cv::vx_setall_f32(k[a][1]) * dhx
+						+ cv::vx_setall_f32(k[a][2]) * dvy + cv::vx_setall_f32(k[a][3]) * dhy);
+					sld = cv::v_max(sld, cv::vx_setall_f32(k[a][4]) * dvx + cv::vx_setall_f32(k[a][5]) * dhx
+						+ cv::vx_setall_f32(k[a][6]) * dvy + cv::vx_setall_f32(k[a][7]) * dhy);
+				}
+				cv::v_store(pOpn + j, opn);
+				cv::v_store(pSld + j, sld);
+			}
+		}
+#endif
+		for (; j < cols; j++)
+			kernel(j);
+	}
+	return 0;
+}
+
 cv::Mat sobel_xy(const cv::Mat & src)
 {
 	cv::Mat src_gray;
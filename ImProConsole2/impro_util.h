@@ -193,8 +193,12 @@ running optical flow. The function interface is similar to calcOpticalFlowPyrLK(
 \param maxLevel For mtm: size factor of winSize in rough matching (step 1). For optical flow, maximum pyramid level number. 0:same size, 1:double (x2), 2:(x4), 3:(x8)
 \param criteria specifying the termination criteria of the iterative search algorithm
 \param flags OPTFLOW_USE_INITIAL_FLOW, OPTFLOW_LK_GET_MIN_EIGENVALS. 
+\param pyrInit optical-flow pyramid of imgInit kept by caller between calls, rebuilt only when imgInit changes (another image) or rotation is tracked (default: NULL, built in every call)
+\param pyrSrch optical-flow pyramid of imgSrch, which can be shared with other optical-flow calls of the same frame (default: NULL, built in every call)
+\param nThreads number of threads running the template matches of targets as a batch (default: 1. 0 or negative: all cores). The optical flow always runs once for all targets.
 \return 0:success. -1:empry image(s). -2:no valid initial point. 
 */
+class LkPyramid;
 int mtm_opfs(cv::Mat imgInit, cv::Mat imgSrch,
 	const std::vector<cv::Point2f> & tPointsInit,
 	std::vector<cv::Point3f> & tPointsSrch,
@@ -205,7 +209,10 @@ int mtm_opfs(cv::Mat imgInit, cv::Mat imgSrch,
 	cv::Size winSize = cv::Size(25, 25), 
 	int maxLevel = 3,
 	cv::TermCriteria criteria = cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, 0.01),
-	int flags = cv::OPTFLOW_USE_INITIAL_FLOW);
+	int flags = cv::OPTFLOW_USE_INITIAL_FLOW,
+	LkPyramid * pyrInit = NULL,
+	LkPyramid * pyrSrch = NULL,
+	int nThreads = 1);
 
 int points2fVecValid(const std::vector<cv::Point2f> & oldVec,
 	std::vector<cv::Point2f> & newVec,
@@ -347,6 +354,27 @@ The displacement fields are normally analyzed by template match, ECC, optical fl
 */
 int uToStrain(const cv::Mat & u, cv::Mat & exx, cv::Mat & eyy, cv::Mat & exy);
 
+//! uToStrainCrack() calculates strain and crack fields according to given displacement fields in one pass.
+/*!
+\details This function calculates the same fields as uToStrain() and uToCrack() (angle 999, i.e., max. of
+angles 0, 45, 90, and 135), but in a single pass over the displacement field. The differences of neighbors
+of a pixel are loaded once and shared by the strains and the cracks of all angles, rows are vectorized 
+(OpenCV universal intrinsics) and row blocks run in parallel (OpenMP). Crack values may differ from uToCrack()
+by float rounding.
+\param u displacement field. Type:CV_32FC2 in unit of pixel, at least 3-by-3. (image coordinate)
+\param exx strain field exx. Type:CV_32F, dimensionless.
+\param eyy strain field eyy. Type:CV_32F, dimensionless.
+\param exy strain field exy. Type:CV_32F, dimensionless.
+\param crack_opn crack opening field. Type:CV_32F, in unit of pixel.
+\param crack_sld crack sliding field. Type:CV_32F, in unit of pixel.
+\param nThreads number of threads (0 or negative for all available)
+\param withStrain calculates exx, eyy, exy (otherwise they are not touched)
+\param withCrack calculates crack_opn, crack_sld (otherwise they are not touched)
+\return 0: success. -1: invalid input.
+*/
+int uToStrainCrack(const cv::Mat & u, cv::Mat & exx, cv::Mat & eyy, cv::Mat & exy,
+	cv::Mat & crack_opn, cv::Mat & crack_sld, int nThreads = 0, bool withStrain = true, bool withCrack = true);
+
 cv::Mat sobel_xy(const cv::Mat & src);
 
 void imshow_resize(std::string winname, cv::Mat img, double factor); 
@@ -29,7 +29,12 @@ int FuncQ4TemplatesPicking(int argc, char** argv);
 int FuncCamMoveCorrection(int argc, char** argv);
 
 int FuncTrackingPointsEcc(int argc, char** argv);
+int FuncTrackingPointsEccIc(int argc, char** argv);
 int FuncTrackingPyrTmpltMatch(int argc, char** argv);
+int FuncBenchTmatchFft(int argc, char** argv);
+int FuncBenchIoData(int argc, char** argv);
+int FuncBenchTextRead(int argc, char** argv);
+int FuncBenchDenseFieldStore(int argc, char** argv);
 
 int FuncSyncTwoCams(int argc, char** argv);
 
@@ -40,6 +45,7 @@ int FuncDrawHouse(int argc, char ** argv);
 int FuncDrawRotatingTemplate(int argc, char ** argv);
 
 int FuncOptflowSeq(int argc, char ** argv);
+int FuncOptflowSeqPipelined(int argc, char ** argv);
 
 int FuncWallDisp(int argc, char ** argv);    // made for SPD test 2019
 int FuncWallDispCam(int argc, char ** argv); // made for SPD test 2019
@@ -50,12 +56,14 @@ int FuncStoryDispV4(int argc, char** argv); // Eric V2 + wider big table
 int FuncStoryDispV6(int argc, char** argv); // Eric V6 (reading image file with named with date/time)
 int FuncStoryDispV7(int argc, char** argv); // V7 (modified V6 in Vincent style, including printing "#", can specify image directory, and some details)
 int FuncStoryDispV8(int argc, char** argv); // V8 (final version in Jun 2020, disabled template match and ECC tracking methods, left only optical flow)
+int FuncBigTableCsv(int argc, char** argv); // converts binary big table log (e.g., of V8) to csv
 
 int FuncBucklingRestrainedBrace_url(int argc, char ** argv); // made for BRB test 2019
 
 int FuncTryCamFocusExposure(int argc, char ** argv);
 
 int FuncVideoDenseTracking(int argc, char ** argv);
+int FuncVideoDenseTrackingTiled(int argc, char ** argv);
 int FuncVidImPointsQ4(int argc, char** argv);
 int FuncVidOptflowToVelocity(int argc, char** argv);
 int FuncMandelbrot(int argc, char** argv);
@@ -103,7 +111,12 @@ int main(int argc, char ** argv)
     s.addItem("cammov",     "Cam correction: Camera movement correction (pic 2 pic, ref. points tracked) ", FuncCamMoveCorrection);
 
     s.addItem("ecc",        "Tracking: Track Points Using ECC method",                FuncTrackingPointsEcc);
+    s.addItem("eccic",      "Tracking: Track Points Using inverse-compositional ECC (precomputed Hessian)", FuncTrackingPointsEccIc);
     s.addItem("tmatch",     "Tracking: Track by pyramid template match",              FuncTrackingPyrTmpltMatch);
+    s.addItem("benchTmFft", "Tracking: Benchmark direct vs. FFT template match and sub-pixel fit (synthetic images)", FuncBenchTmatchFft);
+    s.addItem("benchIoData", "IoData: Benchmark in-memory vs. xml-file serialization of point histories", FuncBenchIoData);
+    s.addItem("benchTxtRead", "IoData: Benchmark former vs. memory-mapped text (txt/csv) readers of point histories", FuncBenchTextRead);
+    s.addItem("benchDfs", "IoData: Round-trip check and benchmark of dense field store (.dfs) vs. xml.gz", FuncBenchDenseFieldStore);
 
     s.addItem("syncC2",     "Synchronize Camera 2 to match Camera 1",                 FuncSyncTwoCams);
 
@@ -114,6 +127,7 @@ int main(int argc, char ** argv)
     s.addItem("drawRotTmplt", "Draw rotating template and create a file sequence.", FuncDrawRotatingTemplate);
 
     s.addItem("optflow", "Dense (Farneback) optical flow analysis", FuncOptflowSeq);
+    s.addItem("optflowPipe", "Dense (Farneback) optical flow analysis (pipelined, multi-core)", FuncOptflowSeqPipelined);
 
     s.addItem("wallDisp", "Plane wall displacement analysis (online)", FuncWallDisp);
     s.addItem("wallDispCam", "Plane wall displacement analysis (online, webcam)", FuncWallDispCam);
@@ -123,12 +137,14 @@ int main(int argc, char ** argv)
     s.addItem("storyDispV6", "Measure story drift (Eric V6, reading file named with date/time)", FuncStoryDispV6);
     s.addItem("storyDispV7", "Measure story drift (V6 enhanced)", FuncStoryDispV7);
     s.addItem("storyDispV8", "Measure story drift (disables template-match and ECC)", FuncStoryDispV8);
+    s.addItem("bigTableCsv", "Convert a binary big table log (e.g., of storyDispV8) to csv text", FuncBigTableCsv);
 
 //    s.addItem("brburl", "FuncBucklingRestrainedBrace_url (for BRB test 2019)", FuncBucklingRestrainedBrace_url);
 
     s.addItem("tryCam", "Try the best camera settings of focus and exposure", FuncTryCamFocusExposure);
 
     s.addItem("vidTrack", "Video dense-point tracking", FuncVideoDenseTracking);
+    s.addItem("vidTrackTiled", "Video dense-point tracking (tiled, multi-core)", FuncVideoDenseTrackingTiled);
     s.addItem("vidImPointsQ4", "Interpolate q4 points through vidTrack result.", FuncVidImPointsQ4);
     s.addItem("vidOptflowToVelocity", "Convert optical flow (image velocity) to real velocity.", FuncVidOptflowToVelocity);
     s.addItem("mandelbrot", "Mandelbrot Set plotting.", FuncMandelbrot);
@@ -0,0 +1,219 @@
+#include <vector>
+#include <list>
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+
+#include "matchTemplateFft.h"
+
+using namespace std;
+
+// converts each channel of an image to CV_32F and pads it (zeros at right and bottom) to dftSize
+static void splitPadded32F(const cv::Mat & img, cv::Size dftSize, vector<cv::Mat> & padded)
+{
+	vector<cv::Mat> chs;
+	cv::split(img, chs);
+	padded.resize(chs.size());
+	for (int c = 0; c < (int)chs.size(); c++) {
+		padded[c] = cv::Mat::zeros(dftSize, CV_32F);
+		chs[c].convertTo(padded[c](cv::Rect(0, 0, img.cols, img.rows)), CV_32F);
+	}
+}
+
+static bool isZeroMeanMethod(int method)
+{
+	return method == cv::TM_CCOEFF || method == cv::TM_CCOEFF_NORMED;
+}
+
+int MatchTemplateFftSearch::create(const cv::Mat & search, cv::Size _dftSize)
+{
+	if (search.rows <= 0 || search.cols <= 0) return -1;
+	this->searchSize = search.size();
+	if (_dftSize.width < search.cols || _dftSize.height < search.rows)
+		this->dftSize = cv::Size(cv::getOptimalDFTSize(search.cols), cv::getOptimalDFTSize(search.rows));
+	else
+		this->dftSize = _dftSize;
+
+	vector<cv::Mat> padded;
+	splitPadded32F(search, this->dftSize, padded);
+	int nch = (int)padded.size();
+	this->spectra.resize(nch);
+	this->sums.resize(nch);
+	this->sqsums.resize(nch);
+	for (int c = 0; c < nch; c++) {
+		cv::dft(padded[c], this->spectra[c], 0, search.rows);
+		cv::integral(padded[c](cv::Rect(0, 0, search.cols, search.rows)),
+			this->sums[c], this->sqsums[c], CV_64F, CV_64F);
+	}
+	return 0;
+}
+
+int MatchTemplateFftTmplt::create(const cv::Mat & _tmplt, cv::Size _dftSize, int _method)
+{
+	if (_tmplt.rows <= 0 || _tmplt.cols <= 0 ||
+		_tmplt.cols > _dftSize.width || _tmplt.rows > _dftSize.height)
+		return -1;
+	_tmplt.copyTo(this->tmplt);
+	this->dftSize = _dftSize;
+	this->method = _method;
+
+	vector<cv::Mat> padded;
+	splitPadded32F(_tmplt, _dftSize, padded);
+	int nch = (int)padded.size();
+	cv::Rect roi(0, 0, _tmplt.cols, _tmplt.rows);
+	this->spectra.resize(nch);
+	this->sums.resize(nch);
+	this->sqsum = 0.0;
+	for (int c = 0; c < nch; c++) {
+		this->sums[c] = cv::sum(padded[c](roi))[0];
+		if (isZeroMeanMethod(_method))
+			padded[c](roi) -= this->sums[c] / roi.area();
+		this->sqsum += padded[c](roi).dot(padded[c](roi));
+		cv::dft(padded[c], this->spectra[c], 0, _tmplt.rows);
+	}
+	return 0;
+}
+
+bool MatchTemplateFftTmplt::isFor(const cv::Mat & _tmplt, cv::Size _dftSize, int _method) const
+{
+	if (this->empty() || this->dftSize != _dftSize ||
+		isZeroMeanMethod(this->method) != isZeroMeanMethod(_method))
+		return false;
+	if (this->tmplt.size() != _tmplt.size() || this->tmplt.type() != _tmplt.type())
+		return false;
+	return cv::norm(this->tmplt, _tmplt, cv::NORM_INF) == 0.0;
+}
+
+bool MatchTemplateFftCache::Key::operator<(const Key & k) const
+{
+	return std::tie(data, srcRows, srcCols, srcStep, thdeg, cropX, cropY, cropW, cropH,
+			scaledW, scaledH, dftW, dftH, zeroMean) <
+		std::tie(k.data, k.srcRows, k.srcCols, k.srcStep, k.thdeg, k.cropX, k.cropY, k.cropW, k.cropH,
+			k.scaledW, k.scaledH, k.dftW, k.dftH, k.zeroMean);
+}
+
+const MatchTemplateFftTmplt & MatchTemplateFftCache::get(const cv::Mat & srcTmplt, double thdeg,
+	cv::Rect crop, cv::Size scaledSize, const cv::Mat & tmplt, cv::Size dftSize, int method)
+{
+	Key key = { srcTmplt.data, srcTmplt.rows, srcTmplt.cols, srcTmplt.step[0], thdeg,
+		crop.x, crop.y, crop.width, crop.height, scaledSize.width, scaledSize.height,
+		dftSize.width, dftSize.height, isZeroMeanMethod(method) };
+	auto found = index.find(key);
+	if (found != index.end()) {
+		nHit++;
+		entries.splice(entries.begin(), entries, found->second);
+		entries.front().spec.method = method;
+		return entries.front().spec;
+	}
+	nMiss++;
+	entries.emplace_front();
+	entries.front().key = key;
+	entries.front().src = srcTmplt;
+	entries.front().spec.create(tmplt, dftSize, method);
+	index[key] = entries.begin();
+	while ((int)entries.size() > std::max(maxEntries, 1)) {
+		index.erase(entries.back().key);
+		entries.pop_back();
+	}
+	return entries.front().spec;
+}
+
+int matchTemplateFft(const MatchTemplateFftSearch & search, const MatchTemplateFftTmplt & tmplt,
+	cv::Mat & result)
+{
+	if (search.empty() || tmplt.empty() ||
+		search.dftSize != tmplt.dftSize || search.spectra.size() != tmplt.spectra.size())
+		return -1;
+	int w = tmplt.tmplt.cols, h = tmplt.tmplt.rows;
+	int rw = search.searchSize.width - w + 1, rh = search.searchSize.height - h + 1;
+	if (rw <= 0 || rh <= 0) return -1;
+	int nch = (int)search.spectra.size();
+	int method = tmplt.method;
+	double area = (double)w * h;
+
+	// numerator: cross correlation (sum over channels)
+	cv::Mat num = cv::Mat::zeros(rh, rw, CV_32F);
+	cv::Mat spec, corr;
+	for (int c = 0; c < nch; c++) {
+		cv::mulSpectrums(search.spectra[c], tmplt.spectra[c], spec, 0, true);
+		cv::dft(spec, corr, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT, rh);
+		num += corr(cv::Rect(0, 0, rw, rh));
+	}
+	if (method == cv::TM_CCORR || method == cv::TM_CCOEFF) {
+		result = num;
+		return 0;
+	}
+
+	// window sums of search image (by integral images) and the final result
+	result.create(rh, rw, CV_32F);
+	double tNorm = std::sqrt(tmplt.sqsum);
+	for (int y = 0; y < rh; y++) {
+		const float * pNum = num.ptr<float>(y);
+		float * pRes = result.ptr<float>(y);
+		for (int x = 0; x < rw; x++) {
+			double wndSum2 = 0.0, wndMean2 = 0.0;
+			for (int c = 0; c < nch; c++) {
+				const cv::Mat & q = search.sqsums[c];
+				double q2 = q.at<double>(y + h, x + w) - q.at<double>(y, x + w)
+					- q.at<double>(y + h, x) + q.at<double>(y, x);
+				wndSum2 += q2;
+				if (isZeroMeanMethod(method)) {
+					const cv::Mat & s = search.sums[c];
+					double s1 = s.at<double>(y + h, x + w) - s.at<double>(y, x + w)
+						- s.at<double>(y + h, x) + s.at<double>(y, x);
+					wndMean2 += s1 * s1 / area;
+				}
+			}
+			double r = pNum[x];
+			if (method == cv::TM_SQDIFF || method == cv::TM_SQDIFF_NORMED)
+				r = wndSum2 - 2.0 * r + tmplt.sqsum;
+			if (method == cv::TM_SQDIFF_NORMED || method == cv::TM_CCORR_NORMED || method == cv::TM_CCOEFF_NORMED) {
+				// the same normalization and clamping as cv::matchTemplate()
+				double t = std::sqrt(std::max(wndSum2 - wndMean2, 0.0)) * tNorm;
+				if (std::fabs(r) < t)
+					r /= t;
+				else if (std::fabs(r) < t * 1.125)
+					r = r > 0 ? 1 : -1;
+				else
+					r = method != cv::TM_SQDIFF_NORMED ? 0 : 1;
+			}
+			pRes[x] = (float)r;
+		}
+	}
+	return 0;
+}
+
+int matchTemplateFft(cv::InputArray image, cv::InputArray templ, cv::OutputArray result, int method)
+{
+	cv::Mat imageMat = image.getMat(), templMat = templ.getMat();
+	MatchTemplateFftSearch search;
+	MatchTemplateFftTmplt tmplt;
+	cv::Mat res;
+	if (search.create(imageMat) != 0) return -1;
+	if (tmplt.create(templMat, search.dftSize, method & TM_MODE_MASK) != 0) return -1;
+	int ret = matchTemplateFft(search, tmplt, res);
+	if (ret == 0) res.copyTo(result);
+	return ret;
+}
+
+bool matchTemplateFftPreferred(cv::Size searchSize, cv::Size tmpltSize, int nTmplt,
+	bool tmpltSpectrumCached)
+{
+	double resultArea = (double)(searchSize.width - tmpltSize.width + 1)
+		* (searchSize.height - tmpltSize.height + 1);
+	if (resultArea <= 0 || nTmplt <= 0) return false;
+	double dftArea = (double)cv::getOptimalDFTSize(searchSize.width)
+		* cv::getOptimalDFTSize(searchSize.height);
+	// rough operation counts per template (1 multiply-add as a unit)
+	// direct: each result pixel takes a full template
+	// fft: an inverse DFT, plus forward DFT of template (if not cached),
+	//      plus forward DFT of search image (shared by nTmplt templates),
+	//      where a real DFT takes about 2.5 * N * log2(N) units.
+	double directCost = resultArea * tmpltSize.area();
+	double oneDft = 2.5 * dftArea * std::log2(std::max(dftArea, 2.0));
+	double fftCost = oneDft * (1.0 + (tmpltSpectrumCached ? 0.0 : 1.0) + 1.0 / nTmplt)
+		+ 4.0 * dftArea + 10.0 * resultArea;
+	return fftCost < directCost;
+}
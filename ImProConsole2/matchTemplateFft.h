@@ -0,0 +1,124 @@
+#pragma once
+
+#include <vector>
+#include <list>
+#include <map>
+#include <opencv2/opencv.hpp>
+
+// Extra flags of the method argument of matchTemplateWithRot() and matchTemplateWithRotPyr().
+// They are combined with cv::TemplateMatchModes, e.g., cv::TM_CCORR_NORMED | TM_FFT.
+const int TM_FFT = 0x100;       // correlation is always computed in frequency domain (FFT)
+const int TM_FFT_AUTO = 0x200;  // FFT or cv::matchTemplate() is chosen by template and search sizes
+const int TM_MODE_MASK = 0x0ff; // mask to get the cv::TemplateMatchModes part of method
+
+//! MatchTemplateFftSearch keeps the spectrum and integral images of a search image
+/*!
+\details The spectrum of the search image is computed once and reused by every template
+(e.g., every rotated template) matched against the same search image.
+*/
+class MatchTemplateFftSearch
+{
+public:
+	//! computes spectrum (and integral images) of search image. dftSize <= 0 uses the optimal size of search image.
+	int create(const cv::Mat & search, cv::Size dftSize = cv::Size(0, 0));
+	bool empty() const { return spectra.size() == 0; }
+
+	cv::Size searchSize;             // size of search image
+	cv::Size dftSize;                // size of DFT (>= searchSize)
+	std::vector<cv::Mat> spectra;    // CCS-packed spectrum of each channel, CV_32F
+	std::vector<cv::Mat> sums;       // integral image of each channel, CV_64F
+	std::vector<cv::Mat> sqsums;     // squared integral image of each channel, CV_64F
+};
+
+//! MatchTemplateFftTmplt keeps the spectrum of a template
+/*!
+\details The spectrum depends on the template, the DFT size and the method (zero-mean
+template for TM_CCOEFF and TM_CCOEFF_NORMED). A template spectrum can be reused across
+frames as long as the template and the DFT size do not change.
+*/
+class MatchTemplateFftTmplt
+{
+public:
+	//! computes spectrum of template for a given DFT size and method (cv::TemplateMatchModes)
+	int create(const cv::Mat & tmplt, cv::Size dftSize, int method);
+	//! returns true if this spectrum was created from the same template (content), DFT size and method.
+	bool isFor(const cv::Mat & tmplt, cv::Size dftSize, int method) const;
+	bool empty() const { return spectra.size() == 0; }
+
+	cv::Mat tmplt;                   // copy of template (for identity check)
+	cv::Size dftSize;                // size of DFT
+	int method = -1;                 // cv::TemplateMatchModes
+	std::vector<cv::Mat> spectra;    // CCS-packed spectrum of each channel, CV_32F
+	double sqsum = 0.0;              // sum of squares of (zero-mean if TM_CCOEFF*) template
+	std::vector<double> sums;        // sum of each channel of template (before zero-mean)
+};
+
+//! MatchTemplateFftCache keeps template spectra across calls (e.g., across frames)
+/*!
+\details Templates that are used frame after frame (until the template is updated)
+do not need to be transformed again. A spectrum is keyed by the identity of its source
+template (data pointer, size and step, not its content) and by how the template was made
+from it (rotation, crop and scaled size), so a lookup does not compare any pixels. An entry
+keeps a reference to its source template, so the buffer is not released and reused by
+another template while it is cached. A source template must not be modified in place while
+it is cached (call clear() if it is). A cache must not be shared among threads.
+*/
+class MatchTemplateFftCache
+{
+public:
+	MatchTemplateFftCache(int maxEntries = 256) : maxEntries(maxEntries) {}
+	//! returns the spectrum of tmplt, which is made from srcTmplt by rotation thdeg, crop
+	//! and scaling to scaledSize. The spectrum is created only if it is not in the cache.
+	const MatchTemplateFftTmplt & get(const cv::Mat & srcTmplt, double thdeg, cv::Rect crop,
+		cv::Size scaledSize, const cv::Mat & tmplt, cv::Size dftSize, int method);
+	void clear() { entries.clear(); index.clear(); }
+	int size() const { return (int) entries.size(); }
+
+	int maxEntries;
+	int nHit = 0, nMiss = 0;         // statistics
+protected:
+	struct Key {
+		const uchar * data;          // source template identity
+		int srcRows, srcCols;
+		size_t srcStep;
+		double thdeg;
+		int cropX, cropY, cropW, cropH, scaledW, scaledH, dftW, dftH;
+		bool zeroMean;
+		bool operator<(const Key & k) const;
+	};
+	struct Entry {
+		Key key;
+		cv::Mat src;                 // reference to the source template (keeps its buffer)
+		MatchTemplateFftTmplt spec;
+	};
+	std::list<Entry> entries;        // most recently used first
+	std::map<Key, std::list<Entry>::iterator> index;
+};
+
+//! matchTemplateFft() is a frequency-domain version of cv::matchTemplate()
+/*!
+\details Numerator (cross correlation) is computed by DFT, and the window sums of
+the search image are computed by integral images. All cv::TemplateMatchModes are
+supported. The result is CV_32F sized (W - w + 1) x (H - h + 1), same as cv::matchTemplate().
+\param search spectrum of search image (see MatchTemplateFftSearch)
+\param tmplt spectrum of template (see MatchTemplateFftTmplt) (must have the same DFT size)
+\param result output result
+\return 0:success. -1:invalid arguments.
+*/
+int matchTemplateFft(const MatchTemplateFftSearch & search, const MatchTemplateFftTmplt & tmplt,
+	cv::Mat & result);
+
+//! matchTemplateFft() with an interface the same as cv::matchTemplate()
+int matchTemplateFft(cv::InputArray image, cv::InputArray templ, cv::OutputArray result,
+	int method = cv::TM_CCORR_NORMED);
+
+//! matchTemplateFftPreferred() estimates if FFT is faster than cv::matchTemplate()
+/*!
+\param searchSize size of search image
+\param tmpltSize size of template
+\param nTmplt number of templates matched against the same search image (e.g., number of rotations)
+\param tmpltSpectrumCached true if template spectra do not need to be computed (cached)
+\return true if FFT is estimated to be faster
+*/
+bool matchTemplateFftPreferred(cv::Size searchSize, cv::Size tmpltSize, int nTmplt = 1,
+	bool tmpltSpectrumCached = false);
@@ -37,6 +37,12 @@
 //            replaced resize() with remap() when scaling search image,
 //              so that ranges do not need to be integer before
 //              scaling, making ranges smaller and saving computin time.
+// Modified: 2026-10-17
+//            added frequency-domain correlation (method | TM_FFT, or TM_FFT_AUTO),
+//              the resampled search image is transformed once for all rotations,
+//              and template spectra can be kept in fftCache across frames.
+//            added optional template bank (RotTmpltBank) that keeps rotated and 
+//              scaled templates across frames.
 //
 
 #include "matchTemplateWithRot.h"
@@ -60,7 +66,9 @@ int matchTemplateWithRot(
         double _min_y,   double _max_y,   double _precision_y, 
         double _min_rot, double _max_rot, double _precision_rot, 
         vector<double> &  result, 
-        int      method)
+        int      method,
+        MatchTemplateFftCache * fftCache,
+        RotTmpltBank * bank)
 {
   // Check
   cv::Mat tmpltMat  = tmplt.getMat(); 
@@ -286,6 +294,25 @@ int matchTemplateWithRot(
   cv::remap(searchMat, searchResampled, mapx, mapy, cv::INTER_CUBIC);
   tEnd2 =   getCpusTime(); tResize += tEnd2 - tStart2; 
 
+  // Step 4b:  Decide direct (cv::matchTemplate) or frequency-domain correlation.
+  //           If FFT is used, the search image is transformed once for all rotations.
+  int  tmMode = method & TM_MODE_MASK; 
+  bool useFft = (method & TM_FFT) != 0; 
+  if ((method & TM_FFT_AUTO) != 0) 
+      useFft = matchTemplateFftPreferred(searchResampled.size(), scaledSize, nRot, 
+                                         fftCache != NULL || bank != NULL);
+  MatchTemplateFftSearch searchFft; 
+  if (useFft) {
+      tStart2 = getCpusTime();
+      searchFft.create(searchResampled); 
+      tEnd2   = getCpusTime(); tMatch += tEnd2 - tStart2;
+  }
+
+  // Step 4c:  Select the source template in the template bank (if given)
+  cv::Point2f rotationCenter((float) _ref_x - tx0, (float) _ref_y - ty0); 
+  if (bank != NULL) 
+      bank->select(squareTmplt, rotationCenter); 
+
   // Step 5:  For each rotation
     // run through all rotation angle
   double best_matched_value;
@@ -301,66 +328,73 @@ int matchTemplateWithRot(
     double thdeg;
     thdeg = _min_rot + iRot * dDegree; 
 
-    // Step 6:      generate rotated template (squareTmpltRotated)
-    tStart2 = getCpusTime(); 
-    cv::Point2f rotationCenter((float) _ref_x - tx0, (float) _ref_y - ty0); 
-    cv::Mat r = cv::getRotationMatrix2D(rotationCenter, thdeg, 1.0);
-    cv::warpAffine(squareTmplt, squareTmpltRotated, r, cv::Size(tx1 - tx0, ty1 - ty0),
-                   CV_INTER_CUBIC);
-    tEnd2   = getCpusTime(); tRotate += tEnd2 - tStart2; 
-
-    //{
-    //  // debug
-    //  cv::Mat imgToFind = squareTmpltRotated; 
-    //  cv::Mat tmpltCorner(1, 1, CV_32FC2); 
-    //  tmpltCorner.at<cv::Point2f>(0, 0).x = 100;
-    //  tmpltCorner.at<cv::Point2f>(0, 0).y = 100; 
-    //  cv::Mat tmpltBW; cv::cvtColor(imgToFind, tmpltBW, CV_BGR2GRAY);
-    //  cv::cornerSubPix(tmpltBW, tmpltCorner, cv::Size(10, 10), 
-    //    cv::Size(-1,-1), 
+    // Step 6~8 are skipped if the template bank already has this template
+    cv::Rect cropRect(txr0 - tx0, tyr0 - ty0, txr1 - txr0, tyr1 - tyr0);
+    bool inBank = (bank != NULL && 
+                   bank->find(thdeg, cropRect, scaledSize, squareTmpltRotatedCroppedScaled));
+    if (!inBank) {
+      // Step 6:      generate rotated template (squareTmpltRotated)
+      tStart2 = getCpusTime(); 
+      cv::Mat r = cv::getRotationMatrix2D(rotationCenter, thdeg, 1.0);
+      cv::warpAffine(squareTmplt, squareTmpltRotated, r, cv::Size(tx1 - tx0, ty1 - ty0),
+                     CV_INTER_CUBIC);
+      tEnd2   = getCpusTime(); tRotate += tEnd2 - tStart2; 
+
+      //{
+      //  // debug
+      //  cv::Mat imgToFind = squareTmpltRotated; 
+      //  cv::Mat tmpltCorner(1, 1, CV_32FC2); 
+      //  tmpltCorner.at<cv::Point2f>(0, 0).x = 100;
+      //  tmpltCorner.at<cv::Point2f>(0, 0).y = 100; 
+      //  cv::Mat tmpltBW; cv::cvtColor(imgToFind, tmpltBW, CV_BGR2GRAY);
+      //  cv::cornerSubPix(tmpltBW, tmpltCorner, cv::Size(10, 10), 
+      //    cv::Size(-1,-1), 
 	//    cv::TermCriteria(CV_TERMCRIT_EPS + CV_TERMCRIT_ITER, 100, 0.01));
-    //  double cx = tmpltCorner.at<cv::Point2f>(0, 0).x; 
-    //  double cy = tmpltCorner.at<cv::Point2f>(0, 0).y; 
-
-    //  double s = 5.5555555555556; 
-    //  cv::Mat sImg; 
-    //  cv::resize(imgToFind, sImg, cv::Size(0,0), s, s); 
-    //  cx = tmpltCorner.at<cv::Point2f>(0, 0).x = (cx + 0.5) * s - 0.5;
-    //  cy = tmpltCorner.at<cv::Point2f>(0, 0).y = (cy + 0.5) * s - 0.5; 
-    //  tmpltBW; cv::cvtColor(sImg, tmpltBW, CV_BGR2GRAY);
-    //  cv::cornerSubPix(tmpltBW, tmpltCorner, cv::Size(10, 10), 
-    //    cv::Size(-1,-1), 
+      //  double cx = tmpltCorner.at<cv::Point2f>(0, 0).x; 
+      //  double cy = tmpltCorner.at<cv::Point2f>(0, 0).y; 
+
+      //  double s = 5.5555555555556; 
+      //  cv::Mat sImg; 
+      //  cv::resize(imgToFind, sImg, cv::Size(0,0), s, s); 
+      //  cx = tmpltCorner.at<cv::Point2f>(0, 0).x = (cx + 0.5) * s - 0.5;
+      //  cy = tmpltCorner.at<cv::Point2f>(0, 0).y = (cy + 0.5) * s - 0.5; 
+      //  tmpltBW; cv::cvtColor(sImg, tmpltBW, CV_BGR2GRAY);
+      //  cv::cornerSubPix(tmpltBW, tmpltCorner, cv::Size(10, 10), 
+      //    cv::Size(-1,-1), 
 	//    cv::TermCriteria(CV_TERMCRIT_EPS + CV_TERMCRIT_ITER, 100, 0.01));
-    //  cx = tmpltCorner.at<cv::Point2f>(0, 0).x; 
-    //  cy = tmpltCorner.at<cv::Point2f>(0, 0).y; 
-    //}
+      //  cx = tmpltCorner.at<cv::Point2f>(0, 0).x; 
+      //  cy = tmpltCorner.at<cv::Point2f>(0, 0).y; 
+      //}
 
-    // Step 7:      crop rotated template  (squareTmpltRotatedCropped)
-    squareTmpltRotatedCropped = squareTmpltRotated(cv::Rect(txr0 - tx0, tyr0 - ty0, 
+      // Step 7:      crop rotated template  (squareTmpltRotatedCropped)
+      squareTmpltRotatedCropped = squareTmpltRotated(cv::Rect(txr0 - tx0, tyr0 - ty0, 
 	                                                        txr1 - txr0, tyr1 - tyr0)); 
-  //cv::imshow("squareTmplt", squareTmplt); cv::waitKey(); 
-  //cv::imshow("squareTmpltRotated", squareTmpltRotated); cv::waitKey(); 
-  //cv::imshow("squareTmpltRotatedCropped", squareTmpltRotatedCropped); cv::waitKey(); 
-
-    //{
-    //  // debug
-    //  cv::Mat imgToFind = squareTmpltRotatedCropped; 
-    //  cv::Mat tmpltCorner(1, 1, CV_32FC2); 
-    //  tmpltCorner.at<cv::Point2f>(0, 0).x = 90;
-    //  tmpltCorner.at<cv::Point2f>(0, 0).y = 90; 
-    //  cv::Mat tmpltBW; cv::cvtColor(imgToFind, tmpltBW, CV_BGR2GRAY);
-    //  cv::cornerSubPix(tmpltBW, tmpltCorner, cv::Size(10, 10), 
-    //    cv::Size(-1,-1), 
+    //cv::imshow("squareTmplt", squareTmplt); cv::waitKey(); 
+    //cv::imshow("squareTmpltRotated", squareTmpltRotated); cv::waitKey(); 
+    //cv::imshow("squareTmpltRotatedCropped", squareTmpltRotatedCropped); cv::waitKey(); 
+
+      //{
+      //  // debug
+      //  cv::Mat imgToFind = squareTmpltRotatedCropped; 
+      //  cv::Mat tmpltCorner(1, 1, CV_32FC2); 
+      //  tmpltCorner.at<cv::Point2f>(0, 0).x = 90;
+      //  tmpltCorner.at<cv::Point2f>(0, 0).y = 90; 
+      //  cv::Mat tmpltBW; cv::cvtColor(imgToFind, tmpltBW, CV_BGR2GRAY);
+      //  cv::cornerSubPix(tmpltBW, tmpltCorner, cv::Size(10, 10), 
+      //    cv::Size(-1,-1), 
 	//    cv::TermCriteria(CV_TERMCRIT_EPS + CV_TERMCRIT_ITER, 100, 0.01));
-    //  double cx = tmpltCorner.at<cv::Point2f>(0, 0).x; 
-    //  double cy = tmpltCorner.at<cv::Point2f>(0, 0).y; 
-    //}
-
-    // Step 8:      scale squareTmpltRotatedCropped to a smaller size for speed
-    tStart2 = getCpusTime(); 
-    cv::resize(squareTmpltRotatedCropped, squareTmpltRotatedCroppedScaled,
-               scaledSize, 0, 0, cv::INTER_LANCZOS4);
-    tEnd2 =   getCpusTime(); tResize += tEnd2 - tStart2; 
+      //  double cx = tmpltCorner.at<cv::Point2f>(0, 0).x; 
+      //  double cy = tmpltCorner.at<cv::Point2f>(0, 0).y; 
+      //}
+
+      // Step 8:      scale squareTmpltRotatedCropped to a smaller size for speed
+      tStart2 = getCpusTime(); 
+      cv::resize(squareTmpltRotatedCropped, squareTmpltRotatedCroppedScaled,
+                 scaledSize, 0, 0, cv::INTER_LANCZOS4);
+      tEnd2 =   getCpusTime(); tResize += tEnd2 - tStart2; 
+      if (bank != NULL)
+        bank->store(thdeg, cropRect, scaledSize, squareTmpltRotatedCroppedScaled);
+    }
 
     //{
     //  // debug
@@ -410,8 +444,25 @@ int matchTemplateWithRot(
     tStart2 = getCpusTime();
 //    cv::imshow("searchResampled", searchResampled); cv::waitKey(-1);
 //    cv::imshow("template", squareTmpltRotatedCroppedScaled); cv::waitKey(-1);
-    cv::matchTemplate(searchResampled, squareTmpltRotatedCroppedScaled, 
-	                  matchResult, method);
+    if (useFft) {
+      if (bank != NULL) {
+        matchTemplateFft(searchFft, 
+                         bank->spectrum(thdeg, cropRect, scaledSize, searchFft.dftSize, tmMode), 
+                         matchResult); 
+      } else if (fftCache != NULL) {
+        matchTemplateFft(searchFft, 
+                         fftCache->get(squareTmplt, thdeg, cropRect, scaledSize, 
+                                       squareTmpltRotatedCroppedScaled, searchFft.dftSize, tmMode), 
+                         matchResult); 
+      } else {
+        MatchTemplateFftTmplt tmpltFft; 
+        tmpltFft.create(squareTmpltRotatedCroppedScaled, searchFft.dftSize, tmMode); 
+        matchTemplateFft(searchFft, tmpltFft, matchResult); 
+      }
+    } else {
+      cv::matchTemplate(searchResampled, squareTmpltRotatedCroppedScaled, 
+	                  matchResult, tmMode);
+    }
     //cv::imshow("searchScaled", searchScaled); 
     //cv::imshow("squareTmpltRotatedCroppedScaled", squareTmpltRotatedCroppedScaled); 
     //cv::imshow("matchResult", matchResult); cv::waitKey(); 
@@ -33,7 +33,9 @@
 //                                    double min_y,    double max_y, 
 //                                    double min_rot,  double max_rot, 
 //                                    vector<double> &  dispAndRot, 
-//                                    int method = CV_TM_CCORR_NORMED); 
+//                                    int method = CV_TM_CCORR_NORMED,
+//                                    MatchTemplateFftCache * fftCache = NULL,
+//                                    RotTmpltBank * bank = NULL); 
 // 
 // Description: 
 //   matchTemplateWithRot() runs template match considering ux, uy, and rotation.
@@ -70,6 +72,23 @@
 //       result[6]:  cpu time on image rotating (cv::getRotationMatrix2D and cv::warpAffine)
 //       result[7]:  cpu time on template match (cv::matchTemplate)
 //   
+//   int                     method
+//     cv::TemplateMatchModes, optionally combined with TM_FFT (always 
+//     correlates in frequency domain) or TM_FFT_AUTO (chooses FFT or 
+//     cv::matchTemplate by template and search sizes). See matchTemplateFft.h.
+//
+//   MatchTemplateFftCache * fftCache
+//     optional cache of template spectra (FFT only). If the same cache is 
+//     given frame after frame with the same template (buffer), template 
+//     spectra are reused. A new template buffer gets new spectra. Templates
+//     must not be modified in place while cached. NULL for no cache. 
+//
+//   RotTmpltBank          * bank
+//     optional template bank of this template (see RotTmpltBank.h). If the
+//     same bank is given frame after frame, rotated and scaled templates 
+//     (and spectra if FFT is used) are built once until the template changes.
+//     NULL for no bank. 
+//
 //   int                     return value
 //      0: done successfully
 //     -1: unsuccessfully
@@ -83,6 +102,8 @@
 //        2015-04-28  Re-compiled in Linux/Qt/OpenCV 3.0 beta
 //                    Minor modifications for OpenCV 3.0 compability , e.g.,
 //                    included some header files (e.g., types_c.h)  for deprecated (?) flags
+//        2026-10-17  added frequency-domain (FFT) correlation (method | TM_FFT or TM_FFT_AUTO)
+//                    added optional template bank (RotTmpltBank)
 
 #ifndef _matchTemplateWithRot_
 #define _matchTemplateWithRot_
@@ -93,6 +114,9 @@
 
 #include "opencv2/imgproc/imgproc_c.h"
 
+#include "matchTemplateFft.h"
+#include "RotTmpltBank.h"
+
 using namespace cv; 
 using namespace std; 
 
@@ -102,6 +126,8 @@ int matchTemplateWithRot(InputArray image, InputArray templ,
                                    double min_y,   double max_y,   double precision_y, 
                                    double min_rot, double max_rot, double precision_rot, 
                                    vector<double> &  result, 
-                                   int method = CV_TM_CCORR_NORMED); 
+                                   int method = CV_TM_CCORR_NORMED,
+                                   MatchTemplateFftCache * fftCache = NULL,
+                                   RotTmpltBank * bank = NULL); 
 
 #endif 
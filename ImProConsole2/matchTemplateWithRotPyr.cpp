@@ -34,8 +34,98 @@
 #include "opencv2/core/core.hpp"
 #include "opencv2/imgproc/imgproc.hpp"
 
+#include <cmath>
+
 #include "matchTemplateWithRot.h"
 #include "matchTemplateWithRotPyr.h"
+#include "impro_util.h"
+
+// match value of template at (x, y) with rotation rot (in degrees), evaluated by 
+// sampling the search image with the inverse rigid transform (so that any 
+// non-integer x, y and rotation can be evaluated). Larger value is better match. 
+static double matchValueAt(const cv::Mat & search, const cv::Mat & tmplt, 
+                           double ref_x, double ref_y, 
+                           double x, double y, double rot, int tmMode)
+{
+  cv::Mat a = cv::getRotationMatrix2D(cv::Point2f((float) ref_x, (float) ref_y), rot, 1.0);
+  a.at<double>(0, 2) += x - ref_x; 
+  a.at<double>(1, 2) += y - ref_y; 
+  cv::Mat patch, r; 
+  cv::warpAffine(search, patch, a, tmplt.size(), 
+                 cv::INTER_CUBIC | cv::WARP_INVERSE_MAP, cv::BORDER_REPLICATE); 
+  cv::matchTemplate(patch, tmplt, r, tmMode); 
+  double v = r.at<float>(0, 0); 
+  if (tmMode == cv::TM_SQDIFF || tmMode == cv::TM_SQDIFF_NORMED)
+    v = -v; 
+  return v; 
+}
+
+// fits a quadratic surface to 3^k samples around (x0[0], x0[1], x0[2]) with steps 
+// h[0], h[1], h[2] (only dimensions dims[] are fitted, k = dims.size()), and 
+// finds its peak. 
+// If gaussian is true, the surface is fitted to the logarithm of match values. 
+// Returns 0 and the peak (xPeak, vPeak) and the RMS residual if the fitted surface 
+// has a maximum within one step. Otherwise returns -1. 
+static int fitPeak(const cv::Mat & search, const cv::Mat & tmplt, 
+                   double ref_x, double ref_y, int tmMode, bool gaussian, 
+                   const double x0[3], const double h[3], const vector<int> & dims,
+                   double xPeak[3], double & vPeak, double & residual)
+{
+  int k = (int) dims.size(); 
+  if (k <= 0) return -1; 
+  int nSample = 1; 
+  for (int i = 0; i < k; i++) nSample *= 3; 
+  int nTerm = 1 + k + k * (k + 1) / 2;  // 1, linear terms, quadratic terms
+  cv::Mat A(nSample, nTerm, CV_64F), b(nSample, 1, CV_64F), coef; 
+  vector<int> nOptions(k, 3), comp(k); 
+  for (int iSample = 0; iSample < nSample; iSample++) {
+    compositionOfIndex(nOptions, iSample, comp); 
+    double x[3] = { x0[0], x0[1], x0[2] }, u[3] = { 0, 0, 0 }; 
+    for (int i = 0; i < k; i++) {
+      u[i] = comp[i] - 1.0;   // -1, 0, 1 (in steps)
+      x[dims[i]] += u[i] * h[dims[i]]; 
+    }
+    double v = matchValueAt(search, tmplt, ref_x, ref_y, x[0], x[1], x[2], tmMode); 
+    if (gaussian) v = std::log(std::max(v, 1e-6)); 
+    b.at<double>(iSample, 0) = v; 
+    int iTerm = 0; 
+    A.at<double>(iSample, iTerm++) = 1.0; 
+    for (int i = 0; i < k; i++) 
+      A.at<double>(iSample, iTerm++) = u[i]; 
+    for (int i = 0; i < k; i++) 
+      for (int j = i; j < k; j++) 
+        A.at<double>(iSample, iTerm++) = u[i] * u[j]; 
+  }
+  if (!cv::solve(A, b, coef, cv::DECOMP_SVD)) return -1; 
+  cv::Mat res = A * coef - b; 
+  residual = std::sqrt(res.dot(res) / nSample); 
+
+  // peak: H * u = -g, where H is the hessian and g is the gradient at u = 0
+  cv::Mat H(k, k, CV_64F), g(k, 1, CV_64F), u; 
+  int iTerm = 1 + k; 
+  for (int i = 0; i < k; i++) {
+    g.at<double>(i, 0) = coef.at<double>(1 + i, 0); 
+    for (int j = i; j < k; j++) {
+      double c = coef.at<double>(iTerm++, 0); 
+      H.at<double>(i, j) = H.at<double>(j, i) = (i == j) ? 2.0 * c : c; 
+    }
+  }
+  cv::Mat eigenvalues; 
+  cv::eigen(H, eigenvalues); 
+  for (int i = 0; i < k; i++) 
+    if (eigenvalues.at<double>(i, 0) >= 0.0) return -1;  // not a maximum
+  if (!cv::solve(H, -g, u, cv::DECOMP_LU)) return -1; 
+  xPeak[0] = x0[0]; xPeak[1] = x0[1]; xPeak[2] = x0[2]; 
+  for (int i = 0; i < k; i++) {
+    double ui = u.at<double>(i, 0); 
+    if (std::fabs(ui) > 1.0) return -1;   // peak is beyond the sampled steps
+    xPeak[dims[i]] += ui * h[dims[i]]; 
+  }
+  vPeak = coef.at<double>(0, 0) + 0.5 * g.dot(u); 
+  if (gaussian) vPeak = std::exp(vPeak); 
+  if (tmMode == cv::TM_SQDIFF || tmMode == cv::TM_SQDIFF_NORMED) vPeak = -vPeak; 
+  return 0; 
+}
 
 int matchTemplateWithRotPyr(
        InputArray _image, InputArray _tmplt, 
@@ -45,7 +135,9 @@ int matchTemplateWithRotPyr(
        double _min_rot, double _max_rot, double _precision_rot, 
        vector<double> &  result, 
        int method, 
-       double _init_prec_x, double _init_prec_y, double _init_prec_rot)
+       double _init_prec_x, double _init_prec_y, double _init_prec_rot,
+       MatchTemplateFftCache * fftCache,
+       RotTmpltBank * bank)
 {
   cv::Mat search = _image.getMat(); 
   cv::Mat tmplt  = _tmplt.getMat(); 
@@ -57,6 +149,11 @@ int matchTemplateWithRotPyr(
       search.rows <= 0 || search.cols <= 0)
     return -1;
 
+  // sub-pixel fit mode
+  int  fitFlags = method & (TM_SUBPIX_QUADRATIC | TM_SUBPIX_GAUSSIAN); 
+  bool fitMode  = fitFlags != 0; 
+  method &= ~(TM_SUBPIX_QUADRATIC | TM_SUBPIX_GAUSSIAN); 
+
   // Check data
   //   Check search size, tmplt size
   //   Check parameter values
@@ -101,6 +198,18 @@ int matchTemplateWithRotPyr(
 //  printf("Pyramid initial prec_x/prec_y/prec_rot: %9.2f %9.2f %9.2f\n", 
 //                  this_prec_x, this_prec_y, this_prec_rot); 
 
+  // In sub-pixel fit mode, the pyramid stops at integer-pixel and coarse rotation 
+  // precision, and the peak fit does the rest. 
+  double fit_prec_x   = max(precision_x, 1.0); 
+  double fit_prec_y   = max(precision_y, 1.0); 
+  double fit_prec_rot = 4.0 * precision_rot; 
+  vector<int> fitDims; // dimensions to fit (0:x, 1:y, 2:rotation)
+  if (max_x   > min_x  ) fitDims.push_back(0); 
+  if (max_y   > min_y  ) fitDims.push_back(1); 
+  if (max_rot > min_rot) fitDims.push_back(2); 
+  if (fitMode && fitDims.size() == 0) fitMode = false; 
+  double fitResidual = -1.0, fitUsed = 0.0; 
+
   // timing data for accumulation
   double timing[] = {0, 0, 0, 0}; 
   while (true) {
@@ -113,7 +222,7 @@ int matchTemplateWithRotPyr(
                                    min_x,   max_x,   this_prec_x, 
                                    min_y,   max_y,   this_prec_y,
                                    min_rot, max_rot, this_prec_rot, 
-                                   result, CV_TM_CCORR_NORMED); 
+                                   result, method, fftCache, bank); 
     // accumulating timing data.
     timing[0] += result[4]; 
     timing[1] += result[5]; 
@@ -133,6 +242,31 @@ int matchTemplateWithRotPyr(
     min_rot = max(min_rot, result[2] - 2.0 * this_prec_rot); 
     max_rot = min(max_rot, result[2] + 2.0 * this_prec_rot); 
     max_rot = max(min_rot, max_rot); 
+    if (fitMode && this_prec_x <= fit_prec_x && this_prec_y <= fit_prec_y 
+     && this_prec_rot <= fit_prec_rot) {
+      // fit a surface around the peak 
+      double tFit = getCpusTime(); 
+      double x0[3] = { result[0], result[1], result[2] }; 
+      double h[3]  = { this_prec_x, this_prec_y, this_prec_rot }; 
+      double xPeak[3], vPeak, residual; 
+      int fitRet = fitPeak(search, tmplt, ref_x, ref_y, method & TM_MODE_MASK, 
+                           (fitFlags & TM_SUBPIX_GAUSSIAN) != 0, 
+                           x0, h, fitDims, xPeak, vPeak, residual); 
+      tFit = getCpusTime() - tFit; 
+      timing[0] += tFit; 
+      timing[3] += tFit; 
+      if (fitRet == 0) {
+        result[0] = xPeak[0]; 
+        result[1] = xPeak[1]; 
+        result[2] = xPeak[2]; 
+        result[3] = vPeak; 
+        fitResidual = residual; 
+        fitUsed = 1.0; 
+        break; 
+      }
+      // the fit failed. Continue the pyramid as usual. 
+      fitMode = false; 
+    }
     if (this_prec_x <= precision_x && this_prec_y <= precision_y 
 	 && this_prec_rot <= precision_rot )
       break;
@@ -145,5 +279,10 @@ int matchTemplateWithRotPyr(
   result[5] = timing[1]; 
   result[6] = timing[2]; 
   result[7] = timing[3]; 
+  if (fitFlags != 0) {
+    result.resize(10); 
+    result[8] = fitResidual; 
+    result[9] = fitUsed; 
+  }
   return 0; 
 }
@@ -70,7 +70,29 @@
 //       result[5]:  cpu time on image resizing (cv::resize)
 //       result[6]:  cpu time on image rotating (cv::getRotationMatrix2D and cv::warpAffine)
 //       result[7]:  cpu time on template match (cv::matchTemplate)
+//       result[8]:  (sub-pixel fit mode only) RMS residual of the peak fit 
+//                   (smaller is more confident), or -1 if the fit failed
+//       result[9]:  (sub-pixel fit mode only) 1 if the result is from the peak fit, 
+//                   0 if the fit failed and the pyramid was run to the end instead 
 //   
+//   int                     method
+//     cv::TemplateMatchModes, optionally combined with TM_FFT or TM_FFT_AUTO
+//     (see matchTemplateWithRot.h), and optionally combined with 
+//     TM_SUBPIX_QUADRATIC or TM_SUBPIX_GAUSSIAN (sub-pixel fit mode). 
+//     In sub-pixel fit mode, the pyramid stops at integer-pixel (and coarse 
+//     rotation, 4 times of precision_rot) precision, and a quadratic surface 
+//     (of the match values, or of their logarithm for a Gaussian peak) is fitted 
+//     to 3 x 3 (x 3) samples around the peak to get sub-pixel x, y (and rotation). 
+//     If the fitted surface has no peak within one step, the pyramid continues 
+//     as usual. 
+//
+//   MatchTemplateFftCache * fftCache
+//     optional cache of template spectra (see matchTemplateWithRot.h)
+//
+//   RotTmpltBank          * bank
+//     optional template bank (see matchTemplateWithRot.h). All pyramid levels
+//     of a template are kept in the same bank. 
+//
 //   int                     return value
 //      0: done successfully
 //     -1: unsuccessfully
@@ -85,6 +107,10 @@
 //        2014-05-20  bug fixed: BUG: min_x   = max(min_x,   result[0] - 1.0 * precision_x); 
 //                               FIX: min_x   = max(min_x,   result[0] - 1.0 * this_prec_x);  
 //                               and so on.
+//        2026-10-17  method (and fftCache) is passed to matchTemplateWithRot() 
+//                    (was always CV_TM_CCORR_NORMED)
+//                    added optional template bank (RotTmpltBank)
+//                    added sub-pixel fit mode (TM_SUBPIX_QUADRATIC, TM_SUBPIX_GAUSSIAN)
 //
 
 #ifndef _matchTemplateWithRotPyr_
@@ -94,9 +120,17 @@
 #include "opencv2/imgproc/imgproc.hpp"
 #include <vector>
 
+#include "matchTemplateFft.h"
+#include "RotTmpltBank.h"
+
 using namespace cv; 
 using namespace std; 
 
+// Extra flags of the method argument of matchTemplateWithRotPyr() (sub-pixel fit mode). 
+// They are combined with cv::TemplateMatchModes, e.g., cv::TM_CCORR_NORMED | TM_SUBPIX_QUADRATIC.
+const int TM_SUBPIX_QUADRATIC = 0x400; // fits a quadratic surface around the correlation peak
+const int TM_SUBPIX_GAUSSIAN  = 0x800; // fits a Gaussian surface (quadratic on logarithm) around the peak
+
 int matchTemplateWithRotPyr(InputArray _image, InputArray _tmplt, 
                                    double ref_x,   double ref_y, 
                                    double min_x,   double max_x,   double precision_x, 
@@ -104,6 +138,8 @@ int matchTemplateWithRotPyr(InputArray _image, InputArray _tmplt,
                                    double min_rot, double max_rot, double precision_rot, 
                                    vector<double> &  result, 
                                    int method = cv::TM_CCORR_NORMED,
-                                   double _init_prec_x = -1, double _init_prec_y = -1, double _init_prec_rot = -1); 
+                                   double _init_prec_x = -1, double _init_prec_y = -1, double _init_prec_rot = -1,
+                                   MatchTemplateFftCache * fftCache = NULL,
+                                   RotTmpltBank * bank = NULL); 
 
 #endif 
@@ -1,6 +1,9 @@
 #include "trackings.h"
 #include <vector>
 #include <opencv2/opencv.hpp>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "matchTemplateWithRotPyr.h"
 #include "impro_util.h"
 #include "improDraw.h"
@@ -30,12 +33,13 @@ int calcTMatchRotPyr(
 	std::vector<float> prcr,        // demand precision of rotation. Caution: smaller prcr leads to much longer computing time. Normally prcr hould be >= 1.
 	vector<float> & rot_deg,        // rotaion of each point (in degrees). (Input: initial guess) 
 	int method,
-	double _init_prec_x, double _init_prec_y, double _init_prec_rot)
+	double _init_prec_x, double _init_prec_y, double _init_prec_rot,
+	int nThreads,
+	vector<RotTmpltBank> * banks)
 {
 	bool debug = false; 
 	// Variables
 	int n; // Number of tracking points
-	int ret; // return value
 	cv::Mat prevPtsMat, nextPtsMat; 
 	// check arguments
 	if (prevImg.getMat().cols <= 0 || prevImg.getMat().rows <= 0) 
@@ -84,26 +88,53 @@ int calcTMatchRotPyr(
 	if (debug) cout << "prevPts:\n" << prevPts.getMat() << endl;
 	if (debug) cout << "prevPtsMat:\n" << prevPtsMat << endl;
 
+	// number of threads
+	// (without OpenMP the loop below is always serial)
+#ifdef _OPENMP
+	if (nThreads <= 0) nThreads = omp_get_max_threads();
+#else
+	nThreads = 1;
+#endif
+	if (nThreads > n) nThreads = n;
+	if (nThreads < 1) nThreads = 1;
+
+	// per-thread scratch buffers (template and match result), reused point by point
+	cv::Mat prevImgMat = prevImg.getMat();
+	cv::Mat nextImgMat = nextImg.getMat();
+	vector<cv::Mat> imgTmpltBuf(nThreads);
+	vector<vector<double>> resultBuf(nThreads, vector<double>(10, 0.0));
+	if (banks != NULL && banks->size() < (size_t) n)
+		banks->resize(n);
+
 	// run tracking
+	// Each point only reads the images and writes its own rows of nextPtsMat and rot_deg,
+	// so the result does not depend on the number of threads or the scheduling. 
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nThreads) if (nThreads > 1)
 	for (int iPoint = 0; iPoint < n; iPoint++)
 	{
+#ifdef _OPENMP
+		int iThread = omp_get_thread_num();
+#else
+		int iThread = 0;
+#endif
 		// define template
 		cv::Point2f refPoint;
 		refPoint.x = ptsWinRatios[iPoint].x * (winSize[iPoint].width - 1);
 		refPoint.y = ptsWinRatios[iPoint].y * (winSize[iPoint].height - 1);
 		cv::Rect rect = getTmpltRectFromImageSizeWithPreferredRef(
-			prevImg.getMat().size(),
+			prevImgMat.size(),
 			prevPtsMat.at<cv::Point2f>(iPoint, 0),
 			winSize[iPoint],
 			refPoint);
-		cv::Mat imgTmplt;
-		prevImg.getMat()(rect).copyTo(imgTmplt);
+		cv::Mat & imgTmplt = imgTmpltBuf[iThread];
+		prevImgMat(rect).copyTo(imgTmplt);
 		// run template match
-		vector<double> result(10, 0.0);
-		if (debug) cout << nextPtsMat.at<cv::Point2f>(iPoint, 0).x << endl;
-		if (debug) cout << nextPtsMat.at<cv::Point2f>(iPoint, 0).y << endl;
-		ret = matchTemplateWithRotPyr(
-			nextImg,
+		vector<double> & result = resultBuf[iThread];
+		std::fill(result.begin(), result.end(), 0.0);
+		if (debug && nThreads == 1) cout << nextPtsMat.at<cv::Point2f>(iPoint, 0).x << endl;
+		if (debug && nThreads == 1) cout << nextPtsMat.at<cv::Point2f>(iPoint, 0).y << endl;
+		matchTemplateWithRotPyr(
+			nextImgMat,
 			imgTmplt,
 			refPoint.x,
 			refPoint.y,
@@ -117,7 +148,8 @@ int calcTMatchRotPyr(
 			rot_deg[iPoint] - search_r[iPoint] / 2,
 			prcr[iPoint],
 			result,
-			method, _init_prec_x, _init_prec_y, _init_prec_rot
+			method, _init_prec_x, _init_prec_y, _init_prec_rot,
+			NULL, banks != NULL ? &(*banks)[iPoint] : NULL
 		);
 		nextPtsMat.at<cv::Point2f>(iPoint, 0).x = (float) result[0];
 		nextPtsMat.at<cv::Point2f>(iPoint, 0).y = (float) result[1];
@@ -125,12 +157,12 @@ int calcTMatchRotPyr(
 	}
 
 	if (debug) {
-		cv::Mat prevImgMat = prevImg.getMat().clone();
-		cv::Mat nextImgMat = nextImg.getMat().clone();
-		drawPointsOnImage(prevImgMat, prevPtsMat, "square", 16, 4, cv::Scalar(255)); 
-		drawPointsOnImage(nextImgMat, nextPtsMat, "square", 16, 4, cv::Scalar(255));
-		imshow_resize("Prev", prevImgMat, 0.5); 
-		imshow_resize("Curr", nextImgMat, 0.5);
+		cv::Mat prevImgDraw = prevImgMat.clone();
+		cv::Mat nextImgDraw = nextImgMat.clone();
+		drawPointsOnImage(prevImgDraw, prevPtsMat, "square", 16, 4, cv::Scalar(255)); 
+		drawPointsOnImage(nextImgDraw, nextPtsMat, "square", 16, 4, cv::Scalar(255));
+		imshow_resize("Prev", prevImgDraw, 0.5); 
+		imshow_resize("Curr", nextImgDraw, 0.5);
 //		cv::waitKey(0); 
 	}
 
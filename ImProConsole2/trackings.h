@@ -1,12 +1,19 @@
 #pragma once
 #include <vector>
 #include <opencv2/opencv.hpp>
+#include "RotTmpltBank.h"
 using namespace std; 
 
 //! calcTMatchRotPyr() allows user to use pyramid template match with 
 // optional rotation tracking (which calls matchTemplateWithRotPyr()) 
 // through an interface similar to calcOpticalFlowLKPyr()
 /*!
+\details Points are independent of each other. If nThreads is not 1, points are 
+dynamically distributed to OpenMP threads (an idle thread takes the next untracked point) 
+and each thread reuses its own template and result buffers. The result is identical 
+to the serial one. 
+If banks is given and kept by the caller between frames, rotated and scaled templates 
+of each point are built once until its template changes (e.g., template updated). 
 */
 int calcTMatchRotPyr(
 	cv::InputArray prevImg,			// previous image (i.e., image containing templates)
@@ -25,7 +32,9 @@ int calcTMatchRotPyr(
 	std::vector<float> prcr,                    // demand precision of rotation. Caution: smaller prcr leads to much longer computing time. Normally prcr hould be >= 1.
 	vector<float> & rot_deg,                    // rotaion of each point (in degrees). (Input: initial guess) 
 	int method = cv::TM_CCORR_NORMED,
-	double _init_prec_x = -1, double _init_prec_y = -1, double _init_prec_rot = -1);
+	double _init_prec_x = -1, double _init_prec_y = -1, double _init_prec_rot = -1,
+	int nThreads = 1,                           // number of threads tracking points in parallel. 1: serial (default). 0 or negative: all available cores.
+	vector<RotTmpltBank> * banks = NULL);       // template banks of points kept by caller between frames (resized to number of points). NULL for not using banks.
 
 //! calcEcc() allows user to use enhanced correlation coefficient method with 
 // different motion types